@@ -4,14 +4,14 @@ import sys
 if __name__ == "__main__":
     input_file = sys.argv[1]
     output_file = sys.argv[2]
-    with open(output_file, 'wb') as outfile:
+    with open(output_file, 'w') as outfile:
         outfile.write("// Include this file to import the usage info as a string.\n\n")
 
         outfile.write("#ifndef  GENERATED_SOURCE_CIPHER_USAGE_HPP_\n")
         outfile.write("#define  GENERATED_SOURCE_CIPHER_USAGE_HPP_\n\n")
 
         outfile.write("static const char usage_str[] = \"\\\n")
-        for line in open(input_file, 'rb'):
+        for line in open(input_file, 'r'):
             outfile.write(line.rstrip())
             outfile.write("\\n\\\n")
         outfile.write("\";\n\n")
@@ -27,14 +27,374 @@ Description:
 
 
 /* ===== Includes ===== */
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include "cipher_result.hpp"
+#include "cipher_simd.hpp"
+#include "cipher_thread_pool.hpp"
 #include "vigenere_cipher.hpp"
 
 
 namespace cipher {
 
+    /* ===== Classes ===== */
+
+    /**
+     * A precompiled Caesar cipherkey
+     * Like VigenereKey, but the single-letter key period buffers are stored
+     * inline so that compiling a key does not allocate either.
+     */
+    class CaesarKey
+    {
+    public:
+        /**
+         * Compile a cipherkey
+         * @param[in]   cipherkey - The key letter, upper-case alphabet character (A-Z)
+         * @throw   If cipherkey is not an alpha character
+         */
+        explicit CaesarKey(const char cipherkey)
+        {
+            if (!IsUpperAlpha(cipherkey))
+            {
+                throw NonAlphaError(cipherkey, "cipherkey");
+            }
+            const uint8_t offset = static_cast<uint8_t>(cipherkey - 'A');
+            std::fill(std::begin(encrypt_), std::end(encrypt_), offset);
+            std::fill(std::begin(decrypt_), std::end(decrypt_), static_cast<uint8_t>((26 - offset) % 26));
+            std::fill(std::begin(byte_decrypt_), std::end(byte_decrypt_), static_cast<uint8_t>(256 - offset));
+        }
+
+        /** Length of the key, always one letter */
+        size_t Period() const
+        {
+            return 1;
+        }
+
+        /** Key period buffer for encryption */
+        const uint8_t* EncryptPeriod() const
+        {
+            return encrypt_;
+        }
+
+        /** Key period buffer for decryption */
+        const uint8_t* DecryptPeriod() const
+        {
+            return decrypt_;
+        }
+
+        /** Key period buffer for decrypting binary data; EncryptPeriod encrypts it */
+        const uint8_t* ByteDecryptPeriod() const
+        {
+            return byte_decrypt_;
+        }
+
+    private:
+        alignas(simd::MAX_VECTOR_WIDTH) uint8_t encrypt_[1 + simd::MAX_VECTOR_WIDTH];
+        alignas(simd::MAX_VECTOR_WIDTH) uint8_t decrypt_[1 + simd::MAX_VECTOR_WIDTH];
+        alignas(simd::MAX_VECTOR_WIDTH) uint8_t byte_decrypt_[1 + simd::MAX_VECTOR_WIDTH];
+    };
+
+
     /* ===== Functions ===== */
 
+    /**
+     * Encrypt the given plaintext using a precompiled Caesar cipherkey, without throwing
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptCaesarAlpha(const CaesarKey& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        return TryShiftVigenereAlpha(cipherkey.EncryptPeriod(), cipherkey.Period(), plaintext, ciphertext);
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Caesar cipherkey, without throwing
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptCaesarAlpha(const CaesarKey& cipherkey, const std::string& ciphertext, std::string& plaintext)
+    {
+        return TryShiftVigenereAlpha(cipherkey.DecryptPeriod(), cipherkey.Period(), ciphertext, plaintext);
+    }
+
+    /**
+     * Encrypt a buffer using a precompiled Caesar cipherkey, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, length bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     * @param[in]   length - Length of plaintext
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptCaesarAlpha(const CaesarKey& cipherkey, const char* plaintext, char* ciphertext, const size_t length)
+    {
+        return TryShiftVigenereAlphaAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0, plaintext, ciphertext, length);
+    }
+
+    /**
+     * Encrypt a string view using a precompiled Caesar cipherkey, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptCaesarAlpha(const CaesarKey& cipherkey, const std::string_view plaintext, char* ciphertext)
+    {
+        return TryEncryptCaesarAlpha(cipherkey, plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a buffer using a precompiled Caesar cipherkey, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, length bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     * @param[in]   length - Length of ciphertext
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptCaesarAlpha(const CaesarKey& cipherkey, const char* ciphertext, char* plaintext, const size_t length)
+    {
+        return TryShiftVigenereAlphaAt(cipherkey.DecryptPeriod(), cipherkey.Period(), 0, ciphertext, plaintext, length);
+    }
+
+    /**
+     * Decrypt a string view using a precompiled Caesar cipherkey, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptCaesarAlpha(const CaesarKey& cipherkey, const std::string_view ciphertext, char* plaintext)
+    {
+        return TryDecryptCaesarAlpha(cipherkey, ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Caesar cipherkey
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @throw   If plaintext contains non-alpha characters
+     */
+    inline void EncryptCaesarAlpha(const CaesarKey& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        ThrowIfError(TryEncryptCaesarAlpha(cipherkey, plaintext, ciphertext), "", "plaintext");
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Caesar cipherkey
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @throw   If ciphertext contains non-alpha characters
+     */
+    inline void DecryptCaesarAlpha(const CaesarKey& cipherkey, const std::string& ciphertext, std::string& plaintext)
+    {
+        ThrowIfError(TryDecryptCaesarAlpha(cipherkey, ciphertext, plaintext), "", "ciphertext");
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Caesar cipherkey on several threads, without throwing
+     * The output is identical to TryEncryptCaesarAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @param[in]   pool - Threads to run on
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptCaesarAlphaParallel(const CaesarKey& cipherkey,
+                                                      const std::string& plaintext,
+                                                      std::string& ciphertext,
+                                                      ThreadPool& pool)
+    {
+        ciphertext.resize(plaintext.size());
+        return TryShiftVigenereAlphaParallel(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                                             plaintext.data(), &ciphertext[0], plaintext.size(), &pool);
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Caesar cipherkey on several threads, without throwing
+     * The output is identical to TryDecryptCaesarAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @param[in]   pool - Threads to run on
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptCaesarAlphaParallel(const CaesarKey& cipherkey,
+                                                      const std::string& ciphertext,
+                                                      std::string& plaintext,
+                                                      ThreadPool& pool)
+    {
+        plaintext.resize(ciphertext.size());
+        return TryShiftVigenereAlphaParallel(cipherkey.DecryptPeriod(), cipherkey.Period(), 0,
+                                             ciphertext.data(), &plaintext[0], ciphertext.size(), &pool);
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Caesar cipherkey on several threads
+     * The output is identical to EncryptCaesarAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @param[in]   pool - Threads to run on
+     * @throw   If plaintext contains non-alpha characters
+     */
+    inline void EncryptCaesarAlphaParallel(const CaesarKey& cipherkey,
+                                           const std::string& plaintext,
+                                           std::string& ciphertext,
+                                           ThreadPool& pool)
+    {
+        ThrowIfError(TryEncryptCaesarAlphaParallel(cipherkey, plaintext, ciphertext, pool), "", "plaintext");
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Caesar cipherkey on several threads
+     * The output is identical to DecryptCaesarAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @param[in]   pool - Threads to run on
+     * @throw   If ciphertext contains non-alpha characters
+     */
+    inline void DecryptCaesarAlphaParallel(const CaesarKey& cipherkey,
+                                           const std::string& ciphertext,
+                                           std::string& plaintext,
+                                           ThreadPool& pool)
+    {
+        ThrowIfError(TryDecryptCaesarAlphaParallel(cipherkey, ciphertext, plaintext, pool), "", "ciphertext");
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Caesar cipherkey, keeping case
+     * Letters of either case are encrypted and keep their case; everything
+     * else is copied unchanged.
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     */
+    inline void EncryptCaesarMixed(const CaesarKey& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        ciphertext.resize(plaintext.size());
+        (void)ShiftVigenereMixedAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                                   plaintext.data(), &ciphertext[0], plaintext.size());
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Caesar cipherkey, keeping case
+     * Letters of either case are decrypted and keep their case; everything
+     * else is copied unchanged.
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     */
+    inline void DecryptCaesarMixed(const CaesarKey& cipherkey, const std::string& ciphertext, std::string& plaintext)
+    {
+        plaintext.resize(ciphertext.size());
+        (void)ShiftVigenereMixedAt(cipherkey.DecryptPeriod(), cipherkey.Period(), 0,
+                                   ciphertext.data(), &plaintext[0], ciphertext.size());
+    }
+
+    /**
+     * Encrypt a string view using a precompiled Caesar cipherkey, keeping case, without allocating
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     */
+    inline void EncryptCaesarMixed(const CaesarKey& cipherkey, const std::string_view plaintext, char* ciphertext)
+    {
+        (void)ShiftVigenereMixedAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                                   plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a string view using a precompiled Caesar cipherkey, keeping case, without allocating
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     */
+    inline void DecryptCaesarMixed(const CaesarKey& cipherkey, const std::string_view ciphertext, char* plaintext)
+    {
+        (void)ShiftVigenereMixedAt(cipherkey.DecryptPeriod(), cipherkey.Period(), 0,
+                                   ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Encrypt binary data using a precompiled Caesar cipherkey
+     * Each byte is shifted by the key letter (A = 0 ... Z = 25) modulo 256.
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The data to encrypt, any bytes
+     * @param[out]  ciphertext - The resulting encrypted data
+     */
+    inline void EncryptCaesarBytes(const CaesarKey& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        ciphertext.resize(plaintext.size());
+        ShiftVigenereBytesAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                             plaintext.data(), &ciphertext[0], plaintext.size());
+    }
+
+    /**
+     * Decrypt binary data using a precompiled Caesar cipherkey
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The data to decrypt, any bytes
+     * @param[out]  plaintext - The resulting decrypted data
+     */
+    inline void DecryptCaesarBytes(const CaesarKey& cipherkey, const std::string& ciphertext, std::string& plaintext)
+    {
+        plaintext.resize(ciphertext.size());
+        ShiftVigenereBytesAt(cipherkey.ByteDecryptPeriod(), cipherkey.Period(), 0,
+                             ciphertext.data(), &plaintext[0], ciphertext.size());
+    }
+
+    /**
+     * Encrypt a string view using a precompiled Caesar cipherkey, as binary data, without allocating
+     * @param[in]   cipherkey - The compiled encryption key
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     */
+    inline void EncryptCaesarBytes(const CaesarKey& cipherkey, const std::string_view plaintext, char* ciphertext)
+    {
+        ShiftVigenereBytesAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                             plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a string view using a precompiled Caesar cipherkey, as binary data, without allocating
+     * @param[in]   cipherkey - The compiled decryption key
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     */
+    inline void DecryptCaesarBytes(const CaesarKey& cipherkey, const std::string_view ciphertext, char* plaintext)
+    {
+        ShiftVigenereBytesAt(cipherkey.ByteDecryptPeriod(), cipherkey.Period(), 0,
+                             ciphertext.data(), plaintext, ciphertext.size());
+    }
+
     /**
      * Encrypt the given plaintext using a Caesar cipher
      * This function is limited to upper-case alphabet characters (A-Z)
@@ -46,7 +406,7 @@ namespace cipher {
      */
     inline void EncryptCaesarAlpha(const char cipherkey, const std::string& plaintext, std::string& ciphertext)
     {
-        EncryptVigenereAlpha(std::string(1, cipherkey), plaintext, ciphertext);
+        EncryptCaesarAlpha(CaesarKey(cipherkey), plaintext, ciphertext);
     }
 
     /**
@@ -60,9 +420,15 @@ namespace cipher {
      */
     inline void DecryptCaesarAlpha(const char cipherkey, const std::string& ciphertext, std::string& plaintext)
     {
-        DecryptVigenereAlpha(std::string(1, cipherkey), ciphertext, plaintext);
+        DecryptCaesarAlpha(CaesarKey(cipherkey), ciphertext, plaintext);
     }
 
+
+    /* ===== Types ===== */
+
+    /** Caesar cipher over a message that arrives in chunks, see ShiftEncoder */
+    typedef ShiftEncoder<CaesarKey> CaesarEncoder;
+
 }   // end namespace cipher
 
 
@@ -0,0 +1,148 @@
+/************************************************************\
+Filename:   cipher.h
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    C interface to the cipher engine, built as libcipher.
+
+    A key is compiled once into a handle, then used to
+    encrypt and decrypt buffers owned by the caller:
+
+        cipher_key* key = NULL;
+        if (cipher_key_create("vigenere", "LEMON", CIPHER_FLAG_NONE, &key) == CIPHER_RESULT_OK)
+        {
+            cipher_result result = cipher_encrypt(key, text, text, length);
+            ...
+            cipher_key_free(key);
+        }
+
+    Methods and keys are the same as for the cipher program:
+    caesar, vigenere, substitution, railfence, scytale, or a
+    chain of METHOD:KEY stages such as "vigenere:LEMON,scytale:7"
+    (the key is then ignored).
+
+    Each call ciphers a whole text. A key handle is never
+    changed after it is created, so it may be used from
+    several threads at once.
+
+    No function lets a C++ exception escape.
+
+\************************************************************/
+
+
+#ifndef CIPHER_H_
+#define CIPHER_H_
+
+
+/* ===== Includes ===== */
+#include <stddef.h>
+
+
+/* ===== Macros ===== */
+
+/** Marks the functions exported by the shared library */
+#if defined(__GNUC__)
+#define CIPHER_API __attribute__((visibility("default")))
+#else
+#define CIPHER_API
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ===== Constants ===== */
+
+/** Outcome of a call, in cipher_result.status or returned directly */
+enum
+{
+    CIPHER_RESULT_OK = 0,               /* Success */
+    CIPHER_RESULT_INVALID_TEXT = 1,     /* Input text contains a character the cipher can't handle */
+    CIPHER_RESULT_INVALID_KEY = 2,      /* The key or method was rejected */
+    CIPHER_RESULT_INVALID_ARGUMENT = 3, /* A null pointer, or flags the method doesn't support */
+    CIPHER_RESULT_OUT_OF_MEMORY = 4,    /* An allocation failed */
+};
+
+/** Flags for cipher_key_create, combined with | */
+enum
+{
+    CIPHER_FLAG_NONE = 0,       /* Upper-case letters (A-Z) only; anything else is invalid text */
+    CIPHER_FLAG_KEEP_CASE = 1,  /* Cipher letters of either case and pass everything else through */
+    CIPHER_FLAG_BINARY = 2,     /* Cipher raw bytes; caesar, vigenere, railfence and scytale only */
+};
+
+
+/* ===== Types ===== */
+
+/** A compiled cipher key, for one method, in both directions */
+typedef struct cipher_key cipher_key;
+
+/** Result of ciphering a buffer */
+typedef struct cipher_result
+{
+    int status;         /* One of CIPHER_RESULT_... */
+    size_t offset;      /* Offset of the offending character in the input */
+    char value;         /* The offending character */
+} cipher_result;
+
+
+/* ===== Functions ===== */
+
+/**
+ * Compile a key
+ * @param[in]   method - Name of the cipher, or a chain of METHOD:KEY stages
+ * @param[in]   key - The cipher key, as given to the cipher program; may be NULL for a chain
+ * @param[in]   flags - CIPHER_FLAG_... values combined with |
+ * @param[out]  key_out - The compiled key, to be freed with cipher_key_free; NULL on error
+ * @return  CIPHER_RESULT_OK, or why the key was rejected; see cipher_last_error
+ */
+CIPHER_API int cipher_key_create(const char* method, const char* key, int flags, cipher_key** key_out);
+
+/**
+ * Free a compiled key
+ * @param[in]   key - Key from cipher_key_create, or NULL
+ */
+CIPHER_API void cipher_key_free(cipher_key* key);
+
+/**
+ * Encrypt a buffer
+ * @param[in]   key - The compiled key
+ * @param[in]   plaintext - The text to encrypt
+ * @param[out]  ciphertext - The resulting encrypted text, length bytes, owned by the caller.
+ *                           Must be the same buffer as plaintext, or not overlap it.
+ * @param[in]   length - Length of plaintext
+ * @return  The first invalid character in plaintext, if any. On error the
+ *          contents of ciphertext are unspecified.
+ */
+CIPHER_API cipher_result cipher_encrypt(const cipher_key* key, const char* plaintext, char* ciphertext, size_t length);
+
+/**
+ * Decrypt a buffer
+ * @param[in]   key - The compiled key
+ * @param[in]   ciphertext - The text to decrypt
+ * @param[out]  plaintext - The resulting decrypted text, length bytes, owned by the caller.
+ *                          Must be the same buffer as ciphertext, or not overlap it.
+ * @param[in]   length - Length of ciphertext
+ * @return  The first invalid character in ciphertext, if any. On error the
+ *          contents of plaintext are unspecified.
+ */
+CIPHER_API cipher_result cipher_decrypt(const cipher_key* key, const char* ciphertext, char* plaintext, size_t length);
+
+/**
+ * Describe the last error of cipher_key_create on this thread
+ * @return  The message, valid until the next call on this thread; empty if there was none
+ */
+CIPHER_API const char* cipher_last_error(void);
+
+/**
+ * Version of the library
+ * @return  MAJOR.MINOR.BUGFIX.SHA1_SHORT
+ */
+CIPHER_API const char* cipher_version(void);
+
+#ifdef __cplusplus
+}   /* end extern "C" */
+#endif
+
+
+#endif  /* CIPHER_H_ */
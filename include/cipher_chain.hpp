@@ -0,0 +1,509 @@
+/************************************************************\
+Filename:   cipher_chain.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Chains of ciphers applied as one job, written as a list
+    of METHOD:KEY stages, e.g.
+
+        vigenere:LEMON,railfence:5,scytale:7
+
+    Stages are applied left to right to encrypt, and undone
+    right to left to decrypt.
+
+    A chain is planned into as few passes over the text as
+    possible, with no copy of the text per stage:
+    - Consecutive letter stages (Caesar, Vigenere,
+      substitution) are fused. Shifts combine into a single
+      shift with the least common multiple of their periods,
+      and single-period stages combine into one substitution
+      table, so they cost one vector pass. Stages that can't
+      be combined are run one after the other on small blocks
+      that stay in cache.
+    - Transpositions (rail fence, scytale) run back to back
+      with their cache-blocked kernels, moving the text
+      between the output and one reused scratch buffer.
+      Composing them into one permutation was measured to be
+      several times slower: the closed-form index maps cost
+      a few divisions per letter, and once two are combined
+      neighbouring letters land far apart in memory.
+
+    Transpositions are applied to each block given to the
+    chain on its own, the same as a single transposition with
+    a block size.
+
+\************************************************************/
+
+
+#ifndef CIPHER_CHAIN_HPP_
+#define CIPHER_CHAIN_HPP_
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "caesar_cipher.hpp"
+#include "cipher_result.hpp"
+#include "cipher_simd.hpp"
+#include "cipher_utils.hpp"
+#include "rail_fence_cipher.hpp"
+#include "scytale_cipher.hpp"
+#include "substitution_cipher.hpp"
+#include "vigenere_cipher.hpp"
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** Letters run through all fused stages at a time, small enough to stay in cache */
+    const size_t CHAIN_BLOCK_SIZE = 16 * 1024;
+
+    /** Longest key period made by fusing shifts; longer ones are run as separate stages */
+    const size_t CHAIN_MAX_FUSED_PERIOD = 4096;
+
+
+    /* ===== Types ===== */
+
+    /**
+     * One stage of a chain, as written
+     */
+    struct ChainStage
+    {
+        std::string method;     // Name of the cipher
+        std::string key;        // The cipher key
+    };
+
+    /**
+     * A letter stage as a map from each letter to its replacement
+     * A shift (Caesar, Vigenere) keeps one offset per key phase;
+     * a substitution keeps its cipher alphabet.
+     */
+    struct LetterMap
+    {
+        std::vector<uint8_t> shifts;    // Offset for each key phase, empty for a substitution
+        std::string alphabet;           // Replacement for A-Z, for a substitution
+
+        /** Length of the key period */
+        size_t Period() const
+        {
+            return shifts.empty() ? 1U : shifts.size();
+        }
+
+        /** Replace one letter at a key phase */
+        char Apply(const char letter, const size_t phase) const
+        {
+            return shifts.empty() ? alphabet[letter - 'A']
+                                  : static_cast<char>('A' + ((letter - 'A') + shifts[phase % shifts.size()]) % 26);
+        }
+    };
+
+    /**
+     * One transposition stage
+     */
+    struct TranspositionStep
+    {
+        bool rail_fence;    // Rail fence if true, scytale if false
+        size_t key;         // Number of rails, or row width
+    };
+
+
+    /* ===== Functions ===== */
+
+    /** Check if a method name is a chain rather than a single cipher */
+    inline bool IsCipherChain(const std::string& method)
+    {
+        return method.find_first_of(":,") != std::string::npos;
+    }
+
+    /** Check if a method is one of the transposition ciphers */
+    inline bool IsTranspositionMethod(const std::string& method)
+    {
+        return (method == "railfence") || (method == "scytale");
+    }
+
+    /**
+     * Split a chain into its stages
+     * @param[in]   chain - METHOD:KEY stages separated by commas
+     * @throw   If a stage is missing its method or key
+     */
+    inline std::vector<ChainStage> ParseChain(const std::string& chain)
+    {
+        std::vector<ChainStage> stages;
+        size_t start = 0U;
+        while (true)
+        {
+            const size_t end = std::min(chain.find(',', start), chain.size());
+            const std::string stage = chain.substr(start, end - start);
+            const size_t colon = stage.find(':');
+            if ((colon == std::string::npos) || (colon == 0) || (colon + 1 == stage.size()))
+            {
+                throw std::runtime_error("Bad chain stage \"" + stage + "\"; expected METHOD:KEY.");
+            }
+            stages.push_back(ChainStage{stage.substr(0, colon), stage.substr(colon + 1)});
+            if (end == chain.size())
+            {
+                break;
+            }
+            start = end + 1;
+        }
+        return stages;
+    }
+
+    /** Check if any stage of a chain is a transposition */
+    inline bool ChainHasTransposition(const std::string& chain)
+    {
+        const std::vector<ChainStage> stages = ParseChain(chain);
+        return std::any_of(stages.begin(), stages.end(),
+                           [](const ChainStage& stage) { return IsTranspositionMethod(stage.method); });
+    }
+
+    /**
+     * Compile a letter stage
+     * @param[in]   stage - A Caesar, Vigenere or substitution stage
+     * @param[in]   decrypt - Build the inverse map
+     * @throw   If the key is invalid or the method is not a letter stage
+     */
+    inline LetterMap MakeLetterMap(const ChainStage& stage, const bool decrypt)
+    {
+        LetterMap map;
+        if (stage.method == "caesar")
+        {
+            const CaesarKey key(stage.key[0]);
+            map.shifts.assign(1, (decrypt ? key.DecryptPeriod() : key.EncryptPeriod())[0]);
+        }
+        else if (stage.method == "vigenere")
+        {
+            const VigenereKey key(stage.key);
+            const uint8_t* key_period = decrypt ? key.DecryptPeriod() : key.EncryptPeriod();
+            map.shifts.assign(key_period, key_period + key.Period());
+        }
+        else if (stage.method == "substitution")
+        {
+            const SubstitutionCipher substitution = SubstitutionCipher::FromKeyword(stage.key);
+            const uint8_t* table = decrypt ? substitution.DecryptTable() : substitution.EncryptTable();
+            map.alphabet.assign(reinterpret_cast<const char*>(table), 26);
+        }
+        else
+        {
+            throw std::runtime_error("method \"" + stage.method + "\" not supported.");
+        }
+        return map;
+    }
+
+    /**
+     * Combine two letter stages into one, if the result stays cheap to apply
+     * @param[in]   first - Stage applied first
+     * @param[in]   second - Stage applied to the output of first
+     * @param[out]  fused - The combined stage
+     * @return  False if the stages can't be combined
+     */
+    inline bool FuseLetterMaps(const LetterMap& first, const LetterMap& second, LetterMap& fused)
+    {
+        if (!first.shifts.empty() && !second.shifts.empty())
+        {
+            const size_t period = std::lcm(first.Period(), second.Period());
+            if (period > CHAIN_MAX_FUSED_PERIOD)
+            {
+                return false;
+            }
+            std::vector<uint8_t> shifts(period);
+            for (size_t phase = 0; phase < period; ++phase)
+            {
+                shifts[phase] = static_cast<uint8_t>(
+                    (first.shifts[phase % first.Period()] + second.shifts[phase % second.Period()]) % 26);
+            }
+            fused.shifts.swap(shifts);
+            fused.alphabet.clear();
+            return true;
+        }
+        else if ((first.Period() == 1) && (second.Period() == 1))
+        {
+            std::string alphabet(26, 'A');
+            for (size_t index = 0; index < 26; ++index)
+            {
+                alphabet[index] = second.Apply(first.Apply(static_cast<char>('A' + index), 0), 0);
+            }
+            fused.shifts.clear();
+            fused.alphabet.swap(alphabet);
+            return true;
+        }
+        return false;
+    }
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Consecutive letter stages, fused into as few kernels as possible
+     */
+    class LetterPass
+    {
+    public:
+        /**
+         * Fuse and compile a run of letter stages
+         * @param[in]   maps - The stages, in the order they are applied
+         */
+        explicit LetterPass(const std::vector<LetterMap>& maps)
+        {
+            LetterMap current = maps.front();
+            for (size_t index = 1; index < maps.size(); ++index)
+            {
+                if (!FuseLetterMaps(current, maps[index], current))
+                {
+                    AddKernel(current);
+                    current = maps[index];
+                }
+            }
+            AddKernel(current);
+        }
+
+        /**
+         * Run the stages over a piece of text, validating it in the same pass
+         * Input and output may be the same buffer.
+         * @param[in]   input - The text
+         * @param[out]  output - The result, length bytes
+         * @param[in]   length - Length of the text
+         * @param[in]   text_offset - Position of the text in the whole text, for the key phase
+         * @return  The first non-alpha character in input, if any
+         */
+        CipherResult Apply(const char* input, char* output, const size_t length, const size_t text_offset) const
+        {
+            if (kernels_.size() == 1)
+            {
+                return kernels_[0].Apply(input, output, length, text_offset);
+            }
+
+            // Take each block through every stage while it is in cache
+            for (size_t start = 0; start < length; start += CHAIN_BLOCK_SIZE)
+            {
+                const size_t block = std::min(CHAIN_BLOCK_SIZE, length - start);
+                CipherResult result = kernels_[0].Apply(input + start, output + start, block, text_offset + start);
+                if (!result.Ok())
+                {
+                    result.offset += start;
+                    return result;
+                }
+                for (size_t index = 1; index < kernels_.size(); ++index)
+                {
+                    (void)kernels_[index].Apply(output + start, output + start, block, text_offset + start);
+                }
+            }
+            return ResultOk();
+        }
+
+    private:
+        /**
+         * One compiled stage: a shift or a substitution table
+         */
+        struct Kernel
+        {
+            std::shared_ptr<const VigenereKey> key;             // Compiled shift, or null
+            std::shared_ptr<const SubstitutionCipher> table;    // Compiled substitution, or null
+
+            /** Run the stage over a piece of text */
+            CipherResult Apply(const char* input, char* output, const size_t length, const size_t text_offset) const
+            {
+                return key ? TryShiftVigenereAlphaAt(key->EncryptPeriod(), key->Period(), text_offset,
+                                                     input, output, length)
+                           : TrySubstituteAlpha(table->EncryptTable(), input, output, length);
+            }
+        };
+
+        /** Compile one fused stage */
+        void AddKernel(const LetterMap& map)
+        {
+            Kernel kernel;
+            if (!map.shifts.empty())
+            {
+                // A shift is a Vigenere key whose letters are the offsets
+                std::string letters(map.shifts.size(), 'A');
+                for (size_t index = 0; index < letters.size(); ++index)
+                {
+                    letters[index] = static_cast<char>('A' + map.shifts[index]);
+                }
+                kernel.key = std::make_shared<const VigenereKey>(letters);
+            }
+            else
+            {
+                kernel.table = std::make_shared<const SubstitutionCipher>(map.alphabet);
+            }
+            kernels_.push_back(kernel);
+        }
+
+        std::vector<Kernel> kernels_;   // Stages left after fusing, in order
+    };
+
+    /**
+     * A compiled chain of ciphers
+     * Safe to apply from several threads at once.
+     */
+    class CipherChain
+    {
+    public:
+        /**
+         * Plan and compile a chain
+         * @param[in]   chain - METHOD:KEY stages separated by commas
+         * @param[in]   decrypt - Undo the chain instead of applying it
+         * @throw   If a stage is malformed, its method is not supported or its key is invalid
+         */
+        CipherChain(const std::string& chain, const bool decrypt) :
+            decrypt_(decrypt),
+            transpositions_(0U)
+        {
+            std::vector<ChainStage> stages = ParseChain(chain);
+            if (decrypt)
+            {
+                std::reverse(stages.begin(), stages.end());
+            }
+
+            // Alpha text is required unless every stage is a scytale
+            validate_ = std::any_of(stages.begin(), stages.end(),
+                                    [](const ChainStage& stage) { return stage.method != "scytale"; });
+
+            // Each run of letter stages becomes one pass; each transposition is a pass of its own
+            std::vector<LetterMap> letter_run;
+            for (const ChainStage& stage : stages)
+            {
+                if (IsTranspositionMethod(stage.method))
+                {
+                    FlushLetters(letter_run);
+                    const bool rail_fence = (stage.method == "railfence");
+                    const TranspositionStep step = {
+                        rail_fence, ParseNumericKey(stage.key, rail_fence ? "rail fence" : "scytale")};
+                    passes_.push_back(Pass{nullptr, step});
+                    ++transpositions_;
+                }
+                else
+                {
+                    letter_run.push_back(MakeLetterMap(stage, decrypt));
+                }
+            }
+            FlushLetters(letter_run);
+        }
+
+        /**
+         * Run the chain over a piece of text
+         * Input and output may be the same buffer.
+         * @param[in]   input - The text
+         * @param[out]  output - The result, length bytes
+         * @param[in]   length - Length of the text
+         * @param[in]   text_offset - Position of the text in the whole text, for the key phase
+         * @return  The first non-alpha character in input, if any
+         */
+        CipherResult Apply(const char* input, char* output, const size_t length, const size_t text_offset) const
+        {
+            // Letter passes work in place, and each transposition moves the text
+            // to the other buffer. Start in whichever buffer makes the last
+            // transposition land in the output.
+            thread_local std::string scratch;
+            const bool starts_moved = !passes_.front().letters;
+            const size_t moves = transpositions_ - (starts_moved ? 1U : 0U);
+            if (transpositions_ > 0)
+            {
+                scratch.resize(std::max(scratch.size(), length));
+            }
+            char* const buffers[2] = {output, &scratch[0]};
+            size_t target = moves % 2;
+
+            const char* source = input;
+            if (starts_moved && (input == output) && (target == 0))
+            {
+                // The first transposition can't read and write the same buffer
+                std::memcpy(buffers[1], input, length);
+                source = buffers[1];
+            }
+
+            bool validate = validate_;
+            for (const Pass& pass : passes_)
+            {
+                CipherResult result = ResultOk();
+                if (pass.letters)
+                {
+                    result = pass.letters->Apply(source, buffers[target], length, text_offset);
+                }
+                else
+                {
+                    if (source == buffers[target])
+                    {
+                        target = 1 - target;
+                    }
+                    result = ApplyTransposition(pass.step, source, buffers[target], length, validate);
+                }
+                if (!result.Ok())
+                {
+                    return result;
+                }
+                source = buffers[target];
+                validate = false;
+            }
+            return ResultOk();
+        }
+
+    private:
+        /**
+         * One pass over the text: a run of letter stages, or one transposition
+         */
+        struct Pass
+        {
+            std::shared_ptr<const LetterPass> letters;  // The letter stages, or null for a transposition
+            TranspositionStep step;                     // The transposition, if letters is null
+        };
+
+        /** Close a run of letter stages */
+        void FlushLetters(std::vector<LetterMap>& run)
+        {
+            if (!run.empty())
+            {
+                passes_.push_back(Pass{std::make_shared<const LetterPass>(run), TranspositionStep()});
+                run.clear();
+            }
+        }
+
+        /** Run one transposition with its blocked kernel */
+        CipherResult ApplyTransposition(const TranspositionStep& step,
+                                        const char* input,
+                                        char* output,
+                                        const size_t length,
+                                        const bool validate) const
+        {
+            if (step.rail_fence)
+            {
+                return decrypt_ ? TryRailFenceAlphaBlocked<true>(step.key, input, output, length, nullptr)
+                                : TryRailFenceAlphaBlocked<false>(step.key, input, output, length, nullptr);
+            }
+            if (validate)
+            {
+                const size_t invalid = simd::FindNonUpperAlpha(input, length);
+                if (invalid != length)
+                {
+                    return ResultInvalidText(invalid, input[invalid]);
+                }
+            }
+            if (decrypt_)
+            {
+                TransposeScytale<true>(step.key, input, output, length);
+            }
+            else
+            {
+                TransposeScytale<false>(step.key, input, output, length);
+            }
+            return ResultOk();
+        }
+
+        bool decrypt_;              // Undo the stages instead of applying them
+        bool validate_;             // Reject anything but upper-case letters
+        size_t transpositions_;     // Number of transposition passes
+        std::vector<Pass> passes_;  // Passes in the order they run
+    };
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_CHAIN_HPP_
@@ -0,0 +1,619 @@
+/************************************************************\
+Filename:   cipher_container.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Chunked container format for ciphertext.
+
+    The payload is split into chunks of a fixed size (the last
+    one may be shorter), and each chunk is ciphered as a
+    message of its own. A transposition never reaches across a
+    chunk boundary, so chunks can be ciphered on separate
+    cores, any one chunk can be decrypted without the others,
+    and an interrupted job can carry on from its last whole
+    chunk.
+
+    All numbers are little-endian.
+
+        Header
+            8    magic           "CIPHCTNR"
+            u16  version         1
+            u16  flags           bit 0 binary, bit 1 keep case,
+                                 bit 2 chunk checksums
+            u32  method length
+            u64  chunk size
+            u64  key fingerprint
+            ...  method          names only, without keys
+        Chunks, one after another
+        Index
+            u64  offset          of each chunk in the file
+            u64  length          of each chunk
+            u32  crc32c          of each chunk, if flag bit 2 is set
+            ...
+            u64  chunk count
+            u64  index offset    in the file
+            8    magic           "CIPHINDX"
+
+    The key fingerprint catches a wrong method or key before
+    anything is decrypted. It is a plain 64 bit hash, not a
+    secure one, so it says as much about the key as any known
+    plaintext would.
+
+    Chunk checksums are CRC32C of the ciphertext, taken by the
+    thread that ciphers each chunk while the chunk is still in
+    its cache, and checked the same way before each chunk is
+    decrypted. They catch damage in transit or on disk; they
+    do nothing against deliberate changes.
+
+\************************************************************/
+
+
+#ifndef CIPHER_CONTAINER_HPP_
+#define CIPHER_CONTAINER_HPP_
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cipher_chain.hpp"
+#include "cipher_crc32c.hpp"
+#include "cipher_result.hpp"
+#include "cipher_stream.hpp"
+#include "cipher_thread_pool.hpp"
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** First bytes of every container */
+    const char CONTAINER_MAGIC[] = "CIPHCTNR";
+
+    /** Last bytes of every complete container */
+    const char CONTAINER_INDEX_MAGIC[] = "CIPHINDX";
+
+    /** Version written in the header */
+    const uint16_t CONTAINER_VERSION = 1;
+
+    /** Bytes in the header before the method name */
+    const size_t CONTAINER_HEADER_SIZE = 32;
+
+    /** Bytes in each index entry */
+    const size_t CONTAINER_ENTRY_SIZE = 16;
+
+    /** Bytes in each index entry of a container with chunk checksums */
+    const size_t CONTAINER_CHECKED_ENTRY_SIZE = 20;
+
+    /** Bytes after the index entries */
+    const size_t CONTAINER_TRAILER_SIZE = 24;
+
+    /** Chunk size used when none is given, large enough that the index stays small */
+    const size_t CONTAINER_CHUNK_SIZE = 1024 * 1024;
+
+    /** Largest chunk size a container can be written with */
+    const size_t CONTAINER_MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+    /** Most payload bytes held by a batch of chunks ciphered at once (and as much again once ciphered) */
+    const size_t CONTAINER_BATCH_BYTES = 64 * 1024 * 1024;
+
+    /** Header flags */
+    const uint16_t CONTAINER_FLAG_BINARY = 0x0001;
+    const uint16_t CONTAINER_FLAG_KEEP_CASE = 0x0002;
+    const uint16_t CONTAINER_FLAG_CHECKSUM = 0x0004;
+
+
+    /* ===== Types ===== */
+
+    /**
+     * Settings a container was written with
+     */
+    struct ContainerHeader
+    {
+        std::string method;     // Method names, without keys; see ContainerMethodName
+        uint64_t fingerprint;   // ContainerFingerprint of the method and key
+        uint64_t chunk_size;    // Bytes in every chunk but the last
+        uint16_t flags;         // CONTAINER_FLAG_... values
+    };
+
+    /**
+     * Where one chunk is in the file
+     */
+    struct ContainerChunk
+    {
+        uint64_t offset;        // Offset of the chunk in the file
+        uint64_t length;        // Bytes in the chunk
+        uint32_t crc;           // CRC32C of the chunk, if the container has checksums
+    };
+
+
+    /* ===== Functions ===== */
+
+    /** Append a little-endian number of the given width */
+    inline void AppendLittleEndian(std::string& output, const uint64_t value, const size_t width)
+    {
+        for (size_t index = 0; index < width; ++index)
+        {
+            output.push_back(static_cast<char>((value >> (8 * index)) & 0xFF));
+        }
+    }
+
+    /** Read a little-endian number of the given width */
+    inline uint64_t ReadLittleEndian(const char* input, const size_t width)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(input);
+        uint64_t value = 0U;
+        for (size_t index = 0; index < width; ++index)
+        {
+            value |= static_cast<uint64_t>(bytes[index]) << (8 * index);
+        }
+        return value;
+    }
+
+    /**
+     * Name of a method as recorded in a container, with any keys left out
+     * @param[in]   method - Name of the cipher, or a chain of METHOD:KEY stages
+     * @return  The method, or the names of the stages of a chain separated by commas
+     * @throw   If a chain stage is missing its method or key
+     */
+    inline std::string ContainerMethodName(const std::string& method)
+    {
+        if (!IsCipherChain(method))
+        {
+            return method;
+        }
+        std::string names;
+        for (const ChainStage& stage : ParseChain(method))
+        {
+            names.append(names.empty() ? "" : ",").append(stage.method);
+        }
+        return names;
+    }
+
+    /**
+     * Fingerprint of a method and key, to check a container is opened with the key it was written with
+     * 64 bit FNV-1a over the method, a NUL and the key.
+     * @param[in]   method - Name of the cipher, or a chain, as given
+     * @param[in]   cipherkey - The cipher key, with trailing whitespace removed; unused for a chain
+     */
+    inline uint64_t ContainerFingerprint(const std::string& method, const std::string& cipherkey)
+    {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        const auto add = [&hash](const char byte)
+        {
+            hash = (hash ^ static_cast<unsigned char>(byte)) * 0x100000001B3ULL;
+        };
+        std::for_each(method.begin(), method.end(), add);
+        add('\0');
+        if (!IsCipherChain(method))
+        {
+            std::for_each(cipherkey.begin(), cipherkey.end(), add);
+        }
+        return hash;
+    }
+
+    /** Bytes in each index entry of a container with the given header flags */
+    inline size_t ContainerEntrySize(const uint16_t flags)
+    {
+        return ((flags & CONTAINER_FLAG_CHECKSUM) != 0) ? CONTAINER_CHECKED_ENTRY_SIZE : CONTAINER_ENTRY_SIZE;
+    }
+
+    /**
+     * Build a container header
+     * @param[in]   header - The settings to record
+     * @return  The header bytes, ready to write at the start of the file
+     */
+    inline std::string EncodeContainerHeader(const ContainerHeader& header)
+    {
+        std::string output(CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC) - 1);
+        AppendLittleEndian(output, CONTAINER_VERSION, 2);
+        AppendLittleEndian(output, header.flags, 2);
+        AppendLittleEndian(output, header.method.size(), 4);
+        AppendLittleEndian(output, header.chunk_size, 8);
+        AppendLittleEndian(output, header.fingerprint, 8);
+        output.append(header.method);
+        return output;
+    }
+
+    /**
+     * Read a container header
+     * @param[in]   data - Start of the file
+     * @param[in]   size - Bytes of the file available
+     * @param[out]  header - The recorded settings
+     * @return  Size of the header, where the first chunk starts
+     * @throw   If the data is not a container, is from a newer version, or is cut short
+     */
+    inline size_t DecodeContainerHeader(const char* data, const size_t size, ContainerHeader& header)
+    {
+        const size_t magic_size = sizeof(CONTAINER_MAGIC) - 1;
+        if ((size < CONTAINER_HEADER_SIZE) || (std::memcmp(data, CONTAINER_MAGIC, magic_size) != 0))
+        {
+            throw std::runtime_error("not a cipher container");
+        }
+        else if (ReadLittleEndian(data + 8, 2) != CONTAINER_VERSION)
+        {
+            throw std::runtime_error("cipher container version is not supported");
+        }
+        header.flags = static_cast<uint16_t>(ReadLittleEndian(data + 10, 2));
+        const size_t method_size = static_cast<size_t>(ReadLittleEndian(data + 12, 4));
+        header.chunk_size = ReadLittleEndian(data + 16, 8);
+        header.fingerprint = ReadLittleEndian(data + 24, 8);
+        if ((header.chunk_size == 0) || (method_size > (size - CONTAINER_HEADER_SIZE)))
+        {
+            throw std::runtime_error("cipher container header is damaged");
+        }
+        header.method.assign(data + CONTAINER_HEADER_SIZE, method_size);
+        return CONTAINER_HEADER_SIZE + method_size;
+    }
+
+
+    /**
+     * Check a chunk size can be written
+     * @throw   If it is 0 or more than CONTAINER_MAX_CHUNK_SIZE
+     */
+    inline void CheckContainerChunkSize(const uint64_t chunk_size)
+    {
+        if ((chunk_size == 0) || (chunk_size > CONTAINER_MAX_CHUNK_SIZE))
+        {
+            throw std::runtime_error("container chunk size must be from 1 byte to 64 MiB");
+        }
+    }
+
+    /**
+     * Chunks to cipher at once: two for every thread, so none sits idle,
+     * but no more than fit in CONTAINER_BATCH_BYTES, and at least one
+     * @param[in]   chunk_size - Bytes in each chunk
+     * @param[in]   threads - Threads ciphering the chunks
+     */
+    inline size_t ContainerBatchChunks(const size_t chunk_size, const size_t threads)
+    {
+        return std::max<size_t>(1U, std::min(2 * threads, CONTAINER_BATCH_BYTES / chunk_size));
+    }
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Writes a container to a stream, one chunk at a time
+     * The index is kept in memory, one entry per chunk, and written by Finish.
+     */
+    class ContainerWriter
+    {
+    public:
+        /**
+         * Start a new container and write its header
+         * @param[in]   output - Stream to write the container to
+         * @param[in]   header - The settings to record
+         * @throw   If the chunk size is 0 or more than CONTAINER_MAX_CHUNK_SIZE
+         */
+        ContainerWriter(std::ostream& output, const ContainerHeader& header) :
+            ContainerWriter(output, header, 0U)
+        {
+            const std::string encoded = EncodeContainerHeader(header_);
+            output_.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+        }
+
+        /**
+         * Carry on with a container whose header and first chunks are already written
+         * @param[in]   output - Stream to write the rest of the container to, placed
+         *                       just after the chunks already written
+         * @param[in]   header - The settings recorded in the container
+         * @param[in]   chunks_written - Number of whole chunks already written
+         * @param[in]   written_crcs - CRC32C of each chunk already written, if the container
+         *                             has checksums; may be null otherwise
+         * @throw   If the chunk size is 0 or more than CONTAINER_MAX_CHUNK_SIZE
+         */
+        ContainerWriter(std::ostream& output,
+                        const ContainerHeader& header,
+                        const size_t chunks_written,
+                        const uint32_t* written_crcs = nullptr) :
+            output_(output),
+            header_(header),
+            position_(CONTAINER_HEADER_SIZE + header.method.size())
+        {
+            CheckContainerChunkSize(header_.chunk_size);
+            for (size_t index = 0; index < chunks_written; ++index)
+            {
+                const uint32_t crc = (written_crcs != nullptr) ? written_crcs[index] : 0U;
+                chunks_.push_back(ContainerChunk{position_, header_.chunk_size, crc});
+                position_ += header_.chunk_size;
+            }
+        }
+
+        ContainerWriter(const ContainerWriter&) = delete;
+        ContainerWriter& operator=(const ContainerWriter&) = delete;
+
+        /**
+         * Write the next chunk
+         * @param[in]   chunk - The ciphered chunk
+         * @param[in]   length - Bytes in the chunk, at most the chunk size; only the last may be shorter
+         * @param[in]   crc - Crc32c of the chunk, recorded if the container has checksums
+         * @throw   If the chunk is empty, too long, or follows a short chunk
+         */
+        void WriteChunk(const char* chunk, const size_t length, const uint32_t crc = 0U)
+        {
+            if ((length == 0) || (length > header_.chunk_size) ||
+                (!chunks_.empty() && (chunks_.back().length != header_.chunk_size)))
+            {
+                throw std::logic_error("container chunks must be full size, except the last");
+            }
+            output_.write(chunk, static_cast<std::streamsize>(length));
+            chunks_.push_back(ContainerChunk{position_, length, crc});
+            position_ += length;
+        }
+
+        /**
+         * Write the index after the last chunk
+         * @throw   If anything could not be written
+         */
+        void Finish()
+        {
+            const bool checksum = ((header_.flags & CONTAINER_FLAG_CHECKSUM) != 0);
+            std::string index;
+            index.reserve((chunks_.size() * ContainerEntrySize(header_.flags)) + CONTAINER_TRAILER_SIZE);
+            for (const ContainerChunk& chunk : chunks_)
+            {
+                AppendLittleEndian(index, chunk.offset, 8);
+                AppendLittleEndian(index, chunk.length, 8);
+                if (checksum)
+                {
+                    AppendLittleEndian(index, chunk.crc, 4);
+                }
+            }
+            AppendLittleEndian(index, chunks_.size(), 8);
+            AppendLittleEndian(index, position_, 8);
+            index.append(CONTAINER_INDEX_MAGIC, sizeof(CONTAINER_INDEX_MAGIC) - 1);
+            output_.write(index.data(), static_cast<std::streamsize>(index.size()));
+            output_.flush();
+            if (!output_)
+            {
+                throw std::runtime_error("cipher container could not be written");
+            }
+        }
+
+        /** The settings recorded in the container */
+        const ContainerHeader& Header() const
+        {
+            return header_;
+        }
+
+        /** Bytes of payload in the chunks written so far */
+        uint64_t PayloadLength() const
+        {
+            return chunks_.empty() ? 0U : (position_ - chunks_.front().offset);
+        }
+
+    private:
+        std::ostream& output_;                  // Where the container goes
+        ContainerHeader header_;                // Settings recorded in the header
+        uint64_t position_;                     // Offset in the file of the next chunk
+        std::vector<ContainerChunk> chunks_;    // Index entries so far
+    };
+
+    /**
+     * Reads a complete container held in memory, such as a mapped file
+     * The header and index are checked up front, so every chunk can then
+     * be found in constant time.
+     */
+    class ContainerReader
+    {
+    public:
+        /**
+         * Check a container and read its header and index
+         * @param[in]   data - The whole container, which must outlive the reader
+         * @param[in]   size - Size of the container
+         * @throw   If the data is not a complete, well-formed container
+         */
+        ContainerReader(const char* data, const size_t size) :
+            data_(data),
+            payload_length_(0U)
+        {
+            const size_t header_size = DecodeContainerHeader(data, size, header_);
+            const size_t magic_size = sizeof(CONTAINER_INDEX_MAGIC) - 1;
+            if (((size - header_size) < CONTAINER_TRAILER_SIZE) ||
+                (std::memcmp(data + size - magic_size, CONTAINER_INDEX_MAGIC, magic_size) != 0))
+            {
+                throw std::runtime_error("cipher container has no index; it may be incomplete");
+            }
+
+            // The index must fill the space between the chunks and the trailer
+            const char* trailer = data + size - CONTAINER_TRAILER_SIZE;
+            const uint64_t count = ReadLittleEndian(trailer, 8);
+            const uint64_t index_offset = ReadLittleEndian(trailer + 8, 8);
+            const uint64_t index_space = size - CONTAINER_TRAILER_SIZE;
+            const size_t entry_size = ContainerEntrySize(header_.flags);
+            if ((index_offset < header_size) || (index_offset > index_space) ||
+                (count != ((index_space - index_offset) / entry_size)) ||
+                (((index_space - index_offset) % entry_size) != 0))
+            {
+                throw std::runtime_error("cipher container index is damaged");
+            }
+
+            // Every chunk but the last is full size, so a chunk size larger than the file is damage
+            if ((count > 1) && (header_.chunk_size > size))
+            {
+                throw std::runtime_error("cipher container index is damaged");
+            }
+
+            // Chunks are full size and back to back, except that the last may be shorter,
+            // and each must end before the index (checked without overflow)
+            uint64_t position = header_size;
+            for (uint64_t index = 0; index < count; ++index)
+            {
+                const char* entry = data + index_offset + (index * entry_size);
+                const uint32_t crc = HasChecksums() ? static_cast<uint32_t>(ReadLittleEndian(entry + 16, 4)) : 0U;
+                const ContainerChunk chunk = {ReadLittleEndian(entry, 8), ReadLittleEndian(entry + 8, 8), crc};
+                const bool last = ((index + 1) == count);
+                if ((chunk.offset != position) || (chunk.length == 0) || (chunk.length > header_.chunk_size) ||
+                    (chunk.length > (index_offset - position)) ||
+                    (!last && (chunk.length != header_.chunk_size)))
+                {
+                    throw std::runtime_error("cipher container index is damaged");
+                }
+                chunks_.push_back(chunk);
+                position += chunk.length;
+            }
+            if (position != index_offset)
+            {
+                throw std::runtime_error("cipher container index is damaged");
+            }
+            payload_length_ = position - header_size;
+        }
+
+        /** The settings recorded in the container */
+        const ContainerHeader& Header() const
+        {
+            return header_;
+        }
+
+        /** Number of chunks */
+        size_t ChunkCount() const
+        {
+            return chunks_.size();
+        }
+
+        /** First byte of a chunk */
+        const char* ChunkData(const size_t index) const
+        {
+            return data_ + chunks_[index].offset;
+        }
+
+        /** Bytes in a chunk */
+        size_t ChunkLength(const size_t index) const
+        {
+            return static_cast<size_t>(chunks_[index].length);
+        }
+
+        /** Bytes of payload in all the chunks */
+        uint64_t PayloadLength() const
+        {
+            return payload_length_;
+        }
+
+        /** Whether the index has a checksum for each chunk */
+        bool HasChecksums() const
+        {
+            return ((header_.flags & CONTAINER_FLAG_CHECKSUM) != 0);
+        }
+
+        /**
+         * Check a chunk against its checksum
+         * Reads the whole chunk; call it from the thread about to decrypt the
+         * chunk, so the bytes are in cache for the decryption.
+         * @return  Whether the chunk matches, or true if the container has no checksums
+         */
+        bool ChunkIntact(const size_t index) const
+        {
+            return !HasChecksums() || (Crc32c(ChunkData(index), ChunkLength(index)) == chunks_[index].crc);
+        }
+
+    private:
+        const char* data_;                      // The whole container
+        ContainerHeader header_;                // Settings recorded in the header
+        std::vector<ContainerChunk> chunks_;    // Where each chunk is
+        uint64_t payload_length_;               // Sum of the chunk lengths
+    };
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Cipher a stream into a container, several chunks at a time in parallel
+     * Text is trimmed of trailing whitespace, as for StreamTransform, unless
+     * it is binary data. Chunks written before an error is found are not
+     * taken back, and the index is only written on success.
+     * @param[in]   input - Stream to read the payload from
+     * @param[in,out]   writer - The container to add chunks to; finished on success. If
+     *                           it has checksums, each chunk is checksummed on the thread that
+     *                           ciphered it.
+     * @param[in]   transform - Callable (const char* input, char* output, size_t length)
+     *                          returning a CipherResult, run on each chunk as a whole
+     *                          message. It is called from several threads at once.
+     * @param[in]   pool - Threads to cipher chunks on, or null to use only this one
+     * @param[in]   binary - Keep trailing whitespace
+     * @return  The first error from transform, with its offset in the whole payload
+     * @throw   If the container could not be written, or whatever transform throws
+     */
+    template <typename Transform>
+    inline CipherResult WriteContainer(std::istream& input,
+                                       ContainerWriter& writer,
+                                       const Transform& transform,
+                                       ThreadPool* pool,
+                                       const bool binary)
+    {
+        // Cipher a batch of chunks for every thread to work on at a time
+        const size_t chunk_size = static_cast<size_t>(writer.Header().chunk_size);
+        const size_t batch_chunks = ContainerBatchChunks(chunk_size, (pool != nullptr) ? pool->Size() : 1U);
+        std::vector<std::string> ciphered(batch_chunks);
+        std::vector<CipherResult> results(batch_chunks);
+        std::vector<uint32_t> crcs(batch_chunks);
+        const bool checksum = ((writer.Header().flags & CONTAINER_FLAG_CHECKSUM) != 0);
+        std::string pending;
+        bool reading = true;
+        while (reading)
+        {
+            const size_t filled = pending.size();
+            pending.resize(filled + (batch_chunks * chunk_size));
+            input.read(&pending[filled], static_cast<std::streamsize>(batch_chunks * chunk_size));
+            pending.resize(filled + static_cast<size_t>(input.gcount()));
+            reading = input.good();
+
+            // Whitespace at the end of what has been read is held back until
+            // more text follows it, since it may be the end of the payload.
+            // Until then, only whole chunks are taken.
+            const size_t text_end = binary ? pending.size() : TrimmedEnd(pending.data(), 0, pending.size());
+            const size_t ready = reading ? (text_end - (text_end % chunk_size)) : text_end;
+            size_t consumed = 0U;
+            while (consumed < ready)
+            {
+                const size_t count = std::min(batch_chunks, ((ready - consumed) + chunk_size - 1) / chunk_size);
+                const auto cipher_chunk = [&](const size_t index)
+                {
+                    const size_t start = consumed + (index * chunk_size);
+                    const size_t length = std::min(chunk_size, ready - start);
+                    ciphered[index].resize(length);
+                    results[index] = transform(pending.data() + start, &ciphered[index][0], length);
+                    if (checksum && results[index].Ok())
+                    {
+                        crcs[index] = Crc32c(ciphered[index].data(), length);
+                    }
+                };
+                if (pool != nullptr)
+                {
+                    pool->ParallelFor(count, cipher_chunk);
+                }
+                else
+                {
+                    for (size_t index = 0; index < count; ++index)
+                    {
+                        cipher_chunk(index);
+                    }
+                }
+
+                for (size_t index = 0; index < count; ++index)
+                {
+                    if (!results[index].Ok())
+                    {
+                        CipherResult result = results[index];
+                        result.offset += writer.PayloadLength();
+                        return result;
+                    }
+                    writer.WriteChunk(ciphered[index].data(), ciphered[index].size(), crcs[index]);
+                    consumed += ciphered[index].size();
+                }
+            }
+            pending.erase(0, consumed);
+        }
+        writer.Finish();
+        return ResultOk();
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_CONTAINER_HPP_
@@ -0,0 +1,247 @@
+/************************************************************\
+Filename:   cipher_crc32c.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    CRC32C (Castagnoli) checksums, for checking ciphertext
+    has not been damaged on its way between hosts.
+
+    The reference kernel looks up eight bytes at a time in
+    eight 256-entry tables ("slicing by 8"). The SSE4.2 kernel
+    uses the crc32 instruction, which takes 8 bytes per call
+    but has a latency of three cycles, so it runs three
+    streams over neighbouring blocks at once and then joins
+    them. Joining needs the CRC of each earlier block moved
+    past the bytes that follow it; that shift is linear in the
+    CRC, so it is a lookup in four 256-entry tables per block
+    length, built once by running the reference kernel over
+    zero bytes.
+
+        crc(A B C) = shift(crc(A), |B| + |C|)
+                   ^ shift(crc(B), |C|)
+                   ^ crc(C)
+
+    Kernels work on the raw CRC register; Crc32c adds the
+    usual inversion before and after, so results match other
+    CRC32C implementations and can be extended piece by piece.
+
+\************************************************************/
+
+
+#ifndef CIPHER_CRC32C_HPP_
+#define CIPHER_CRC32C_HPP_
+
+
+/* ===== Includes ===== */
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "cipher_simd.hpp"
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** CRC32C polynomial, bit-reversed */
+    const uint32_t CRC32C_POLYNOMIAL = 0x82F63B78U;
+
+    /** Bytes in each of the three blocks the SSE4.2 kernel runs at once */
+    const size_t CRC32C_STREAM_BLOCK = 4096;
+
+
+    /* ===== Types ===== */
+
+    /**
+     * Signature shared by all CRC32C kernels
+     * @param[in]   state - The CRC register after any earlier bytes, already inverted
+     * @param[in]   data - The bytes to add
+     * @param[in]   length - Number of bytes to add
+     * @return  The CRC register after the bytes, not yet inverted
+     */
+    typedef uint32_t (*Crc32cFunc)(uint32_t state, const char* data, size_t length);
+
+    /**
+     * Lookup tables for the reference kernel
+     */
+    struct Crc32cTables
+    {
+        uint32_t table[8][256];     // table[k][b]: byte b followed by k zero bytes
+    };
+
+    /**
+     * Lookup tables to move a CRC register past a fixed number of zero bytes
+     */
+    struct Crc32cShift
+    {
+        uint32_t table[4][256];     // table[k][b]: the shift of b << (8 * k)
+    };
+
+
+    /* ===== Functions ===== */
+
+    /** Tables for the reference kernel (built once, on first use) */
+    inline const Crc32cTables& GetCrc32cTables()
+    {
+        static const Crc32cTables tables = []()
+        {
+            Crc32cTables built = Crc32cTables();
+            for (uint32_t byte = 0; byte < 256; ++byte)
+            {
+                uint32_t crc = byte;
+                for (size_t bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc >> 1) ^ ((crc & 1U) ? CRC32C_POLYNOMIAL : 0U);
+                }
+                built.table[0][byte] = crc;
+            }
+            for (size_t slice = 1; slice < 8; ++slice)
+            {
+                for (size_t byte = 0; byte < 256; ++byte)
+                {
+                    const uint32_t previous = built.table[slice - 1][byte];
+                    built.table[slice][byte] = (previous >> 8) ^ built.table[0][previous & 0xFF];
+                }
+            }
+            return built;
+        }();
+        return tables;
+    }
+
+    /** Read 4 bytes as a little-endian number */
+    inline uint32_t LoadLittleEndian32(const char* data)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+               (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    }
+
+    /** Reference CRC32C kernel, eight bytes at a time */
+    inline uint32_t Crc32cScalar(uint32_t state, const char* data, const size_t length)
+    {
+        const Crc32cTables& tables = GetCrc32cTables();
+        const auto& table = tables.table;
+        size_t index = 0;
+        for (; index + 8 <= length; index += 8)
+        {
+            const uint32_t low = LoadLittleEndian32(data + index) ^ state;
+            const uint32_t high = LoadLittleEndian32(data + index + 4);
+            state = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+                    table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+                    table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+                    table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+        }
+        for (; index < length; ++index)
+        {
+            state = (state >> 8) ^ table[0][(state ^ static_cast<unsigned char>(data[index])) & 0xFF];
+        }
+        return state;
+    }
+
+    /**
+     * Build the tables that move a CRC register past some zero bytes
+     * @param[in]   length - Number of zero bytes
+     */
+    inline Crc32cShift MakeCrc32cShift(const size_t length)
+    {
+        const std::string zeros(length, '\0');
+        Crc32cShift shift = Crc32cShift();
+        for (size_t slice = 0; slice < 4; ++slice)
+        {
+            for (uint32_t byte = 0; byte < 256; ++byte)
+            {
+                shift.table[slice][byte] = Crc32cScalar(byte << (8 * slice), zeros.data(), length);
+            }
+        }
+        return shift;
+    }
+
+    /** Move a CRC register past the zero bytes a shift table was built for */
+    inline uint32_t ShiftCrc32c(const Crc32cShift& shift, const uint32_t state)
+    {
+        return shift.table[0][state & 0xFF] ^ shift.table[1][(state >> 8) & 0xFF] ^
+               shift.table[2][(state >> 16) & 0xFF] ^ shift.table[3][state >> 24];
+    }
+
+#if defined(CIPHER_SIMD_X86) && defined(__x86_64__)
+
+    /** CRC32C kernel using the SSE4.2 crc32 instruction on three streams at once */
+    __attribute__((target("sse4.2")))
+    inline uint32_t Crc32cSSE42(uint32_t state, const char* data, size_t length)
+    {
+        static const Crc32cShift shift_one = MakeCrc32cShift(CRC32C_STREAM_BLOCK);
+        static const Crc32cShift shift_two = MakeCrc32cShift(2 * CRC32C_STREAM_BLOCK);
+        const auto load = [](const char* bytes)
+        {
+            uint64_t value = 0U;
+            std::memcpy(&value, bytes, sizeof(value));
+            return value;
+        };
+
+        while (length >= (3 * CRC32C_STREAM_BLOCK))
+        {
+            uint64_t first = state;
+            uint64_t second = 0U;
+            uint64_t third = 0U;
+            for (size_t index = 0; index < CRC32C_STREAM_BLOCK; index += 8)
+            {
+                first = _mm_crc32_u64(first, load(data + index));
+                second = _mm_crc32_u64(second, load(data + CRC32C_STREAM_BLOCK + index));
+                third = _mm_crc32_u64(third, load(data + (2 * CRC32C_STREAM_BLOCK) + index));
+            }
+            state = ShiftCrc32c(shift_two, static_cast<uint32_t>(first)) ^
+                    ShiftCrc32c(shift_one, static_cast<uint32_t>(second)) ^ static_cast<uint32_t>(third);
+            data += 3 * CRC32C_STREAM_BLOCK;
+            length -= 3 * CRC32C_STREAM_BLOCK;
+        }
+
+        uint64_t tail = state;
+        for (; length >= 8; data += 8, length -= 8)
+        {
+            tail = _mm_crc32_u64(tail, load(data));
+        }
+        state = static_cast<uint32_t>(tail);
+        for (; length > 0; ++data, --length)
+        {
+            state = _mm_crc32_u8(state, static_cast<unsigned char>(*data));
+        }
+        return state;
+    }
+
+#endif  // CIPHER_SIMD_X86 && __x86_64__
+
+    /**
+     * Get the CRC32C kernel for a given instruction set level
+     * The caller is responsible for checking the CPU supports the level.
+     */
+    inline Crc32cFunc GetCrc32cKernel(const simd::SimdLevel level)
+    {
+        Crc32cFunc kernel = Crc32cScalar;
+#if defined(CIPHER_SIMD_X86) && defined(__x86_64__)
+        if (level >= simd::SIMD_LEVEL_SSE42)
+        {
+            kernel = Crc32cSSE42;
+        }
+#else
+        (void)level;
+#endif
+        return kernel;
+    }
+
+    /**
+     * CRC32C of some bytes, using the best kernel for this CPU
+     * @param[in]   data - The bytes to check
+     * @param[in]   length - Number of bytes
+     * @param[in]   crc - CRC32C of any bytes before these, to extend it; 0 to start
+     * @return  CRC32C of the earlier bytes followed by these
+     */
+    inline uint32_t Crc32c(const char* data, const size_t length, const uint32_t crc = 0U)
+    {
+        static const Crc32cFunc kernel = GetCrc32cKernel(simd::GetSimdLevel());
+        return ~kernel(~crc, data, length);
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_CRC32C_HPP_
@@ -0,0 +1,422 @@
+/************************************************************\
+Filename:   cipher_manifest.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Reading and writing the JSON Lines manifest used to run
+    many independent cipher jobs through one process.
+
+    Each line of a manifest is one JSON object:
+
+        {"method": "vigenere", "key": "LEMON", "decrypt": false,
+         "payload": "ATTACKATDAWN"}
+
+    "decrypt" is optional and defaults to false. "key" may also
+    be a number, for the transposition ciphers. Other fields
+    are ignored.
+
+    Each result is written as one JSON object per line, in the
+    same order as the manifest:
+
+        {"result":"LXFOPVEFRNHR"}
+        {"error":"Non alphabet character 0x20 found in plaintext"}
+
+    Only the small part of JSON needed for this is handled
+    here: objects of strings, numbers, booleans and null.
+    Nested objects and arrays are skipped.
+
+\************************************************************/
+
+
+#ifndef CIPHER_MANIFEST_HPP_
+#define CIPHER_MANIFEST_HPP_
+
+
+/* ===== Includes ===== */
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "cipher_utils.hpp"
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** Deepest nesting of objects and arrays skipped in a record, to bound the stack */
+    const size_t JSON_MAX_DEPTH = 256;
+
+
+    /* ===== Types ===== */
+
+    /**
+     * One job from a manifest
+     */
+    struct ManifestRecord
+    {
+        std::string method;     // Name of the cipher to use
+        std::string key;        // The cipher key
+        bool decrypt;           // Decrypt instead of encrypt
+        std::string payload;    // The text to transform
+    };
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Reader for one line of JSON
+     * Throws std::runtime_error on anything that is not valid JSON.
+     */
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(const std::string& text) :
+            text_(text),
+            position_(0U)
+        {
+        }
+
+        /** Skip whitespace, then check the next character without consuming it */
+        char Peek()
+        {
+            while ((position_ < text_.size()) &&
+                   ((text_[position_] == ' ') || (text_[position_] == '\t') ||
+                    (text_[position_] == '\r') || (text_[position_] == '\n')))
+            {
+                ++position_;
+            }
+            return (position_ < text_.size()) ? text_[position_] : '\0';
+        }
+
+        /** Consume the next character, which must be the one given */
+        void Expect(const char expected)
+        {
+            if (Peek() != expected)
+            {
+                throw Error(std::string("expected '") + expected + "'");
+            }
+            ++position_;
+        }
+
+        /** True if only whitespace is left */
+        bool AtEnd()
+        {
+            return (Peek() == '\0') && (position_ == text_.size());
+        }
+
+        /** Read a string value, decoding escapes to UTF-8 */
+        std::string ReadString()
+        {
+            Expect('"');
+            std::string value;
+            while (true)
+            {
+                if (position_ >= text_.size())
+                {
+                    throw Error("unterminated string");
+                }
+                const char letter = text_[position_++];
+                if (letter == '"')
+                {
+                    break;
+                }
+                else if (static_cast<uint8_t>(letter) < 0x20)
+                {
+                    throw Error("control character in string");
+                }
+                else if (letter != '\\')
+                {
+                    value.push_back(letter);
+                }
+                else if (position_ >= text_.size())
+                {
+                    throw Error("unterminated string");
+                }
+                else
+                {
+                    const char escape = text_[position_++];
+                    switch (escape)
+                    {
+                        case '"':   value.push_back('"');   break;
+                        case '\\':  value.push_back('\\');  break;
+                        case '/':   value.push_back('/');   break;
+                        case 'b':   value.push_back('\b');  break;
+                        case 'f':   value.push_back('\f');  break;
+                        case 'n':   value.push_back('\n');  break;
+                        case 'r':   value.push_back('\r');  break;
+                        case 't':   value.push_back('\t');  break;
+                        case 'u':   AppendCodePoint(value); break;
+                        default:    throw Error("bad escape in string");
+                    }
+                }
+            }
+            return value;
+        }
+
+        /** Read a number, true, false or null as its literal text */
+        std::string ReadLiteral()
+        {
+            (void)Peek();
+            const size_t start = position_;
+            while ((position_ < text_.size()) &&
+                   (IsUpperAlpha(text_[position_]) || IsLowerAlpha(text_[position_]) ||
+                    ((text_[position_] >= '0') && (text_[position_] <= '9')) ||
+                    (text_[position_] == '-') || (text_[position_] == '+') || (text_[position_] == '.')))
+            {
+                ++position_;
+            }
+            if (position_ == start)
+            {
+                throw Error("expected a value");
+            }
+            return text_.substr(start, position_ - start);
+        }
+
+        /**
+         * Skip over any value, including nested objects and arrays
+         * @param[in]   depth - Objects and arrays the value is inside of
+         * @throw   If the value is not valid JSON, or is nested deeper than JSON_MAX_DEPTH
+         */
+        void SkipValue(const size_t depth = 0U)
+        {
+            const char next = Peek();
+            if (next == '"')
+            {
+                (void)ReadString();
+            }
+            else if (((next == '{') || (next == '[')) && (depth >= JSON_MAX_DEPTH))
+            {
+                throw Error("value nested too deeply");
+            }
+            else if ((next == '{') || (next == '['))
+            {
+                const char close = (next == '{') ? '}' : ']';
+                ++position_;
+                if (Peek() == close)
+                {
+                    ++position_;
+                    return;
+                }
+                while (true)
+                {
+                    if (close == '}')
+                    {
+                        (void)ReadString();
+                        Expect(':');
+                    }
+                    SkipValue(depth + 1);
+                    if (Peek() == close)
+                    {
+                        ++position_;
+                        break;
+                    }
+                    Expect(',');
+                }
+            }
+            else
+            {
+                (void)ReadLiteral();
+            }
+        }
+
+        /** Build an error that points at the current position */
+        std::runtime_error Error(const std::string& message) const
+        {
+            return std::runtime_error("bad manifest record at column " + std::to_string(position_ + 1) +
+                                      ": " + message);
+        }
+
+    private:
+        /** Decode \uXXXX (and a following low surrogate) and append it as UTF-8 */
+        void AppendCodePoint(std::string& value)
+        {
+            uint32_t code_point = ReadHex4();
+            if ((code_point >= 0xD800) && (code_point < 0xDC00))
+            {
+                if (text_.compare(position_, 2, "\\u") != 0)
+                {
+                    throw Error("unpaired surrogate in string");
+                }
+                position_ += 2;
+                const uint32_t low = ReadHex4();
+                if ((low < 0xDC00) || (low >= 0xE000))
+                {
+                    throw Error("unpaired surrogate in string");
+                }
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+            }
+
+            if (code_point < 0x80)
+            {
+                value.push_back(static_cast<char>(code_point));
+            }
+            else if (code_point < 0x800)
+            {
+                value.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+                value.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+            else if (code_point < 0x10000)
+            {
+                value.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+                value.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+                value.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+            else
+            {
+                value.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+                value.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+                value.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+                value.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+        }
+
+        /** Read four hex digits */
+        uint32_t ReadHex4()
+        {
+            uint32_t value = 0U;
+            for (size_t digit = 0; digit < 4; ++digit, ++position_)
+            {
+                const char letter = (position_ < text_.size()) ? text_[position_] : '\0';
+                value <<= 4;
+                if ((letter >= '0') && (letter <= '9'))
+                {
+                    value |= static_cast<uint32_t>(letter - '0');
+                }
+                else if ((letter >= 'a') && (letter <= 'f'))
+                {
+                    value |= static_cast<uint32_t>(letter - 'a' + 10);
+                }
+                else if ((letter >= 'A') && (letter <= 'F'))
+                {
+                    value |= static_cast<uint32_t>(letter - 'A' + 10);
+                }
+                else
+                {
+                    throw Error("bad \\u escape in string");
+                }
+            }
+            return value;
+        }
+
+        const std::string& text_;   // The line being read
+        size_t position_;           // Offset of the next character to read
+    };
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Parse one manifest line
+     * @param[in]   line - A JSON object
+     * @return  The job described by the line
+     * @throw   If the line is not a JSON object, or method or payload is missing
+     */
+    inline ManifestRecord ParseManifestRecord(const std::string& line)
+    {
+        ManifestRecord record = ManifestRecord();
+        bool has_method = false;
+        bool has_payload = false;
+
+        JsonReader reader(line);
+        reader.Expect('{');
+        if (reader.Peek() != '}')
+        {
+            while (true)
+            {
+                const std::string name = reader.ReadString();
+                reader.Expect(':');
+                if (name == "method")
+                {
+                    record.method = reader.ReadString();
+                    has_method = true;
+                }
+                else if (name == "payload")
+                {
+                    record.payload = reader.ReadString();
+                    has_payload = true;
+                }
+                else if (name == "key")
+                {
+                    record.key = (reader.Peek() == '"') ? reader.ReadString() : reader.ReadLiteral();
+                }
+                else if (name == "decrypt")
+                {
+                    const std::string value = reader.ReadLiteral();
+                    if ((value != "true") && (value != "false"))
+                    {
+                        throw reader.Error("\"decrypt\" must be true or false");
+                    }
+                    record.decrypt = (value == "true");
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+
+                if (reader.Peek() == '}')
+                {
+                    break;
+                }
+                reader.Expect(',');
+            }
+        }
+        reader.Expect('}');
+        if (!reader.AtEnd())
+        {
+            throw reader.Error("text after the end of the record");
+        }
+        else if (!has_method)
+        {
+            throw std::runtime_error("manifest record has no \"method\"");
+        }
+        else if (!has_payload)
+        {
+            throw std::runtime_error("manifest record has no \"payload\"");
+        }
+        return record;
+    }
+
+    /**
+     * Append text as a quoted JSON string
+     * Quotes, backslashes and control characters are escaped; other bytes are copied as they are.
+     */
+    inline void AppendJsonString(std::string& output, const char* text, const size_t length)
+    {
+        static const char hex_digits[] = "0123456789abcdef";
+        output.push_back('"');
+        for (size_t index = 0; index < length; ++index)
+        {
+            const char letter = text[index];
+            if ((letter == '"') || (letter == '\\'))
+            {
+                output.push_back('\\');
+                output.push_back(letter);
+            }
+            else if (static_cast<uint8_t>(letter) < 0x20)
+            {
+                output.append("\\u00");
+                output.push_back(hex_digits[static_cast<uint8_t>(letter) >> 4]);
+                output.push_back(hex_digits[static_cast<uint8_t>(letter) & 0xF]);
+            }
+            else
+            {
+                output.push_back(letter);
+            }
+        }
+        output.push_back('"');
+    }
+
+    /** Build a result line: {"result":"..."} or {"error":"..."} */
+    inline std::string ManifestResultLine(const bool ok, const std::string& text)
+    {
+        std::string line(ok ? "{\"result\":" : "{\"error\":");
+        line.reserve(text.size() + 16);
+        AppendJsonString(line, text.data(), text.size());
+        line.push_back('}');
+        return line;
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_MANIFEST_HPP_
@@ -0,0 +1,239 @@
+/************************************************************\
+Filename:   cipher_mmap.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Memory-mapped files, so the cipher kernels can read the
+    input and write the output directly in the page cache
+    without copying through stream buffers and strings.
+
+    Only regular files can be mapped. Open returns false for
+    anything else (pipes, terminals, devices), and the caller
+    falls back to the stream path.
+
+\************************************************************/
+
+
+#ifndef CIPHER_MMAP_HPP_
+#define CIPHER_MMAP_HPP_
+
+
+/* ===== Includes ===== */
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace cipher {
+
+    /* ===== Functions ===== */
+
+    /**
+     * Check if two paths name the same existing file
+     * A file can't be mapped for input and output at once, since
+     * pre-sizing the output would change the input under the cipher.
+     */
+    inline bool IsSameFile(const char* first_path, const char* second_path)
+    {
+        struct stat first_stat;
+        struct stat second_stat;
+        return (stat(first_path, &first_stat) == 0) &&
+               (stat(second_path, &second_stat) == 0) &&
+               (first_stat.st_dev == second_stat.st_dev) &&
+               (first_stat.st_ino == second_stat.st_ino);
+    }
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * A regular file mapped read-only
+     */
+    class MappedInput
+    {
+    public:
+        MappedInput() :
+            data_(nullptr),
+            size_(0U)
+        {
+        }
+
+        ~MappedInput()
+        {
+            Close();
+        }
+
+        MappedInput(const MappedInput&) = delete;
+        MappedInput& operator=(const MappedInput&) = delete;
+
+        /**
+         * Map a file for reading, hinting that it will be read front to back
+         * @param[in]   path - File to map
+         * @return  False if the file can't be opened, is not a regular file or can't be mapped
+         */
+        bool Open(const char* path)
+        {
+            Close();
+            const int fd = open(path, O_RDONLY);
+            if (fd < 0)
+            {
+                return false;
+            }
+
+            struct stat file_stat;
+            bool mapped = (fstat(fd, &file_stat) == 0) && S_ISREG(file_stat.st_mode);
+            if (mapped && (file_stat.st_size > 0))
+            {
+                size_ = static_cast<size_t>(file_stat.st_size);
+                void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    size_ = 0U;
+                    mapped = false;
+                }
+                else
+                {
+                    data_ = static_cast<const char*>(data);
+                    (void)madvise(data, size_, MADV_SEQUENTIAL);
+                }
+            }
+
+            // The mapping stays valid after the descriptor is closed
+            (void)close(fd);
+            return mapped;
+        }
+
+        /** Unmap the file */
+        void Close()
+        {
+            if (data_ != nullptr)
+            {
+                (void)munmap(const_cast<char*>(data_), size_);
+            }
+            data_ = nullptr;
+            size_ = 0U;
+        }
+
+        /** First byte of the file, or null for an empty file */
+        const char* Data() const
+        {
+            return data_;
+        }
+
+        /** Size of the file in bytes */
+        size_t Size() const
+        {
+            return size_;
+        }
+
+    private:
+        const char* data_;  // Start of the mapping
+        size_t size_;       // Length of the mapping
+    };
+
+    /**
+     * A regular file created (or truncated) at a known size and mapped for writing
+     */
+    class MappedOutput
+    {
+    public:
+        MappedOutput() :
+            fd_(-1),
+            data_(nullptr),
+            size_(0U)
+        {
+        }
+
+        ~MappedOutput()
+        {
+            Close(size_);
+        }
+
+        MappedOutput(const MappedOutput&) = delete;
+        MappedOutput& operator=(const MappedOutput&) = delete;
+
+        /**
+         * Create the file at its final size and map it, hinting that it will be written front to back
+         * The blocks are allocated up front, so a full disk is found here instead
+         * of as a SIGBUS when a store first touches a page that has no block.
+         * @param[in]   path - File to create or overwrite
+         * @param[in]   size - Size of the output in bytes, at least 1
+         * @return  False if the file can't be opened, is not a regular file, can't be resized,
+         *          can't be allocated or can't be mapped
+         */
+        bool Open(const char* path, const size_t size)
+        {
+            Close(size_);
+            fd_ = open(path, O_RDWR | O_CREAT, 0666);
+            if (fd_ < 0)
+            {
+                return false;
+            }
+
+            struct stat file_stat;
+            void* data = MAP_FAILED;
+            if ((fstat(fd_, &file_stat) == 0) && S_ISREG(file_stat.st_mode) &&
+                (ftruncate(fd_, static_cast<off_t>(size)) == 0) &&
+                (posix_fallocate(fd_, 0, static_cast<off_t>(size)) == 0))
+            {
+                data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            }
+            if (data == MAP_FAILED)
+            {
+                (void)close(fd_);
+                fd_ = -1;
+                return false;
+            }
+
+            data_ = static_cast<char*>(data);
+            size_ = size;
+            (void)madvise(data, size_, MADV_SEQUENTIAL);
+            return true;
+        }
+
+        /**
+         * Unmap the file and set its final size
+         * @param[in]   final_size - Bytes of output to keep, at most the size it was opened with
+         */
+        void Close(const size_t final_size)
+        {
+            if (data_ != nullptr)
+            {
+                (void)munmap(data_, size_);
+                if (final_size != size_)
+                {
+                    (void)ftruncate(fd_, static_cast<off_t>(final_size));
+                }
+            }
+            if (fd_ >= 0)
+            {
+                (void)close(fd_);
+            }
+            fd_ = -1;
+            data_ = nullptr;
+            size_ = 0U;
+        }
+
+        /** First byte of the mapping */
+        char* Data()
+        {
+            return data_;
+        }
+
+        /** Size of the mapping in bytes */
+        size_t Size() const
+        {
+            return size_;
+        }
+
+    private:
+        int fd_;        // Open descriptor, kept to resize the file on close
+        char* data_;    // Start of the mapping
+        size_t size_;   // Length of the mapping
+    };
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_MMAP_HPP_
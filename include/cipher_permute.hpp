@@ -0,0 +1,258 @@
+/************************************************************\
+Filename:   cipher_permute.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    In-place permutation of a byte buffer, used by the
+    transposition ciphers to encrypt and decrypt without a
+    second full-size buffer.
+
+    Every permutation is made of independent cycles. Starting
+    from the first position not yet visited, each cycle is
+    followed until it returns to its start, moving one byte
+    per step and holding only a single byte aside. A bitmap
+    (one bit per byte of input) records which positions have
+    already been placed.
+
+    Both functions take a map from a position in the
+    "natural" order (e.g. plaintext) to a position in the
+    permuted order (e.g. ciphertext):
+    - ScatterInPlace moves the byte at p to map(p)
+    - GatherInPlace moves the byte at map(p) to p
+    so one map serves both encryption and decryption.
+
+    StreamingTransposition applies the same kind of map to a
+    message that arrives in chunks, when its length is known
+    up front.
+
+\************************************************************/
+
+
+#ifndef CIPHER_PERMUTE_HPP_
+#define CIPHER_PERMUTE_HPP_
+
+
+/* ===== Includes ===== */
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+namespace cipher {
+
+    /* ===== Classes ===== */
+
+    /**
+     * One bit per position, tracking which positions hold their final byte
+     */
+    class VisitedBitmap
+    {
+    public:
+        /** Create a bitmap with all positions unvisited */
+        explicit VisitedBitmap(const size_t length) :
+            words_((length + 63) / 64, 0U)
+        {
+        }
+
+        /** Check if a position has been visited */
+        bool Test(const size_t index) const
+        {
+            return ((words_[index / 64] >> (index % 64)) & 1U) != 0U;
+        }
+
+        /** Mark a position as visited */
+        void Set(const size_t index)
+        {
+            words_[index / 64] |= (uint64_t(1) << (index % 64));
+        }
+
+        /**
+         * Find the first unvisited position at or after index
+         * Whole words of visited positions are skipped at once.
+         */
+        size_t NextUnvisited(size_t index, const size_t length) const
+        {
+            while (index < length)
+            {
+                const uint64_t unvisited = ~words_[index / 64] >> (index % 64);
+                if (unvisited != 0U)
+                {
+                    index += static_cast<size_t>(__builtin_ctzll(unvisited));
+                    break;
+                }
+                index += 64 - (index % 64);
+            }
+            return (index < length) ? index : length;
+        }
+
+    private:
+        std::vector<uint64_t> words_;
+    };
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Permute a buffer in place, moving the byte at each position p to map(p)
+     * @param[in,out]   data - The buffer to permute
+     * @param[in]       length - Size of the buffer
+     * @param[in]       map - Callable returning the destination of each position; must be a permutation
+     */
+    template <typename IndexMap>
+    inline void ScatterInPlace(char* data, const size_t length, const IndexMap& map)
+    {
+        VisitedBitmap visited(length);
+        for (size_t start = visited.NextUnvisited(0, length);
+             start < length;
+             start = visited.NextUnvisited(start + 1, length))
+        {
+            // Carry the displaced byte around the cycle until it closes
+            char carry = data[start];
+            size_t current = start;
+            do
+            {
+                current = map(current);
+                std::swap(carry, data[current]);
+                visited.Set(current);
+            }
+            while (current != start);
+        }
+    }
+
+    /**
+     * Permute a buffer in place, moving the byte at each position map(p) to p
+     * @param[in,out]   data - The buffer to permute
+     * @param[in]       length - Size of the buffer
+     * @param[in]       map - Callable returning the source of each position; must be a permutation
+     */
+    template <typename IndexMap>
+    inline void GatherInPlace(char* data, const size_t length, const IndexMap& map)
+    {
+        VisitedBitmap visited(length);
+        for (size_t start = visited.NextUnvisited(0, length);
+             start < length;
+             start = visited.NextUnvisited(start + 1, length))
+        {
+            // Pull each byte into place, holding the first one aside
+            const char first = data[start];
+            size_t current = start;
+            size_t source = map(current);
+            while (source != start)
+            {
+                data[current] = data[source];
+                visited.Set(current);
+                current = source;
+                source = map(current);
+            }
+            data[current] = first;
+            visited.Set(current);
+        }
+    }
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Transposition of a message that arrives in chunks, with its length known up front
+     * Each byte is moved straight to its final place in the output as it
+     * arrives, so nothing is buffered but the output itself. The output
+     * fills from the front as the bytes it needs arrive, and Ready() says
+     * how much of it is final and can be sent on.
+     *
+     * Layout maps positions both ways for the whole message:
+     * CipherIndex(plaintext offset) and PlainIndex(ciphertext offset).
+     */
+    template <typename Layout>
+    class StreamingTransposition
+    {
+    public:
+        /**
+         * Start a message
+         * @param[in]   layout - Positions of the transposition, for this length
+         * @param[in]   identity - Leave every byte where it is and ignore layout
+         * @param[in]   length - Length of the whole message
+         * @param[in]   decrypt - Map ciphertext to plaintext instead of the other way round
+         * @param[out]  output - The result, length bytes, owned by the caller
+         */
+        StreamingTransposition(const Layout& layout,
+                               const bool identity,
+                               const size_t length,
+                               const bool decrypt,
+                               char* output) :
+            layout_(layout),
+            identity_(identity),
+            decrypt_(decrypt),
+            length_(length),
+            received_(0U),
+            ready_(0U),
+            output_(output)
+        {
+        }
+
+        /**
+         * Place the next piece of the message in the output
+         * @param[in]   input - The piece, which must not overlap the output
+         * @param[in]   count - Length of the piece; at most Length() - Received()
+         */
+        void Write(const char* input, const size_t count)
+        {
+            for (size_t index = 0; index < count; ++index)
+            {
+                output_[Destination(received_ + index)] = input[index];
+            }
+            received_ += count;
+        }
+
+        /**
+         * Find how much of the front of the output is final
+         * Each position is checked once over the whole message, so this
+         * costs constant time per byte however often it is called.
+         * @return  Length of the output prefix whose bytes have all arrived
+         */
+        size_t Ready()
+        {
+            while ((ready_ < length_) && (Source(ready_) < received_))
+            {
+                ++ready_;
+            }
+            return ready_;
+        }
+
+        /** Length of the whole message */
+        size_t Length() const
+        {
+            return length_;
+        }
+
+        /** Bytes of the message placed so far */
+        size_t Received() const
+        {
+            return received_;
+        }
+
+    private:
+        /** Output position of an input position */
+        size_t Destination(const size_t index) const
+        {
+            return identity_ ? index : (decrypt_ ? layout_.PlainIndex(index) : layout_.CipherIndex(index));
+        }
+
+        /** Input position of an output position */
+        size_t Source(const size_t index) const
+        {
+            return identity_ ? index : (decrypt_ ? layout_.CipherIndex(index) : layout_.PlainIndex(index));
+        }
+
+        Layout layout_;     // Positions of the transposition
+        bool identity_;     // Every byte stays where it is
+        bool decrypt_;      // Input is ciphertext
+        size_t length_;     // Length of the whole message
+        size_t received_;   // Bytes of input placed so far
+        size_t ready_;      // Length of the output prefix known to be final
+        char* output_;      // The result, owned by the caller
+    };
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_PERMUTE_HPP_
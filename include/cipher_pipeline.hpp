@@ -0,0 +1,356 @@
+/************************************************************\
+Filename:   cipher_pipeline.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Pipelined streaming, so reading, ciphering and writing a
+    stream overlap instead of taking turns.
+
+    Three threads share a small set of reusable chunks:
+
+        reader --filled--> cipher --done--> writer
+           ^                                  |
+           +--------------- free -------------+
+
+    Each arrow is a lock-free single-producer single-consumer
+    ring of chunk pointers. The reader fills a free chunk from
+    the input, the cipher thread (the caller) transforms it in
+    place, and the writer writes it out and hands it back to
+    the reader. With a few chunks in flight, a slow read or
+    write no longer stalls the cipher, and the other way round.
+
+    Output is the same as StreamTransform (cipher_stream.hpp)
+    for ciphers that work letter by letter: trailing whitespace
+    of the whole stream is dropped and a newline is written at
+    the end, unless the stream is binary data. The transposition
+    ciphers need their blocks framed exactly, so they keep using
+    StreamTransform.
+
+\************************************************************/
+
+
+#ifndef CIPHER_PIPELINE_HPP_
+#define CIPHER_PIPELINE_HPP_
+
+
+/* ===== Includes ===== */
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cipher_result.hpp"
+#include "cipher_stream.hpp"
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** Chunks shared by the pipeline: one being read, one ciphered, one written, one spare */
+    const size_t PIPELINE_CHUNKS = 4;
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Wait a little longer each time a ring is found empty or full
+     * Spins briefly first, since the other side is usually about to
+     * finish a chunk, then sleeps so a thread waiting on slow I/O
+     * doesn't hold a core.
+     * @param[in,out]   attempt - Times waited so far, starting at zero
+     */
+    inline void Backoff(size_t& attempt)
+    {
+        if (attempt < 64)
+        {
+            // Spin
+        }
+        else if (attempt < 128)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        ++attempt;
+    }
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Lock-free ring for passing values from one thread to one other thread
+     */
+    template <typename T>
+    class SpscRing
+    {
+    public:
+        /**
+         * Create an empty ring
+         * @param[in]   capacity - Most values held at once; rounded up to a power of two
+         */
+        explicit SpscRing(const size_t capacity) :
+            slots_(RoundUpPowerOfTwo(capacity)),
+            mask_(slots_.size() - 1),
+            head_(0U),
+            tail_(0U)
+        {
+        }
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        /**
+         * Add a value, from the producer thread only
+         * @return  False if the ring is full
+         */
+        bool TryPush(const T& value)
+        {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            if ((tail - head_.load(std::memory_order_acquire)) == slots_.size())
+            {
+                return false;
+            }
+            slots_[tail & mask_] = value;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Take the oldest value, from the consumer thread only
+         * @return  False if the ring is empty
+         */
+        bool TryPop(T& value)
+        {
+            const size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            value = slots_[head & mask_];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Add a value, waiting while the ring is full */
+        void Push(const T& value)
+        {
+            for (size_t attempt = 0; !TryPush(value); )
+            {
+                Backoff(attempt);
+            }
+        }
+
+        /**
+         * Take the oldest value, waiting while the ring is empty
+         * @param[out]  value - The value taken
+         * @param[in]   abort - Stop waiting once this is set
+         * @return  False if aborted before a value arrived
+         */
+        bool Pop(T& value, const std::atomic<bool>& abort)
+        {
+            for (size_t attempt = 0; !TryPop(value); )
+            {
+                if (abort.load(std::memory_order_relaxed))
+                {
+                    return false;
+                }
+                Backoff(attempt);
+            }
+            return true;
+        }
+
+    private:
+        /** Smallest power of two at least value */
+        static size_t RoundUpPowerOfTwo(const size_t value)
+        {
+            size_t power = 1U;
+            while (power < value)
+            {
+                power *= 2;
+            }
+            return power;
+        }
+
+        std::vector<T> slots_;                      // Storage, a power of two long
+        size_t mask_;                               // Turns a position into a slot index
+        alignas(64) std::atomic<size_t> head_;      // Next position to pop, written by the consumer
+        alignas(64) std::atomic<size_t> tail_;      // Next position to push, written by the producer
+    };
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Run a cipher over a stream with reading, ciphering and writing on separate threads
+     * Output written before an error is found is not taken back.
+     * The input and output streams are used only by the reader and writer
+     * threads while this runs; the input is untied from any output stream
+     * for that time, so reading doesn't flush the output from the wrong thread.
+     * @param[in]   input - Stream to read the text from
+     * @param[out]  output - Stream to write the result to. A newline is written after the text.
+     * @param[in]   chunk_size - Bytes read and written at a time
+     * @param[in]   transform - Callable (const char* input, char* output, size_t length,
+     *                          size_t stream_offset) returning a CipherResult, where
+     *                          stream_offset is the position of the text in the stream.
+     *                          It is called with input == output, and with pieces of any size.
+     * @param[in]   binary - Keep trailing whitespace and write no newline after the text
+     * @return  The first error from transform, with its offset in the whole stream
+     * @throw   Whatever transform throws, once the other threads have stopped
+     */
+    template <typename Transform>
+    inline CipherResult PipelinedStreamTransform(std::istream& input,
+                                                 std::ostream& output,
+                                                 const size_t chunk_size,
+                                                 const Transform& transform,
+                                                 const bool binary = false)
+    {
+        struct Chunk
+        {
+            std::string data;       // Bytes read, ciphered in place
+            size_t length;          // Bytes of data read
+            size_t text_length;     // Bytes of data to write
+            std::string prefix;     // Held-back whitespace to write before data
+            bool last;              // The end of the input
+            bool failed;            // The cipher stopped here; write nothing more
+        };
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        SpscRing<Chunk*> free_chunks(PIPELINE_CHUNKS);
+        SpscRing<Chunk*> filled_chunks(PIPELINE_CHUNKS);
+        SpscRing<Chunk*> done_chunks(PIPELINE_CHUNKS);
+        for (size_t index = 0; index < PIPELINE_CHUNKS; ++index)
+        {
+            chunks.emplace_back(new Chunk{std::string(chunk_size, '\0'), 0U, 0U, std::string(), false, false});
+            (void)free_chunks.TryPush(chunks.back().get());
+        }
+        std::atomic<bool> abort(false);
+        std::ostream* const tied = input.tie(nullptr);
+
+        std::thread reader([&]()
+        {
+            Chunk* chunk = nullptr;
+            while (free_chunks.Pop(chunk, abort))
+            {
+                input.read(&chunk->data[0], static_cast<std::streamsize>(chunk_size));
+                chunk->length = static_cast<size_t>(input.gcount());
+                chunk->last = !input.good();
+                filled_chunks.Push(chunk);
+                if (chunk->last)
+                {
+                    break;
+                }
+            }
+        });
+
+        std::thread writer([&]()
+        {
+            // The cipher thread always sends a last or failed chunk, so never give up waiting
+            const std::atomic<bool> never(false);
+            Chunk* chunk = nullptr;
+            while (done_chunks.Pop(chunk, never))
+            {
+                if (chunk->failed)
+                {
+                    break;
+                }
+                output.write(chunk->prefix.data(), static_cast<std::streamsize>(chunk->prefix.size()));
+                output.write(chunk->data.data(), static_cast<std::streamsize>(chunk->text_length));
+                if (chunk->last)
+                {
+                    if (!binary)
+                    {
+                        output << '\n';
+                    }
+                    output.flush();
+                    break;
+                }
+                free_chunks.Push(chunk);
+            }
+        });
+
+        // Cipher each chunk as it arrives. A run of whitespace at the end of
+        // a chunk may be the end of the stream, so it is held back until
+        // more text follows it.
+        CipherResult result = ResultOk();
+        std::exception_ptr error;
+        std::string held;
+        size_t stream_offset = 0U;
+        Chunk stop_chunk{std::string(), 0U, 0U, std::string(), false, false};
+        Chunk* chunk = nullptr;     // The chunk being ciphered, null once it is passed on
+        try
+        {
+            while (filled_chunks.Pop(chunk, abort))
+            {
+                char* const text = &chunk->data[0];
+                const size_t text_end = binary ? chunk->length : TrimmedEnd(text, 0, chunk->length);
+                chunk->prefix.clear();
+                chunk->text_length = 0U;
+                if (text_end > 0)
+                {
+                    if (!held.empty())
+                    {
+                        result = transform(held.data(), &held[0], held.size(), stream_offset);
+                        if (result.Ok())
+                        {
+                            stream_offset += held.size();
+                            chunk->prefix.swap(held);
+                            held.clear();
+                        }
+                    }
+                    if (result.Ok())
+                    {
+                        result = transform(text, text, text_end, stream_offset);
+                    }
+                    if (!result.Ok())
+                    {
+                        result.offset += stream_offset;
+                        chunk->failed = true;
+                        abort = true;
+                        done_chunks.Push(chunk);
+                        chunk = nullptr;
+                        break;
+                    }
+                    stream_offset += text_end;
+                    chunk->text_length = text_end;
+                }
+                held.append(text + text_end, chunk->length - text_end);
+                const bool last = chunk->last;
+                done_chunks.Push(chunk);
+                chunk = nullptr;
+                if (last)
+                {
+                    break;
+                }
+            }
+        }
+        catch (...)
+        {
+            // Stop the other threads before passing the exception on. The
+            // writer waits for a failed chunk, so send one even if none is held.
+            error = std::current_exception();
+            abort = true;
+            Chunk* const failed_chunk = (chunk != nullptr) ? chunk : &stop_chunk;
+            failed_chunk->failed = true;
+            done_chunks.Push(failed_chunk);
+        }
+
+        reader.join();
+        writer.join();
+        (void)input.tie(tied);
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return result;
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_PIPELINE_HPP_
@@ -0,0 +1,187 @@
+/************************************************************\
+Filename:   cipher_protocol.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Wire format for the cipher server.
+
+    Every message is a frame: a 4 byte little-endian length
+    followed by that many bytes of body.
+
+    A request body holds one job, the same fields as a
+    manifest record:
+
+        u8   flags           bit 0 set to decrypt
+        u8   method length
+        u16  key length      little-endian
+        ...  method
+        ...  key
+        ...  payload         the rest of the body
+
+    A response body is a status byte (0 for success, 1 for an
+    error) followed by the result text or the error message.
+
+    Any number of requests may be sent on one connection
+    without waiting; responses come back in the same order.
+
+\************************************************************/
+
+
+#ifndef CIPHER_PROTOCOL_HPP_
+#define CIPHER_PROTOCOL_HPP_
+
+
+/* ===== Includes ===== */
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "cipher_manifest.hpp"
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** Bytes in the length prefix of each frame */
+    const size_t FRAME_HEADER_SIZE = 4;
+
+    /** Largest frame body accepted, so one bad length can't exhaust memory */
+    const size_t FRAME_MAX_SIZE = 64 * 1024 * 1024;
+
+    /** Bytes in a request body before the method name */
+    const size_t REQUEST_HEADER_SIZE = 4;
+
+    /** Request flag: decrypt instead of encrypt */
+    const uint8_t REQUEST_FLAG_DECRYPT = 0x01;
+
+    /** Response status bytes */
+    const uint8_t RESPONSE_OK = 0;
+    const uint8_t RESPONSE_ERROR = 1;
+
+
+    /* ===== Functions ===== */
+
+    /** Read a little-endian 32 bit length */
+    inline uint32_t ReadFrameLength(const char* header)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(header);
+        return static_cast<uint32_t>(bytes[0]) |
+               (static_cast<uint32_t>(bytes[1]) << 8) |
+               (static_cast<uint32_t>(bytes[2]) << 16) |
+               (static_cast<uint32_t>(bytes[3]) << 24);
+    }
+
+    /** Append a little-endian 32 bit length */
+    inline void AppendFrameLength(std::string& frame, const size_t length)
+    {
+        frame.push_back(static_cast<char>(length & 0xFF));
+        frame.push_back(static_cast<char>((length >> 8) & 0xFF));
+        frame.push_back(static_cast<char>((length >> 16) & 0xFF));
+        frame.push_back(static_cast<char>((length >> 24) & 0xFF));
+    }
+
+    /**
+     * Build a request frame
+     * @param[in]   request - The job to send
+     * @return  The frame, length prefix included
+     * @throw   If the method, key or whole frame is too long to encode
+     */
+    inline std::string EncodeRequest(const ManifestRecord& request)
+    {
+        if (request.method.size() > 0xFF)
+        {
+            throw std::runtime_error("method name is too long");
+        }
+        else if (request.key.size() > 0xFFFF)
+        {
+            throw std::runtime_error("key is too long");
+        }
+        const size_t body_size = REQUEST_HEADER_SIZE + request.method.size() +
+                                 request.key.size() + request.payload.size();
+        if (body_size > FRAME_MAX_SIZE)
+        {
+            throw std::runtime_error("payload is too long");
+        }
+
+        std::string frame;
+        frame.reserve(FRAME_HEADER_SIZE + body_size);
+        AppendFrameLength(frame, body_size);
+        frame.push_back(static_cast<char>(request.decrypt ? REQUEST_FLAG_DECRYPT : 0));
+        frame.push_back(static_cast<char>(request.method.size()));
+        frame.push_back(static_cast<char>(request.key.size() & 0xFF));
+        frame.push_back(static_cast<char>(request.key.size() >> 8));
+        frame.append(request.method);
+        frame.append(request.key);
+        frame.append(request.payload);
+        return frame;
+    }
+
+    /**
+     * Read a request body
+     * @param[in]   body - Frame body, without the length prefix
+     * @param[in]   length - Size of the body
+     * @return  The job described by the body
+     * @throw   If the body is shorter than its method and key lengths
+     */
+    inline ManifestRecord DecodeRequest(const char* body, const size_t length)
+    {
+        if (length < REQUEST_HEADER_SIZE)
+        {
+            throw std::runtime_error("request is too short");
+        }
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(body);
+        const size_t method_length = bytes[1];
+        const size_t key_length = static_cast<size_t>(bytes[2]) | (static_cast<size_t>(bytes[3]) << 8);
+        if (REQUEST_HEADER_SIZE + method_length + key_length > length)
+        {
+            throw std::runtime_error("request is too short");
+        }
+
+        ManifestRecord request = ManifestRecord();
+        const char* field = body + REQUEST_HEADER_SIZE;
+        request.decrypt = ((bytes[0] & REQUEST_FLAG_DECRYPT) != 0);
+        request.method.assign(field, method_length);
+        field += method_length;
+        request.key.assign(field, key_length);
+        field += key_length;
+        request.payload.assign(field, static_cast<size_t>(body + length - field));
+        return request;
+    }
+
+    /**
+     * Build a response frame
+     * @param[in]   ok - True for a result, false for an error
+     * @param[in]   text - The result or error message
+     */
+    inline std::string EncodeResponse(const bool ok, const std::string& text)
+    {
+        std::string frame;
+        frame.reserve(FRAME_HEADER_SIZE + 1 + text.size());
+        AppendFrameLength(frame, 1 + text.size());
+        frame.push_back(static_cast<char>(ok ? RESPONSE_OK : RESPONSE_ERROR));
+        frame.append(text);
+        return frame;
+    }
+
+    /**
+     * Read a response body
+     * @param[in]   body - Frame body, without the length prefix
+     * @param[in]   length - Size of the body
+     * @param[out]  text - The result or error message
+     * @return  True for a result, false for an error
+     * @throw   If the body is empty
+     */
+    inline bool DecodeResponse(const char* body, const size_t length, std::string& text)
+    {
+        if (length < 1)
+        {
+            throw std::runtime_error("response is too short");
+        }
+        text.assign(body + 1, length - 1);
+        return (static_cast<uint8_t>(body[0]) == RESPONSE_OK);
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_PROTOCOL_HPP_
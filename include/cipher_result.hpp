@@ -0,0 +1,102 @@
+/************************************************************\
+Filename:   cipher_result.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    This header contains the result type returned by the
+    non-throwing cipher functions (the Try... functions).
+
+    Each cipher has a pair of entry points:
+    - EncryptXxxAlpha throws std::runtime_error on bad input
+    - TryEncryptXxxAlpha returns a CipherResult instead, for
+      callers where exceptions are too expensive
+
+    When the result is an error, the contents of the output
+    text are unspecified.
+
+\************************************************************/
+
+
+#ifndef CIPHER_RESULT_HPP_
+#define CIPHER_RESULT_HPP_
+
+
+/* ===== Includes ===== */
+#include <cstddef>
+#include <stdexcept>
+#include "cipher_utils.hpp"
+
+
+namespace cipher {
+
+    /* ===== Types ===== */
+
+    /**
+     * Outcome of a cipher operation
+     */
+    enum CipherStatus
+    {
+        CIPHER_STATUS_OK,               // Success
+        CIPHER_STATUS_INVALID_TEXT,     // Input text contains a character the cipher can't handle
+        CIPHER_STATUS_INVALID_KEY,      // The cipher key is out of range
+    };
+
+    /**
+     * Result of a non-throwing cipher operation
+     */
+    struct CipherResult
+    {
+        CipherStatus status;    // Outcome of the operation
+        size_t offset;          // Offset of the offending character in the input text
+        char value;             // The offending character
+
+        /** True if the operation succeeded */
+        bool Ok() const
+        {
+            return status == CIPHER_STATUS_OK;
+        }
+    };
+
+
+    /* ===== Functions ===== */
+
+    /** Build a successful result */
+    inline CipherResult ResultOk()
+    {
+        return CipherResult{CIPHER_STATUS_OK, 0U, '\0'};
+    }
+
+    /** Build a result for an invalid character in the input text */
+    inline CipherResult ResultInvalidText(const size_t offset, const char value)
+    {
+        return CipherResult{CIPHER_STATUS_INVALID_TEXT, offset, value};
+    }
+
+    /** Build a result for an out of range key */
+    inline CipherResult ResultInvalidKey()
+    {
+        return CipherResult{CIPHER_STATUS_INVALID_KEY, 0U, '\0'};
+    }
+
+    /**
+     * Convert an error result to an exception
+     * @param[in]   result - Result of a Try... function
+     * @param[in]   key_message - Message used if the key was out of range
+     * @param[in]   text_name - What the input text was, "plaintext" or "ciphertext"
+     * @throw   If result is not OK
+     */
+    inline void ThrowIfError(const CipherResult& result, const char* key_message, const char* text_name)
+    {
+        if (result.status == CIPHER_STATUS_INVALID_TEXT)
+        {
+            throw NonAlphaError(result.value, text_name);
+        }
+        else if (result.status == CIPHER_STATUS_INVALID_KEY)
+        {
+            throw std::runtime_error(key_message);
+        }
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_RESULT_HPP_
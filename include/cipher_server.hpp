@@ -0,0 +1,703 @@
+/************************************************************\
+Filename:   cipher_server.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    A long-running cipher server on a Unix domain socket, and
+    a blocking client for it.
+
+    The server keeps one epoll loop on the calling thread. It
+    accepts connections, reads frames (see cipher_protocol.hpp)
+    into per-connection buffers and hands each complete request
+    to a worker pool. Workers post finished responses back to
+    the loop through an eventfd, and the loop writes them out
+    in request order for each connection. No socket is ever
+    read or written outside the loop, and the loop never runs
+    a cipher itself, so one large request doesn't hold up the
+    other connections.
+
+    A connection stops being read while it has too many
+    requests in the workers or too much output the client has
+    not taken yet, so a client that pipelines requests without
+    reading the answers can't grow the server without bound.
+
+\************************************************************/
+
+
+#ifndef CIPHER_SERVER_HPP_
+#define CIPHER_SERVER_HPP_
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "cipher_protocol.hpp"
+#include "cipher_thread_pool.hpp"
+
+
+namespace cipher {
+
+    /* ===== Functions ===== */
+
+    /**
+     * Fill in a Unix socket address
+     * @throw   If the path doesn't fit in the address
+     */
+    inline sockaddr_un UnixSocketAddress(const std::string& path)
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || (path.size() >= sizeof(address.sun_path)))
+        {
+            throw std::runtime_error("bad socket path \"" + path + "\"");
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    /** Build an exception from errno */
+    inline std::runtime_error SystemError(const std::string& what)
+    {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Server answering cipher requests on a Unix domain socket
+     */
+    class CipherServer
+    {
+    public:
+        /**
+         * Callable that runs one request on a worker thread
+         * Returns true with the result in text, or false with an error message in text.
+         */
+        typedef std::function<bool(const ManifestRecord& request, std::string& text)> Handler;
+
+        /**
+         * Set up the server without listening yet
+         * @param[in]   handler - Runs each request; called from several threads at once
+         * @param[in]   num_threads - Worker threads running requests. Zero means one per hardware thread.
+         */
+        CipherServer(const Handler& handler, const size_t num_threads) :
+            handler_(handler),
+            pool_(((num_threads == 0) ? std::max(1U, std::thread::hardware_concurrency()) : num_threads) + 1),
+            listen_fd_(-1),
+            epoll_fd_(-1),
+            wake_fd_(-1),
+            next_connection_(FIRST_CONNECTION_ID),
+            stopping_(false),
+            in_flight_(0)
+        {
+            epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+            wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if ((epoll_fd_ < 0) || (wake_fd_ < 0))
+            {
+                CloseDescriptors();
+                throw SystemError("cannot create event loop");
+            }
+            Watch(wake_fd_, WAKE_ID, EPOLLIN);
+        }
+
+        /** Close the socket and every connection */
+        ~CipherServer()
+        {
+            // Workers may still be finishing requests that point back here
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_.wait(lock, [this]() { return in_flight_ == 0; });
+            lock.unlock();
+
+            for (const auto& entry : connections_)
+            {
+                (void)close(entry.second.fd);
+            }
+            if (listen_fd_ >= 0)
+            {
+                (void)unlink(socket_path_.c_str());
+            }
+            CloseDescriptors();
+        }
+
+        CipherServer(const CipherServer&) = delete;
+        CipherServer& operator=(const CipherServer&) = delete;
+
+        /**
+         * Create the socket and start listening
+         * A stale socket file left at the path is replaced.
+         * @param[in]   path - Filesystem path of the socket
+         * @throw   If the socket can't be created, bound or listened on
+         */
+        void Listen(const std::string& path)
+        {
+            const sockaddr_un address = UnixSocketAddress(path);
+            listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listen_fd_ < 0)
+            {
+                throw SystemError("cannot create socket");
+            }
+            (void)unlink(path.c_str());
+            if ((bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) ||
+                (listen(listen_fd_, SOMAXCONN) != 0))
+            {
+                const std::runtime_error error = SystemError("cannot listen on \"" + path + "\"");
+                (void)close(listen_fd_);
+                listen_fd_ = -1;
+                throw error;
+            }
+            socket_path_ = path;
+            Watch(listen_fd_, LISTEN_ID, EPOLLIN);
+        }
+
+        /**
+         * Serve requests until Stop is called
+         * @throw   If the event loop itself fails
+         */
+        void Run()
+        {
+            epoll_event events[64];
+            while (!stopping_)
+            {
+                const int count = epoll_wait(epoll_fd_, events, 64, -1);
+                if (count < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw SystemError("event loop failed");
+                }
+
+                for (int index = 0; index < count; ++index)
+                {
+                    const uint64_t id = events[index].data.u64;
+                    if (id == LISTEN_ID)
+                    {
+                        AcceptConnections();
+                    }
+                    else if (id == WAKE_ID)
+                    {
+                        DeliverResponses();
+                    }
+                    else
+                    {
+                        ServiceConnection(id, events[index].events);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Make Run return
+         * Safe to call from any thread, or from a signal handler.
+         */
+        void Stop()
+        {
+            stopping_ = true;
+            const uint64_t one = 1;
+            (void)!write(wake_fd_, &one, sizeof(one));
+        }
+
+    private:
+        /** Event loop ids for the two fixed descriptors; connections count up from there */
+        static constexpr uint64_t LISTEN_ID = 0;
+        static constexpr uint64_t WAKE_ID = 1;
+        static constexpr uint64_t FIRST_CONNECTION_ID = 2;
+
+        /** Bytes read from a socket at a time */
+        static constexpr size_t READ_SIZE = 64 * 1024;
+
+        /** Requests one connection may have unanswered before it stops being read */
+        static constexpr uint64_t MAX_QUEUED_REQUESTS = 64;
+
+        /** Unwritten response bytes one connection may have before it stops being read */
+        static constexpr size_t MAX_QUEUED_OUTPUT = 1024 * 1024;
+
+        /**
+         * One client connection, touched only by the event loop
+         */
+        struct Connection
+        {
+            int fd;                                 // Connected socket
+            std::string input;                      // Bytes read but not yet framed
+            std::string output;                     // Response bytes not yet written
+            size_t output_sent;                     // Bytes of output already written
+            uint64_t requests;                      // Requests handed to workers
+            uint64_t responses;                     // Responses moved to output
+            std::map<uint64_t, std::string> ready;  // Finished responses waiting for earlier ones
+            bool peer_closed;                       // No more requests will arrive
+            uint32_t events;                        // Events the loop is watching for
+        };
+
+        /**
+         * A response finished by a worker
+         */
+        struct Completion
+        {
+            uint64_t connection;    // Connection the request came from
+            uint64_t sequence;      // Position of the request on its connection
+            std::string frame;      // The response frame
+        };
+
+        /** Add a descriptor to the event loop */
+        void Watch(const int fd, const uint64_t id, const uint32_t events)
+        {
+            epoll_event event;
+            event.events = events;
+            event.data.u64 = id;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0)
+            {
+                throw SystemError("cannot watch descriptor");
+            }
+        }
+
+        /** Close the loop's own descriptors */
+        void CloseDescriptors()
+        {
+            for (int* fd : {&listen_fd_, &wake_fd_, &epoll_fd_})
+            {
+                if (*fd >= 0)
+                {
+                    (void)close(*fd);
+                }
+                *fd = -1;
+            }
+        }
+
+        /** Accept every pending connection */
+        void AcceptConnections()
+        {
+            while (true)
+            {
+                const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0)
+                {
+                    // EAGAIN: no more pending; anything else only affects that one client
+                    return;
+                }
+                const uint64_t id = next_connection_++;
+                Connection& connection = connections_[id];
+                connection = Connection();
+                connection.fd = fd;
+                connection.events = EPOLLIN | EPOLLRDHUP;
+                Watch(fd, id, connection.events);
+            }
+        }
+
+        /** Read from a connection, or write to it, as its events allow */
+        void ServiceConnection(const uint64_t id, const uint32_t events)
+        {
+            const auto found = connections_.find(id);
+            if (found == connections_.end())
+            {
+                return;
+            }
+            Connection& connection = found->second;
+
+            if ((events & EPOLLERR) != 0)
+            {
+                CloseConnection(id);
+                return;
+            }
+            if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) != 0)
+            {
+                if (!ReadRequests(id, connection))
+                {
+                    CloseConnection(id);
+                    return;
+                }
+            }
+            if ((events & EPOLLHUP) != 0)
+            {
+                // Both directions are shut, so no response could be delivered
+                CloseConnection(id);
+                return;
+            }
+            if ((events & EPOLLOUT) != 0)
+            {
+                FlushOutput(id, connection);
+            }
+            else
+            {
+                CloseIfDone(id, connection);
+            }
+        }
+
+        /** Check if a connection has as much queued as it may before more is read */
+        static bool Backlogged(const Connection& connection)
+        {
+            return ((connection.requests - connection.responses) >= MAX_QUEUED_REQUESTS) ||
+                   ((connection.output.size() - connection.output_sent) >= MAX_QUEUED_OUTPUT);
+        }
+
+        /**
+         * Read what is available and dispatch every complete request, until the connection is backlogged
+         * @return  False if the connection failed or sent a frame that is too large
+         */
+        bool ReadRequests(const uint64_t id, Connection& connection)
+        {
+            while (!connection.peer_closed && !Backlogged(connection))
+            {
+                const size_t filled = connection.input.size();
+                connection.input.resize(filled + READ_SIZE);
+                const ssize_t received = recv(connection.fd, &connection.input[filled], READ_SIZE, 0);
+                connection.input.resize(filled + ((received > 0) ? static_cast<size_t>(received) : 0U));
+                if (received == 0)
+                {
+                    connection.peer_closed = true;
+                }
+                else if (received < 0)
+                {
+                    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+                    {
+                        return false;
+                    }
+                    if (errno != EINTR)
+                    {
+                        break;
+                    }
+                }
+                if (!DispatchRequests(id, connection))
+                {
+                    return false;
+                }
+            }
+            return DispatchRequests(id, connection);
+        }
+
+        /**
+         * Dispatch the complete requests already read, until the connection is backlogged
+         * @return  False if the connection sent a frame that is too large
+         */
+        bool DispatchRequests(const uint64_t id, Connection& connection)
+        {
+            size_t consumed = 0U;
+            while (((connection.input.size() - consumed) >= FRAME_HEADER_SIZE) && !Backlogged(connection))
+            {
+                const size_t body_size = ReadFrameLength(connection.input.data() + consumed);
+                if (body_size > FRAME_MAX_SIZE)
+                {
+                    return false;
+                }
+                if ((connection.input.size() - consumed - FRAME_HEADER_SIZE) < body_size)
+                {
+                    break;
+                }
+                Dispatch(id, connection.requests++,
+                         connection.input.substr(consumed + FRAME_HEADER_SIZE, body_size));
+                consumed += FRAME_HEADER_SIZE + body_size;
+            }
+            connection.input.erase(0, consumed);
+            return true;
+        }
+
+        /** Hand one request body to a worker */
+        void Dispatch(const uint64_t id, const uint64_t sequence, std::string body)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++in_flight_;
+            }
+            pool_.Post([this, id, sequence, body = std::move(body)]()
+            {
+                bool ok = false;
+                std::string text;
+                try
+                {
+                    ok = handler_(DecodeRequest(body.data(), body.size()), text);
+                }
+                catch (const std::exception& error)
+                {
+                    ok = false;
+                    text = error.what();
+                }
+
+                // Nothing of the server is touched once the lock is released,
+                // since the destructor may be waiting for in_flight_ to reach zero
+                Completion completion = {id, sequence, EncodeResponse(ok, text)};
+                std::lock_guard<std::mutex> lock(mutex_);
+                completed_.push_back(std::move(completion));
+                const uint64_t one = 1;
+                (void)!write(wake_fd_, &one, sizeof(one));
+                --in_flight_;
+                idle_.notify_all();
+            });
+        }
+
+        /** Move finished responses onto their connections, in request order */
+        void DeliverResponses()
+        {
+            uint64_t wakes = 0;
+            (void)!read(wake_fd_, &wakes, sizeof(wakes));
+
+            std::vector<Completion> completed;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                completed.swap(completed_);
+            }
+
+            for (Completion& completion : completed)
+            {
+                const auto found = connections_.find(completion.connection);
+                if (found == connections_.end())
+                {
+                    continue;   // The client went away before its answer was ready
+                }
+                Connection& connection = found->second;
+                connection.ready.emplace(completion.sequence, std::move(completion.frame));
+                for (auto next = connection.ready.find(connection.responses);
+                     next != connection.ready.end();
+                     next = connection.ready.find(connection.responses))
+                {
+                    connection.output.append(next->second);
+                    connection.ready.erase(next);
+                    ++connection.responses;
+                }
+                FlushOutput(completion.connection, connection);
+            }
+        }
+
+        /** Write as much pending output as the socket takes */
+        void FlushOutput(const uint64_t id, Connection& connection)
+        {
+            while (connection.output_sent < connection.output.size())
+            {
+                const ssize_t sent = send(connection.fd, connection.output.data() + connection.output_sent,
+                                          connection.output.size() - connection.output_sent, MSG_NOSIGNAL);
+                if (sent < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                    {
+                        break;
+                    }
+                    CloseConnection(id);
+                    return;
+                }
+                connection.output_sent += static_cast<size_t>(sent);
+            }
+
+            if (connection.output_sent == connection.output.size())
+            {
+                connection.output.clear();
+                connection.output_sent = 0U;
+            }
+
+            // Requests held back while the connection was backlogged can go now
+            if (!DispatchRequests(id, connection))
+            {
+                CloseConnection(id);
+                return;
+            }
+            CloseIfDone(id, connection);
+        }
+
+        /**
+         * Watch a connection for what it can do next
+         * Writable while output is blocked; readable unless the peer is done or
+         * the connection is backlogged. A connection that is neither is left
+         * unwatched, which also stops level-triggered hangup events while its
+         * answers are still being worked on.
+         */
+        void UpdateEvents(const uint64_t id, Connection& connection)
+        {
+            const bool blocked = (connection.output_sent < connection.output.size());
+            const bool reading = !connection.peer_closed && !Backlogged(connection);
+            const uint32_t events = (blocked ? EPOLLOUT : 0U) | (reading ? (EPOLLIN | EPOLLRDHUP) : 0U);
+            if (events != connection.events)
+            {
+                epoll_event event;
+                event.events = events;
+                event.data.u64 = id;
+                (void)epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+                connection.events = events;
+            }
+        }
+
+        /** Close a connection once the peer is done and every response is written, otherwise update its events */
+        void CloseIfDone(const uint64_t id, Connection& connection)
+        {
+            if (connection.peer_closed && (connection.responses == connection.requests) &&
+                connection.output.empty())
+            {
+                CloseConnection(id);
+            }
+            else
+            {
+                UpdateEvents(id, connection);
+            }
+        }
+
+        /** Drop a connection; responses still being worked on are thrown away */
+        void CloseConnection(const uint64_t id)
+        {
+            const auto found = connections_.find(id);
+            if (found != connections_.end())
+            {
+                (void)close(found->second.fd);
+                connections_.erase(found);
+            }
+        }
+
+        Handler handler_;                                       // Runs each request
+        ThreadPool pool_;                                       // Workers running requests
+        int listen_fd_;                                         // Listening socket
+        int epoll_fd_;                                          // Event loop
+        int wake_fd_;                                           // Signals finished responses or Stop
+        std::string socket_path_;                               // Removed on shutdown
+        uint64_t next_connection_;                              // Id for the next connection
+        std::unordered_map<uint64_t, Connection> connections_;  // Open connections by id
+        std::atomic<bool> stopping_;                            // Set by Stop
+        std::mutex mutex_;                                      // Guards completed_ and in_flight_
+        std::condition_variable idle_;                          // Signals in_flight_ going down
+        std::vector<Completion> completed_;                     // Responses waiting for the loop
+        size_t in_flight_;                                      // Requests handed out but not finished
+    };
+
+    /**
+     * Blocking client for the cipher server
+     */
+    class CipherClient
+    {
+    public:
+        CipherClient() :
+            fd_(-1)
+        {
+        }
+
+        ~CipherClient()
+        {
+            Close();
+        }
+
+        CipherClient(const CipherClient&) = delete;
+        CipherClient& operator=(const CipherClient&) = delete;
+
+        /**
+         * Connect to a server
+         * @param[in]   path - Filesystem path of the server's socket
+         * @throw   If the connection fails
+         */
+        void Connect(const std::string& path)
+        {
+            Close();
+            const sockaddr_un address = UnixSocketAddress(path);
+            fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if ((fd_ < 0) ||
+                (connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0))
+            {
+                const std::runtime_error error = SystemError("cannot connect to \"" + path + "\"");
+                Close();
+                throw error;
+            }
+        }
+
+        /** Close the connection */
+        void Close()
+        {
+            if (fd_ >= 0)
+            {
+                (void)close(fd_);
+            }
+            fd_ = -1;
+        }
+
+        /**
+         * Send one request and wait for its response
+         * @param[in]   request - The job to run
+         * @param[out]  text - The result or the server's error message
+         * @return  True for a result, false for an error from the server
+         * @throw   If the connection fails, or the response is longer than FRAME_MAX_SIZE
+         */
+        bool Call(const ManifestRecord& request, std::string& text)
+        {
+            const std::string frame = EncodeRequest(request);
+            WriteAll(frame.data(), frame.size());
+
+            char header[FRAME_HEADER_SIZE];
+            ReadAll(header, FRAME_HEADER_SIZE);
+            const size_t body_size = ReadFrameLength(header);
+            if (body_size > FRAME_MAX_SIZE)
+            {
+                // The rest of the stream can't be trusted either
+                Close();
+                throw std::runtime_error("response is too long");
+            }
+            std::string body(body_size, '\0');
+            ReadAll(&body[0], body.size());
+            return DecodeResponse(body.data(), body.size(), text);
+        }
+
+    private:
+        /** Write a whole buffer to the socket */
+        void WriteAll(const char* data, size_t length)
+        {
+            while (length > 0)
+            {
+                const ssize_t sent = send(fd_, data, length, MSG_NOSIGNAL);
+                if (sent < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw SystemError("cannot send request");
+                }
+                data += sent;
+                length -= static_cast<size_t>(sent);
+            }
+        }
+
+        /** Read exactly length bytes from the socket */
+        void ReadAll(char* data, size_t length)
+        {
+            while (length > 0)
+            {
+                const ssize_t received = recv(fd_, data, length, 0);
+                if (received == 0)
+                {
+                    throw std::runtime_error("server closed the connection");
+                }
+                else if (received < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw SystemError("cannot read response");
+                }
+                data += received;
+                length -= static_cast<size_t>(received);
+            }
+        }
+
+        int fd_;    // Connected socket
+    };
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_SERVER_HPP_
@@ -0,0 +1,1262 @@
+/************************************************************\
+Filename:   cipher_simd.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Vectorized kernels shared by the substitution ciphers,
+    along with the runtime CPU detection used to choose the
+    widest kernel the host supports.
+
+    The shift kernel adds a repeating list of key offsets
+    (0-25) to upper-case text, modulo 26. The key is stored
+    as a "period buffer": the offsets repeated end to end so
+    that a full vector of key bytes can be loaded starting at
+    any phase of the key without wrapping around.
+
+    Example: key offsets 7 4 11 (HEL), vector width 4
+        period buffer: 7 4 11 7 4 11 7 ...
+        phase 2 loads: 11 7 4 11
+
+    The substitution kernel maps each letter through a fixed
+    26-entry table, using byte shuffles as the lookup.
+
+    The validation kernel only finds the first byte that is
+    not an upper-case letter; the shift and substitution
+    kernels do the same check as part of their transform.
+
+    The case-preserving ("mixed") kernels accept any bytes:
+    letters of either case are enciphered keeping their case
+    and everything else is copied unchanged. Only letters use
+    up key offsets, so within each vector the key is spread
+    out over the letter positions with a byte shuffle indexed
+    by the number of letters before each byte.
+
+    Example: key offsets 7 4 11, phase 0, text "Hi, yo"
+        letters before each byte: 0 1 2 2 2 3
+        key offset used:          7 4 - - 11 7
+
+    The byte kernels are for binary data: every byte is shifted
+    by its key offset modulo 256, with no validation at all, so
+    they are a plain vector add of the period buffer.
+
+    The scalar kernels are the reference implementations; the
+    SSE4.2, AVX2 and AVX-512BW kernels must produce the same
+    output byte for byte.
+
+\************************************************************/
+
+
+#ifndef CIPHER_SIMD_HPP_
+#define CIPHER_SIMD_HPP_
+
+
+/* ===== Includes ===== */
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "cipher_utils.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CIPHER_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+
+namespace cipher {
+namespace simd {
+
+    /* ===== Constants ===== */
+
+    /**
+     * Widest vector loaded by any kernel, in bytes.
+     * Key period buffers must extend this many bytes past the key length.
+     */
+    const size_t MAX_VECTOR_WIDTH = 64;
+
+
+    /* ===== Types ===== */
+
+    /** A block of bytes aligned to the widest vector, used to build aligned buffers */
+    struct alignas(MAX_VECTOR_WIDTH) VectorBlock
+    {
+        uint8_t bytes[MAX_VECTOR_WIDTH];
+    };
+
+    /** Instruction set levels, from least to most capable */
+    enum SimdLevel
+    {
+        SIMD_LEVEL_SCALAR,
+        SIMD_LEVEL_SSE42,
+        SIMD_LEVEL_AVX2,
+        SIMD_LEVEL_AVX512BW,
+    };
+
+    /** How far the key phase moves for each letter count a vector can hold */
+    struct PhaseSteps
+    {
+        uint8_t step[MAX_VECTOR_WIDTH + 1];     // step[count]: count % period
+    };
+
+    /**
+     * Signature shared by all shift kernels
+     * @param[in]   key_period - Key offsets (0-25) repeated for at least period + MAX_VECTOR_WIDTH bytes
+     * @param[in]   period - Length of the key
+     * @param[in]   phase - Position in the key used for the first byte of input (< period)
+     * @param[in]   input - The text to shift, length bytes
+     * @param[out]  output - The shifted text, length bytes. May be the same buffer as input.
+     * @param[in]   length - Number of bytes to shift
+     * @return  Index of the first non-alpha byte in input, or length if all bytes are A-Z.
+     *          Output bytes before the returned index are written.
+     */
+    typedef size_t (*ShiftAlphaFunc)(const uint8_t* key_period,
+                                     size_t period,
+                                     size_t phase,
+                                     const char* input,
+                                     char* output,
+                                     size_t length);
+
+    /**
+     * Signature shared by all substitution kernels
+     * @param[in]   table - Output letter for each input letter A-Z, padded to 32 bytes
+     * @param[in]   input - The text to substitute, length bytes
+     * @param[out]  output - The substituted text, length bytes. May be the same buffer as input.
+     * @param[in]   length - Number of bytes to substitute
+     * @return  Index of the first non-alpha byte in input, or length if all bytes are A-Z.
+     *          Output bytes before the returned index are written.
+     */
+    typedef size_t (*SubstituteAlphaFunc)(const uint8_t* table,
+                                          const char* input,
+                                          char* output,
+                                          size_t length);
+
+    /**
+     * Signature shared by all validation kernels
+     * @param[in]   input - The text to check, length bytes
+     * @param[in]   length - Number of bytes to check
+     * @return  Index of the first non-alpha byte in input, or length if all bytes are A-Z.
+     */
+    typedef size_t (*FindNonUpperAlphaFunc)(const char* input, size_t length);
+
+    /**
+     * Signature shared by all case-preserving shift kernels
+     * Letters of either case are shifted and keep their case; every other
+     * byte is copied unchanged and does not use up a key offset.
+     * @param[in]   key_period - Key offsets (0-25) repeated for at least period + MAX_VECTOR_WIDTH bytes
+     * @param[in]   period - Length of the key
+     * @param[in]   phase - Position in the key used for the first letter of input (< period)
+     * @param[in]   input - The text to shift, length bytes
+     * @param[out]  output - The shifted text, length bytes. May be the same buffer as input.
+     * @param[in]   length - Number of bytes to shift
+     * @return  Number of letters in input
+     */
+    typedef size_t (*ShiftMixedFunc)(const uint8_t* key_period,
+                                     size_t period,
+                                     size_t phase,
+                                     const char* input,
+                                     char* output,
+                                     size_t length);
+
+    /**
+     * Signature shared by all case-preserving substitution kernels
+     * Letters of either case are substituted and keep their case; every
+     * other byte is copied unchanged.
+     * @param[in]   table - Output letter (A-Z) for each input letter, padded to 32 bytes
+     * @param[in]   input - The text to substitute, length bytes
+     * @param[out]  output - The substituted text, length bytes. May be the same buffer as input.
+     * @param[in]   length - Number of bytes to substitute
+     */
+    typedef void (*SubstituteMixedFunc)(const uint8_t* table,
+                                        const char* input,
+                                        char* output,
+                                        size_t length);
+
+
+    /**
+     * Signature shared by all byte shift kernels
+     * @param[in]   key_period - Key offsets repeated for at least period + MAX_VECTOR_WIDTH bytes
+     * @param[in]   period - Length of the key
+     * @param[in]   phase - Position in the key used for the first byte of input (< period)
+     * @param[in]   input - The bytes to shift, length bytes
+     * @param[out]  output - The shifted bytes, modulo 256. May be the same buffer as input.
+     * @param[in]   length - Number of bytes to shift
+     */
+    typedef void (*ShiftBytesFunc)(const uint8_t* key_period,
+                                   size_t period,
+                                   size_t phase,
+                                   const char* input,
+                                   char* output,
+                                   size_t length);
+
+
+    /* ===== Functions ===== */
+
+    /** Query the CPU for the most capable instruction set it supports */
+    inline SimdLevel DetectSimdLevel()
+    {
+        SimdLevel level = SIMD_LEVEL_SCALAR;
+#ifdef CIPHER_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw"))
+        {
+            level = SIMD_LEVEL_AVX512BW;
+        }
+        else if (__builtin_cpu_supports("avx2"))
+        {
+            level = SIMD_LEVEL_AVX2;
+        }
+        else if (__builtin_cpu_supports("sse4.2"))
+        {
+            level = SIMD_LEVEL_SSE42;
+        }
+#endif
+        return level;
+    }
+
+    /** The instruction set level detected for this process (detected once, on first use) */
+    inline SimdLevel GetSimdLevel()
+    {
+        static const SimdLevel level = DetectSimdLevel();
+        return level;
+    }
+
+    /** Advance a key phase by step positions, where step < period */
+    inline size_t AdvancePhase(size_t phase, const size_t step, const size_t period)
+    {
+        phase += step;
+        if (phase >= period)
+        {
+            phase -= period;
+        }
+        return phase;
+    }
+
+    /**
+     * Build the phase steps for a key, so kernels can advance the phase
+     * by a letter count without a division in the loop
+     * @param[in]   period - Length of the key
+     */
+    inline PhaseSteps MakePhaseSteps(const size_t period)
+    {
+        PhaseSteps steps = PhaseSteps();
+        size_t step = 0U;
+        for (size_t count = 0; count <= MAX_VECTOR_WIDTH; ++count)
+        {
+            steps.step[count] = static_cast<uint8_t>(step);
+            step = AdvancePhase(step, 1U, period);
+        }
+        return steps;
+    }
+
+    /** Reference shift kernel, one byte at a time */
+    inline size_t ShiftAlphaScalar(const uint8_t* key_period,
+                                   const size_t period,
+                                   size_t phase,
+                                   const char* input,
+                                   char* output,
+                                   const size_t length)
+    {
+        for (size_t index = 0; index < length; ++index)
+        {
+            const char letter = input[index];
+            if (!IsUpperAlpha(letter))
+            {
+                return index;
+            }
+            output[index] = static_cast<char>(((letter - 'A') + key_period[phase]) % 26 + 'A');
+            if (++phase == period)
+            {
+                phase = 0;
+            }
+        }
+        return length;
+    }
+
+    /** Reference substitution kernel, one byte at a time */
+    inline size_t SubstituteAlphaScalar(const uint8_t* table,
+                                        const char* input,
+                                        char* output,
+                                        const size_t length)
+    {
+        for (size_t index = 0; index < length; ++index)
+        {
+            const char letter = input[index];
+            if (!IsUpperAlpha(letter))
+            {
+                return index;
+            }
+            output[index] = static_cast<char>(table[letter - 'A']);
+        }
+        return length;
+    }
+
+    /** Reference validation kernel, one byte at a time */
+    inline size_t FindNonUpperAlphaScalar(const char* input, const size_t length)
+    {
+        size_t index = 0;
+        while ((index < length) && IsUpperAlpha(input[index]))
+        {
+            ++index;
+        }
+        return index;
+    }
+
+    /** Reference case-preserving shift kernel, one byte at a time */
+    inline size_t ShiftMixedScalar(const uint8_t* key_period,
+                                   const size_t period,
+                                   size_t phase,
+                                   const char* input,
+                                   char* output,
+                                   const size_t length)
+    {
+        size_t letters = 0U;
+        for (size_t index = 0; index < length; ++index)
+        {
+            const char letter = input[index];
+            const uint8_t offset = FoldedLetterIndex(letter);
+            if (offset > 25U)
+            {
+                output[index] = letter;
+                continue;
+            }
+            const char base = ((letter & 0x20) != 0) ? 'a' : 'A';
+            output[index] = static_cast<char>((offset + key_period[phase]) % 26 + base);
+            if (++phase == period)
+            {
+                phase = 0;
+            }
+            ++letters;
+        }
+        return letters;
+    }
+
+    /** Reference case-preserving substitution kernel, one byte at a time */
+    inline void SubstituteMixedScalar(const uint8_t* table,
+                                      const char* input,
+                                      char* output,
+                                      const size_t length)
+    {
+        for (size_t index = 0; index < length; ++index)
+        {
+            const char letter = input[index];
+            const uint8_t offset = FoldedLetterIndex(letter);
+            output[index] = (offset > 25U) ? letter : static_cast<char>(table[offset] | (letter & 0x20));
+        }
+    }
+
+    /** Reference byte shift kernel, one byte at a time */
+    inline void ShiftBytesScalar(const uint8_t* key_period,
+                                 const size_t period,
+                                 size_t phase,
+                                 const char* input,
+                                 char* output,
+                                 const size_t length)
+    {
+        for (size_t index = 0; index < length; ++index)
+        {
+            output[index] = static_cast<char>(static_cast<uint8_t>(input[index]) + key_period[phase]);
+            if (++phase == period)
+            {
+                phase = 0;
+            }
+        }
+    }
+
+#ifdef CIPHER_SIMD_X86
+
+    // All vector kernels use the same arithmetic:
+    // 1. Subtract 'A' so letters become 0-25. Any byte that is now
+    //    above 25 (unsigned) was not an upper-case letter.
+    // 2. Add the key offsets, giving a sum in the range 0-50.
+    // 3. Reduce mod 26 with min(sum, sum - 26): for sums below 26
+    //    the subtraction wraps to 230 or more, so min keeps the sum.
+    // 4. Add 'A' back.
+    // When a vector contains an invalid byte the kernel stops and
+    // the scalar kernel finishes the job, locating the exact byte.
+
+    /** Shift kernel processing 16 bytes at a time */
+    __attribute__((target("sse4.2")))
+    inline size_t ShiftAlphaSSE42(const uint8_t* key_period,
+                                  const size_t period,
+                                  size_t phase,
+                                  const char* input,
+                                  char* output,
+                                  const size_t length)
+    {
+        const __m128i letter_a = _mm_set1_epi8('A');
+        const __m128i max_offset = _mm_set1_epi8(25);
+        const __m128i alpha_size = _mm_set1_epi8(26);
+        const size_t step = 16 % period;
+
+        size_t index = 0;
+        for (; index + 16 <= length; index += 16)
+        {
+            const __m128i text = _mm_sub_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index)), letter_a);
+            const __m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(text, max_offset), text);
+            if (_mm_movemask_epi8(valid) != 0xFFFF)
+            {
+                break;
+            }
+            const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase));
+            const __m128i sum = _mm_add_epi8(text, key);
+            const __m128i reduced = _mm_min_epu8(sum, _mm_sub_epi8(sum, alpha_size));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index), _mm_add_epi8(reduced, letter_a));
+            phase = AdvancePhase(phase, step, period);
+        }
+        return index + ShiftAlphaScalar(key_period, period, phase,
+                                        input + index, output + index, length - index);
+    }
+
+    /** Shift kernel processing 32 bytes at a time */
+    __attribute__((target("avx2")))
+    inline size_t ShiftAlphaAVX2(const uint8_t* key_period,
+                                 const size_t period,
+                                 size_t phase,
+                                 const char* input,
+                                 char* output,
+                                 const size_t length)
+    {
+        const __m256i letter_a = _mm256_set1_epi8('A');
+        const __m256i max_offset = _mm256_set1_epi8(25);
+        const __m256i alpha_size = _mm256_set1_epi8(26);
+        const size_t step = 32 % period;
+
+        size_t index = 0;
+        for (; index + 32 <= length; index += 32)
+        {
+            const __m256i text = _mm256_sub_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + index)), letter_a);
+            const __m256i valid = _mm256_cmpeq_epi8(_mm256_min_epu8(text, max_offset), text);
+            if (_mm256_movemask_epi8(valid) != -1)
+            {
+                break;
+            }
+            const __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key_period + phase));
+            const __m256i sum = _mm256_add_epi8(text, key);
+            const __m256i reduced = _mm256_min_epu8(sum, _mm256_sub_epi8(sum, alpha_size));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + index), _mm256_add_epi8(reduced, letter_a));
+            phase = AdvancePhase(phase, step, period);
+        }
+        return index + ShiftAlphaSSE42(key_period, period, phase,
+                                       input + index, output + index, length - index);
+    }
+
+    /** Shift kernel processing 64 bytes at a time */
+    __attribute__((target("avx512f,avx512bw")))
+    inline size_t ShiftAlphaAVX512BW(const uint8_t* key_period,
+                                     const size_t period,
+                                     size_t phase,
+                                     const char* input,
+                                     char* output,
+                                     const size_t length)
+    {
+        const __m512i letter_a = _mm512_set1_epi8('A');
+        const __m512i max_offset = _mm512_set1_epi8(25);
+        const __m512i alpha_size = _mm512_set1_epi8(26);
+        const size_t step = 64 % period;
+
+        size_t index = 0;
+        for (; index + 64 <= length; index += 64)
+        {
+            const __m512i text = _mm512_sub_epi8(_mm512_loadu_si512(input + index), letter_a);
+            if (_mm512_cmpgt_epu8_mask(text, max_offset) != 0)
+            {
+                break;
+            }
+            const __m512i key = _mm512_loadu_si512(key_period + phase);
+            const __m512i sum = _mm512_add_epi8(text, key);
+            const __m512i reduced = _mm512_min_epu8(sum, _mm512_sub_epi8(sum, alpha_size));
+            _mm512_storeu_si512(output + index, _mm512_add_epi8(reduced, letter_a));
+            phase = AdvancePhase(phase, step, period);
+        }
+        return index + ShiftAlphaAVX2(key_period, period, phase,
+                                      input + index, output + index, length - index);
+    }
+
+    // The substitution kernels look up 26 table entries with byte
+    // shuffles, which only index 16 entries, so two lookups are made:
+    // - Letters 0-15 index the low half. A saturating add of 0x70
+    //   leaves the low nibble of 0-15 alone and pushes 16-25 above
+    //   0x80, which makes the shuffle return zero for them.
+    // - Letters 16-25 index the high half after subtracting 16, while
+    //   0-15 go negative and again shuffle to zero.
+    // OR-ing the two lookups gives the substituted letter.
+
+    /** Substitution kernel processing 16 bytes at a time */
+    __attribute__((target("sse4.2")))
+    inline size_t SubstituteAlphaSSE42(const uint8_t* table,
+                                       const char* input,
+                                       char* output,
+                                       const size_t length)
+    {
+        const __m128i letter_a = _mm_set1_epi8('A');
+        const __m128i max_offset = _mm_set1_epi8(25);
+        const __m128i low_bias = _mm_set1_epi8(0x70);
+        const __m128i high_bias = _mm_set1_epi8(16);
+        const __m128i table_low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+        const __m128i table_high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16));
+
+        size_t index = 0;
+        for (; index + 16 <= length; index += 16)
+        {
+            const __m128i text = _mm_sub_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index)), letter_a);
+            const __m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(text, max_offset), text);
+            if (_mm_movemask_epi8(valid) != 0xFFFF)
+            {
+                break;
+            }
+            const __m128i low = _mm_shuffle_epi8(table_low, _mm_adds_epu8(text, low_bias));
+            const __m128i high = _mm_shuffle_epi8(table_high, _mm_sub_epi8(text, high_bias));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index), _mm_or_si128(low, high));
+        }
+        return index + SubstituteAlphaScalar(table, input + index, output + index, length - index);
+    }
+
+    /** Substitution kernel processing 32 bytes at a time */
+    __attribute__((target("avx2")))
+    inline size_t SubstituteAlphaAVX2(const uint8_t* table,
+                                      const char* input,
+                                      char* output,
+                                      const size_t length)
+    {
+        const __m256i letter_a = _mm256_set1_epi8('A');
+        const __m256i max_offset = _mm256_set1_epi8(25);
+        const __m256i low_bias = _mm256_set1_epi8(0x70);
+        const __m256i high_bias = _mm256_set1_epi8(16);
+        const __m256i table_low = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+        const __m256i table_high = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16)));
+
+        size_t index = 0;
+        for (; index + 32 <= length; index += 32)
+        {
+            const __m256i text = _mm256_sub_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + index)), letter_a);
+            const __m256i valid = _mm256_cmpeq_epi8(_mm256_min_epu8(text, max_offset), text);
+            if (_mm256_movemask_epi8(valid) != -1)
+            {
+                break;
+            }
+            const __m256i low = _mm256_shuffle_epi8(table_low, _mm256_adds_epu8(text, low_bias));
+            const __m256i high = _mm256_shuffle_epi8(table_high, _mm256_sub_epi8(text, high_bias));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + index), _mm256_or_si256(low, high));
+        }
+        return index + SubstituteAlphaSSE42(table, input + index, output + index, length - index);
+    }
+
+    /**
+     * Load 16 bytes into all four lanes of a 512-bit vector
+     * The copies are made in memory: _mm512_broadcast_i32x4 and the lane
+     * shuffles trip -Wuninitialized inside GCC 12's own header.
+     */
+    __attribute__((target("avx512f")))
+    inline __m512i LoadBroadcast128(const uint8_t* bytes)
+    {
+        VectorBlock copies;
+        for (size_t lane = 0; lane < 4; ++lane)
+        {
+            std::memcpy(copies.bytes + (16 * lane), bytes, 16);
+        }
+        return _mm512_loadu_si512(copies.bytes);
+    }
+
+    /** Substitution kernel processing 64 bytes at a time */
+    __attribute__((target("avx512f,avx512bw")))
+    inline size_t SubstituteAlphaAVX512BW(const uint8_t* table,
+                                          const char* input,
+                                          char* output,
+                                          const size_t length)
+    {
+        const __m512i letter_a = _mm512_set1_epi8('A');
+        const __m512i max_offset = _mm512_set1_epi8(25);
+        const __m512i low_bias = _mm512_set1_epi8(0x70);
+        const __m512i high_bias = _mm512_set1_epi8(16);
+        const __m512i table_low = LoadBroadcast128(table);
+        const __m512i table_high = LoadBroadcast128(table + 16);
+
+        size_t index = 0;
+        for (; index + 64 <= length; index += 64)
+        {
+            const __m512i text = _mm512_sub_epi8(_mm512_loadu_si512(input + index), letter_a);
+            if (_mm512_cmpgt_epu8_mask(text, max_offset) != 0)
+            {
+                break;
+            }
+            const __m512i low = _mm512_shuffle_epi8(table_low, _mm512_adds_epu8(text, low_bias));
+            const __m512i high = _mm512_shuffle_epi8(table_high, _mm512_sub_epi8(text, high_bias));
+            _mm512_storeu_si512(output + index, _mm512_or_si512(low, high));
+        }
+        return index + SubstituteAlphaAVX2(table, input + index, output + index, length - index);
+    }
+
+    // The validation kernels use the same range check as the shift
+    // kernels, four vectors per iteration so the loop is limited by
+    // load bandwidth rather than by the branch.
+
+    /** Validation kernel checking 16 bytes at a time */
+    __attribute__((target("sse4.2")))
+    inline size_t FindNonUpperAlphaSSE42(const char* input, const size_t length)
+    {
+        const __m128i letter_a = _mm_set1_epi8('A');
+        const __m128i max_offset = _mm_set1_epi8(25);
+
+        size_t index = 0;
+        for (; index + 16 <= length; index += 16)
+        {
+            const __m128i text = _mm_sub_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index)), letter_a);
+            const __m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(text, max_offset), text);
+            if (_mm_movemask_epi8(valid) != 0xFFFF)
+            {
+                break;
+            }
+        }
+        return index + FindNonUpperAlphaScalar(input + index, length - index);
+    }
+
+    /** Validation kernel checking 128 bytes at a time */
+    __attribute__((target("avx2")))
+    inline size_t FindNonUpperAlphaAVX2(const char* input, const size_t length)
+    {
+        const __m256i letter_a = _mm256_set1_epi8('A');
+        const __m256i max_offset = _mm256_set1_epi8(25);
+
+        size_t index = 0;
+        for (; index + 128 <= length; index += 128)
+        {
+            __m256i text[4];
+            __m256i valid = _mm256_set1_epi8(-1);
+            for (size_t vector = 0; vector < 4; ++vector)
+            {
+                text[vector] = _mm256_sub_epi8(_mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(input + index + (32 * vector))), letter_a);
+                valid = _mm256_and_si256(valid,
+                    _mm256_cmpeq_epi8(_mm256_min_epu8(text[vector], max_offset), text[vector]));
+            }
+            if (_mm256_movemask_epi8(valid) != -1)
+            {
+                break;
+            }
+        }
+        return index + FindNonUpperAlphaSSE42(input + index, length - index);
+    }
+
+    /** Validation kernel checking 256 bytes at a time */
+    __attribute__((target("avx512f,avx512bw")))
+    inline size_t FindNonUpperAlphaAVX512BW(const char* input, const size_t length)
+    {
+        const __m512i letter_a = _mm512_set1_epi8('A');
+        const __m512i max_offset = _mm512_set1_epi8(25);
+
+        size_t index = 0;
+        for (; index + 256 <= length; index += 256)
+        {
+            __mmask64 invalid = 0;
+            for (size_t vector = 0; vector < 4; ++vector)
+            {
+                const __m512i text = _mm512_sub_epi8(_mm512_loadu_si512(input + index + (64 * vector)), letter_a);
+                invalid |= _mm512_cmpgt_epu8_mask(text, max_offset);
+            }
+            if (invalid != 0)
+            {
+                break;
+            }
+        }
+        return index + FindNonUpperAlphaAVX2(input + index, length - index);
+    }
+
+    // The case-preserving kernels fold case by setting bit 0x20,
+    // which maps A-Z onto a-z and nothing else into a-z, so one
+    // range check after subtracting 'a' finds the letters of both
+    // cases. Letters are enciphered as upper case, the case bit of
+    // the input is OR-ed back in, and a blend keeps every other
+    // byte as it was.
+    //
+    // For the shift kernels, the letters before each byte are
+    // counted with a prefix sum of byte shifts within each 128-bit
+    // lane. That count indexes a byte shuffle of the key offsets
+    // loaded for the lane, so each letter gets the next offset.
+    // Each lane loads its key where the previous lane's letters
+    // left off, and the phase advances by the letters in the vector.
+    // With AVX512-VBMI2, a byte expand does all of that in one step.
+    // The phase moves by a table lookup of the count mod the period,
+    // which keeps a division out of the loop.
+
+    /** Case-preserving shift kernel processing 16 bytes at a time */
+    __attribute__((target("sse4.2")))
+    inline size_t ShiftMixedSSE42(const uint8_t* key_period,
+                                  const size_t period,
+                                  size_t phase,
+                                  const char* input,
+                                  char* output,
+                                  const size_t length)
+    {
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        const __m128i lower_a = _mm_set1_epi8('a');
+        const __m128i upper_a = _mm_set1_epi8('A');
+        const __m128i max_offset = _mm_set1_epi8(25);
+        const __m128i alpha_size = _mm_set1_epi8(26);
+        const __m128i one = _mm_set1_epi8(1);
+        const PhaseSteps steps = MakePhaseSteps(period);
+
+        size_t letters = 0U;
+        size_t index = 0;
+        for (; index + 16 <= length; index += 16)
+        {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index));
+            const __m128i text = _mm_sub_epi8(_mm_or_si128(bytes, case_bit), lower_a);
+            const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(text, max_offset), text);
+            const __m128i counts = _mm_and_si128(is_letter, one);
+            __m128i before = _mm_slli_si128(counts, 1);
+            before = _mm_add_epi8(before, _mm_slli_si128(before, 1));
+            before = _mm_add_epi8(before, _mm_slli_si128(before, 2));
+            before = _mm_add_epi8(before, _mm_slli_si128(before, 4));
+            before = _mm_add_epi8(before, _mm_slli_si128(before, 8));
+            const size_t count = static_cast<size_t>(_mm_extract_epi8(_mm_add_epi8(before, counts), 15));
+
+            const __m128i key = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase)), before);
+            const __m128i sum = _mm_add_epi8(text, key);
+            const __m128i reduced = _mm_min_epu8(sum, _mm_sub_epi8(sum, alpha_size));
+            const __m128i shifted = _mm_or_si128(_mm_add_epi8(reduced, upper_a), _mm_and_si128(bytes, case_bit));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index), _mm_blendv_epi8(bytes, shifted, is_letter));
+            letters += count;
+            phase = AdvancePhase(phase, steps.step[count], period);
+        }
+        return letters + ShiftMixedScalar(key_period, period, phase,
+                                          input + index, output + index, length - index);
+    }
+
+    /** Case-preserving shift kernel processing 32 bytes at a time */
+    __attribute__((target("avx2")))
+    inline size_t ShiftMixedAVX2(const uint8_t* key_period,
+                                 const size_t period,
+                                 size_t phase,
+                                 const char* input,
+                                 char* output,
+                                 const size_t length)
+    {
+        const __m256i case_bit = _mm256_set1_epi8(0x20);
+        const __m256i lower_a = _mm256_set1_epi8('a');
+        const __m256i upper_a = _mm256_set1_epi8('A');
+        const __m256i max_offset = _mm256_set1_epi8(25);
+        const __m256i alpha_size = _mm256_set1_epi8(26);
+        const __m256i one = _mm256_set1_epi8(1);
+        const PhaseSteps steps = MakePhaseSteps(period);
+
+        size_t letters = 0U;
+        size_t index = 0;
+        for (; index + 32 <= length; index += 32)
+        {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + index));
+            const __m256i text = _mm256_sub_epi8(_mm256_or_si256(bytes, case_bit), lower_a);
+            const __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(text, max_offset), text);
+            const __m256i counts = _mm256_and_si256(is_letter, one);
+            __m256i before = _mm256_slli_si256(counts, 1);
+            before = _mm256_add_epi8(before, _mm256_slli_si256(before, 1));
+            before = _mm256_add_epi8(before, _mm256_slli_si256(before, 2));
+            before = _mm256_add_epi8(before, _mm256_slli_si256(before, 4));
+            before = _mm256_add_epi8(before, _mm256_slli_si256(before, 8));
+            const __m256i through = _mm256_add_epi8(before, counts);
+            const size_t low_count = static_cast<size_t>(_mm256_extract_epi8(through, 15));
+            const size_t high_count = static_cast<size_t>(_mm256_extract_epi8(through, 31));
+
+            const __m256i key_offsets = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase + low_count)), 1);
+            const __m256i key = _mm256_shuffle_epi8(key_offsets, before);
+            const __m256i sum = _mm256_add_epi8(text, key);
+            const __m256i reduced = _mm256_min_epu8(sum, _mm256_sub_epi8(sum, alpha_size));
+            const __m256i shifted = _mm256_or_si256(_mm256_add_epi8(reduced, upper_a),
+                                                    _mm256_and_si256(bytes, case_bit));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + index),
+                                _mm256_blendv_epi8(bytes, shifted, is_letter));
+            letters += low_count + high_count;
+            phase = AdvancePhase(phase, steps.step[low_count + high_count], period);
+        }
+        return letters + ShiftMixedSSE42(key_period, period, phase,
+                                         input + index, output + index, length - index);
+    }
+
+    /** Case-preserving shift kernel processing 64 bytes at a time */
+    __attribute__((target("avx512f,avx512bw,popcnt")))
+    inline size_t ShiftMixedAVX512BW(const uint8_t* key_period,
+                                     const size_t period,
+                                     size_t phase,
+                                     const char* input,
+                                     char* output,
+                                     const size_t length)
+    {
+        const __m512i case_bit = _mm512_set1_epi8(0x20);
+        const __m512i lower_a = _mm512_set1_epi8('a');
+        const __m512i upper_a = _mm512_set1_epi8('A');
+        const __m512i max_offset = _mm512_set1_epi8(25);
+        const __m512i alpha_size = _mm512_set1_epi8(26);
+        const __m512i one = _mm512_set1_epi8(1);
+        const PhaseSteps steps = MakePhaseSteps(period);
+
+        size_t letters = 0U;
+        size_t index = 0;
+        for (; index + 64 <= length; index += 64)
+        {
+            const __m512i bytes = _mm512_loadu_si512(input + index);
+            const __m512i text = _mm512_sub_epi8(_mm512_or_si512(bytes, case_bit), lower_a);
+            const __mmask64 is_letter = _mm512_cmple_epu8_mask(text, max_offset);
+            __m512i before = _mm512_bslli_epi128(_mm512_maskz_mov_epi8(is_letter, one), 1);
+            before = _mm512_add_epi8(before, _mm512_bslli_epi128(before, 1));
+            before = _mm512_add_epi8(before, _mm512_bslli_epi128(before, 2));
+            before = _mm512_add_epi8(before, _mm512_bslli_epi128(before, 4));
+            before = _mm512_add_epi8(before, _mm512_bslli_epi128(before, 8));
+
+            // Each lane's key starts after the letters of the lanes below it
+            const uint64_t mask = static_cast<uint64_t>(is_letter);
+            const size_t lane1 = static_cast<size_t>(__builtin_popcountll(mask & 0xFFFFULL));
+            const size_t lane2 = lane1 + static_cast<size_t>(__builtin_popcountll(mask & 0xFFFF0000ULL));
+            const size_t lane3 = lane2 + static_cast<size_t>(__builtin_popcountll(mask & 0xFFFF00000000ULL));
+            const size_t count = static_cast<size_t>(__builtin_popcountll(mask));
+            __m512i key_offsets = _mm512_castsi128_si512(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase)));
+            key_offsets = _mm512_inserti32x4(key_offsets,
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase + lane1)), 1);
+            key_offsets = _mm512_inserti32x4(key_offsets,
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase + lane2)), 2);
+            key_offsets = _mm512_inserti32x4(key_offsets,
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase + lane3)), 3);
+
+            const __m512i key = _mm512_shuffle_epi8(key_offsets, before);
+            const __m512i sum = _mm512_add_epi8(text, key);
+            const __m512i reduced = _mm512_min_epu8(sum, _mm512_sub_epi8(sum, alpha_size));
+            const __m512i shifted = _mm512_or_si512(_mm512_add_epi8(reduced, upper_a),
+                                                    _mm512_and_si512(bytes, case_bit));
+            _mm512_storeu_si512(output + index, _mm512_mask_blend_epi8(is_letter, bytes, shifted));
+            letters += count;
+            phase = AdvancePhase(phase, steps.step[count], period);
+        }
+        return letters + ShiftMixedAVX2(key_period, period, phase,
+                                        input + index, output + index, length - index);
+    }
+
+    /**
+     * Case-preserving shift kernel processing 64 bytes at a time, for CPUs with AVX512-VBMI2
+     * The byte expand instruction spreads the next key offsets across the letters directly,
+     * in place of the prefix sum and the per-lane key loads.
+     */
+    __attribute__((target("avx512f,avx512bw,avx512vbmi2,popcnt")))
+    inline size_t ShiftMixedAVX512VBMI2(const uint8_t* key_period,
+                                        const size_t period,
+                                        size_t phase,
+                                        const char* input,
+                                        char* output,
+                                        const size_t length)
+    {
+        const __m512i case_bit = _mm512_set1_epi8(0x20);
+        const __m512i lower_a = _mm512_set1_epi8('a');
+        const __m512i upper_a = _mm512_set1_epi8('A');
+        const __m512i max_offset = _mm512_set1_epi8(25);
+        const __m512i alpha_size = _mm512_set1_epi8(26);
+        const PhaseSteps steps = MakePhaseSteps(period);
+
+        size_t letters = 0U;
+        size_t index = 0;
+        for (; index + 64 <= length; index += 64)
+        {
+            const __m512i bytes = _mm512_loadu_si512(input + index);
+            const __m512i text = _mm512_sub_epi8(_mm512_or_si512(bytes, case_bit), lower_a);
+            const __mmask64 is_letter = _mm512_cmple_epu8_mask(text, max_offset);
+            const size_t count = static_cast<size_t>(__builtin_popcountll(static_cast<uint64_t>(is_letter)));
+
+            const __m512i key = _mm512_maskz_expand_epi8(is_letter, _mm512_loadu_si512(key_period + phase));
+            const __m512i sum = _mm512_add_epi8(text, key);
+            const __m512i reduced = _mm512_min_epu8(sum, _mm512_sub_epi8(sum, alpha_size));
+            const __m512i shifted = _mm512_or_si512(_mm512_add_epi8(reduced, upper_a),
+                                                    _mm512_and_si512(bytes, case_bit));
+            _mm512_storeu_si512(output + index, _mm512_mask_blend_epi8(is_letter, bytes, shifted));
+            letters += count;
+            phase = AdvancePhase(phase, steps.step[count], period);
+        }
+        return letters + ShiftMixedAVX2(key_period, period, phase,
+                                        input + index, output + index, length - index);
+    }
+
+    /** Case-preserving substitution kernel processing 16 bytes at a time */
+    __attribute__((target("sse4.2")))
+    inline void SubstituteMixedSSE42(const uint8_t* table,
+                                     const char* input,
+                                     char* output,
+                                     const size_t length)
+    {
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        const __m128i lower_a = _mm_set1_epi8('a');
+        const __m128i max_offset = _mm_set1_epi8(25);
+        const __m128i low_bias = _mm_set1_epi8(0x70);
+        const __m128i high_bias = _mm_set1_epi8(16);
+        const __m128i table_low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+        const __m128i table_high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16));
+
+        size_t index = 0;
+        for (; index + 16 <= length; index += 16)
+        {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index));
+            const __m128i text = _mm_sub_epi8(_mm_or_si128(bytes, case_bit), lower_a);
+            const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(text, max_offset), text);
+            const __m128i low = _mm_shuffle_epi8(table_low, _mm_adds_epu8(text, low_bias));
+            const __m128i high = _mm_shuffle_epi8(table_high, _mm_sub_epi8(text, high_bias));
+            const __m128i substituted = _mm_or_si128(_mm_or_si128(low, high), _mm_and_si128(bytes, case_bit));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index),
+                             _mm_blendv_epi8(bytes, substituted, is_letter));
+        }
+        SubstituteMixedScalar(table, input + index, output + index, length - index);
+    }
+
+    /** Case-preserving substitution kernel processing 32 bytes at a time */
+    __attribute__((target("avx2")))
+    inline void SubstituteMixedAVX2(const uint8_t* table,
+                                    const char* input,
+                                    char* output,
+                                    const size_t length)
+    {
+        const __m256i case_bit = _mm256_set1_epi8(0x20);
+        const __m256i lower_a = _mm256_set1_epi8('a');
+        const __m256i max_offset = _mm256_set1_epi8(25);
+        const __m256i low_bias = _mm256_set1_epi8(0x70);
+        const __m256i high_bias = _mm256_set1_epi8(16);
+        const __m256i table_low = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+        const __m256i table_high = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16)));
+
+        size_t index = 0;
+        for (; index + 32 <= length; index += 32)
+        {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + index));
+            const __m256i text = _mm256_sub_epi8(_mm256_or_si256(bytes, case_bit), lower_a);
+            const __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(text, max_offset), text);
+            const __m256i low = _mm256_shuffle_epi8(table_low, _mm256_adds_epu8(text, low_bias));
+            const __m256i high = _mm256_shuffle_epi8(table_high, _mm256_sub_epi8(text, high_bias));
+            const __m256i substituted = _mm256_or_si256(_mm256_or_si256(low, high),
+                                                        _mm256_and_si256(bytes, case_bit));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + index),
+                                _mm256_blendv_epi8(bytes, substituted, is_letter));
+        }
+        SubstituteMixedSSE42(table, input + index, output + index, length - index);
+    }
+
+    /** Case-preserving substitution kernel processing 64 bytes at a time */
+    __attribute__((target("avx512f,avx512bw")))
+    inline void SubstituteMixedAVX512BW(const uint8_t* table,
+                                        const char* input,
+                                        char* output,
+                                        const size_t length)
+    {
+        const __m512i case_bit = _mm512_set1_epi8(0x20);
+        const __m512i lower_a = _mm512_set1_epi8('a');
+        const __m512i max_offset = _mm512_set1_epi8(25);
+        const __m512i low_bias = _mm512_set1_epi8(0x70);
+        const __m512i high_bias = _mm512_set1_epi8(16);
+        const __m512i table_low = LoadBroadcast128(table);
+        const __m512i table_high = LoadBroadcast128(table + 16);
+
+        size_t index = 0;
+        for (; index + 64 <= length; index += 64)
+        {
+            const __m512i bytes = _mm512_loadu_si512(input + index);
+            const __m512i text = _mm512_sub_epi8(_mm512_or_si512(bytes, case_bit), lower_a);
+            const __mmask64 is_letter = _mm512_cmple_epu8_mask(text, max_offset);
+            const __m512i low = _mm512_shuffle_epi8(table_low, _mm512_adds_epu8(text, low_bias));
+            const __m512i high = _mm512_shuffle_epi8(table_high, _mm512_sub_epi8(text, high_bias));
+            const __m512i substituted = _mm512_or_si512(_mm512_or_si512(low, high),
+                                                        _mm512_and_si512(bytes, case_bit));
+            _mm512_storeu_si512(output + index, _mm512_mask_blend_epi8(is_letter, bytes, substituted));
+        }
+        SubstituteMixedAVX2(table, input + index, output + index, length - index);
+    }
+
+    // The byte kernels need no validation or reduction: a wrapping
+    // byte add is already modulo 256.
+
+    /** Byte shift kernel processing 16 bytes at a time */
+    __attribute__((target("sse4.2")))
+    inline void ShiftBytesSSE42(const uint8_t* key_period,
+                                const size_t period,
+                                size_t phase,
+                                const char* input,
+                                char* output,
+                                const size_t length)
+    {
+        const size_t step = 16 % period;
+        size_t index = 0;
+        for (; index + 16 <= length; index += 16)
+        {
+            const __m128i text = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index));
+            const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_period + phase));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index), _mm_add_epi8(text, key));
+            phase = AdvancePhase(phase, step, period);
+        }
+        ShiftBytesScalar(key_period, period, phase, input + index, output + index, length - index);
+    }
+
+    /** Byte shift kernel processing 32 bytes at a time */
+    __attribute__((target("avx2")))
+    inline void ShiftBytesAVX2(const uint8_t* key_period,
+                               const size_t period,
+                               size_t phase,
+                               const char* input,
+                               char* output,
+                               const size_t length)
+    {
+        const size_t step = 32 % period;
+        size_t index = 0;
+        for (; index + 32 <= length; index += 32)
+        {
+            const __m256i text = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + index));
+            const __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key_period + phase));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + index), _mm256_add_epi8(text, key));
+            phase = AdvancePhase(phase, step, period);
+        }
+        ShiftBytesSSE42(key_period, period, phase, input + index, output + index, length - index);
+    }
+
+    /** Byte shift kernel processing 64 bytes at a time */
+    __attribute__((target("avx512f,avx512bw")))
+    inline void ShiftBytesAVX512BW(const uint8_t* key_period,
+                                   const size_t period,
+                                   size_t phase,
+                                   const char* input,
+                                   char* output,
+                                   const size_t length)
+    {
+        const size_t step = 64 % period;
+        size_t index = 0;
+        for (; index + 64 <= length; index += 64)
+        {
+            const __m512i text = _mm512_loadu_si512(input + index);
+            const __m512i key = _mm512_loadu_si512(key_period + phase);
+            _mm512_storeu_si512(output + index, _mm512_add_epi8(text, key));
+            phase = AdvancePhase(phase, step, period);
+        }
+        ShiftBytesAVX2(key_period, period, phase, input + index, output + index, length - index);
+    }
+
+#endif  // CIPHER_SIMD_X86
+
+    /**
+     * Get the shift kernel for a given instruction set level
+     * The caller is responsible for checking the CPU supports the level.
+     */
+    inline ShiftAlphaFunc GetShiftAlphaKernel(const SimdLevel level)
+    {
+        ShiftAlphaFunc kernel = ShiftAlphaScalar;
+#ifdef CIPHER_SIMD_X86
+        switch (level)
+        {
+            case SIMD_LEVEL_AVX512BW:   kernel = ShiftAlphaAVX512BW;    break;
+            case SIMD_LEVEL_AVX2:       kernel = ShiftAlphaAVX2;        break;
+            case SIMD_LEVEL_SSE42:      kernel = ShiftAlphaSSE42;       break;
+            case SIMD_LEVEL_SCALAR:
+            default:                    kernel = ShiftAlphaScalar;      break;
+        }
+#else
+        (void)level;
+#endif
+        return kernel;
+    }
+
+    /**
+     * Shift upper-case text by a repeating key using the best kernel for this CPU
+     * See ShiftAlphaFunc for a description of the parameters.
+     */
+    inline size_t ShiftAlpha(const uint8_t* key_period,
+                             const size_t period,
+                             const size_t phase,
+                             const char* input,
+                             char* output,
+                             const size_t length)
+    {
+        static const ShiftAlphaFunc kernel = GetShiftAlphaKernel(GetSimdLevel());
+        return kernel(key_period, period, phase, input, output, length);
+    }
+
+    /**
+     * Get the substitution kernel for a given instruction set level
+     * The caller is responsible for checking the CPU supports the level.
+     */
+    inline SubstituteAlphaFunc GetSubstituteAlphaKernel(const SimdLevel level)
+    {
+        SubstituteAlphaFunc kernel = SubstituteAlphaScalar;
+#ifdef CIPHER_SIMD_X86
+        switch (level)
+        {
+            case SIMD_LEVEL_AVX512BW:   kernel = SubstituteAlphaAVX512BW;   break;
+            case SIMD_LEVEL_AVX2:       kernel = SubstituteAlphaAVX2;       break;
+            case SIMD_LEVEL_SSE42:      kernel = SubstituteAlphaSSE42;      break;
+            case SIMD_LEVEL_SCALAR:
+            default:                    kernel = SubstituteAlphaScalar;     break;
+        }
+#else
+        (void)level;
+#endif
+        return kernel;
+    }
+
+    /**
+     * Substitute upper-case text through a lookup table using the best kernel for this CPU
+     * See SubstituteAlphaFunc for a description of the parameters.
+     */
+    inline size_t SubstituteAlpha(const uint8_t* table,
+                                  const char* input,
+                                  char* output,
+                                  const size_t length)
+    {
+        static const SubstituteAlphaFunc kernel = GetSubstituteAlphaKernel(GetSimdLevel());
+        return kernel(table, input, output, length);
+    }
+
+    /**
+     * Get the validation kernel for a given instruction set level
+     * The caller is responsible for checking the CPU supports the level.
+     */
+    inline FindNonUpperAlphaFunc GetFindNonUpperAlphaKernel(const SimdLevel level)
+    {
+        FindNonUpperAlphaFunc kernel = FindNonUpperAlphaScalar;
+#ifdef CIPHER_SIMD_X86
+        switch (level)
+        {
+            case SIMD_LEVEL_AVX512BW:   kernel = FindNonUpperAlphaAVX512BW; break;
+            case SIMD_LEVEL_AVX2:       kernel = FindNonUpperAlphaAVX2;     break;
+            case SIMD_LEVEL_SSE42:      kernel = FindNonUpperAlphaSSE42;    break;
+            case SIMD_LEVEL_SCALAR:
+            default:                    kernel = FindNonUpperAlphaScalar;   break;
+        }
+#else
+        (void)level;
+#endif
+        return kernel;
+    }
+
+    /**
+     * Find the first byte that is not an upper-case letter using the best kernel for this CPU
+     * See FindNonUpperAlphaFunc for a description of the parameters.
+     */
+    inline size_t FindNonUpperAlpha(const char* input, const size_t length)
+    {
+        static const FindNonUpperAlphaFunc kernel = GetFindNonUpperAlphaKernel(GetSimdLevel());
+        return kernel(input, length);
+    }
+
+    /**
+     * Get the case-preserving shift kernel for a given instruction set level
+     * The caller is responsible for checking the CPU supports the level.
+     */
+    inline ShiftMixedFunc GetShiftMixedKernel(const SimdLevel level)
+    {
+        ShiftMixedFunc kernel = ShiftMixedScalar;
+#ifdef CIPHER_SIMD_X86
+        switch (level)
+        {
+            case SIMD_LEVEL_AVX512BW:
+                kernel = __builtin_cpu_supports("avx512vbmi2") ? ShiftMixedAVX512VBMI2 : ShiftMixedAVX512BW;
+                break;
+            case SIMD_LEVEL_AVX2:       kernel = ShiftMixedAVX2;        break;
+            case SIMD_LEVEL_SSE42:      kernel = ShiftMixedSSE42;       break;
+            case SIMD_LEVEL_SCALAR:
+            default:                    kernel = ShiftMixedScalar;      break;
+        }
+#else
+        (void)level;
+#endif
+        return kernel;
+    }
+
+    /**
+     * Shift letters of either case by a repeating key using the best kernel for this CPU
+     * See ShiftMixedFunc for a description of the parameters.
+     */
+    inline size_t ShiftMixed(const uint8_t* key_period,
+                             const size_t period,
+                             const size_t phase,
+                             const char* input,
+                             char* output,
+                             const size_t length)
+    {
+        static const ShiftMixedFunc kernel = GetShiftMixedKernel(GetSimdLevel());
+        return kernel(key_period, period, phase, input, output, length);
+    }
+
+    /**
+     * Get the case-preserving substitution kernel for a given instruction set level
+     * The caller is responsible for checking the CPU supports the level.
+     */
+    inline SubstituteMixedFunc GetSubstituteMixedKernel(const SimdLevel level)
+    {
+        SubstituteMixedFunc kernel = SubstituteMixedScalar;
+#ifdef CIPHER_SIMD_X86
+        switch (level)
+        {
+            case SIMD_LEVEL_AVX512BW:   kernel = SubstituteMixedAVX512BW;   break;
+            case SIMD_LEVEL_AVX2:       kernel = SubstituteMixedAVX2;       break;
+            case SIMD_LEVEL_SSE42:      kernel = SubstituteMixedSSE42;      break;
+            case SIMD_LEVEL_SCALAR:
+            default:                    kernel = SubstituteMixedScalar;     break;
+        }
+#else
+        (void)level;
+#endif
+        return kernel;
+    }
+
+    /**
+     * Substitute letters of either case through a lookup table using the best kernel for this CPU
+     * See SubstituteMixedFunc for a description of the parameters.
+     */
+    inline void SubstituteMixed(const uint8_t* table,
+                                const char* input,
+                                char* output,
+                                const size_t length)
+    {
+        static const SubstituteMixedFunc kernel = GetSubstituteMixedKernel(GetSimdLevel());
+        kernel(table, input, output, length);
+    }
+
+    /**
+     * Get the byte shift kernel for a given instruction set level
+     * The caller is responsible for checking the CPU supports the level.
+     */
+    inline ShiftBytesFunc GetShiftBytesKernel(const SimdLevel level)
+    {
+        ShiftBytesFunc kernel = ShiftBytesScalar;
+#ifdef CIPHER_SIMD_X86
+        switch (level)
+        {
+            case SIMD_LEVEL_AVX512BW:   kernel = ShiftBytesAVX512BW;    break;
+            case SIMD_LEVEL_AVX2:       kernel = ShiftBytesAVX2;        break;
+            case SIMD_LEVEL_SSE42:      kernel = ShiftBytesSSE42;       break;
+            case SIMD_LEVEL_SCALAR:
+            default:                    kernel = ShiftBytesScalar;      break;
+        }
+#else
+        (void)level;
+#endif
+        return kernel;
+    }
+
+    /**
+     * Shift raw bytes by a repeating key, modulo 256, using the best kernel for this CPU
+     * See ShiftBytesFunc for a description of the parameters.
+     */
+    inline void ShiftBytes(const uint8_t* key_period,
+                           const size_t period,
+                           const size_t phase,
+                           const char* input,
+                           char* output,
+                           const size_t length)
+    {
+        static const ShiftBytesFunc kernel = GetShiftBytesKernel(GetSimdLevel());
+        kernel(key_period, period, phase, input, output, length);
+    }
+
+}   // end namespace simd
+}   // end namespace cipher
+
+
+#endif  // CIPHER_SIMD_HPP_
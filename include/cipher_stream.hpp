@@ -0,0 +1,142 @@
+/************************************************************\
+Filename:   cipher_stream.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Streaming driver for running a cipher over an input of
+    any size with a fixed amount of memory.
+
+    The input is read in blocks into a reusable buffer, each
+    block is transformed into a second reusable buffer and
+    written out, so at most a couple of blocks are held at
+    any time.
+
+    Trailing whitespace is removed from the end of the whole
+    stream, the same as trimming the full text would: a run
+    of whitespace is held back until either more text follows
+    it (and it is passed through) or the stream ends (and it
+    is dropped). Binary data is passed through whole, with
+    nothing trimmed and no newline added.
+
+    Ciphers that work letter by letter (Caesar, Vigenere,
+    substitution) give the same output for any block size,
+    as long as they track their position in the stream. The
+    transposition ciphers are applied to each block on its
+    own ("block-framed"), so the same block size must be used
+    to decrypt.
+
+\************************************************************/
+
+
+#ifndef CIPHER_STREAM_HPP_
+#define CIPHER_STREAM_HPP_
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include "cipher_result.hpp"
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** Default block size for streaming, large enough to amortize each read and write */
+    const size_t STREAM_BLOCK_SIZE = 1024 * 1024;
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Find the end of the text in a buffer, ignoring trailing whitespace
+     * @param[in]   text - Buffer to search
+     * @param[in]   begin - Offset to stop searching at
+     * @param[in]   end - Offset to start searching back from
+     * @return  One past the last non-whitespace character in [begin, end), or begin if there is none
+     */
+    inline size_t TrimmedEnd(const char* text, const size_t begin, size_t end)
+    {
+        while ((end > begin) && std::isspace(static_cast<unsigned char>(text[end - 1])))
+        {
+            --end;
+        }
+        return end;
+    }
+
+    /**
+     * Run a cipher over a stream in fixed-size blocks
+     * Output written before an error is found is not taken back.
+     * @param[in]   input - Stream to read the text from
+     * @param[out]  output - Stream to write the result to. A newline is written after the text.
+     * @param[in]   block_size - Letters given to each call of transform, except the last
+     * @param[in]   transform - Callable (const char* input, char* output, size_t length,
+     *                          size_t stream_offset) returning a CipherResult for the block,
+     *                          where stream_offset is the position of the block in the stream
+     * @param[in]   binary - Keep trailing whitespace and write no newline after the text
+     * @return  The first error from transform, with its offset in the whole stream
+     */
+    template <typename Transform>
+    inline CipherResult StreamTransform(std::istream& input,
+                                        std::ostream& output,
+                                        const size_t block_size,
+                                        const Transform& transform,
+                                        const bool binary = false)
+    {
+        // Text read but not yet transformed: [0, text_end) is ready to use,
+        // anything after it is whitespace that may turn out to be trailing
+        std::string pending;
+        std::string result(block_size, '\0');
+        size_t text_end = 0U;
+        size_t stream_offset = 0U;
+        bool reading = true;
+        while (reading)
+        {
+            // Read the next block
+            const size_t filled = pending.size();
+            pending.resize(filled + block_size);
+            input.read(&pending[filled], static_cast<std::streamsize>(block_size));
+            const size_t received = static_cast<size_t>(input.gcount());
+            pending.resize(filled + received);
+            reading = (received > 0) && input.good();
+            const size_t new_text_end = binary ? pending.size() : TrimmedEnd(pending.data(), filled, pending.size());
+            if (new_text_end > filled)
+            {
+                text_end = new_text_end;
+            }
+
+            // Transform every full block, or the final partial block at the end
+            size_t consumed = 0U;
+            while (((text_end - consumed) >= block_size) || (!reading && (consumed < text_end)))
+            {
+                const size_t length = std::min(block_size, text_end - consumed);
+                const CipherResult block_result = transform(pending.data() + consumed, &result[0],
+                                                            length, stream_offset);
+                if (!block_result.Ok())
+                {
+                    CipherResult stream_result = block_result;
+                    stream_result.offset += stream_offset;
+                    return stream_result;
+                }
+                output.write(result.data(), static_cast<std::streamsize>(length));
+                consumed += length;
+                stream_offset += length;
+            }
+            pending.erase(0, consumed);
+            text_end -= consumed;
+        }
+        if (!binary)
+        {
+            output << '\n';
+        }
+        output.flush();
+        return ResultOk();
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_STREAM_HPP_
@@ -0,0 +1,204 @@
+/************************************************************\
+Filename:   cipher_thread_pool.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    A small fixed-size thread pool used by the parallel
+    cipher engines.
+
+    Work is given to the pool as a range of task indexes
+    with ParallelFor. Worker threads (and the calling thread)
+    claim indexes from a shared counter until the range is
+    used up, so uneven tasks balance themselves out. Single
+    jobs can also be queued with Post, without waiting.
+
+\************************************************************/
+
+
+#ifndef CIPHER_THREAD_POOL_HPP_
+#define CIPHER_THREAD_POOL_HPP_
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace cipher {
+
+    /* ===== Classes ===== */
+
+    /**
+     * Fixed-size pool of worker threads
+     */
+    class ThreadPool
+    {
+    public:
+        /**
+         * Start the worker threads
+         * @param[in]   num_threads - Total threads to use, including the thread that
+         *                            calls ParallelFor. Zero means one per hardware thread.
+         */
+        explicit ThreadPool(size_t num_threads) :
+            stopping_(false)
+        {
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1U, std::thread::hardware_concurrency());
+            }
+            for (size_t index = 1; index < num_threads; ++index)
+            {
+                workers_.emplace_back([this]() { WorkerLoop(); });
+            }
+        }
+
+        /** Stop and join the worker threads */
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wake_.notify_all();
+            for (std::thread& worker : workers_)
+            {
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /** Total number of threads doing work, including the caller */
+        size_t Size() const
+        {
+            return workers_.size() + 1;
+        }
+
+        /**
+         * Run task(index) for every index in [0, count) and wait for all of them
+         * The calling thread works on tasks too. If any task throws, the
+         * remaining unclaimed tasks are skipped and the first exception is
+         * rethrown here.
+         * @param[in]   count - Number of tasks
+         * @param[in]   task - Callable taking the task index
+         */
+        template <typename Task>
+        void ParallelFor(const size_t count, const Task& task)
+        {
+            if ((count <= 1) || workers_.empty())
+            {
+                for (size_t index = 0; index < count; ++index)
+                {
+                    task(index);
+                }
+                return;
+            }
+
+            std::atomic<size_t> next(0);
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            const std::function<void()> claim_tasks = [&]()
+            {
+                for (size_t index = next++; index < count; index = next++)
+                {
+                    try
+                    {
+                        task(index);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error)
+                        {
+                            error = std::current_exception();
+                        }
+                        next = count;
+                    }
+                }
+            };
+
+            // One helper per worker that could be useful, plus the caller
+            const size_t helpers = std::min(workers_.size(), count - 1);
+            std::atomic<size_t> helpers_left(helpers);
+            std::mutex done_mutex;
+            std::condition_variable done;
+            for (size_t helper = 0; helper < helpers; ++helper)
+            {
+                Post([&]()
+                {
+                    claim_tasks();
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    if (--helpers_left == 0)
+                    {
+                        done.notify_one();
+                    }
+                });
+            }
+            claim_tasks();
+
+            std::unique_lock<std::mutex> lock(done_mutex);
+            done.wait(lock, [&]() { return helpers_left == 0; });
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        /**
+         * Queue a job for the next free worker and return without waiting
+         * With no worker threads the job runs here before returning.
+         */
+        void Post(std::function<void()> job)
+        {
+            if (workers_.empty())
+            {
+                job();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                jobs_.push_back(std::move(job));
+            }
+            wake_.notify_one();
+        }
+
+    private:
+        /** Body of each worker thread: run queued jobs until stopped */
+        void WorkerLoop()
+        {
+            while (true)
+            {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+                    if (jobs_.empty())
+                    {
+                        return;
+                    }
+                    job = std::move(jobs_.front());
+                    jobs_.pop_front();
+                }
+                job();
+            }
+        }
+
+        std::vector<std::thread> workers_;          // Worker threads
+        std::deque<std::function<void()>> jobs_;    // Jobs waiting for a worker
+        std::mutex mutex_;                          // Guards jobs_ and stopping_
+        std::condition_variable wake_;              // Signals new jobs or shutdown
+        bool stopping_;                             // Set when the pool is destroyed
+    };
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_THREAD_POOL_HPP_
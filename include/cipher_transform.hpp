@@ -0,0 +1,358 @@
+/************************************************************\
+Filename:   cipher_transform.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Compiles a method name, key and flags into one cipher
+    applied block by block. The command line tool and the C
+    library both build their ciphers here, so the methods and
+    flags they accept, and the errors they give, stay the same.
+
+    Every transform takes the input and output buffers, which
+    may be the same buffer, the length of the block and the
+    offset of the block in the whole text.
+
+\************************************************************/
+
+
+#ifndef CIPHER_TRANSFORM_HPP_
+#define CIPHER_TRANSFORM_HPP_
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include "caesar_cipher.hpp"
+#include "cipher_chain.hpp"
+#include "cipher_result.hpp"
+#include "cipher_thread_pool.hpp"
+#include "cipher_utils.hpp"
+#include "rail_fence_cipher.hpp"
+#include "scytale_cipher.hpp"
+#include "substitution_cipher.hpp"
+#include "vigenere_cipher.hpp"
+
+
+namespace cipher {
+
+    /* ===== Types ===== */
+
+    /**
+     * A cipher applied to one block of text
+     * Takes (input, output, length, offset of the block in the whole text).
+     */
+    typedef std::function<CipherResult(const char*, char*, size_t, size_t)> BlockTransform;
+
+    /**
+     * What to compile: the method and the flags that change how it runs
+     */
+    struct TransformOptions
+    {
+        std::string method;     // Name of the cipher, or a chain of METHOD:KEY stages
+        bool decrypt;           // Build the decryption instead of the encryption
+        bool keep_case;         // Cipher letters of either case and pass everything else through
+        bool binary;            // Cipher raw bytes, with no validation
+        size_t num_threads;     // Threads for the parallel engines, 0 for one per core, 1 for none
+    };
+
+    /**
+     * Key phase of the stream a case-preserving Vigenere transform is working through
+     * Owned by the transform, so separate transforms never share a phase.
+     */
+    struct MixedKeyPhase
+    {
+        std::mutex mutex;       // Guards the fields below
+        size_t next_offset;     // Offset the next block of the stream starts at
+        size_t letters;         // Letters in the stream before next_offset
+    };
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Check that a method can run with the given flags
+     * @param[in]   options - Method and flags
+     * @throw   If the flags can't be used with the method
+     */
+    inline void CheckTransformOptions(const TransformOptions& options)
+    {
+        if (options.binary && (options.keep_case || IsCipherChain(options.method) || (options.method == "substitution")))
+        {
+            throw std::runtime_error("binary mode supports only caesar, vigenere, railfence and scytale, without keep case");
+        }
+        else if (options.keep_case && IsCipherChain(options.method))
+        {
+            throw std::runtime_error("case-preserving mode does not support cipher chains");
+        }
+    }
+
+    /**
+     * Threads for a cipher with a parallel engine to run on
+     * @param[in]   num_threads - Worker count, 0 for one per core
+     * @return  The pool, or null to run on the calling thread only
+     */
+    inline std::shared_ptr<ThreadPool> MakeThreadPool(const size_t num_threads)
+    {
+        std::shared_ptr<ThreadPool> pool;
+        if (num_threads != 1)
+        {
+            pool = std::make_shared<ThreadPool>(num_threads);
+        }
+        return pool;
+    }
+
+    /**
+     * Shift one block of text with a case-preserving Vigenere key
+     * The key phase depends on the letters in every earlier block, so the
+     * blocks of a stream must come in order, starting from offset 0, and a
+     * transform works through one stream at a time. A block at offset 0
+     * starts a new stream; whole messages at offset 0 may run at once.
+     * @param[in,out]   phase - The transform's key phase
+     * @param[in]   key_period - Key period buffer, see cipher_simd.hpp
+     * @param[in]   period - Length of the cipherkey
+     * @param[in]   input - The block to shift
+     * @param[out]  output - The resulting block
+     * @param[in]   length - Length of the block
+     * @param[in]   offset - Position of the block in the whole text
+     * @throw   If a block comes out of order
+     */
+    inline CipherResult ShiftMixedInOrder(MixedKeyPhase& phase,
+                                          const uint8_t* key_period,
+                                          const size_t period,
+                                          const char* input,
+                                          char* output,
+                                          const size_t length,
+                                          const size_t offset)
+    {
+        size_t letters = 0U;
+        if (offset != 0)
+        {
+            std::lock_guard<std::mutex> lock(phase.mutex);
+            if (offset != phase.next_offset)
+            {
+                throw std::logic_error("case-preserving Vigenere blocks must come in order");
+            }
+            letters = phase.letters;
+        }
+        letters += ShiftVigenereMixedAt(key_period, period, letters, input, output, length);
+
+        std::lock_guard<std::mutex> lock(phase.mutex);
+        phase.next_offset = offset + length;
+        phase.letters = letters;
+        return ResultOk();
+    }
+
+    /**
+     * Run a transposition over the letters of a block only, leaving everything else in place
+     * @param[in]   transpose - The transposition, as a transform over letters
+     * @param[in]   input - The block to transpose
+     * @param[out]  output - The resulting block. May be the same buffer as input.
+     * @param[in]   length - Length of the block
+     * @return  Any error from transpose other than invalid text
+     */
+    inline CipherResult TransposeLetters(const BlockTransform& transpose,
+                                         const char* input,
+                                         char* output,
+                                         const size_t length)
+    {
+        thread_local std::string letters;
+        thread_local std::string transposed;
+        letters.resize(std::max(letters.size(), length));
+        transposed.resize(std::max(transposed.size(), length));
+        const size_t count = GatherLetters(input, length, &letters[0]);
+
+        // Lower-case letters are reported as invalid text, but the whole block is still transposed
+        const CipherResult result = transpose(letters.data(), &transposed[0], count, 0);
+        if (!result.Ok() && (result.status != CIPHER_STATUS_INVALID_TEXT))
+        {
+            return result;
+        }
+        ScatterLetters(input, transposed.data(), output, length);
+        return ResultOk();
+    }
+
+    /**
+     * Compile the key and build the cipher as a transform over blocks of text
+     * Caesar, Vigenere and substitution give the same result for any block
+     * size. Rail fence and scytale transpose each block on its own, in place
+     * when the output is the input buffer. A chain of METHOD:KEY stages is
+     * planned and compiled as one cipher. In binary mode Caesar and Vigenere
+     * shift every byte modulo 256 and the transpositions move any bytes.
+     * @param[in]   options - Method and flags
+     * @param[in]   cipherkey - The cipher key, with trailing whitespace removed; unused for a chain
+     * @return  The transform, or an empty function if the method is not supported
+     * @throw   If the key is invalid, or the flags can't be used with the method
+     */
+    inline BlockTransform MakeBlockTransform(const TransformOptions& options, const std::string& cipherkey)
+    {
+        const std::string& method = options.method;
+        const bool decrypt = options.decrypt;
+        CheckTransformOptions(options);
+
+        BlockTransform transform;
+        if (options.binary && (method == "vigenere"))
+        {
+            const std::shared_ptr<const VigenereKey> key = std::make_shared<const VigenereKey>(cipherkey);
+            const uint8_t* key_period = decrypt ? key->ByteDecryptPeriod() : key->EncryptPeriod();
+            const std::shared_ptr<ThreadPool> pool = MakeThreadPool(options.num_threads);
+            transform = [key, key_period, pool](const char* input, char* output, const size_t length, const size_t offset)
+            {
+                ShiftVigenereBytesParallel(key_period, key->Period(), offset, input, output, length, pool.get());
+                return ResultOk();
+            };
+        }
+        else if (options.binary && (method == "caesar"))
+        {
+            const std::shared_ptr<const CaesarKey> key = std::make_shared<const CaesarKey>(cipherkey[0]);
+            const uint8_t* key_period = decrypt ? key->ByteDecryptPeriod() : key->EncryptPeriod();
+            const std::shared_ptr<ThreadPool> pool = MakeThreadPool(options.num_threads);
+            transform = [key, key_period, pool](const char* input, char* output, const size_t length, const size_t)
+            {
+                ShiftVigenereBytesParallel(key_period, key->Period(), 0, input, output, length, pool.get());
+                return ResultOk();
+            };
+        }
+        else if (options.binary && (method == "railfence"))
+        {
+            const size_t num_rails = ParseNumericKey(cipherkey, "rail fence");
+            const std::shared_ptr<ThreadPool> pool = MakeThreadPool(options.num_threads);
+            transform = [num_rails, decrypt, pool](const char* input, char* output, const size_t length, const size_t)
+            {
+                if (input == output)
+                {
+                    decrypt ? TransposeRailFenceInPlace<true>(num_rails, output, length)
+                            : TransposeRailFenceInPlace<false>(num_rails, output, length);
+                }
+                else
+                {
+                    (void)(decrypt ? TransposeRailFence<true>(num_rails, input, output, length, pool.get())
+                                   : TransposeRailFence<false>(num_rails, input, output, length, pool.get()));
+                }
+                return ResultOk();
+            };
+        }
+        else if (options.keep_case && (method == "vigenere"))
+        {
+            const std::shared_ptr<const VigenereKey> key = std::make_shared<const VigenereKey>(cipherkey);
+            const uint8_t* key_period = decrypt ? key->DecryptPeriod() : key->EncryptPeriod();
+            const std::shared_ptr<MixedKeyPhase> phase = std::make_shared<MixedKeyPhase>();
+            phase->next_offset = 0U;
+            phase->letters = 0U;
+            transform = [key, key_period, phase](const char* input, char* output, const size_t length, const size_t offset)
+            {
+                return ShiftMixedInOrder(*phase, key_period, key->Period(), input, output, length, offset);
+            };
+        }
+        else if (options.keep_case && (method == "caesar"))
+        {
+            const std::shared_ptr<const CaesarKey> key = std::make_shared<const CaesarKey>(cipherkey[0]);
+            const uint8_t* key_period = decrypt ? key->DecryptPeriod() : key->EncryptPeriod();
+            transform = [key, key_period](const char* input, char* output, const size_t length, const size_t)
+            {
+                (void)ShiftVigenereMixedAt(key_period, key->Period(), 0, input, output, length);
+                return ResultOk();
+            };
+        }
+        else if (options.keep_case && (method == "substitution"))
+        {
+            const std::shared_ptr<const SubstitutionCipher> substitution =
+                std::make_shared<const SubstitutionCipher>(SubstitutionCipher::FromKeyword(cipherkey));
+            const uint8_t* table = decrypt ? substitution->DecryptTable() : substitution->EncryptTable();
+            transform = [substitution, table](const char* input, char* output, const size_t length, const size_t)
+            {
+                SubstituteAlphaMixed(table, input, output, length);
+                return ResultOk();
+            };
+        }
+        else if (options.keep_case && IsTranspositionMethod(method))
+        {
+            TransformOptions letter_options(options);
+            letter_options.keep_case = false;
+            const BlockTransform transpose = MakeBlockTransform(letter_options, cipherkey);
+            transform = [transpose](const char* input, char* output, const size_t length, const size_t)
+            {
+                return TransposeLetters(transpose, input, output, length);
+            };
+        }
+        else if (IsCipherChain(method))
+        {
+            const std::shared_ptr<const CipherChain> chain = std::make_shared<const CipherChain>(method, decrypt);
+            transform = [chain](const char* input, char* output, const size_t length, const size_t offset)
+            {
+                return chain->Apply(input, output, length, offset);
+            };
+        }
+        else if (method == "vigenere")
+        {
+            const std::shared_ptr<const VigenereKey> key = std::make_shared<const VigenereKey>(cipherkey);
+            const uint8_t* key_period = decrypt ? key->DecryptPeriod() : key->EncryptPeriod();
+            const std::shared_ptr<ThreadPool> pool = MakeThreadPool(options.num_threads);
+            transform = [key, key_period, pool](const char* input, char* output, const size_t length, const size_t offset)
+            {
+                return TryShiftVigenereAlphaParallel(key_period, key->Period(), offset, input, output, length, pool.get());
+            };
+        }
+        else if (method == "caesar")
+        {
+            const std::shared_ptr<const CaesarKey> key = std::make_shared<const CaesarKey>(cipherkey[0]);
+            const uint8_t* key_period = decrypt ? key->DecryptPeriod() : key->EncryptPeriod();
+            const std::shared_ptr<ThreadPool> pool = MakeThreadPool(options.num_threads);
+            transform = [key, key_period, pool](const char* input, char* output, const size_t length, const size_t offset)
+            {
+                return TryShiftVigenereAlphaParallel(key_period, key->Period(), offset, input, output, length, pool.get());
+            };
+        }
+        else if (method == "substitution")
+        {
+            // The key is a keyword for a keyed cipher alphabet,
+            // or the full 26 letter cipher alphabet
+            const std::shared_ptr<const SubstitutionCipher> substitution =
+                std::make_shared<const SubstitutionCipher>(SubstitutionCipher::FromKeyword(cipherkey));
+            const uint8_t* table = decrypt ? substitution->DecryptTable() : substitution->EncryptTable();
+            transform = [substitution, table](const char* input, char* output, const size_t length, const size_t)
+            {
+                return TrySubstituteAlpha(table, input, output, length);
+            };
+        }
+        else if (method == "railfence")
+        {
+            // Determine the correct key
+            // In this case, the number of rails
+            const size_t num_rails = ParseNumericKey(cipherkey, "rail fence");
+            const std::shared_ptr<ThreadPool> pool = MakeThreadPool(options.num_threads);
+            transform = [num_rails, decrypt, pool](const char* input, char* output, const size_t length, const size_t)
+            {
+                if (input == output)
+                {
+                    return decrypt ? TryDecryptRailFenceAlphaInPlace(num_rails, output, length)
+                                   : TryEncryptRailFenceAlphaInPlace(num_rails, output, length);
+                }
+                return decrypt
+                    ? TryRailFenceAlphaBlocked<true>(num_rails, input, output, length, pool.get())
+                    : TryRailFenceAlphaBlocked<false>(num_rails, input, output, length, pool.get());
+            };
+        }
+        else if (method == "scytale")
+        {
+            // Determine the correct key
+            // In this case, the width of the rows
+            // Scytale takes any characters, so binary mode needs nothing else
+            const size_t row_width = ParseNumericKey(cipherkey, "scytale");
+            transform = [row_width, decrypt](const char* input, char* output, const size_t length, const size_t)
+            {
+                return decrypt ? TryDecryptScytaleAlpha(row_width, input, output, length)
+                               : TryEncryptScytaleAlpha(row_width, input, output, length);
+            };
+        }
+        return transform;
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_TRANSFORM_HPP_
@@ -0,0 +1,215 @@
+/************************************************************\
+Filename:   cipher_transpose.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Cache-blocked byte matrix transpose, used by the
+    transposition ciphers.
+
+    A naive transpose reads one matrix with a large stride,
+    touching a new cache line (and often a new page) for every
+    byte once the matrix no longer fits in cache. Here the
+    matrix is split into tiles small enough that both the
+    source and destination tile stay in L1 cache, and full
+    16x16 blocks inside each tile are transposed in registers.
+
+\************************************************************/
+
+
+#ifndef CIPHER_TRANSPOSE_HPP_
+#define CIPHER_TRANSPOSE_HPP_
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** Edge length of the square tiles, chosen so a source and destination tile fit in L1 */
+    const size_t TRANSPOSE_TILE_SIZE = 64;
+
+    /** Edge length of the blocks transposed in registers */
+    const size_t TRANSPOSE_BLOCK_SIZE = 16;
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Transpose a small block one byte at a time
+     * See TransposeBytes for a description of the parameters.
+     */
+    inline void TransposeBytesScalar(const char* source,
+                                     const size_t source_stride,
+                                     char* destination,
+                                     const size_t destination_stride,
+                                     const size_t rows,
+                                     const size_t columns)
+    {
+        for (size_t column = 0; column < columns; ++column)
+        {
+            char* destination_row = destination + (column * destination_stride);
+            for (size_t row = 0; row < rows; ++row)
+            {
+                destination_row[row] = source[(row * source_stride) + column];
+            }
+        }
+    }
+
+#if defined(__SSE2__)
+
+    /**
+     * Transpose a 16x16 block of bytes in registers
+     * Four rounds of interleaving double the width of the elements each
+     * time (8, 16, 32 then 64 bits), after which register N holds column N.
+     */
+    inline void TransposeBlock16x16(const char* source,
+                                    const size_t source_stride,
+                                    char* destination,
+                                    const size_t destination_stride)
+    {
+        __m128i rows[16];
+        for (size_t row = 0; row < 16; ++row)
+        {
+            rows[row] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (row * source_stride)));
+        }
+
+        // Interleave bytes of row pairs: 2 rows x 8 columns per register
+        __m128i pairs[16];
+        for (size_t row = 0; row < 16; row += 2)
+        {
+            pairs[row] = _mm_unpacklo_epi8(rows[row], rows[row + 1]);
+            pairs[row + 1] = _mm_unpackhi_epi8(rows[row], rows[row + 1]);
+        }
+
+        // Interleave 16-bit pairs: 4 rows x 4 columns per register
+        __m128i quads[16];
+        for (size_t group = 0; group < 4; ++group)
+        {
+            const __m128i* in = pairs + (4 * group);
+            __m128i* out = quads + (4 * group);
+            out[0] = _mm_unpacklo_epi16(in[0], in[2]);
+            out[1] = _mm_unpackhi_epi16(in[0], in[2]);
+            out[2] = _mm_unpacklo_epi16(in[1], in[3]);
+            out[3] = _mm_unpackhi_epi16(in[1], in[3]);
+        }
+
+        // Interleave 32-bit quads: 8 rows x 2 columns per register
+        __m128i octets[2][8];
+        for (size_t half = 0; half < 2; ++half)
+        {
+            const __m128i* upper = quads + (8 * half);
+            const __m128i* lower = quads + (8 * half) + 4;
+            for (size_t quad = 0; quad < 4; ++quad)
+            {
+                octets[half][2 * quad] = _mm_unpacklo_epi32(upper[quad], lower[quad]);
+                octets[half][(2 * quad) + 1] = _mm_unpackhi_epi32(upper[quad], lower[quad]);
+            }
+        }
+
+        // Interleave 64-bit octets: 16 rows x 1 column per register
+        for (size_t pair = 0; pair < 8; ++pair)
+        {
+            const __m128i column_low = _mm_unpacklo_epi64(octets[0][pair], octets[1][pair]);
+            const __m128i column_high = _mm_unpackhi_epi64(octets[0][pair], octets[1][pair]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + ((2 * pair) * destination_stride)),
+                             column_low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (((2 * pair) + 1) * destination_stride)),
+                             column_high);
+        }
+    }
+
+#endif  // __SSE2__
+
+    /**
+     * Transpose one tile, using the register kernel for every full 16x16 block
+     * See TransposeBytes for a description of the parameters.
+     */
+    inline void TransposeTile(const char* source,
+                              const size_t source_stride,
+                              char* destination,
+                              const size_t destination_stride,
+                              const size_t rows,
+                              const size_t columns)
+    {
+#if defined(__SSE2__)
+        const size_t full_rows = rows - (rows % TRANSPOSE_BLOCK_SIZE);
+        const size_t full_columns = columns - (columns % TRANSPOSE_BLOCK_SIZE);
+        for (size_t row = 0; row < full_rows; row += TRANSPOSE_BLOCK_SIZE)
+        {
+            for (size_t column = 0; column < full_columns; column += TRANSPOSE_BLOCK_SIZE)
+            {
+                TransposeBlock16x16(source + (row * source_stride) + column,
+                                    source_stride,
+                                    destination + (column * destination_stride) + row,
+                                    destination_stride);
+            }
+        }
+
+        // Ragged right edge, then ragged bottom edge
+        TransposeBytesScalar(source + full_columns, source_stride,
+                             destination + (full_columns * destination_stride), destination_stride,
+                             rows, columns - full_columns);
+        TransposeBytesScalar(source + (full_rows * source_stride), source_stride,
+                             destination + full_rows, destination_stride,
+                             rows - full_rows, full_columns);
+#else
+        TransposeBytesScalar(source, source_stride, destination, destination_stride, rows, columns);
+#endif
+    }
+
+    /**
+     * Transpose a matrix of bytes
+     * Row r, column c of the source is copied to row c, column r of the destination:
+     *     destination[c * destination_stride + r] = source[r * source_stride + c]
+     * @param[in]   source - First byte of the source matrix
+     * @param[in]   source_stride - Distance between source rows, in bytes (>= columns)
+     * @param[out]  destination - First byte of the destination matrix. Must not overlap source.
+     * @param[in]   destination_stride - Distance between destination rows, in bytes (>= rows)
+     * @param[in]   rows - Number of rows in the source
+     * @param[in]   columns - Number of columns in the source
+     */
+    inline void TransposeBytes(const char* source,
+                               const size_t source_stride,
+                               char* destination,
+                               const size_t destination_stride,
+                               const size_t rows,
+                               const size_t columns)
+    {
+        // Degenerate shapes are plain copies
+        if ((rows == 1) || (columns == 1))
+        {
+            for (size_t index = 0; index < (rows * columns); ++index)
+            {
+                destination[(rows == 1) ? (index * destination_stride) : index] =
+                    source[(rows == 1) ? index : (index * source_stride)];
+            }
+            return;
+        }
+
+        for (size_t row = 0; row < rows; row += TRANSPOSE_TILE_SIZE)
+        {
+            const size_t tile_rows = std::min(TRANSPOSE_TILE_SIZE, rows - row);
+            for (size_t column = 0; column < columns; column += TRANSPOSE_TILE_SIZE)
+            {
+                const size_t tile_columns = std::min(TRANSPOSE_TILE_SIZE, columns - column);
+                TransposeTile(source + (row * source_stride) + column,
+                              source_stride,
+                              destination + (column * destination_stride) + row,
+                              destination_stride,
+                              tile_rows,
+                              tile_columns);
+            }
+        }
+    }
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_TRANSPOSE_HPP_
@@ -0,0 +1,512 @@
+/************************************************************\
+Filename:   cipher_uring.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    File to file ciphering through io_uring, so large reads
+    and writes are queued to the kernel a few at a time
+    instead of making one system call each.
+
+    A fixed set of chunk buffers is registered with the ring
+    once and reused. Each buffer goes round read, cipher in
+    place, write, then read the next unclaimed chunk. Chunks
+    may finish in any order, since the letter ciphers only
+    need the offset of each chunk to pick up the key phase.
+    With O_DIRECT the page cache is skipped; reads and writes
+    are then whole aligned blocks, and the padding written
+    after the last chunk is cut off at the end.
+
+    The backend is only built when liburing is found
+    (CIPHER_HAVE_LIBURING). Otherwise, and whenever a ring or
+    a file can't be set up, Open returns false and the caller
+    falls back to the stream path, as with MappedInput.
+
+\************************************************************/
+
+
+#ifndef CIPHER_URING_HPP_
+#define CIPHER_URING_HPP_
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "cipher_result.hpp"
+#ifdef CIPHER_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+
+namespace cipher {
+
+    /* ===== Constants ===== */
+
+    /** Default bytes read and written per request */
+    const size_t URING_CHUNK_SIZE = 1024 * 1024;
+
+    /** Chunk buffers, and so requests, in flight at once */
+    const size_t URING_QUEUE_DEPTH = 8;
+
+    /** Alignment of buffers, offsets and lengths for O_DIRECT */
+    const size_t URING_ALIGNMENT = 4096;
+
+
+    /* ===== Functions ===== */
+
+    /** Check if this build has the io_uring backend */
+    inline bool UringSupported()
+    {
+#ifdef CIPHER_HAVE_LIBURING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /** Round a length up to a multiple of URING_ALIGNMENT */
+    inline size_t AlignUp(const size_t length)
+    {
+        return ((length + URING_ALIGNMENT - 1) / URING_ALIGNMENT) * URING_ALIGNMENT;
+    }
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Ciphers one regular file into another through io_uring
+     * The ring and buffers are set up on the first Open and kept for
+     * later files, so one transformer can work through a whole batch.
+     */
+    class UringTransformer
+    {
+    public:
+        /**
+         * Create a transformer; nothing is set up until Open
+         * @param[in]   chunk_size - Bytes per read and write, rounded up to the O_DIRECT alignment
+         * @param[in]   direct - Open files with O_DIRECT where the file system allows it
+         */
+        UringTransformer(const size_t chunk_size, const bool direct) :
+            chunk_size_(AlignUp(std::max<size_t>(chunk_size, 1U))),
+            direct_(direct),
+            ready_(false),
+            fixed_buffers_(false),
+            buffers_(nullptr),
+            input_fd_(-1),
+            output_fd_(-1),
+            input_direct_(false),
+            output_direct_(false),
+            input_size_(0U),
+            newline_length_(1U)
+        {
+        }
+
+        ~UringTransformer()
+        {
+            Close();
+#ifdef CIPHER_HAVE_LIBURING
+            if (ready_)
+            {
+                io_uring_queue_exit(&ring_);
+            }
+#endif
+            std::free(buffers_);
+        }
+
+        UringTransformer(const UringTransformer&) = delete;
+        UringTransformer& operator=(const UringTransformer&) = delete;
+
+        /**
+         * Open an input and output file for Run
+         * @param[in]   input_path - Regular file to read the text from
+         * @param[in]   output_path - File to write the result to, created or truncated
+         * @return  False if io_uring is not available, or either file is not a regular file
+         * @throw   If the input is a regular file but the output can't be opened
+         */
+        bool Open(const char* input_path, const char* output_path)
+        {
+            Close();
+#ifdef CIPHER_HAVE_LIBURING
+            struct stat output_stat;
+            if (!SetUp() ||
+                ((stat(output_path, &output_stat) == 0) && !S_ISREG(output_stat.st_mode)))
+            {
+                return false;
+            }
+            input_fd_ = OpenFile(input_path, O_RDONLY, input_direct_);
+            struct stat input_stat;
+            if ((input_fd_ < 0) || (fstat(input_fd_, &input_stat) != 0) || !S_ISREG(input_stat.st_mode))
+            {
+                Close();
+                return false;
+            }
+            input_size_ = static_cast<size_t>(input_stat.st_size);
+            output_fd_ = OpenFile(output_path, O_WRONLY | O_CREAT | O_TRUNC, output_direct_);
+            if (output_fd_ < 0)
+            {
+                Close();
+                throw std::runtime_error("output file could not be opened");
+            }
+            return true;
+#else
+            (void)input_path;
+            (void)output_path;
+            return false;
+#endif
+        }
+
+        /** Close the files, if open */
+        void Close()
+        {
+            if (input_fd_ >= 0)
+            {
+                (void)close(input_fd_);
+                input_fd_ = -1;
+            }
+            if (output_fd_ >= 0)
+            {
+                (void)close(output_fd_);
+                output_fd_ = -1;
+            }
+        }
+
+        /**
+         * Cipher the open input file into the output file, then close both
+         * Trailing whitespace is dropped and a newline is written after the
+         * text, unless the file is binary data. After an error the output is
+         * cut at the offset of the error.
+         * @param[in]   transform - Callable (const char* input, char* output, size_t length,
+         *                          size_t offset) returning a CipherResult, where offset is
+         *                          the position of the text in the file. It is called with
+         *                          input == output, on chunks in any order.
+         * @param[in]   binary - Keep trailing whitespace and write no newline after the text
+         * @return  The error closest to the start of the text, if any
+         * @throw   If a read or write fails
+         */
+        template <typename Transform>
+        CipherResult Run(const Transform& transform, const bool binary = false)
+        {
+#ifdef CIPHER_HAVE_LIBURING
+            newline_length_ = binary ? 0U : 1U;
+            const size_t text_length = binary ? input_size_ : FindTextLength();
+            const size_t chunk_count = std::max<size_t>((text_length + chunk_size_ - 1) / chunk_size_, 1U);
+            std::vector<Slot> slots(URING_QUEUE_DEPTH);
+            size_t next_chunk = 0U;
+            size_t in_flight = 0U;
+            bool stopping = false;
+            int io_error = 0;
+            CipherResult result = ResultOk();
+
+            // Start a read in every slot, then keep each one busy until the chunks run out
+            for (size_t index = 0; (index < slots.size()) && (next_chunk < chunk_count); ++index)
+            {
+                slots[index].buffer = Buffer(index);
+                slots[index].index = index;
+                StartRead(slots[index], next_chunk++, text_length);
+                ++in_flight;
+            }
+            (void)io_uring_submit(&ring_);
+
+            while (in_flight > 0)
+            {
+                struct io_uring_cqe* cqe = nullptr;
+                const int wait_error = io_uring_wait_cqe(&ring_, &cqe);
+                if (wait_error == -EINTR)
+                {
+                    continue;
+                }
+                else if (wait_error < 0)
+                {
+                    // Nothing more can be collected, so buffers can't be reused safely
+                    throw std::runtime_error(std::string("io_uring: ") + std::strerror(-wait_error));
+                }
+                Slot& slot = *static_cast<Slot*>(io_uring_cqe_get_data(cqe));
+                const int completed = cqe->res;
+                io_uring_cqe_seen(&ring_, cqe);
+
+                if ((completed == -EINTR) || (completed == -EAGAIN))
+                {
+                    Submit(slot);
+                    (void)io_uring_submit(&ring_);
+                    continue;
+                }
+                else if ((completed < 0) || (slot.reading && (completed == 0)))
+                {
+                    // A failed request, or a file that shrank while being read
+                    io_error = (completed < 0) ? -completed : EIO;
+                    stopping = true;
+                    --in_flight;
+                    continue;
+                }
+                const size_t previous_done = slot.done;
+                slot.done += static_cast<size_t>(completed);
+
+                // A short O_DIRECT transfer can only carry on from an aligned
+                // position, so part of it is redone, or it fails if none can be kept
+                const size_t wanted = slot.reading ? slot.length : slot.io_length;
+                if ((slot.reading ? input_direct_ : output_direct_) && (slot.done < wanted))
+                {
+                    slot.done -= slot.done % URING_ALIGNMENT;
+                    if (slot.done == previous_done)
+                    {
+                        io_error = EIO;
+                        stopping = true;
+                        --in_flight;
+                        continue;
+                    }
+                }
+
+                if (slot.reading && (slot.done < slot.length))
+                {
+                    Submit(slot);
+                }
+                else if (slot.reading)
+                {
+                    // Cipher in place, even after an error, in case an earlier chunk has an earlier one
+                    CipherResult chunk_result = transform(slot.buffer, slot.buffer, slot.length, slot.offset);
+                    if (!chunk_result.Ok())
+                    {
+                        chunk_result.offset += slot.offset;
+                        if (result.Ok() || (chunk_result.offset < result.offset))
+                        {
+                            result = chunk_result;
+                        }
+                        stopping = true;
+                    }
+                    // Only text before the first error is kept
+                    if ((io_error != 0) || (!result.Ok() && (slot.offset > result.offset)))
+                    {
+                        --in_flight;
+                        continue;
+                    }
+                    StartWrite(slot, text_length);
+                }
+                else if (slot.done < slot.io_length)
+                {
+                    Submit(slot);
+                }
+                else if (!stopping && (next_chunk < chunk_count))
+                {
+                    StartRead(slot, next_chunk++, text_length);
+                }
+                else
+                {
+                    --in_flight;
+                }
+                (void)io_uring_submit(&ring_);
+            }
+
+            // Cut off the O_DIRECT padding, or the output after an error
+            const size_t output_length = result.Ok() ? (text_length + newline_length_) : result.offset;
+            const int truncate_error = ftruncate(output_fd_, static_cast<off_t>(output_length));
+            Close();
+            if (io_error != 0)
+            {
+                throw std::runtime_error(std::string("io_uring: ") + std::strerror(io_error));
+            }
+            else if (truncate_error != 0)
+            {
+                throw std::runtime_error("output file could not be written");
+            }
+            return result;
+#else
+            (void)transform;
+            (void)binary;
+            return ResultOk();
+#endif
+        }
+
+    private:
+        /**
+         * One buffer and the request it is part of
+         */
+        struct Slot
+        {
+            char* buffer;           // Registered chunk buffer
+            size_t index;           // Index of the buffer in the registration
+            size_t offset;          // Position of the chunk in the file
+            size_t length;          // Bytes of text in the chunk
+            size_t io_length;       // Bytes to read or write, padded for O_DIRECT
+            size_t done;            // Bytes read or written so far
+            bool reading;           // Read in progress, otherwise a write
+        };
+
+        /** Start of one chunk buffer, with room for the final newline and padding */
+        char* Buffer(const size_t index) const
+        {
+            return buffers_ + (index * (chunk_size_ + URING_ALIGNMENT));
+        }
+
+#ifdef CIPHER_HAVE_LIBURING
+        /**
+         * Create the ring and buffers on first use
+         * @return  False if the kernel refuses io_uring or memory runs out
+         */
+        bool SetUp()
+        {
+            if (ready_)
+            {
+                return true;
+            }
+            const size_t buffer_size = chunk_size_ + URING_ALIGNMENT;
+            if ((buffers_ == nullptr) &&
+                (posix_memalign(reinterpret_cast<void**>(&buffers_), URING_ALIGNMENT,
+                                buffer_size * URING_QUEUE_DEPTH) != 0))
+            {
+                buffers_ = nullptr;
+                return false;
+            }
+            if (io_uring_queue_init(static_cast<unsigned>(URING_QUEUE_DEPTH), &ring_, 0) < 0)
+            {
+                return false;
+            }
+
+            // Registered buffers save pinning pages on every request, but need
+            // enough locked memory; plain requests work without them
+            std::vector<struct iovec> iovecs(URING_QUEUE_DEPTH);
+            for (size_t index = 0; index < URING_QUEUE_DEPTH; ++index)
+            {
+                iovecs[index].iov_base = Buffer(index);
+                iovecs[index].iov_len = buffer_size;
+            }
+            fixed_buffers_ = (io_uring_register_buffers(&ring_, iovecs.data(),
+                                                        static_cast<unsigned>(iovecs.size())) == 0);
+            ready_ = true;
+            return true;
+        }
+
+        /**
+         * Open a file, with O_DIRECT if asked for and the file system allows it
+         * @param[out]  direct - Set if the file was opened with O_DIRECT
+         */
+        int OpenFile(const char* path, const int flags, bool& direct) const
+        {
+            direct = false;
+            if (direct_)
+            {
+                const int fd = open(path, flags | O_DIRECT, 0644);
+                if ((fd >= 0) || (errno != EINVAL))
+                {
+                    direct = (fd >= 0);
+                    return fd;
+                }
+            }
+            return open(path, flags, 0644);
+        }
+
+        /**
+         * Find the length of the input without trailing whitespace
+         * Reads back from the end one aligned block at a time, through
+         * the first buffer, so it works for O_DIRECT files too.
+         */
+        size_t FindTextLength()
+        {
+            char* block = Buffer(0);
+            size_t end = input_size_;
+            while (end > 0)
+            {
+                const size_t block_start = ((end - 1) / URING_ALIGNMENT) * URING_ALIGNMENT;
+                const ssize_t received = pread(input_fd_, block, URING_ALIGNMENT, static_cast<off_t>(block_start));
+                if (received <= 0)
+                {
+                    throw std::runtime_error("input file could not be read");
+                }
+                end = std::min(end, block_start + static_cast<size_t>(received));
+                while ((end > block_start) && std::isspace(static_cast<unsigned char>(block[end - block_start - 1])))
+                {
+                    --end;
+                }
+                if (end > block_start)
+                {
+                    break;
+                }
+            }
+            return end;
+        }
+
+        /** Queue a read of a chunk into a slot */
+        void StartRead(Slot& slot, const size_t chunk, const size_t text_length)
+        {
+            slot.offset = chunk * chunk_size_;
+            slot.length = std::min(chunk_size_, text_length - std::min(text_length, slot.offset));
+            slot.io_length = input_direct_ ? AlignUp(slot.length) : slot.length;
+            slot.done = 0U;
+            slot.reading = true;
+            if (slot.length == 0)
+            {
+                // Empty text: skip straight to writing the newline
+                StartWrite(slot, text_length);
+                return;
+            }
+            Submit(slot);
+        }
+
+        /** Queue the write of a ciphered chunk, with the newline after the last one */
+        void StartWrite(Slot& slot, const size_t text_length)
+        {
+            size_t write_length = slot.length;
+            if ((slot.offset + slot.length == text_length) && (newline_length_ != 0))
+            {
+                slot.buffer[write_length++] = '\n';
+            }
+            slot.io_length = output_direct_ ? AlignUp(write_length) : write_length;
+            slot.done = 0U;
+            slot.reading = false;
+            Submit(slot);
+        }
+
+        /** Queue the rest of a slot's read or write */
+        void Submit(Slot& slot)
+        {
+            struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+            char* const buffer = slot.buffer + slot.done;
+            const unsigned length = static_cast<unsigned>(slot.io_length - slot.done);
+            const off_t offset = static_cast<off_t>(slot.offset + slot.done);
+            if (slot.reading && fixed_buffers_)
+            {
+                io_uring_prep_read_fixed(sqe, input_fd_, buffer, length, offset, static_cast<int>(slot.index));
+            }
+            else if (slot.reading)
+            {
+                io_uring_prep_read(sqe, input_fd_, buffer, length, offset);
+            }
+            else if (fixed_buffers_)
+            {
+                io_uring_prep_write_fixed(sqe, output_fd_, buffer, length, offset, static_cast<int>(slot.index));
+            }
+            else
+            {
+                io_uring_prep_write(sqe, output_fd_, buffer, length, offset);
+            }
+            io_uring_sqe_set_data(sqe, &slot);
+        }
+
+        struct io_uring ring_;      // The submission and completion queues
+#endif
+
+        size_t chunk_size_;         // Bytes per read and write
+        bool direct_;               // Try O_DIRECT when opening files
+        bool ready_;                // Ring and buffers are set up
+        bool fixed_buffers_;        // Buffers are registered with the ring
+        char* buffers_;             // URING_QUEUE_DEPTH aligned chunk buffers
+        int input_fd_;              // Open input file, or -1
+        int output_fd_;             // Open output file, or -1
+        bool input_direct_;         // Input was opened with O_DIRECT
+        bool output_direct_;        // Output was opened with O_DIRECT
+        size_t input_size_;         // Size of the input file
+        size_t newline_length_;     // Bytes written after the text: 1 for text, 0 for binary data
+    };
+
+}   // end namespace cipher
+
+
+#endif  // CIPHER_URING_HPP_
@@ -15,10 +15,14 @@ Description:
 #include <algorithm>
 #include <functional>
 #include <cctype>
+#include <cstdint>
+#include <limits>
 #include <locale>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 
 namespace cipher {
@@ -31,12 +35,36 @@ namespace cipher {
         return ((alpha >= 'A') && (alpha <= 'Z'));
     }
 
+    /**
+     * Check if a given character is NOT a valid upper-case alphabet character
+     * Branch-free, so it can be accumulated inside a transform loop
+     */
+    inline bool NotUpperAlpha(const char alpha)
+    {
+        return static_cast<uint8_t>(alpha - 'A') > 25U;
+    }
+
     /** Check if a given character is a valid upper-case alphabet character */
     inline bool IsLowerAlpha(const char alpha)
     {
         return ((alpha >= 'a') && (alpha <= 'z'));
     }
 
+    /**
+     * Letter index (0-25) of a letter of either case, or more than 25 for any other byte
+     * Branch-free: setting the 0x20 bit folds A-Z onto a-z and moves nothing else into a-z.
+     */
+    inline uint8_t FoldedLetterIndex(const char alpha)
+    {
+        return static_cast<uint8_t>(static_cast<uint8_t>(alpha | 0x20) - 'a');
+    }
+
+    /** Check if a given character is a letter of either case */
+    inline bool IsAlpha(const char alpha)
+    {
+        return FoldedLetterIndex(alpha) < 26U;
+    }
+
     /** Convert a chart to a hexadecimal string */
     inline std::string PrintCharHex(const char alpha)
     {
@@ -45,6 +73,20 @@ namespace cipher {
         return oss.str();
     }
 
+    /**
+     * Build the error thrown when a non-alpha character is found
+     * @param[in]   alpha - The offending character
+     * @param[in]   location - Where the character was found, e.g. "plaintext"
+     */
+    inline std::runtime_error NonAlphaError(const char alpha, const char* location)
+    {
+        std::stringstream oss;
+        oss << "Non alphabet character 0x"
+            << PrintCharHex(alpha)
+            << " found in " << location;
+        return std::runtime_error(oss.str());
+    }
+
     /** Invert a cipherkey (for A-Z alphabet) so it can be used for decryption */
     inline std::string InvertCipherkey(const std::string& cipherkey)
     {
@@ -65,6 +107,71 @@ namespace cipher {
         return std::all_of(plaintext.begin(), plaintext.end(), IsUpperAlpha);
     }
 
+    /**
+     * Copy the letters (A-Z and a-z) of a text to a buffer, leaving out everything else
+     * @param[in]   text - The text to read
+     * @param[in]   length - Length of text
+     * @param[out]  letters - The letters of text, in order; must hold length bytes
+     * @return  Number of letters copied
+     */
+    inline size_t GatherLetters(const char* text, const size_t length, char* letters)
+    {
+        size_t count = 0U;
+        for (size_t index = 0; index < length; ++index)
+        {
+            letters[count] = text[index];
+            count += IsAlpha(text[index]) ? 1U : 0U;
+        }
+        return count;
+    }
+
+    /**
+     * Put letters back in the letter positions of a text, the reverse of GatherLetters
+     * @param[in]   text - The text whose letter positions are used
+     * @param[in]   letters - One letter for each letter of text, in order
+     * @param[out]  output - Text with its letters replaced and every other byte copied.
+     *                       May be the same buffer as text.
+     * @param[in]   length - Length of text
+     */
+    inline void ScatterLetters(const char* text, const char* letters, char* output, const size_t length)
+    {
+        size_t count = 0U;
+        for (size_t index = 0; index < length; ++index)
+        {
+            output[index] = IsAlpha(text[index]) ? letters[count++] : text[index];
+        }
+    }
+
+    /**
+     * Parse the key of a transposition cipher
+     * Keys larger than the text are allowed; they leave the text unchanged.
+     * @param[in]   cipherkey - Decimal number, at least 1
+     * @param[in]   cipher_name - Name of the cipher, for the error message
+     * @throw   If the key is not a positive decimal number that fits in size_t
+     */
+    inline size_t ParseNumericKey(const std::string& cipherkey, const char* cipher_name)
+    {
+        size_t value = 0U;
+        bool valid = !cipherkey.empty();
+        for (const char digit : cipherkey)
+        {
+            const size_t digit_value = static_cast<size_t>(digit - '0');
+            if ((digit < '0') || (digit > '9') ||
+                (value > ((std::numeric_limits<size_t>::max() - digit_value) / 10)))
+            {
+                valid = false;
+                break;
+            }
+            value = (value * 10) + digit_value;
+        }
+        if (!valid || (value == 0))
+        {
+            throw std::runtime_error(std::string("Bad key \"") + cipherkey + "\"; key for " + cipher_name +
+                                     " cipher is a positive number.");
+        }
+        return value;
+    }
+
 
     // Whitespace trim functions
     // Taken from https://stackoverflow.com/a/217605/5179394
@@ -15,67 +15,601 @@ Description:
 
 
 /* ===== Includes ===== */
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <exception>
+#include <stdexcept>
+#include "cipher_permute.hpp"
+#include "cipher_result.hpp"
+#include "cipher_simd.hpp"
+#include "cipher_thread_pool.hpp"
 #include "cipher_utils.hpp"
 
 
 namespace cipher {
 
+    /* ===== Constants ===== */
+
+    /** Letters copied by each block of the rail fence engine, sized to stay in L2 cache */
+    const size_t RAIL_FENCE_BLOCK_SIZE = 256 * 1024;
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Closed-form positions of the rail fence zigzag
+     *
+     * The zigzag repeats every cycle of 2 * (num_rails - 1) letters. Within
+     * a cycle, rail 0 and the last rail take one letter each and every
+     * middle rail takes two (one going down, one coming back up). So the
+     * ciphertext offset where each rail starts, and where any plaintext
+     * letter lands, can be computed directly from the number of full
+     * cycles and the letters left over.
+     *
+     * Example: 4 rails, cycle length 6
+     *     W . . . . . I . . . . . R
+     *     . E . . . D . S . . . E .
+     *     . . A . E . . . C . V . .
+     *     . . . R . . . . . O . . .
+     */
+    class RailFenceLayout
+    {
+    public:
+        /**
+         * Create the layout for a message
+         * @param[in]   num_rails - Number of rails, must be at least 2
+         * @param[in]   length - Length of the message
+         */
+        RailFenceLayout(const size_t num_rails, const size_t length) :
+            num_rails_(num_rails),
+            cycle_(2 * (num_rails - 1)),
+            full_cycles_(length / cycle_),
+            remainder_(length % cycle_)
+        {
+        }
+
+        /** Number of letters in one full zigzag cycle */
+        size_t CycleLength() const
+        {
+            return cycle_;
+        }
+
+        /** Offset in the ciphertext of the first letter of a rail */
+        size_t RailStart(const size_t rail) const
+        {
+            if (rail == 0)
+            {
+                return 0U;
+            }
+            // Full cycles give rail 0 one letter and each middle rail two,
+            // then count the letters of rails above this one in the last cycle
+            const size_t going_down = std::min(remainder_, rail);
+            const size_t coming_up_from = cycle_ - rail + 1;
+            const size_t coming_up = (remainder_ > coming_up_from) ? (remainder_ - coming_up_from) : 0U;
+            return (full_cycles_ * ((2 * rail) - 1)) + going_down + coming_up;
+        }
+
+        /** Offset in the ciphertext of the letter at a plaintext offset */
+        size_t CipherIndex(const size_t plain_index) const
+        {
+            const size_t cycle = plain_index / cycle_;
+            const size_t position = plain_index % cycle_;
+            size_t cipher_index = 0U;
+            if (position == 0)
+            {
+                cipher_index = cycle;
+            }
+            else if (position < (num_rails_ - 1))
+            {
+                cipher_index = RailStart(position) + (2 * cycle);
+            }
+            else if (position == (num_rails_ - 1))
+            {
+                cipher_index = RailStart(position) + cycle;
+            }
+            else
+            {
+                cipher_index = RailStart(cycle_ - position) + (2 * cycle) + 1;
+            }
+            return cipher_index;
+        }
+
+        /** Offset in the plaintext of the letter at a ciphertext offset, the reverse of CipherIndex */
+        size_t PlainIndex(const size_t cipher_index) const
+        {
+            // Find the last rail starting at or before the letter; empty
+            // rails start where the next one does, so they are passed over
+            size_t rail = 0U;
+            size_t end_rail = num_rails_;
+            while ((end_rail - rail) > 1)
+            {
+                const size_t middle = rail + ((end_rail - rail) / 2);
+                if (RailStart(middle) <= cipher_index)
+                {
+                    rail = middle;
+                }
+                else
+                {
+                    end_rail = middle;
+                }
+            }
+
+            // Rail 0 and the last rail take one letter per cycle, the others two
+            const size_t letter = cipher_index - RailStart(rail);
+            if ((rail == 0) || (rail == (num_rails_ - 1)))
+            {
+                return (letter * cycle_) + rail;
+            }
+            return ((letter / 2) * cycle_) + (((letter % 2) == 0) ? rail : (cycle_ - rail));
+        }
+
+    private:
+        size_t num_rails_;      // Number of rails
+        size_t cycle_;          // Letters per zigzag cycle
+        size_t full_cycles_;    // Number of complete cycles in the message
+        size_t remainder_;      // Letters in the final partial cycle
+    };
+
+
     /* ===== Functions ===== */
 
     /**
-     * Encrypt the given plaintext using a Rail fence cipher
+     * Report the first non-alpha character in the text
+     * Called only after a transform loop has seen an invalid character,
+     * so the common case reads the text just once.
+     */
+    inline CipherResult FindInvalidText(const char* text, const size_t length)
+    {
+        const size_t offset = simd::FindNonUpperAlpha(text, length);
+        return ResultInvalidText(offset, text[offset]);
+    }
+
+    /**
+     * Copy the letters of a block of rails over a block of zigzag cycles
+     * Each rail's ciphertext offset comes from the layout, so blocks are
+     * independent and can be copied in any order, or concurrently.
+     * @param[in]   layout - Layout of the whole message
+     * @param[in]   num_rails - Number of rails, at least 2
+     * @param[in]   input - Plaintext when encrypting, ciphertext when decrypting
+     * @param[out]  output - Ciphertext when encrypting, plaintext when decrypting
+     * @param[in]   length - Length of the message
+     * @param[in]   first_rail, last_rail - Rails to copy, [first_rail, last_rail)
+     * @param[in]   first_cycle, last_cycle - Cycles to copy, [first_cycle, last_cycle)
+     * @return  True if any letter copied was not A-Z
+     */
+    template <bool Decrypt>
+    inline bool CopyRailFenceBlock(const RailFenceLayout& layout,
+                                   const size_t num_rails,
+                                   const char* input,
+                                   char* output,
+                                   const size_t length,
+                                   const size_t first_rail,
+                                   const size_t last_rail,
+                                   const size_t first_cycle,
+                                   const size_t last_cycle)
+    {
+        const size_t cycle_length = layout.CycleLength();
+        bool invalid = false;
+        for (size_t rail = first_rail; rail < last_rail; ++rail)
+        {
+            // Middle rails take two letters per cycle, the top and bottom rails one
+            const bool middle = (rail != 0) && (rail != (num_rails - 1));
+            size_t cipher_index = layout.RailStart(rail) + ((middle ? 2 : 1) * first_cycle);
+            size_t plain_index = (first_cycle * cycle_length) + rail;
+            for (size_t cycle = first_cycle; (cycle < last_cycle) && (plain_index < length); ++cycle)
+            {
+                char letter = Decrypt ? input[cipher_index] : input[plain_index];
+                output[Decrypt ? plain_index : cipher_index] = letter;
+                invalid |= NotUpperAlpha(letter);
+                ++cipher_index;
+
+                const size_t return_index = plain_index + cycle_length - (2 * rail);
+                if (middle && (return_index < length))
+                {
+                    letter = Decrypt ? input[cipher_index] : input[return_index];
+                    output[Decrypt ? return_index : cipher_index] = letter;
+                    invalid |= NotUpperAlpha(letter);
+                    ++cipher_index;
+                }
+                plain_index += cycle_length;
+            }
+        }
+        return invalid;
+    }
+
+    /**
+     * Run a rail fence transform as a grid of independent blocks
+     * The message is split into blocks of cycles and, when one cycle is
+     * longer than a block, blocks of rails too. Each block reads and
+     * writes about RAIL_FENCE_BLOCK_SIZE letters, so the cost is linear
+     * in the length of the message and stays cache-friendly for any
+     * number of rails. Any bytes are moved, so this also transposes
+     * binary data.
+     * @param[in]   num_rails - The encryption key, number of rails; 0 or 1 copies the text
+     * @param[in]   input - Plaintext when encrypting, ciphertext when decrypting
+     * @param[out]  output - Ciphertext when encrypting, plaintext when decrypting.
+     *                       Must hold length bytes and must not overlap input.
+     * @param[in]   length - Length of the text
+     * @param[in]   pool - Threads to run the blocks on, or null to run them on this thread
+     * @return  True if any byte of input was not A-Z
+     */
+    template <bool Decrypt>
+    inline bool TransposeRailFence(const size_t num_rails,
+                                   const char* input,
+                                   char* output,
+                                   const size_t length,
+                                   ThreadPool* pool)
+    {
+        // With one rail, or at least as many rails as letters, every letter
+        // stays where it is
+        if ((num_rails <= 1) || (num_rails >= length))
+        {
+            std::copy(input, input + length, output); // identity, text is unchanged
+            return simd::FindNonUpperAlpha(input, length) != length;
+        }
+
+        const RailFenceLayout layout(num_rails, length);
+        const size_t cycle_length = layout.CycleLength();
+        const size_t total_cycles = (length + cycle_length - 1) / cycle_length;
+        size_t cycles_per_block = 1;
+        size_t rails_per_block = num_rails;
+        if (cycle_length <= RAIL_FENCE_BLOCK_SIZE)
+        {
+            cycles_per_block = RAIL_FENCE_BLOCK_SIZE / cycle_length;
+        }
+        else
+        {
+            rails_per_block = RAIL_FENCE_BLOCK_SIZE / 2;
+        }
+        const size_t cycle_blocks = (total_cycles + cycles_per_block - 1) / cycles_per_block;
+        const size_t rail_blocks = (num_rails + rails_per_block - 1) / rails_per_block;
+
+        std::atomic<bool> invalid(false);
+        const auto copy_block = [&](const size_t block)
+        {
+            const size_t first_cycle = (block / rail_blocks) * cycles_per_block;
+            const size_t first_rail = (block % rail_blocks) * rails_per_block;
+            if (CopyRailFenceBlock<Decrypt>(layout, num_rails, input, output, length,
+                                            first_rail, std::min(num_rails, first_rail + rails_per_block),
+                                            first_cycle, std::min(total_cycles, first_cycle + cycles_per_block)))
+            {
+                invalid = true;
+            }
+        };
+
+        if (pool != nullptr)
+        {
+            pool->ParallelFor(cycle_blocks * rail_blocks, copy_block);
+        }
+        else
+        {
+            for (size_t block = 0; block < (cycle_blocks * rail_blocks); ++block)
+            {
+                copy_block(block);
+            }
+        }
+        return invalid;
+    }
+
+    /**
+     * Run a rail fence transform as a grid of independent blocks, validating the text
+     * See TransposeRailFence. The whole output is written even when the text is invalid.
+     * @param[in]   num_rails - The encryption key, number of rails
+     * @param[in]   input - Plaintext when encrypting, ciphertext when decrypting
+     * @param[out]  output - Ciphertext when encrypting, plaintext when decrypting.
+     *                       Must hold length bytes and must not overlap input.
+     * @param[in]   length - Length of the text
+     * @param[in]   pool - Threads to run the blocks on, or null to run them on this thread
+     * @return  The first non-alpha character in input, if any, or an invalid key
+     */
+    template <bool Decrypt>
+    inline CipherResult TryRailFenceAlphaBlocked(const size_t num_rails,
+                                                 const char* input,
+                                                 char* output,
+                                                 const size_t length,
+                                                 ThreadPool* pool)
+    {
+        // Input checking
+        if (num_rails <= 0)
+        {
+            return ResultInvalidKey();
+        }
+        return TransposeRailFence<Decrypt>(num_rails, input, output, length, pool)
+            ? FindInvalidText(input, length) : ResultOk();
+    }
+
+    /**
+     * Encrypt the given plaintext using a Rail fence cipher, without throwing
      * This function is limited to upper-case alphabet characters (A-Z)
      * @param[in]   num_rails - The encryption key, number of rails used for encryption.
      *                          Use the same key to decrypt.
      * @param[in]   plaintext - The text to encrypt
      * @param[out]  ciphertext - The resulting encrypted text
-     * @throw   If plaintext contain non-alpha characters
+     * @return  The first non-alpha character in plaintext, if any, or an invalid key
      */
-    inline void EncryptRailFenceAlpha(const size_t num_rails, const std::string& plaintext, std::string& ciphertext)
+    inline CipherResult TryEncryptRailFenceAlpha(const size_t num_rails, const std::string& plaintext, std::string& ciphertext)
     {
-        // Input checking
-        if (!AllUpperAlpha(plaintext))
+        ciphertext.resize(plaintext.size());
+        return TryRailFenceAlphaBlocked<false>(num_rails, plaintext.data(), &ciphertext[0], plaintext.size(), nullptr);
+    }
+
+    /**
+     * Decrypt the given ciphertext using a Rail fence cipher, without throwing
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   num_rails - The encryption key, number of rails used for decryption.
+     *                          Use the same key to encrypt.
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @return  The first non-alpha character in ciphertext, if any, or an invalid key
+     */
+    inline CipherResult TryDecryptRailFenceAlpha(const size_t num_rails, const std::string& ciphertext, std::string& plaintext)
+    {
+        plaintext.resize(ciphertext.size());
+        return TryRailFenceAlphaBlocked<true>(num_rails, ciphertext.data(), &plaintext[0], ciphertext.size(), nullptr);
+    }
+
+    /**
+     * Encrypt the given plaintext using a Rail fence cipher on several threads, without throwing
+     * The output is identical to TryEncryptRailFenceAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   num_rails - The encryption key, number of rails used for encryption.
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @param[in]   pool - Threads to run on
+     * @return  The first non-alpha character in plaintext, if any, or an invalid key
+     */
+    inline CipherResult TryEncryptRailFenceAlphaParallel(const size_t num_rails,
+                                                         const std::string& plaintext,
+                                                         std::string& ciphertext,
+                                                         ThreadPool& pool)
+    {
+        ciphertext.resize(plaintext.size());
+        return TryRailFenceAlphaBlocked<false>(num_rails, plaintext.data(), &ciphertext[0], plaintext.size(), &pool);
+    }
+
+    /**
+     * Decrypt the given ciphertext using a Rail fence cipher on several threads, without throwing
+     * The output is identical to TryDecryptRailFenceAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   num_rails - The encryption key, number of rails used for decryption.
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @param[in]   pool - Threads to run on
+     * @return  The first non-alpha character in ciphertext, if any, or an invalid key
+     */
+    inline CipherResult TryDecryptRailFenceAlphaParallel(const size_t num_rails,
+                                                         const std::string& ciphertext,
+                                                         std::string& plaintext,
+                                                         ThreadPool& pool)
+    {
+        plaintext.resize(ciphertext.size());
+        return TryRailFenceAlphaBlocked<true>(num_rails, ciphertext.data(), &plaintext[0], ciphertext.size(), &pool);
+    }
+
+    /**
+     * Encrypt the given plaintext using a Rail fence cipher on several threads
+     * The output is identical to EncryptRailFenceAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   num_rails - The encryption key, number of rails used for encryption.
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @param[in]   pool - Threads to run on
+     * @throw   If plaintext contains non-alpha characters
+     */
+    inline void EncryptRailFenceAlphaParallel(const size_t num_rails,
+                                              const std::string& plaintext,
+                                              std::string& ciphertext,
+                                              ThreadPool& pool)
+    {
+        ThrowIfError(TryEncryptRailFenceAlphaParallel(num_rails, plaintext, ciphertext, pool),
+                     "Error: number of rails must be > 0", "plaintext");
+    }
+
+    /**
+     * Decrypt the given ciphertext using a Rail fence cipher on several threads
+     * The output is identical to DecryptRailFenceAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   num_rails - The encryption key, number of rails used for decryption.
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @param[in]   pool - Threads to run on
+     * @throw   If ciphertext contains non-alpha characters
+     */
+    inline void DecryptRailFenceAlphaParallel(const size_t num_rails,
+                                              const std::string& ciphertext,
+                                              std::string& plaintext,
+                                              ThreadPool& pool)
+    {
+        ThrowIfError(TryDecryptRailFenceAlphaParallel(num_rails, ciphertext, plaintext, pool),
+                     "Error: number of rails must be > 0", "ciphertext");
+    }
+
+    /**
+     * Run a rail fence transform within the caller's buffer
+     * Uses one bit of extra memory per byte instead of a second buffer.
+     * Any bytes are moved, so this also transposes binary data.
+     * @param[in]       num_rails - The encryption key, number of rails; 0 or 1 leaves the text unchanged
+     * @param[in,out]   text - Plaintext when encrypting, ciphertext when decrypting; replaced with the result
+     * @param[in]       length - Length of text
+     */
+    template <bool Decrypt>
+    inline void TransposeRailFenceInPlace(const size_t num_rails, char* text, const size_t length)
+    {
+        if ((num_rails <= 1) || (num_rails >= length))
         {
-            throw std::runtime_error("Error: non-alpha character in plaintext.");
+            return; // identity, text is unchanged
         }
-        else if (num_rails <= 0)
+        const RailFenceLayout layout(num_rails, length);
+        const auto cipher_index = [&layout](const size_t index) { return layout.CipherIndex(index); };
+        if (Decrypt)
         {
-            throw std::runtime_error("Error: number of rails must be > 0");
+            GatherInPlace(text, length, cipher_index);
         }
-        else if (num_rails == 1)
+        else
         {
-            ciphertext = plaintext; // identity, plaintext is unchanged
+            ScatterInPlace(text, length, cipher_index);
         }
-        else
+    }
+
+    /**
+     * Encrypt text using a Rail fence cipher within the caller's buffer, without throwing
+     * Uses one bit of extra memory per letter instead of a second buffer.
+     * The text is checked before it is modified, so on error it is unchanged.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]       num_rails - The encryption key, number of rails used for encryption.
+     * @param[in,out]   text - The plaintext to encrypt, replaced with the ciphertext
+     * @param[in]       length - Length of text
+     * @return  The first non-alpha character in text, if any, or an invalid key
+     */
+    inline CipherResult TryEncryptRailFenceAlphaInPlace(const size_t num_rails, char* text, const size_t length)
+    {
+        const size_t invalid_offset = simd::FindNonUpperAlpha(text, length);
+        if (num_rails <= 0)
         {
-            // Allocate space for the ciphertext
-            const size_t plaintext_size = plaintext.size();
-            ciphertext.resize(plaintext_size);
-            size_t ciphertext_index = 0U;
-            for (size_t rail_n = 0; rail_n < num_rails; ++rail_n)
-            {
-                // gap1 = (num_rails - rail_n - 1) * 2
-                const size_t gap1 = (num_rails - rail_n - 1) << 1;  // same as x2
-                const size_t gap2 = ((num_rails - 1) << 1) - gap1;
-
-                // Starting point, rail_n
-                size_t plaintext_index = rail_n;
-                size_t gap = 1;
-                bool gap_switch = true;
-                while (plaintext_index < plaintext_size)
-                {
-                    if (gap > 0)
-                    {
-                        ciphertext[ciphertext_index++] = plaintext[plaintext_index];
-                    }
-                    gap = (gap_switch ? gap1 : gap2);
-                    gap_switch = !gap_switch;
-                    plaintext_index += gap;
-                }
-            }
+            return ResultInvalidKey();
+        }
+        else if (invalid_offset != length)
+        {
+            return ResultInvalidText(invalid_offset, text[invalid_offset]);
+        }
+        TransposeRailFenceInPlace<false>(num_rails, text, length);
+        return ResultOk();
+    }
+
+    /**
+     * Decrypt text using a Rail fence cipher within the caller's buffer, without throwing
+     * Uses one bit of extra memory per letter instead of a second buffer.
+     * The text is checked before it is modified, so on error it is unchanged.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]       num_rails - The encryption key, number of rails used for decryption.
+     * @param[in,out]   text - The ciphertext to decrypt, replaced with the plaintext
+     * @param[in]       length - Length of text
+     * @return  The first non-alpha character in text, if any, or an invalid key
+     */
+    inline CipherResult TryDecryptRailFenceAlphaInPlace(const size_t num_rails, char* text, const size_t length)
+    {
+        const size_t invalid_offset = simd::FindNonUpperAlpha(text, length);
+        if (num_rails <= 0)
+        {
+            return ResultInvalidKey();
+        }
+        else if (invalid_offset != length)
+        {
+            return ResultInvalidText(invalid_offset, text[invalid_offset]);
+        }
+        TransposeRailFenceInPlace<true>(num_rails, text, length);
+        return ResultOk();
+    }
+
+    /**
+     * Encrypt text using a Rail fence cipher within the caller's buffer
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]       num_rails - The encryption key, number of rails used for encryption.
+     * @param[in,out]   text - The plaintext to encrypt, replaced with the ciphertext
+     * @throw   If text contains non-alpha characters
+     */
+    inline void EncryptRailFenceAlphaInPlace(const size_t num_rails, std::string& text)
+    {
+        ThrowIfError(TryEncryptRailFenceAlphaInPlace(num_rails, &text[0], text.size()),
+                     "Error: number of rails must be > 0", "plaintext");
+    }
+
+    /**
+     * Decrypt text using a Rail fence cipher within the caller's buffer
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]       num_rails - The encryption key, number of rails used for decryption.
+     * @param[in,out]   text - The ciphertext to decrypt, replaced with the plaintext
+     * @throw   If text contains non-alpha characters
+     */
+    inline void DecryptRailFenceAlphaInPlace(const size_t num_rails, std::string& text)
+    {
+        ThrowIfError(TryDecryptRailFenceAlphaInPlace(num_rails, &text[0], text.size()),
+                     "Error: number of rails must be > 0", "ciphertext");
+    }
+
+    /**
+     * Encrypt a buffer using a Rail fence cipher, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * When ciphertext is the same buffer as plaintext the text is transposed in
+     * place instead, which allocates one bit per letter.
+     * @param[in]   num_rails - The encryption key, number of rails used for encryption.
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, length bytes, owned by the caller.
+     *                          Must be the same buffer as plaintext, or not overlap it.
+     * @param[in]   length - Length of plaintext
+     * @return  The first non-alpha character in plaintext, if any, or an invalid key
+     */
+    inline CipherResult TryEncryptRailFenceAlpha(const size_t num_rails, const char* plaintext, char* ciphertext, const size_t length)
+    {
+        if (plaintext == ciphertext)
+        {
+            return TryEncryptRailFenceAlphaInPlace(num_rails, ciphertext, length);
         }
+        return TryRailFenceAlphaBlocked<false>(num_rails, plaintext, ciphertext, length, nullptr);
+    }
+
+    /**
+     * Encrypt a string view using a Rail fence cipher, without throwing or allocating
+     * See the buffer overload above.
+     * @param[in]   num_rails - The encryption key, number of rails used for encryption.
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller
+     * @return  The first non-alpha character in plaintext, if any, or an invalid key
+     */
+    inline CipherResult TryEncryptRailFenceAlpha(const size_t num_rails, const std::string_view plaintext, char* ciphertext)
+    {
+        return TryEncryptRailFenceAlpha(num_rails, plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a buffer using a Rail fence cipher, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * When plaintext is the same buffer as ciphertext the text is transposed in
+     * place instead, which allocates one bit per letter.
+     * @param[in]   num_rails - The encryption key, number of rails used for decryption.
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, length bytes, owned by the caller.
+     *                         Must be the same buffer as ciphertext, or not overlap it.
+     * @param[in]   length - Length of ciphertext
+     * @return  The first non-alpha character in ciphertext, if any, or an invalid key
+     */
+    inline CipherResult TryDecryptRailFenceAlpha(const size_t num_rails, const char* ciphertext, char* plaintext, const size_t length)
+    {
+        if (ciphertext == plaintext)
+        {
+            return TryDecryptRailFenceAlphaInPlace(num_rails, plaintext, length);
+        }
+        return TryRailFenceAlphaBlocked<true>(num_rails, ciphertext, plaintext, length, nullptr);
+    }
+
+    /**
+     * Decrypt a string view using a Rail fence cipher, without throwing or allocating
+     * See the buffer overload above.
+     * @param[in]   num_rails - The encryption key, number of rails used for decryption.
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller
+     * @return  The first non-alpha character in ciphertext, if any, or an invalid key
+     */
+    inline CipherResult TryDecryptRailFenceAlpha(const size_t num_rails, const std::string_view ciphertext, char* plaintext)
+    {
+        return TryDecryptRailFenceAlpha(num_rails, ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Encrypt the given plaintext using a Rail fence cipher
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   num_rails - The encryption key, number of rails used for encryption.
+     *                          Use the same key to decrypt.
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @throw   If plaintext contain non-alpha characters
+     */
+    inline void EncryptRailFenceAlpha(const size_t num_rails, const std::string& plaintext, std::string& ciphertext)
+    {
+        ThrowIfError(TryEncryptRailFenceAlpha(num_rails, plaintext, ciphertext),
+                     "Error: number of rails must be > 0", "plaintext");
     }
 
     /**
@@ -89,48 +623,168 @@ namespace cipher {
      */
     inline void DecryptRailFenceAlpha(const size_t num_rails, const std::string& ciphertext, std::string& plaintext)
     {
-        // Input checking
-        if (!AllUpperAlpha(ciphertext))
+        ThrowIfError(TryDecryptRailFenceAlpha(num_rails, ciphertext, plaintext),
+                     "Error: number of rails must be > 0", "ciphertext");
+    }
+
+    /**
+     * Decrypt part of a text encrypted with a Rail fence cipher
+     * Each plaintext letter in the window is read from its place in the
+     * whole ciphertext, found in closed form, so the cost depends only on
+     * the size of the window. Any bytes are moved, with no check for letters.
+     * @param[in]   num_rails - The encryption key, number of rails; 0 or 1 leaves the text as it is
+     * @param[in]   ciphertext - The whole ciphertext
+     * @param[in]   offset - Offset in the plaintext of the first letter wanted
+     * @param[in]   count - Number of letters wanted; offset + count must not be past the end of ciphertext
+     * @param[out]  plaintext - The letters of the window, count bytes, owned by the caller
+     */
+    inline void DecryptRailFenceRange(const size_t num_rails,
+                                      const std::string_view ciphertext,
+                                      const size_t offset,
+                                      const size_t count,
+                                      char* plaintext)
+    {
+        if ((num_rails <= 1) || (num_rails >= ciphertext.size()))
         {
-            throw std::runtime_error("Error: non-alpha character in plaintext.");
+            std::copy_n(ciphertext.data() + offset, count, plaintext);
+            return;
         }
-        else if (num_rails <= 0)
+        const RailFenceLayout layout(num_rails, ciphertext.size());
+        for (size_t index = 0; index < count; ++index)
         {
-            throw std::runtime_error("Error: number of rails must be > 0");
+            plaintext[index] = ciphertext[layout.CipherIndex(offset + index)];
         }
-        else if (num_rails == 1)
+    }
+
+    /**
+     * Decrypt part of a text encrypted with a Rail fence cipher, without throwing or allocating
+     * See DecryptRailFenceRange above.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   num_rails - The encryption key, number of rails used for decryption.
+     * @param[in]   ciphertext - The whole ciphertext
+     * @param[in]   offset - Offset in the plaintext of the first letter wanted
+     * @param[in]   count - Number of letters wanted; offset + count must not be past the end of ciphertext
+     * @param[out]  plaintext - The letters of the window, count bytes, owned by the caller
+     * @return  The first non-alpha character read, with its offset in ciphertext, or an invalid key
+     */
+    inline CipherResult TryDecryptRailFenceAlphaRange(const size_t num_rails,
+                                                      const std::string_view ciphertext,
+                                                      const size_t offset,
+                                                      const size_t count,
+                                                      char* plaintext)
+    {
+        if (num_rails == 0)
         {
-            plaintext = ciphertext; // identity, ciphertext is unchanged
+            return ResultInvalidKey();
         }
-        else
+        DecryptRailFenceRange(num_rails, ciphertext, offset, count, plaintext);
+        const size_t invalid_offset = simd::FindNonUpperAlpha(plaintext, count);
+        if (invalid_offset != count)
         {
-            // Allocate space for the plaintext
-            const size_t plaintext_size = ciphertext.size();
-            plaintext.resize(plaintext_size);
-            size_t ciphertext_index = 0U;
-            for (size_t rail_n = 0; rail_n < num_rails; ++rail_n)
+            const size_t plain_index = offset + invalid_offset;
+            const size_t cipher_index = ((num_rails <= 1) || (num_rails >= ciphertext.size()))
+                ? plain_index : RailFenceLayout(num_rails, ciphertext.size()).CipherIndex(plain_index);
+            return ResultInvalidText(cipher_index, plaintext[invalid_offset]);
+        }
+        return ResultOk();
+    }
+
+
+    /* ===== Classes ===== */
+
+    /**
+     * Rail fence cipher over a message that arrives in chunks
+     * The length of the message is declared up front, which fixes where
+     * every letter goes, so each chunk is moved straight to its place in
+     * the caller's output and the message is never buffered on its own.
+     * The front of the output can be sent on as soon as Ready() covers it:
+     * when encrypting, rail 0 grows as each zigzag cycle arrives; when
+     * decrypting, the plaintext grows once the last rail starts arriving.
+     * This class is limited to upper-case alphabet characters (A-Z)
+     */
+    class RailFenceEncoder
+    {
+    public:
+        /**
+         * Start a message
+         * @param[in]   num_rails - The encryption key, number of rails
+         * @param[in]   length - Length of the whole message
+         * @param[out]  output - The result, length bytes, owned by the caller; see Ready
+         * @param[in]   decrypt - Decrypt instead of encrypt
+         * @throw   If num_rails is zero
+         */
+        RailFenceEncoder(const size_t num_rails, const size_t length, char* output, const bool decrypt = false) :
+            transposition_(RailFenceLayout(IsIdentity(num_rails, length) ? 2U : num_rails, length),
+                           IsIdentity(num_rails, length), length, decrypt, output)
+        {
+            if (num_rails == 0)
             {
-                // gap1 = (num_rails - rail_n - 1) * 2
-                const size_t gap1 = (num_rails - rail_n - 1) << 1;  // same as x2
-                const size_t gap2 = ((num_rails - 1) << 1) - gap1;
-
-                // Starting point, rail_n
-                size_t plaintext_index = rail_n;
-                size_t gap = 1;
-                bool gap_switch = true;
-                while (plaintext_index < plaintext_size)
-                {
-                    if (gap > 0)
-                    {
-                        plaintext[plaintext_index] = ciphertext[ciphertext_index++];
-                    }
-                    gap = (gap_switch ? gap1 : gap2);
-                    gap_switch = !gap_switch;
-                    plaintext_index += gap;
-                }
+                throw std::runtime_error("Error: number of rails must be > 0");
             }
         }
-    }
+
+        /**
+         * Place the next piece of the message in the output
+         * @param[in]   input - The piece, which must not overlap the output
+         * @param[in]   length - Length of the piece
+         * @return  The first non-alpha character in input, as an offset in the whole message,
+         *          or the first character past the declared length. Nothing is placed on error.
+         */
+        CipherResult Update(const char* input, const size_t length)
+        {
+            const size_t received = transposition_.Received();
+            const size_t invalid_offset = simd::FindNonUpperAlpha(input, length);
+            if (invalid_offset != length)
+            {
+                return ResultInvalidText(received + invalid_offset, input[invalid_offset]);
+            }
+            else if (length > (transposition_.Length() - received))
+            {
+                return ResultInvalidText(transposition_.Length(), input[transposition_.Length() - received]);
+            }
+            transposition_.Write(input, length);
+            return ResultOk();
+        }
+
+        /**
+         * Place the next piece of the message in the output
+         * @param[in]   input - The piece, which must not overlap the output
+         * @return  The first non-alpha character in input, as an offset in the whole message,
+         *          or the first character past the declared length
+         */
+        CipherResult Update(const std::string_view input)
+        {
+            return Update(input.data(), input.size());
+        }
+
+        /** Length of the front of the output that is final and can be sent on */
+        size_t Ready()
+        {
+            return transposition_.Ready();
+        }
+
+        /**
+         * Check that the whole message has arrived
+         * @return  Invalid text ('\0') at the end of the input, if it is shorter than declared
+         */
+        CipherResult Finish() const
+        {
+            if (transposition_.Received() != transposition_.Length())
+            {
+                return ResultInvalidText(transposition_.Received(), '\0');
+            }
+            return ResultOk();
+        }
+
+    private:
+        /** Check if a key leaves every letter where it is */
+        static bool IsIdentity(const size_t num_rails, const size_t length)
+        {
+            return (num_rails <= 1) || (num_rails >= length);
+        }
+
+        StreamingTransposition<RailFenceLayout> transposition_;     // Where each letter goes
+    };
 
 }   // end namespace cipher
 
@@ -48,54 +48,475 @@ Description:
 
 
 /* ===== Includes ===== */
+#include <algorithm>
+#include <stdexcept>
 #include <string>
-#include "vigenere_cipher.hpp"
+#include <string_view>
+#include "cipher_permute.hpp"
+#include "cipher_result.hpp"
+#include "cipher_transpose.hpp"
 
 
 namespace cipher {
 
+    /* ===== Classes ===== */
+
+    /**
+     * Closed-form positions of the scytale transpose
+     * See the description of the two rectangles below.
+     */
+    class ScytaleLayout
+    {
+    public:
+        /**
+         * Create the layout for a message
+         * @param[in]   row_width - Width of the rows of text, must be at least 1
+         * @param[in]   length - Length of the message
+         */
+        ScytaleLayout(const size_t row_width, const size_t length) :
+            row_width_(row_width),
+            full_rows_(length / row_width),
+            tall_columns_(length % row_width)
+        {
+        }
+
+        /** Offset in the ciphertext of the letter at a plaintext offset */
+        size_t CipherIndex(const size_t plain_index) const
+        {
+            const size_t row = plain_index / row_width_;
+            const size_t column = plain_index % row_width_;
+            size_t column_start = column * (full_rows_ + 1);
+            if (column >= tall_columns_)
+            {
+                column_start -= (column - tall_columns_);
+            }
+            return column_start + row;
+        }
+
+        /** Offset in the plaintext of the letter at a ciphertext offset, the reverse of CipherIndex */
+        size_t PlainIndex(const size_t cipher_index) const
+        {
+            // The tall columns come first, each one letter longer than the rest
+            const size_t tall_letters = tall_columns_ * (full_rows_ + 1);
+            size_t column = 0U;
+            size_t row = 0U;
+            if (cipher_index < tall_letters)
+            {
+                column = cipher_index / (full_rows_ + 1);
+                row = cipher_index % (full_rows_ + 1);
+            }
+            else
+            {
+                column = tall_columns_ + ((cipher_index - tall_letters) / full_rows_);
+                row = (cipher_index - tall_letters) % full_rows_;
+            }
+            return (row * row_width_) + column;
+        }
+
+    private:
+        size_t row_width_;      // Width of the rows of text
+        size_t full_rows_;      // Number of complete rows
+        size_t tall_columns_;   // Columns with a letter in the partial last row
+    };
+
+
     /* ===== Functions ===== */
 
+    // The scytale cipher is a transpose of the rows of text. When the
+    // text does not fill the last row, the first (length % row_width)
+    // columns are one letter taller than the rest, so the text is
+    // transposed as two rectangles:
+    //
+    //     G O O D | M        Left:  8 rows x 4 columns, including
+    //     O R N I | N               the partial last row
+    //     . . .   | .
+    //     I T I T |          Right: 7 rows x 1 column
+    //
+    // Each column of the left rectangle takes (full_rows + 1) letters
+    // of ciphertext and each column of the right takes full_rows.
+
     /**
-     * Encrypt the given plaintext using a scytale cipher
-     * This function is limited to upper-case alphabet characters (A-Z)
+     * Transpose text through the two rectangles of a scytale
+     * @param[in]   row_width - The width of the rows of text, at least 1
+     * @param[in]   input - Plaintext when encrypting, ciphertext when decrypting
+     * @param[out]  output - Ciphertext when encrypting, plaintext when decrypting.
+     *                       Must hold length bytes and must not overlap input.
+     * @param[in]   length - Length of the text
+     */
+    template <bool Decrypt>
+    inline void TransposeScytale(const size_t row_width, const char* input, char* output, const size_t length)
+    {
+        // A single column, or a single row, leaves the text unchanged
+        if ((row_width == 1) || (row_width >= length))
+        {
+            std::copy(input, input + length, output);
+            return;
+        }
+
+        const size_t full_rows = length / row_width;
+        const size_t tall_columns = length % row_width;
+        const size_t short_columns = row_width - tall_columns;
+        char* const right_output = output + (tall_columns * (full_rows + 1));
+        const char* const right_input = input + (tall_columns * (full_rows + 1));
+        if (Decrypt)
+        {
+            TransposeBytes(input, full_rows + 1,
+                           output, row_width,
+                           tall_columns, full_rows + 1);
+            TransposeBytes(right_input, full_rows,
+                           output + tall_columns, row_width,
+                           short_columns, full_rows);
+        }
+        else
+        {
+            TransposeBytes(input, row_width,
+                           output, full_rows + 1,
+                           full_rows + 1, tall_columns);
+            TransposeBytes(input + tall_columns, row_width,
+                           right_output, full_rows,
+                           full_rows, short_columns);
+        }
+    }
+
+    /**
+     * Encrypt the given plaintext using a scytale cipher, without throwing
+     * This function works with any characters; none are rejected
      * @param[in]   row_width - The width of the rows of text
      * @param[in]   plaintext - The text to encrypt
-     * @param[out]  ciphertext - The resulting encrypted text
-     * @throw   If plaintext contains non-alpha characters
+     * @param[out]  ciphertext - The resulting encrypted text. Must not be the same string as plaintext.
+     * @return  An invalid key if row_width is zero
      */
-    inline void EncryptScytaleAlpha(const size_t row_width, const std::string& plaintext, std::string& ciphertext)
+    inline CipherResult TryEncryptScytaleAlpha(const size_t row_width, const std::string& plaintext, std::string& ciphertext)
     {
+        if (row_width == 0)
+        {
+            return ResultInvalidKey();
+        }
+
         // Allocate space for the ciphertext
-        const size_t plaintext_size = plaintext.size();
         ciphertext.resize(plaintext.size());
+        TransposeScytale<false>(row_width, plaintext.data(), &ciphertext[0], plaintext.size());
+        return ResultOk();
+    }
 
-        // Go column by column copying letters
-        size_t cipher_index = 0;
-        for (size_t column = 0; column < row_width; ++column)
+    /**
+     * Decrypt the given ciphertext using a scytale cipher, without throwing
+     * This function works with any characters; none are rejected
+     * @param[in]   row_width - The width of the rows of text, from the original encryption
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text. Must not be the same string as ciphertext.
+     * @return  An invalid key if row_width is zero
+     */
+    inline CipherResult TryDecryptScytaleAlpha(const size_t row_width, const std::string& ciphertext, std::string& plaintext)
+    {
+        if (row_width == 0)
         {
-            for (size_t plain_index = column; plain_index < plaintext_size; plain_index += row_width)
-            {
-                ciphertext[cipher_index++] = plaintext[plain_index];
-            }
+            return ResultInvalidKey();
+        }
+
+        // Allocate space for the plaintext
+        plaintext.resize(ciphertext.size());
+        TransposeScytale<true>(row_width, ciphertext.data(), &plaintext[0], ciphertext.size());
+        return ResultOk();
+    }
+
+    /**
+     * Encrypt text using a scytale cipher within the caller's buffer, without throwing
+     * Uses one bit of extra memory per letter instead of a second buffer.
+     * This function works with any characters; none are rejected
+     * @param[in]       row_width - The width of the rows of text
+     * @param[in,out]   text - The plaintext to encrypt, replaced with the ciphertext
+     * @param[in]       length - Length of text
+     * @return  An invalid key if row_width is zero
+     */
+    inline CipherResult TryEncryptScytaleAlphaInPlace(const size_t row_width, char* text, const size_t length)
+    {
+        if (row_width == 0)
+        {
+            return ResultInvalidKey();
+        }
+        else if ((row_width == 1) || (row_width >= length))
+        {
+            return ResultOk();  // identity
+        }
+        const ScytaleLayout layout(row_width, length);
+        ScatterInPlace(text, length,
+                       [&layout](const size_t index) { return layout.CipherIndex(index); });
+        return ResultOk();
+    }
+
+    /**
+     * Decrypt text using a scytale cipher within the caller's buffer, without throwing
+     * Uses one bit of extra memory per letter instead of a second buffer.
+     * This function works with any characters; none are rejected
+     * @param[in]       row_width - The width of the rows of text, from the original encryption
+     * @param[in,out]   text - The ciphertext to decrypt, replaced with the plaintext
+     * @param[in]       length - Length of text
+     * @return  An invalid key if row_width is zero
+     */
+    inline CipherResult TryDecryptScytaleAlphaInPlace(const size_t row_width, char* text, const size_t length)
+    {
+        if (row_width == 0)
+        {
+            return ResultInvalidKey();
+        }
+        else if ((row_width == 1) || (row_width >= length))
+        {
+            return ResultOk();  // identity
+        }
+        const ScytaleLayout layout(row_width, length);
+        GatherInPlace(text, length,
+                      [&layout](const size_t index) { return layout.CipherIndex(index); });
+        return ResultOk();
+    }
+
+    /**
+     * Encrypt text using a scytale cipher within the caller's buffer
+     * This function works with any characters; none are rejected
+     * @param[in]       row_width - The width of the rows of text
+     * @param[in,out]   text - The plaintext to encrypt, replaced with the ciphertext
+     * @throw   If row_width is zero
+     */
+    inline void EncryptScytaleAlphaInPlace(const size_t row_width, std::string& text)
+    {
+        ThrowIfError(TryEncryptScytaleAlphaInPlace(row_width, &text[0], text.size()),
+                     "Error: row width must be > 0", "plaintext");
+    }
+
+    /**
+     * Decrypt text using a scytale cipher within the caller's buffer
+     * This function works with any characters; none are rejected
+     * @param[in]       row_width - The width of the rows of text, from the original encryption
+     * @param[in,out]   text - The ciphertext to decrypt, replaced with the plaintext
+     * @throw   If row_width is zero
+     */
+    inline void DecryptScytaleAlphaInPlace(const size_t row_width, std::string& text)
+    {
+        ThrowIfError(TryDecryptScytaleAlphaInPlace(row_width, &text[0], text.size()),
+                     "Error: row width must be > 0", "ciphertext");
+    }
+
+    /**
+     * Encrypt a buffer using a scytale cipher, without throwing or allocating
+     * This function works with any characters; none are rejected
+     * When ciphertext is the same buffer as plaintext the text is transposed in
+     * place instead, which allocates one bit per letter.
+     * @param[in]   row_width - The width of the rows of text
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, length bytes, owned by the caller.
+     *                          Must be the same buffer as plaintext, or not overlap it.
+     * @param[in]   length - Length of plaintext
+     * @return  An invalid key if row_width is zero
+     */
+    inline CipherResult TryEncryptScytaleAlpha(const size_t row_width, const char* plaintext, char* ciphertext, const size_t length)
+    {
+        if (plaintext == ciphertext)
+        {
+            return TryEncryptScytaleAlphaInPlace(row_width, ciphertext, length);
+        }
+        else if (row_width == 0)
+        {
+            return ResultInvalidKey();
+        }
+        TransposeScytale<false>(row_width, plaintext, ciphertext, length);
+        return ResultOk();
+    }
+
+    /**
+     * Encrypt a string view using a scytale cipher, without throwing or allocating
+     * See the buffer overload above.
+     * @param[in]   row_width - The width of the rows of text
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller
+     * @return  An invalid key if row_width is zero
+     */
+    inline CipherResult TryEncryptScytaleAlpha(const size_t row_width, const std::string_view plaintext, char* ciphertext)
+    {
+        return TryEncryptScytaleAlpha(row_width, plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a buffer using a scytale cipher, without throwing or allocating
+     * This function works with any characters; none are rejected
+     * When plaintext is the same buffer as ciphertext the text is transposed in
+     * place instead, which allocates one bit per letter.
+     * @param[in]   row_width - The width of the rows of text, from the original encryption
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, length bytes, owned by the caller.
+     *                         Must be the same buffer as ciphertext, or not overlap it.
+     * @param[in]   length - Length of ciphertext
+     * @return  An invalid key if row_width is zero
+     */
+    inline CipherResult TryDecryptScytaleAlpha(const size_t row_width, const char* ciphertext, char* plaintext, const size_t length)
+    {
+        if (ciphertext == plaintext)
+        {
+            return TryDecryptScytaleAlphaInPlace(row_width, plaintext, length);
+        }
+        else if (row_width == 0)
+        {
+            return ResultInvalidKey();
         }
+        TransposeScytale<true>(row_width, ciphertext, plaintext, length);
+        return ResultOk();
+    }
+
+    /**
+     * Decrypt a string view using a scytale cipher, without throwing or allocating
+     * See the buffer overload above.
+     * @param[in]   row_width - The width of the rows of text, from the original encryption
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller
+     * @return  An invalid key if row_width is zero
+     */
+    inline CipherResult TryDecryptScytaleAlpha(const size_t row_width, const std::string_view ciphertext, char* plaintext)
+    {
+        return TryDecryptScytaleAlpha(row_width, ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Encrypt the given plaintext using a scytale cipher
+     * This function works with any characters; none are rejected
+     * @param[in]   row_width - The width of the rows of text
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text. Must not be the same string as plaintext.
+     * @throw   If row_width is zero
+     */
+    inline void EncryptScytaleAlpha(const size_t row_width, const std::string& plaintext, std::string& ciphertext)
+    {
+        ThrowIfError(TryEncryptScytaleAlpha(row_width, plaintext, ciphertext),
+                     "Error: row width must be > 0", "plaintext");
     }
 
     /**
      * Decrypt the given ciphertext using a scytale cipher
-     * This function is limited to upper-case alphabet characters (A-Z)
+     * This function works with any characters; none are rejected
      * @param[in]   row_width - The width of the rows of text, from the original encryption
      * @param[in]   ciphertext - The text to decrypt
-     * @param[out]  plaintext - The resulting decrypted text
-     * @throw   If plaintext contains non-alpha characters
+     * @param[out]  plaintext - The resulting decrypted text. Must not be the same string as ciphertext.
+     * @throw   If row_width is zero
      */
     inline void DecryptScytaleAlpha(const size_t row_width, const std::string& ciphertext, std::string& plaintext)
     {
-        const size_t total_length = ciphertext.size();
-        const size_t column_height = 1 + ((total_length - 1) / row_width);
-        EncryptScytaleAlpha(column_height, ciphertext, plaintext);
+        ThrowIfError(TryDecryptScytaleAlpha(row_width, ciphertext, plaintext),
+                     "Error: row width must be > 0", "ciphertext");
+    }
+
+    /**
+     * Decrypt part of a text encrypted with a scytale cipher, without throwing or allocating
+     * Each plaintext letter in the window is read from its place in the
+     * whole ciphertext, found in closed form, so the cost depends only on
+     * the size of the window.
+     * This function works with any characters; none are rejected
+     * @param[in]   row_width - The width of the rows of text, from the original encryption
+     * @param[in]   ciphertext - The whole ciphertext
+     * @param[in]   offset - Offset in the plaintext of the first letter wanted
+     * @param[in]   count - Number of letters wanted; offset + count must not be past the end of ciphertext
+     * @param[out]  plaintext - The letters of the window, count bytes, owned by the caller
+     * @return  An invalid key if row_width is zero
+     */
+    inline CipherResult TryDecryptScytaleAlphaRange(const size_t row_width,
+                                                    const std::string_view ciphertext,
+                                                    const size_t offset,
+                                                    const size_t count,
+                                                    char* plaintext)
+    {
+        if (row_width == 0)
+        {
+            return ResultInvalidKey();
+        }
+        const ScytaleLayout layout(row_width, ciphertext.size());
+        for (size_t index = 0; index < count; ++index)
+        {
+            plaintext[index] = ciphertext[layout.CipherIndex(offset + index)];
+        }
+        return ResultOk();
     }
 
+
+    /* ===== Classes ===== */
+
+    /**
+     * Scytale cipher over a message that arrives in chunks
+     * The length of the message is declared up front, which fixes where
+     * every letter goes, so each chunk is moved straight to its place in
+     * the caller's output and the message is never buffered on its own.
+     * The front of the output can be sent on as soon as Ready() covers it:
+     * when encrypting, the first column grows a letter per row; when
+     * decrypting, the plaintext grows once the last column starts arriving.
+     * This class works with any characters; none are rejected
+     */
+    class ScytaleEncoder
+    {
+    public:
+        /**
+         * Start a message
+         * @param[in]   row_width - The width of the rows of text
+         * @param[in]   length - Length of the whole message
+         * @param[out]  output - The result, length bytes, owned by the caller; see Ready
+         * @param[in]   decrypt - Decrypt instead of encrypt
+         * @throw   If row_width is zero
+         */
+        ScytaleEncoder(const size_t row_width, const size_t length, char* output, const bool decrypt = false) :
+            transposition_(ScytaleLayout(std::max<size_t>(row_width, 1U), length),
+                           false, length, decrypt, output)
+        {
+            if (row_width == 0)
+            {
+                throw std::runtime_error("Error: row width must be > 0");
+            }
+        }
+
+        /**
+         * Place the next piece of the message in the output
+         * @param[in]   input - The piece, which must not overlap the output
+         * @param[in]   length - Length of the piece
+         * @return  The first character past the declared length, if any. Nothing is placed on error.
+         */
+        CipherResult Update(const char* input, const size_t length)
+        {
+            const size_t received = transposition_.Received();
+            if (length > (transposition_.Length() - received))
+            {
+                return ResultInvalidText(transposition_.Length(), input[transposition_.Length() - received]);
+            }
+            transposition_.Write(input, length);
+            return ResultOk();
+        }
+
+        /**
+         * Place the next piece of the message in the output
+         * @param[in]   input - The piece, which must not overlap the output
+         * @return  The first character past the declared length, if any
+         */
+        CipherResult Update(const std::string_view input)
+        {
+            return Update(input.data(), input.size());
+        }
+
+        /** Length of the front of the output that is final and can be sent on */
+        size_t Ready()
+        {
+            return transposition_.Ready();
+        }
+
+        /**
+         * Check that the whole message has arrived
+         * @return  Invalid text ('\0') at the end of the input, if it is shorter than declared
+         */
+        CipherResult Finish() const
+        {
+            if (transposition_.Received() != transposition_.Length())
+            {
+                return ResultInvalidText(transposition_.Received(), '\0');
+            }
+            return ResultOk();
+        }
+
+    private:
+        StreamingTransposition<ScytaleLayout> transposition_;   // Where each letter goes
+    };
+
 }   // end namespace cipher
 
 
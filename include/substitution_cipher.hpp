@@ -0,0 +1,404 @@
+/************************************************************\
+Filename:   substitution_cipher.hpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    This header contains definitions for using monoalphabetic
+    substitution ciphers. A substitution cipher replaces each
+    letter of the plaintext with the letter at the same
+    position in a scrambled "cipher alphabet".
+
+    The most common way to choose the cipher alphabet is with
+    a keyword: the letters of the keyword are written first
+    (skipping repeats), followed by the rest of the alphabet
+    in order.
+
+    Example: keyword is ZEBRAS
+
+    Plain alphabet:  ABCDEFGHIJKLMNOPQRSTUVWXYZ
+    Cipher alphabet: ZEBRASCDFGHIJKLMNOPQTUVWXY
+
+    - plaintext:  FLEEATONCE
+    - ciphertext: SIAAZQLKBA
+
+    Several classical ciphers are special cases:
+    - Caesar: the cipher alphabet is the plain alphabet rotated
+    - Atbash: the cipher alphabet is the plain alphabet reversed
+    - Affine: letter x is replaced with (a * x + b) mod 26
+
+    See https://en.wikipedia.org/wiki/Substitution_cipher
+
+\************************************************************/
+
+
+#ifndef SUBSTITUTION_CIPHER_HPP_
+#define SUBSTITUTION_CIPHER_HPP_
+
+
+/* ===== Includes ===== */
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "cipher_result.hpp"
+#include "cipher_utils.hpp"
+#include "cipher_simd.hpp"
+
+
+namespace cipher {
+
+    /* ===== Classes ===== */
+
+    /**
+     * A compiled substitution cipher
+     * The cipher alphabet is stored as a pair of lookup tables, one for
+     * encryption and its inverse for decryption, laid out for the
+     * substitution kernels in cipher_simd.hpp.
+     */
+    class SubstitutionCipher
+    {
+    public:
+        /**
+         * Compile a cipher alphabet
+         * @param[in]   alphabet - The 26 upper-case letters A-Z in any order.
+         *                         Plaintext 'A' is replaced with alphabet[0] and so on.
+         * @throw   If alphabet is not a permutation of A-Z
+         */
+        explicit SubstitutionCipher(const std::string& alphabet) :
+            encrypt_(),
+            decrypt_()
+        {
+            if (alphabet.size() != 26)
+            {
+                throw std::runtime_error("Cipher alphabet must contain exactly 26 letters");
+            }
+            bool seen[26] = {};
+            for (size_t index = 0; index < 26; ++index)
+            {
+                const char letter = alphabet[index];
+                if (!IsUpperAlpha(letter))
+                {
+                    throw NonAlphaError(letter, "cipher alphabet");
+                }
+                if (seen[letter - 'A'])
+                {
+                    throw std::runtime_error(std::string("Letter ") + letter + " repeated in cipher alphabet");
+                }
+                seen[letter - 'A'] = true;
+                encrypt_[index] = static_cast<uint8_t>(letter);
+                decrypt_[letter - 'A'] = static_cast<uint8_t>('A' + index);
+            }
+        }
+
+        /**
+         * Build the keyed cipher alphabet for a keyword
+         * @param[in]   keyword - Upper-case letters; repeated letters are ignored.
+         *                        A 26 letter permutation is used as the alphabet directly.
+         * @throw   If keyword is empty or contains non-alpha characters
+         */
+        static SubstitutionCipher FromKeyword(const std::string& keyword)
+        {
+            if (keyword.empty())
+            {
+                throw std::runtime_error("Empty cipherkey");
+            }
+            std::string alphabet;
+            bool used[26] = {};
+            for (const char letter : keyword)
+            {
+                if (!IsUpperAlpha(letter))
+                {
+                    throw NonAlphaError(letter, "cipherkey");
+                }
+                if (!used[letter - 'A'])
+                {
+                    used[letter - 'A'] = true;
+                    alphabet.push_back(letter);
+                }
+            }
+            for (char letter = 'A'; letter <= 'Z'; ++letter)
+            {
+                if (!used[letter - 'A'])
+                {
+                    alphabet.push_back(letter);
+                }
+            }
+            return SubstitutionCipher(alphabet);
+        }
+
+        /**
+         * Build an affine cipher, mapping letter x to (multiplier * x + shift) mod 26
+         * @param[in]   multiplier - Must be coprime with 26 so the cipher can be inverted
+         * @param[in]   shift - Offset added after multiplying
+         * @throw   If multiplier is not coprime with 26
+         */
+        static SubstitutionCipher Affine(const uint32_t multiplier, const uint32_t shift)
+        {
+            if (((multiplier % 2) == 0) || ((multiplier % 13) == 0))
+            {
+                throw std::runtime_error("Affine multiplier must be coprime with 26");
+            }
+            std::string alphabet(26, 'A');
+            for (uint32_t index = 0; index < 26; ++index)
+            {
+                alphabet[index] = static_cast<char>('A' + ((multiplier % 26) * index + shift) % 26);
+            }
+            return SubstitutionCipher(alphabet);
+        }
+
+        /**
+         * Build a Caesar cipher
+         * @param[in]   cipherkey - The key letter, A = 0, B = 1, etc.
+         * @throw   If cipherkey is not an alpha character
+         */
+        static SubstitutionCipher Caesar(const char cipherkey)
+        {
+            if (!IsUpperAlpha(cipherkey))
+            {
+                throw NonAlphaError(cipherkey, "cipherkey");
+            }
+            return Affine(1, static_cast<uint32_t>(cipherkey - 'A'));
+        }
+
+        /** Build an Atbash cipher, which reverses the alphabet */
+        static SubstitutionCipher Atbash()
+        {
+            return Affine(25, 25);
+        }
+
+        /** The cipher alphabet, i.e. the encryption of ABC...Z */
+        std::string Alphabet() const
+        {
+            return std::string(reinterpret_cast<const char*>(encrypt_), 26);
+        }
+
+        /** Lookup table for encryption */
+        const uint8_t* EncryptTable() const
+        {
+            return encrypt_;
+        }
+
+        /** Lookup table for decryption */
+        const uint8_t* DecryptTable() const
+        {
+            return decrypt_;
+        }
+
+    private:
+        // Tables are padded to 32 bytes so they can be loaded as two 16 byte halves
+        alignas(32) uint8_t encrypt_[32];
+        alignas(32) uint8_t decrypt_[32];
+    };
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Substitute a buffer through a lookup table, validating it in the same pass
+     * @param[in]   table - Lookup table from SubstitutionCipher
+     * @param[in]   input - The text to substitute
+     * @param[out]  output - The resulting text, length bytes
+     * @param[in]   length - Length of input
+     * @return  The first non-alpha character in input, if any
+     */
+    inline CipherResult TrySubstituteAlpha(const uint8_t* table, const char* input, char* output, const size_t length)
+    {
+        const size_t processed = simd::SubstituteAlpha(table, input, output, length);
+        if (processed != length)
+        {
+            return ResultInvalidText(processed, input[processed]);
+        }
+        return ResultOk();
+    }
+
+    /**
+     * Substitute the text through a lookup table, validating it in the same pass
+     * @param[in]   table - Lookup table from SubstitutionCipher
+     * @param[in]   input - The text to substitute
+     * @param[out]  output - The resulting text, resized to match input
+     * @return  The first non-alpha character in input, if any
+     */
+    inline CipherResult TrySubstituteAlpha(const uint8_t* table, const std::string& input, std::string& output)
+    {
+        // Output text should be same length as input text
+        output.resize(input.size());
+        return TrySubstituteAlpha(table, input.data(), &output[0], input.size());
+    }
+
+    /**
+     * Substitute a buffer through a lookup table, keeping case and copying non-letters
+     * @param[in]   table - Lookup table from SubstitutionCipher
+     * @param[in]   input - The text to substitute, any bytes
+     * @param[out]  output - The resulting text, length bytes. May be the same buffer as input.
+     * @param[in]   length - Length of input
+     */
+    inline void SubstituteAlphaMixed(const uint8_t* table, const char* input, char* output, const size_t length)
+    {
+        simd::SubstituteMixed(table, input, output, length);
+    }
+
+    /**
+     * Encrypt the given plaintext using a substitution cipher, keeping case
+     * Letters of either case are encrypted and keep their case; everything
+     * else is copied unchanged.
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to decrypt
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     */
+    inline void EncryptSubstitutionMixed(const SubstitutionCipher& cipher, const std::string& plaintext, std::string& ciphertext)
+    {
+        ciphertext.resize(plaintext.size());
+        SubstituteAlphaMixed(cipher.EncryptTable(), plaintext.data(), &ciphertext[0], plaintext.size());
+    }
+
+    /**
+     * Decrypt the given ciphertext using a substitution cipher, keeping case
+     * Letters of either case are decrypted and keep their case; everything
+     * else is copied unchanged.
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to encrypt
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     */
+    inline void DecryptSubstitutionMixed(const SubstitutionCipher& cipher, const std::string& ciphertext, std::string& plaintext)
+    {
+        plaintext.resize(ciphertext.size());
+        SubstituteAlphaMixed(cipher.DecryptTable(), ciphertext.data(), &plaintext[0], ciphertext.size());
+    }
+
+    /**
+     * Encrypt a string view using a substitution cipher, keeping case, without allocating
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to decrypt
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     */
+    inline void EncryptSubstitutionMixed(const SubstitutionCipher& cipher, const std::string_view plaintext, char* ciphertext)
+    {
+        SubstituteAlphaMixed(cipher.EncryptTable(), plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a string view using a substitution cipher, keeping case, without allocating
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to encrypt
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     */
+    inline void DecryptSubstitutionMixed(const SubstitutionCipher& cipher, const std::string_view ciphertext, char* plaintext)
+    {
+        SubstituteAlphaMixed(cipher.DecryptTable(), ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Encrypt the given plaintext using a substitution cipher, without throwing
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to decrypt
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptSubstitutionAlpha(const SubstitutionCipher& cipher, const std::string& plaintext, std::string& ciphertext)
+    {
+        return TrySubstituteAlpha(cipher.EncryptTable(), plaintext, ciphertext);
+    }
+
+    /**
+     * Decrypt the given ciphertext using a substitution cipher, without throwing
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to encrypt
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptSubstitutionAlpha(const SubstitutionCipher& cipher, const std::string& ciphertext, std::string& plaintext)
+    {
+        return TrySubstituteAlpha(cipher.DecryptTable(), ciphertext, plaintext);
+    }
+
+    /**
+     * Encrypt a buffer using a substitution cipher, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to decrypt
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, length bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     * @param[in]   length - Length of plaintext
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptSubstitutionAlpha(const SubstitutionCipher& cipher, const char* plaintext, char* ciphertext, const size_t length)
+    {
+        return TrySubstituteAlpha(cipher.EncryptTable(), plaintext, ciphertext, length);
+    }
+
+    /**
+     * Encrypt a string view using a substitution cipher, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to decrypt
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptSubstitutionAlpha(const SubstitutionCipher& cipher, const std::string_view plaintext, char* ciphertext)
+    {
+        return TryEncryptSubstitutionAlpha(cipher, plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a buffer using a substitution cipher, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to encrypt
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, length bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     * @param[in]   length - Length of ciphertext
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptSubstitutionAlpha(const SubstitutionCipher& cipher, const char* ciphertext, char* plaintext, const size_t length)
+    {
+        return TrySubstituteAlpha(cipher.DecryptTable(), ciphertext, plaintext, length);
+    }
+
+    /**
+     * Decrypt a string view using a substitution cipher, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to encrypt
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptSubstitutionAlpha(const SubstitutionCipher& cipher, const std::string_view ciphertext, char* plaintext)
+    {
+        return TryDecryptSubstitutionAlpha(cipher, ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Encrypt the given plaintext using a substitution cipher
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to decrypt
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @throw   If plaintext contains non-alpha characters
+     */
+    inline void EncryptSubstitutionAlpha(const SubstitutionCipher& cipher, const std::string& plaintext, std::string& ciphertext)
+    {
+        ThrowIfError(TryEncryptSubstitutionAlpha(cipher, plaintext, ciphertext), "", "plaintext");
+    }
+
+    /**
+     * Decrypt the given ciphertext using a substitution cipher
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipher - The compiled cipher alphabet. Use the same cipher to encrypt
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @throw   If ciphertext contains non-alpha characters
+     */
+    inline void DecryptSubstitutionAlpha(const SubstitutionCipher& cipher, const std::string& ciphertext, std::string& plaintext)
+    {
+        ThrowIfError(TryDecryptSubstitutionAlpha(cipher, ciphertext, plaintext), "", "ciphertext");
+    }
+
+}   // end namespace cipher
+
+
+#endif  // SUBSTITUTION_CIPHER_HPP_
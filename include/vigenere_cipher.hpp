@@ -21,6 +21,11 @@ Description:
     cipher operates somewhat like many independent Caesar
     ciphers.
 
+    The key phase of any letter follows from its position
+    alone, so the Parallel functions split a text into pieces
+    that fit in a core's cache and shift them on separate
+    threads, each from its own phase.
+
 \************************************************************/
 
 
@@ -29,69 +34,627 @@ Description:
 
 
 /* ===== Includes ===== */
+#include <algorithm>
+#include <cstdint>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <stdexcept>
+#include <vector>
+#include "cipher_result.hpp"
 #include "cipher_utils.hpp"
+#include "cipher_simd.hpp"
+#include "cipher_thread_pool.hpp"
 
 
 namespace cipher {
 
-    /* ===== Functions ===== */
+    /* ===== Constants ===== */
+
+    /** Bytes each thread shifts at a time in the Parallel functions, small enough to stay in cache */
+    const size_t VIGENERE_PARALLEL_PIECE = 64 * 1024;
+
+
+    /* ===== Classes ===== */
 
     /**
-     * Encrypt the given plaintext using a Vigenere cipher
-     * This function is limited to upper-case alphabet characters (A-Z)
-     * See https://en.wikipedia.org/wiki/Vigen%C3%A8re_cipher for details
-     * @param[in]   cipherkey - The encryption keyword. Use the same keyword to decrypt
-     * @param[in]   plaintext - The text to encrypt
-     * @param[out]  ciphertext - The resulting encrypted text
-     * @throw   If cipherkey or plaintext contain non-alpha characters
+     * A precompiled Vigenere cipherkey
+     * The key is validated and converted to offsets (A = 0, B = 1, ...) once,
+     * for encryption, decryption, and decryption of binary data (modulo 256),
+     * and stored as aligned key period buffers (see cipher_simd.hpp). A key can then be used for any number of
+     * messages without allocating.
      */
-    inline void EncryptVigenereAlpha(const std::string& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    class VigenereKey
     {
-        // Cipher text should be same length as plaintext
-        ciphertext.resize(plaintext.size());
-
-        auto cipherkey_iter = cipherkey.cbegin();
-        const auto cipherkey_end = cipherkey.cend();
-        auto plaintext_iter = plaintext.cbegin();
-        const auto plaintext_end = plaintext.cend();
-        auto ciphertext_iter = ciphertext.begin();
-
-        while (plaintext_iter != plaintext_end)
+    public:
+        /**
+         * Compile a cipherkey
+         * @param[in]   cipherkey - The keyword, upper-case alphabet characters (A-Z)
+         * @throw   If cipherkey is empty or contains non-alpha characters
+         */
+        explicit VigenereKey(const std::string& cipherkey) :
+            period_(cipherkey.size()),
+            stride_(1 + (cipherkey.size() / simd::MAX_VECTOR_WIDTH)),
+            blocks_(3 * (1 + stride_))
         {
-            if (IsUpperAlpha(*cipherkey_iter))
+            if (cipherkey.empty())
             {
-                if (IsUpperAlpha(*plaintext_iter))
-                {
-                    const char offset1 = (*cipherkey_iter) - 'A';
-                    const char offset2 = (*plaintext_iter) - 'A';
-                    *ciphertext_iter = ((offset1 + offset2) % 26) + 'A';
-                }
-                else
+                throw std::runtime_error("Empty cipherkey");
+            }
+
+            uint8_t* const encrypt = blocks_[0].bytes;
+            uint8_t* const decrypt = blocks_[1 + stride_].bytes;
+            uint8_t* const byte_decrypt = blocks_[2 * (1 + stride_)].bytes;
+            for (size_t index = 0; index < period_; ++index)
+            {
+                const char letter = cipherkey[index];
+                if (!IsUpperAlpha(letter))
                 {
-                    std::stringstream oss;
-                    oss << "Non alphabet character 0x"
-                        << PrintCharHex(*plaintext_iter)
-                        << " found in plaintext";
-                    throw std::runtime_error(oss.str());
+                    throw NonAlphaError(letter, "cipherkey");
                 }
+                encrypt[index] = static_cast<uint8_t>(letter - 'A');
+                decrypt[index] = static_cast<uint8_t>((26 - encrypt[index]) % 26);
+                byte_decrypt[index] = static_cast<uint8_t>(256 - encrypt[index]);
             }
-            else {
-                std::stringstream oss;
-                oss << "Non alphabet character 0x"
-                    << PrintCharHex(*cipherkey_iter)
-                    << " found in cipherkey";
-                throw std::runtime_error(oss.str());
+
+            // Repeat the key so a full vector can be loaded at any phase
+            for (size_t index = period_; index < period_ + simd::MAX_VECTOR_WIDTH; ++index)
+            {
+                encrypt[index] = encrypt[index - period_];
+                decrypt[index] = decrypt[index - period_];
+                byte_decrypt[index] = byte_decrypt[index - period_];
             }
-            cipherkey_iter++;
-            plaintext_iter++;
-            ciphertext_iter++;
+        }
+
+        /** Length of the key, in letters */
+        size_t Period() const
+        {
+            return period_;
+        }
+
+        /** Key period buffer for encryption */
+        const uint8_t* EncryptPeriod() const
+        {
+            return blocks_[0].bytes;
+        }
+
+        /** Key period buffer for decryption */
+        const uint8_t* DecryptPeriod() const
+        {
+            return blocks_[1 + stride_].bytes;
+        }
+
+        /** Key period buffer for decrypting binary data; EncryptPeriod encrypts it */
+        const uint8_t* ByteDecryptPeriod() const
+        {
+            return blocks_[2 * (1 + stride_)].bytes;
+        }
+
+    private:
+        size_t period_;     // Length of the key
+        size_t stride_;     // Blocks needed for one key period buffer, less one
+        std::vector<simd::VectorBlock> blocks_; // Encrypt, decrypt and byte decrypt buffers, in order
+    };
+
+
+    /* ===== Functions ===== */
+
+    /**
+     * Shift one piece of a longer text by a key period buffer, validating it in the same pass
+     * The key phase is taken from the position of the piece, so a text can
+     * be shifted in pieces of any size and give the same result.
+     * @param[in]   key_period - Key period buffer, see cipher_simd.hpp
+     * @param[in]   period - Length of the cipherkey
+     * @param[in]   text_offset - Position of input within the whole text
+     * @param[in]   input - The text to shift
+     * @param[out]  output - The resulting text, length bytes
+     * @param[in]   length - Length of input
+     * @return  The first non-alpha character in input, if any, as an offset into input
+     */
+    inline CipherResult TryShiftVigenereAlphaAt(const uint8_t* key_period,
+                                                const size_t period,
+                                                const size_t text_offset,
+                                                const char* input,
+                                                char* output,
+                                                const size_t length)
+    {
+        const size_t processed = simd::ShiftAlpha(key_period, period, text_offset % period,
+                                                  input, output, length);
+        if (processed != length)
+        {
+            return ResultInvalidText(processed, input[processed]);
+        }
+        return ResultOk();
+    }
+
+    /**
+     * Shift one piece of a longer text by a key period buffer, keeping case and copying non-letters
+     * Only letters use up the key, so the key phase is taken from the number
+     * of letters before the piece rather than from its position.
+     * @param[in]   key_period - Key period buffer, see cipher_simd.hpp
+     * @param[in]   period - Length of the cipherkey
+     * @param[in]   letter_offset - Number of letters in the whole text before input
+     * @param[in]   input - The text to shift, any bytes
+     * @param[out]  output - The resulting text, length bytes. May be the same buffer as input.
+     * @param[in]   length - Length of input
+     * @return  Number of letters in input
+     */
+    inline size_t ShiftVigenereMixedAt(const uint8_t* key_period,
+                                       const size_t period,
+                                       const size_t letter_offset,
+                                       const char* input,
+                                       char* output,
+                                       const size_t length)
+    {
+        return simd::ShiftMixed(key_period, period, letter_offset % period, input, output, length);
+    }
+
+    /**
+     * Shift one piece of a longer run of binary data by a key period buffer, modulo 256
+     * The key phase is taken from the position of the piece, so data can
+     * be shifted in pieces of any size and give the same result.
+     * @param[in]   key_period - Key period buffer, EncryptPeriod or ByteDecryptPeriod
+     * @param[in]   period - Length of the cipherkey
+     * @param[in]   data_offset - Position of input within the whole data
+     * @param[in]   input - The bytes to shift, any values
+     * @param[out]  output - The resulting bytes, length bytes. May be the same buffer as input.
+     * @param[in]   length - Length of input
+     */
+    inline void ShiftVigenereBytesAt(const uint8_t* key_period,
+                                     const size_t period,
+                                     const size_t data_offset,
+                                     const char* input,
+                                     char* output,
+                                     const size_t length)
+    {
+        simd::ShiftBytes(key_period, period, data_offset % period, input, output, length);
+    }
+
+    /**
+     * Shift the text by a key period buffer, validating it in the same pass
+     * @param[in]   key_period - Key period buffer, see cipher_simd.hpp
+     * @param[in]   period - Length of the cipherkey
+     * @param[in]   input - The text to shift
+     * @param[out]  output - The resulting text, resized to match input
+     * @return  The first non-alpha character in input, if any
+     */
+    inline CipherResult TryShiftVigenereAlpha(const uint8_t* key_period,
+                                              const size_t period,
+                                              const std::string& input,
+                                              std::string& output)
+    {
+        // Output text should be same length as input text
+        output.resize(input.size());
+        return TryShiftVigenereAlphaAt(key_period, period, 0, input.data(), &output[0], input.size());
+    }
+
+    /**
+     * Shift one piece of a longer text by a key period buffer on several threads, validating it in the same pass
+     * The output is identical to TryShiftVigenereAlphaAt. When the text is
+     * invalid, pieces after the first invalid character may still be shifted.
+     * @param[in]   key_period - Key period buffer, see cipher_simd.hpp
+     * @param[in]   period - Length of the cipherkey
+     * @param[in]   text_offset - Position of input within the whole text
+     * @param[in]   input - The text to shift
+     * @param[out]  output - The resulting text, length bytes
+     * @param[in]   length - Length of input
+     * @param[in]   pool - Threads to run on, or null to use only this one
+     * @return  The first non-alpha character in input, if any, as an offset into input
+     */
+    inline CipherResult TryShiftVigenereAlphaParallel(const uint8_t* key_period,
+                                                      const size_t period,
+                                                      const size_t text_offset,
+                                                      const char* input,
+                                                      char* output,
+                                                      const size_t length,
+                                                      ThreadPool* pool)
+    {
+        const size_t num_pieces = (length + VIGENERE_PARALLEL_PIECE - 1) / VIGENERE_PARALLEL_PIECE;
+        if ((pool == nullptr) || (num_pieces <= 1))
+        {
+            return TryShiftVigenereAlphaAt(key_period, period, text_offset, input, output, length);
+        }
 
-            if (cipherkey_iter == cipherkey_end) {
-                cipherkey_iter = cipherkey.cbegin();
+        std::vector<CipherResult> results(num_pieces);
+        pool->ParallelFor(num_pieces, [&](const size_t index)
+        {
+            const size_t start = index * VIGENERE_PARALLEL_PIECE;
+            const size_t piece = std::min(VIGENERE_PARALLEL_PIECE, length - start);
+            results[index] = TryShiftVigenereAlphaAt(key_period, period, text_offset + start,
+                                                     input + start, output + start, piece);
+            results[index].offset += start;
+        });
+        for (const CipherResult& result : results)
+        {
+            if (!result.Ok())
+            {
+                return result;
             }
         }
+        return ResultOk();
+    }
+
+    /**
+     * Shift one piece of a longer run of binary data by a key period buffer on several threads, modulo 256
+     * The output is identical to ShiftVigenereBytesAt.
+     * @param[in]   key_period - Key period buffer, EncryptPeriod or ByteDecryptPeriod
+     * @param[in]   period - Length of the cipherkey
+     * @param[in]   data_offset - Position of input within the whole data
+     * @param[in]   input - The bytes to shift, any values
+     * @param[out]  output - The resulting bytes, length bytes. May be the same buffer as input.
+     * @param[in]   length - Length of input
+     * @param[in]   pool - Threads to run on, or null to use only this one
+     */
+    inline void ShiftVigenereBytesParallel(const uint8_t* key_period,
+                                           const size_t period,
+                                           const size_t data_offset,
+                                           const char* input,
+                                           char* output,
+                                           const size_t length,
+                                           ThreadPool* pool)
+    {
+        const size_t num_pieces = (length + VIGENERE_PARALLEL_PIECE - 1) / VIGENERE_PARALLEL_PIECE;
+        if ((pool == nullptr) || (num_pieces <= 1))
+        {
+            ShiftVigenereBytesAt(key_period, period, data_offset, input, output, length);
+            return;
+        }
+        pool->ParallelFor(num_pieces, [&](const size_t index)
+        {
+            const size_t start = index * VIGENERE_PARALLEL_PIECE;
+            const size_t piece = std::min(VIGENERE_PARALLEL_PIECE, length - start);
+            ShiftVigenereBytesAt(key_period, period, data_offset + start, input + start, output + start, piece);
+        });
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Vigenere cipherkey, without throwing
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptVigenereAlpha(const VigenereKey& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        return TryShiftVigenereAlpha(cipherkey.EncryptPeriod(), cipherkey.Period(), plaintext, ciphertext);
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Vigenere cipherkey, without throwing
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptVigenereAlpha(const VigenereKey& cipherkey, const std::string& ciphertext, std::string& plaintext)
+    {
+        return TryShiftVigenereAlpha(cipherkey.DecryptPeriod(), cipherkey.Period(), ciphertext, plaintext);
+    }
+
+    /**
+     * Encrypt a buffer using a precompiled Vigenere cipherkey, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, length bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     * @param[in]   length - Length of plaintext
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptVigenereAlpha(const VigenereKey& cipherkey, const char* plaintext, char* ciphertext, const size_t length)
+    {
+        return TryShiftVigenereAlphaAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0, plaintext, ciphertext, length);
+    }
+
+    /**
+     * Encrypt a string view using a precompiled Vigenere cipherkey, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptVigenereAlpha(const VigenereKey& cipherkey, const std::string_view plaintext, char* ciphertext)
+    {
+        return TryEncryptVigenereAlpha(cipherkey, plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a buffer using a precompiled Vigenere cipherkey, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, length bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     * @param[in]   length - Length of ciphertext
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptVigenereAlpha(const VigenereKey& cipherkey, const char* ciphertext, char* plaintext, const size_t length)
+    {
+        return TryShiftVigenereAlphaAt(cipherkey.DecryptPeriod(), cipherkey.Period(), 0, ciphertext, plaintext, length);
+    }
+
+    /**
+     * Decrypt a string view using a precompiled Vigenere cipherkey, without throwing or allocating
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptVigenereAlpha(const VigenereKey& cipherkey, const std::string_view ciphertext, char* plaintext)
+    {
+        return TryDecryptVigenereAlpha(cipherkey, ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Vigenere cipherkey
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @throw   If plaintext contains non-alpha characters
+     */
+    inline void EncryptVigenereAlpha(const VigenereKey& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        ThrowIfError(TryEncryptVigenereAlpha(cipherkey, plaintext, ciphertext), "", "plaintext");
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Vigenere cipherkey
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @throw   If ciphertext contains non-alpha characters
+     */
+    inline void DecryptVigenereAlpha(const VigenereKey& cipherkey, const std::string& ciphertext, std::string& plaintext)
+    {
+        ThrowIfError(TryDecryptVigenereAlpha(cipherkey, ciphertext, plaintext), "", "ciphertext");
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Vigenere cipherkey on several threads, without throwing
+     * The output is identical to TryEncryptVigenereAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @param[in]   pool - Threads to run on
+     * @return  The first non-alpha character in plaintext, if any
+     */
+    inline CipherResult TryEncryptVigenereAlphaParallel(const VigenereKey& cipherkey,
+                                                        const std::string& plaintext,
+                                                        std::string& ciphertext,
+                                                        ThreadPool& pool)
+    {
+        ciphertext.resize(plaintext.size());
+        return TryShiftVigenereAlphaParallel(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                                             plaintext.data(), &ciphertext[0], plaintext.size(), &pool);
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Vigenere cipherkey on several threads, without throwing
+     * The output is identical to TryDecryptVigenereAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @param[in]   pool - Threads to run on
+     * @return  The first non-alpha character in ciphertext, if any
+     */
+    inline CipherResult TryDecryptVigenereAlphaParallel(const VigenereKey& cipherkey,
+                                                        const std::string& ciphertext,
+                                                        std::string& plaintext,
+                                                        ThreadPool& pool)
+    {
+        plaintext.resize(ciphertext.size());
+        return TryShiftVigenereAlphaParallel(cipherkey.DecryptPeriod(), cipherkey.Period(), 0,
+                                             ciphertext.data(), &plaintext[0], ciphertext.size(), &pool);
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Vigenere cipherkey on several threads
+     * The output is identical to EncryptVigenereAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @param[in]   pool - Threads to run on
+     * @throw   If plaintext contains non-alpha characters
+     */
+    inline void EncryptVigenereAlphaParallel(const VigenereKey& cipherkey,
+                                             const std::string& plaintext,
+                                             std::string& ciphertext,
+                                             ThreadPool& pool)
+    {
+        ThrowIfError(TryEncryptVigenereAlphaParallel(cipherkey, plaintext, ciphertext, pool), "", "plaintext");
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Vigenere cipherkey on several threads
+     * The output is identical to DecryptVigenereAlpha.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     * @param[in]   pool - Threads to run on
+     * @throw   If ciphertext contains non-alpha characters
+     */
+    inline void DecryptVigenereAlphaParallel(const VigenereKey& cipherkey,
+                                             const std::string& ciphertext,
+                                             std::string& plaintext,
+                                             ThreadPool& pool)
+    {
+        ThrowIfError(TryDecryptVigenereAlphaParallel(cipherkey, ciphertext, plaintext, pool), "", "ciphertext");
+    }
+
+    /**
+     * Encrypt the given plaintext using a precompiled Vigenere cipherkey, keeping case
+     * Letters of either case are encrypted and keep their case; everything
+     * else is copied unchanged and does not use up the key.
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     */
+    inline void EncryptVigenereMixed(const VigenereKey& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        ciphertext.resize(plaintext.size());
+        (void)ShiftVigenereMixedAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                                   plaintext.data(), &ciphertext[0], plaintext.size());
+    }
+
+    /**
+     * Decrypt the given ciphertext using a precompiled Vigenere cipherkey, keeping case
+     * Letters of either case are decrypted and keep their case; everything
+     * else is copied unchanged and does not use up the key.
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text
+     */
+    inline void DecryptVigenereMixed(const VigenereKey& cipherkey, const std::string& ciphertext, std::string& plaintext)
+    {
+        plaintext.resize(ciphertext.size());
+        (void)ShiftVigenereMixedAt(cipherkey.DecryptPeriod(), cipherkey.Period(), 0,
+                                   ciphertext.data(), &plaintext[0], ciphertext.size());
+    }
+
+    /**
+     * Encrypt a string view using a precompiled Vigenere cipherkey, keeping case, without allocating
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     */
+    inline void EncryptVigenereMixed(const VigenereKey& cipherkey, const std::string_view plaintext, char* ciphertext)
+    {
+        (void)ShiftVigenereMixedAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                                   plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a string view using a precompiled Vigenere cipherkey, keeping case, without allocating
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     */
+    inline void DecryptVigenereMixed(const VigenereKey& cipherkey, const std::string_view ciphertext, char* plaintext)
+    {
+        (void)ShiftVigenereMixedAt(cipherkey.DecryptPeriod(), cipherkey.Period(), 0,
+                                   ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Encrypt binary data using a precompiled Vigenere cipherkey
+     * Each byte is shifted by its key letter (A = 0 ... Z = 25) modulo 256.
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The data to encrypt, any bytes
+     * @param[out]  ciphertext - The resulting encrypted data
+     */
+    inline void EncryptVigenereBytes(const VigenereKey& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        ciphertext.resize(plaintext.size());
+        ShiftVigenereBytesAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                             plaintext.data(), &ciphertext[0], plaintext.size());
+    }
+
+    /**
+     * Decrypt binary data using a precompiled Vigenere cipherkey
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The data to decrypt, any bytes
+     * @param[out]  plaintext - The resulting decrypted data
+     */
+    inline void DecryptVigenereBytes(const VigenereKey& cipherkey, const std::string& ciphertext, std::string& plaintext)
+    {
+        plaintext.resize(ciphertext.size());
+        ShiftVigenereBytesAt(cipherkey.ByteDecryptPeriod(), cipherkey.Period(), 0,
+                             ciphertext.data(), &plaintext[0], ciphertext.size());
+    }
+
+    /**
+     * Encrypt a string view using a precompiled Vigenere cipherkey, as binary data, without allocating
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text, plaintext.size() bytes, owned by the caller.
+     *                           May be the same buffer as plaintext.
+     */
+    inline void EncryptVigenereBytes(const VigenereKey& cipherkey, const std::string_view plaintext, char* ciphertext)
+    {
+        ShiftVigenereBytesAt(cipherkey.EncryptPeriod(), cipherkey.Period(), 0,
+                             plaintext.data(), ciphertext, plaintext.size());
+    }
+
+    /**
+     * Decrypt a string view using a precompiled Vigenere cipherkey, as binary data, without allocating
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The text to decrypt
+     * @param[out]  plaintext - The resulting decrypted text, ciphertext.size() bytes, owned by the caller.
+     *                          May be the same buffer as ciphertext.
+     */
+    inline void DecryptVigenereBytes(const VigenereKey& cipherkey, const std::string_view ciphertext, char* plaintext)
+    {
+        ShiftVigenereBytesAt(cipherkey.ByteDecryptPeriod(), cipherkey.Period(), 0,
+                             ciphertext.data(), plaintext, ciphertext.size());
+    }
+
+    /**
+     * Decrypt part of a longer ciphertext using a precompiled Vigenere cipherkey, without throwing or allocating
+     * The key phase is taken from the offset, so only the window is read.
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The whole ciphertext
+     * @param[in]   offset - Offset of the first letter wanted
+     * @param[in]   count - Number of letters wanted; offset + count must not be past the end of ciphertext
+     * @param[out]  plaintext - The letters of the window, count bytes, owned by the caller
+     * @return  The first non-alpha character in the window, if any, with its offset in ciphertext
+     */
+    inline CipherResult TryDecryptVigenereAlphaRange(const VigenereKey& cipherkey,
+                                                     const std::string_view ciphertext,
+                                                     const size_t offset,
+                                                     const size_t count,
+                                                     char* plaintext)
+    {
+        CipherResult result = TryShiftVigenereAlphaAt(cipherkey.DecryptPeriod(), cipherkey.Period(), offset,
+                                                      ciphertext.data() + offset, plaintext, count);
+        result.offset += offset;
+        return result;
+    }
+
+    /**
+     * Decrypt part of a longer run of binary data using a precompiled Vigenere cipherkey
+     * The key phase is taken from the offset, so only the window is read.
+     * @param[in]   cipherkey - The compiled encryption keyword
+     * @param[in]   ciphertext - The whole ciphertext, any bytes
+     * @param[in]   offset - Offset of the first byte wanted
+     * @param[in]   count - Number of bytes wanted; offset + count must not be past the end of ciphertext
+     * @param[out]  plaintext - The bytes of the window, count bytes, owned by the caller
+     */
+    inline void DecryptVigenereBytesRange(const VigenereKey& cipherkey,
+                                          const std::string_view ciphertext,
+                                          const size_t offset,
+                                          const size_t count,
+                                          char* plaintext)
+    {
+        ShiftVigenereBytesAt(cipherkey.ByteDecryptPeriod(), cipherkey.Period(), offset,
+                             ciphertext.data() + offset, plaintext, count);
+    }
+
+    /**
+     * Encrypt the given plaintext using a Vigenere cipher
+     * This function is limited to upper-case alphabet characters (A-Z)
+     * See https://en.wikipedia.org/wiki/Vigen%C3%A8re_cipher for details
+     * @param[in]   cipherkey - The encryption keyword. Use the same keyword to decrypt
+     * @param[in]   plaintext - The text to encrypt
+     * @param[out]  ciphertext - The resulting encrypted text
+     * @throw   If cipherkey or plaintext contain non-alpha characters
+     */
+    inline void EncryptVigenereAlpha(const std::string& cipherkey, const std::string& plaintext, std::string& ciphertext)
+    {
+        EncryptVigenereAlpha(VigenereKey(cipherkey), plaintext, ciphertext);
     }
 
     /**
@@ -105,9 +668,94 @@ namespace cipher {
      */
     inline void DecryptVigenereAlpha(const std::string& cipherkey, const std::string& ciphertext, std::string& plaintext)
     {
-        EncryptVigenereAlpha(InvertCipherkey(cipherkey), ciphertext, plaintext);
+        DecryptVigenereAlpha(VigenereKey(cipherkey), ciphertext, plaintext);
     }
 
+
+    /* ===== Classes ===== */
+
+    /**
+     * Vigenere (or Caesar) cipher over a message that arrives in chunks
+     * The key phase carries over from one chunk to the next, so chunks of
+     * any size give the same result as the whole message at once.
+     * This class is limited to upper-case alphabet characters (A-Z)
+     * @tparam  Key - VigenereKey or CaesarKey
+     */
+    template <typename Key>
+    class ShiftEncoder
+    {
+    public:
+        /**
+         * Start a message
+         * @param[in]   cipherkey - The compiled key, copied into the encoder
+         * @param[in]   decrypt - Decrypt instead of encrypt
+         */
+        explicit ShiftEncoder(const Key& cipherkey, const bool decrypt = false) :
+            cipherkey_(cipherkey),
+            decrypt_(decrypt),
+            position_(0U)
+        {
+        }
+
+        /**
+         * Cipher the next piece of the message
+         * @param[in]   input - The piece
+         * @param[out]  output - The result, length bytes, owned by the caller. May be the same buffer as input.
+         * @param[in]   length - Length of the piece
+         * @return  The first non-alpha character in input, if any, as an offset in the whole message.
+         *          On error the message does not move on, so the piece can be sent again.
+         */
+        CipherResult Update(const char* input, char* output, const size_t length)
+        {
+            const uint8_t* key_period = decrypt_ ? cipherkey_.DecryptPeriod() : cipherkey_.EncryptPeriod();
+            CipherResult result = TryShiftVigenereAlphaAt(key_period, cipherkey_.Period(), position_,
+                                                          input, output, length);
+            if (!result.Ok())
+            {
+                result.offset += position_;
+                return result;
+            }
+            position_ += length;
+            return result;
+        }
+
+        /**
+         * Cipher the next piece of the message
+         * @param[in]   input - The piece
+         * @param[out]  output - The result, input.size() bytes, owned by the caller. May be the same buffer as input.
+         * @return  The first non-alpha character in input, if any, as an offset in the whole message
+         */
+        CipherResult Update(const std::string_view input, char* output)
+        {
+            return Update(input.data(), output, input.size());
+        }
+
+        /**
+         * End the message, so the next piece starts a new one at the first letter of the key
+         * @return  Length of the message that ended
+         */
+        size_t Finish()
+        {
+            const size_t length = position_;
+            position_ = 0U;
+            return length;
+        }
+
+        /** Letters of the message ciphered so far */
+        size_t Position() const
+        {
+            return position_;
+        }
+
+    private:
+        Key cipherkey_;                 // The compiled key, owned so a temporary key can't dangle
+        bool decrypt_;                  // Use the decryption buffer of the key
+        size_t position_;               // Offset of the next piece in the message
+    };
+
+    /** Vigenere cipher over a message that arrives in chunks */
+    typedef ShiftEncoder<VigenereKey> VigenereEncoder;
+
 }   // end namespace cipher
 
 
@@ -0,0 +1,171 @@
+/************************************************************\
+Filename:   cipher_c.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Implementation of the C interface in cipher.h, on top of
+    the header-only cipher engine.
+
+    Each key handle holds one compiled transform per direction,
+    so a call does no parsing, compiling or allocating of its
+    own. The exceptions are case-preserving transpositions,
+    which gather the letters into a per-thread buffer, and
+    rail fence or scytale in place, which need one bit per
+    byte to track the permutation.
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include "cipher.h"
+#include "cipher_version.hpp"
+#include "cipher_transform.hpp"
+
+using cipher::BlockTransform;
+using cipher::CipherResult;
+using cipher::TransformOptions;
+
+
+/* ===== Types ===== */
+
+/**
+ * A compiled key, opaque to C callers
+ * Both directions are compiled by cipher::MakeBlockTransform, the same as the command line tool.
+ */
+struct cipher_key
+{
+    BlockTransform encrypt; // Transform for cipher_encrypt
+    BlockTransform decrypt; // Transform for cipher_decrypt
+};
+
+
+/* ===== Variables ===== */
+
+/** Message for the last error of cipher_key_create, for cipher_last_error */
+static thread_local std::string last_error;
+
+
+/* ===== Functions ===== */
+
+/**
+ * Run one direction of a key over a buffer, keeping exceptions out of C
+ */
+static cipher_result ApplyKey(const cipher_key* key,
+                              const BlockTransform cipher_key::* direction,
+                              const char* input,
+                              char* output,
+                              const size_t length)
+{
+    cipher_result result = {CIPHER_RESULT_OK, 0U, '\0'};
+    if ((key == nullptr) || ((length > 0) && ((input == nullptr) || (output == nullptr))))
+    {
+        result.status = CIPHER_RESULT_INVALID_ARGUMENT;
+        return result;
+    }
+    try
+    {
+        const CipherResult status = (key->*direction)(input, output, length, 0);
+        result.status = static_cast<int>(status.status);
+        result.offset = status.offset;
+        result.value = status.value;
+    }
+    catch (...)
+    {
+        // Only scratch allocations can throw once the key is compiled
+        result.status = CIPHER_RESULT_OUT_OF_MEMORY;
+    }
+    return result;
+}
+
+
+/* ===== C Interface ===== */
+
+int cipher_key_create(const char* method, const char* key, const int flags, cipher_key** key_out)
+{
+    last_error.clear();
+    if ((method == nullptr) || (key_out == nullptr))
+    {
+        last_error = "method and key_out must not be null";
+        return CIPHER_RESULT_INVALID_ARGUMENT;
+    }
+    *key_out = nullptr;
+    try
+    {
+        const std::string method_name(method);
+        if ((flags & ~(CIPHER_FLAG_KEEP_CASE | CIPHER_FLAG_BINARY)) != 0)
+        {
+            last_error = "unknown flags";
+            return CIPHER_RESULT_INVALID_ARGUMENT;
+        }
+
+        // Calls run on the caller's thread, so no engine gets a pool of its own
+        TransformOptions options;
+        options.method = method_name;
+        options.decrypt = false;
+        options.keep_case = ((flags & CIPHER_FLAG_KEEP_CASE) != 0);
+        options.binary = ((flags & CIPHER_FLAG_BINARY) != 0);
+        options.num_threads = 1;
+        try
+        {
+            cipher::CheckTransformOptions(options);
+        }
+        catch (const std::runtime_error& e)
+        {
+            last_error = e.what();
+            return CIPHER_RESULT_INVALID_ARGUMENT;
+        }
+
+        std::string cipherkey((key == nullptr) ? "" : key);
+        (void)cipher::rtrim(cipherkey);
+        std::unique_ptr<cipher_key> compiled(new cipher_key);
+        compiled->encrypt = cipher::MakeBlockTransform(options, cipherkey);
+        options.decrypt = true;
+        compiled->decrypt = cipher::MakeBlockTransform(options, cipherkey);
+        if (!compiled->encrypt)
+        {
+            last_error = "method \"" + method_name + "\" not supported.";
+            return CIPHER_RESULT_INVALID_KEY;
+        }
+        *key_out = compiled.release();
+        return CIPHER_RESULT_OK;
+    }
+    catch (const std::bad_alloc&)
+    {
+        last_error = "out of memory";
+        return CIPHER_RESULT_OUT_OF_MEMORY;
+    }
+    catch (const std::exception& e)
+    {
+        last_error = e.what();
+        return CIPHER_RESULT_INVALID_KEY;
+    }
+}
+
+void cipher_key_free(cipher_key* key)
+{
+    delete key;
+}
+
+cipher_result cipher_encrypt(const cipher_key* key, const char* plaintext, char* ciphertext, const size_t length)
+{
+    return ApplyKey(key, &cipher_key::encrypt, plaintext, ciphertext, length);
+}
+
+cipher_result cipher_decrypt(const cipher_key* key, const char* ciphertext, char* plaintext, const size_t length)
+{
+    return ApplyKey(key, &cipher_key::decrypt, ciphertext, plaintext, length);
+}
+
+const char* cipher_last_error(void)
+{
+    return last_error.c_str();
+}
+
+const char* cipher_version(void)
+{
+    return cipher::VERSION_FULL.c_str();
+}
@@ -9,35 +9,124 @@ Description:
     Supported ciphers:
     - Caesar cipher
     - Vigenere cipher
+    - Substitution cipher
+    - Rail fence cipher
+    - Scytale cipher
 
 \************************************************************/
 
 
 /* ===== Includes ===== */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
 #include <cstdio>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <fstream>
-#include <sstream>
+#include <functional>
 #include "unistd.h"
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/stat.h>
 #include "cipher_usage.hpp"
 #include "cipher_version.hpp"
 #include "caesar_cipher.hpp"
 #include "vigenere_cipher.hpp"
 #include "rail_fence_cipher.hpp"
 #include "scytale_cipher.hpp"
+#include "substitution_cipher.hpp"
+#include "cipher_chain.hpp"
+#include "cipher_stream.hpp"
+#include "cipher_pipeline.hpp"
+#include "cipher_mmap.hpp"
+#include "cipher_uring.hpp"
+#include "cipher_manifest.hpp"
+#include "cipher_server.hpp"
+#include "cipher_thread_pool.hpp"
+#include "cipher_container.hpp"
+#include "cipher_transform.hpp"
 
-using cipher::EncryptCaesarAlpha;
-using cipher::DecryptCaesarAlpha;
-using cipher::EncryptVigenereAlpha;
-using cipher::DecryptVigenereAlpha;
+using cipher::TransposeRailFenceInPlace;
 using cipher::EncryptRailFenceAlpha;
 using cipher::DecryptRailFenceAlpha;
+using cipher::EncryptRailFenceAlphaInPlace;
+using cipher::DecryptRailFenceAlphaInPlace;
+using cipher::EncryptRailFenceAlphaParallel;
+using cipher::DecryptRailFenceAlphaParallel;
 using cipher::EncryptScytaleAlpha;
 using cipher::DecryptScytaleAlpha;
+using cipher::EncryptScytaleAlphaInPlace;
+using cipher::DecryptScytaleAlphaInPlace;
+using cipher::DecryptRailFenceRange;
+using cipher::TryDecryptRailFenceAlphaRange;
+using cipher::TryDecryptScytaleAlphaRange;
+using cipher::ContainerHeader;
+using cipher::ContainerReader;
+using cipher::ContainerWriter;
+using cipher::BlockTransform;
+using cipher::CipherResult;
+using cipher::CipherClient;
+using cipher::CipherServer;
+using cipher::IsCipherChain;
+using cipher::ManifestRecord;
+using cipher::MappedInput;
+using cipher::ParseManifestRecord;
+using cipher::ParseNumericKey;
+using cipher::PipelinedStreamTransform;
+using cipher::MappedOutput;
+using cipher::TrimmedEnd;
+using cipher::UringTransformer;
+using cipher::StreamTransform;
+using cipher::ThrowIfError;
+using cipher::ThreadPool;
 using cipher::VERSION_FULL;
 
 
+/* ===== Constants ===== */
+
+/** Manifest records read and run together */
+static const size_t MANIFEST_WINDOW = 4096;
+
+/** Most compiled keys kept from one manifest */
+static const size_t MANIFEST_KEY_CACHE_SIZE = 1024;
+
+/** Most compiled keys kept by the server */
+static const size_t SERVER_KEY_CACHE_SIZE = 1024;
+
+/** Requests and payload size used by the benchmark when not given */
+static const size_t BENCH_DEFAULT_REQUESTS = 10000;
+static const size_t BENCH_DEFAULT_PAYLOAD = 64;
+
+/** Values returned by getopt_long for options that only have a long name */
+enum LongOption
+{
+    OPTION_SERVE = 256,
+    OPTION_CLIENT,
+    OPTION_BENCH,
+    OPTION_REQUESTS,
+    OPTION_PAYLOAD,
+    OPTION_URING,
+    OPTION_DIRECT,
+    OPTION_BINARY,
+    OPTION_OFFSET,
+    OPTION_LENGTH,
+    OPTION_CONTAINER,
+    OPTION_RESUME,
+    OPTION_CHECKSUM,
+    OPTION_VERIFY,
+};
+
+
 /**
  * Cipher method to use
  */
@@ -48,142 +137,1397 @@ enum EncryptMethod
 };
 
 
-/* ===== Functions ===== */
+/**
+ * Options given on the command line
+ */
+struct CipherOptions
+{
+    std::string method;     // Name of the cipher to use
+    std::string cipherkey;  // The cipher key, as given
+    bool decrypt_flag;      // Decrypt instead of encrypt
+    bool in_place;          // Transform the input buffer instead of allocating a second buffer
+    size_t num_threads;     // Threads to use for the parallel engines, 0 for one per core
+    size_t block_size;      // Transpose blocks of this many letters separately, 0 for the whole text
+    std::string batch_list; // File listing input and output pairs, - for stdin
+    bool batch_directory;   // Input and output are directory trees
+    std::string manifest;   // JSON Lines file of jobs, each with its own method and key, - for stdin
+    std::string serve;      // Socket to serve requests on
+    std::string client;     // Socket of a server to send the input to
+    std::string bench;      // Socket of a server to measure
+    size_t bench_requests;  // Requests sent by the benchmark
+    size_t bench_payload;   // Letters in each benchmark request
+    bool io_uring;          // Read and write files through io_uring when it is available
+    bool direct_io;         // Open files with O_DIRECT for io_uring
+    bool keep_case;         // Cipher letters of either case and pass everything else through
+    bool binary;            // Cipher raw bytes: no validation, no trimming, no final newline
+    bool range;             // Decrypt only a window of the input
+    size_t range_offset;    // Offset of the first letter of the window
+    size_t range_length;    // Letters in the window, SIZE_MAX for the rest of the text
+    bool container;         // Write or read the chunked container format
+    bool resume;            // Carry on with an interrupted container
+    bool checksum;          // Record a CRC32C of each chunk of a container
+    bool verify;            // Check each chunk of a container against its CRC32C
+};
+
+
+/**
+ * One file of a batch
+ */
+struct BatchJob
+{
+    std::string input_path;     // File to read the input text from
+    std::string output_path;    // File to write the result to
+};
+
+
+/* ===== Function Declarations ===== */
+
+static BlockTransform MakeBlockTransform(const CipherOptions& options, const std::string& cipherkey);
+
+
+/* ===== Classes ===== */
+
+/**
+ * Compiled ciphers by method, key and direction, safe to share between threads
+ * A rejected key is cached with its error, so it is only compiled once too.
+ * Entries are handed out as shared pointers, so the cache can be cleared
+ * while they are still in use.
+ */
+class KeyCache
+{
+public:
+    /**
+     * A compiled cipher, or the reason it could not be compiled
+     */
+    struct Entry
+    {
+        BlockTransform transform;   // The cipher, or empty if it was rejected
+        std::string error;          // Why the key or method was rejected
+    };
+
+    /**
+     * Create an empty cache
+     * @param[in]   options - Flags from the command line; method, key and direction come from each lookup
+     * @param[in]   capacity - Entries kept before the cache is emptied
+     */
+    KeyCache(const CipherOptions& options, const size_t capacity) :
+        options_(options),
+        capacity_(capacity)
+    {
+        // Threads are spent on separate requests, so each one is transformed on one thread
+        options_.num_threads = 1;
+        options_.block_size = 0;
+    }
+
+    /** Find or compile the cipher for a method, key and direction */
+    std::shared_ptr<const Entry> Get(const std::string& method, const std::string& key, const bool decrypt)
+    {
+        std::string cache_key = method;
+        cache_key.push_back('\0');
+        cache_key.append(key);
+        cache_key.push_back(decrypt ? 'D' : 'E');
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto found = entries_.find(cache_key);
+            if (found != entries_.end())
+            {
+                return found->second;
+            }
+        }
+
+        // Compile without holding the lock; two threads may both compile a new key
+        CipherOptions key_options(options_);
+        key_options.method = method;
+        key_options.decrypt_flag = decrypt;
+        std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+        try
+        {
+            std::string cipherkey(key);
+            (void)cipher::rtrim(cipherkey);
+            entry->transform = MakeBlockTransform(key_options, cipherkey);
+            if (!entry->transform)
+            {
+                entry->error = "method \"" + method + "\" not supported.";
+            }
+        }
+        catch (const std::exception& e)
+        {
+            entry->transform = nullptr;
+            entry->error = e.what();
+        }
+
+        // Keep the cache bounded when every lookup has a new key
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entries_.size() >= capacity_)
+        {
+            entries_.clear();
+        }
+        return entries_.emplace(cache_key, entry).first->second;
+    }
+
+private:
+    CipherOptions options_;     // Flags shared by every entry
+    size_t capacity_;           // Entries kept before the cache is emptied
+    std::mutex mutex_;          // Guards entries_
+    std::unordered_map<std::string, std::shared_ptr<const Entry>> entries_;
+};
+
+
+/* ===== Functions ===== */
+
+/**
+ * Read data from the file into string
+ * If the file is empty or can't be opened, empty string is returned
+ */
+static void ReadFromFile(std::istream& input_file, std::string& output_str)
+{
+    // Read straight into the string, one block at a time
+    size_t filled = 0U;
+    output_str.clear();
+    while (input_file)
+    {
+        output_str.resize(filled + cipher::STREAM_BLOCK_SIZE);
+        input_file.read(&output_str[filled], static_cast<std::streamsize>(cipher::STREAM_BLOCK_SIZE));
+        filled += static_cast<size_t>(input_file.gcount());
+    }
+    output_str.resize(filled);
+}
+
+/** Check if a method is one of the transposition ciphers, or a chain that includes one */
+static bool IsTransposition(const std::string& method)
+{
+    return IsCipherChain(method) ? cipher::ChainHasTransposition(method) : cipher::IsTranspositionMethod(method);
+}
+
+/** What the input text is called in error messages: the ciphertext when decrypting */
+static const char* TextName(const CipherOptions& options)
+{
+    return options.decrypt_flag ? "ciphertext" : "plaintext";
+}
+
+/**
+ * Compile the key and build the cipher as a transform over blocks of text
+ * See cipher::MakeBlockTransform, which the C library shares.
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   cipherkey - The cipher key, with trailing whitespace removed; unused for a chain
+ * @return  Transform for cipher::StreamTransform, or an empty function if the method is not supported
+ * @throw   If the key is invalid, or the flags can't be used with the method
+ */
+static BlockTransform MakeBlockTransform(const CipherOptions& options, const std::string& cipherkey)
+{
+    cipher::TransformOptions transform_options;
+    transform_options.method = options.method;
+    transform_options.decrypt = options.decrypt_flag;
+    transform_options.keep_case = options.keep_case;
+    transform_options.binary = options.binary;
+    transform_options.num_threads = options.num_threads;
+    return cipher::MakeBlockTransform(transform_options, cipherkey);
+}
+
+/**
+ * Run a transposition cipher over the whole input at once
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   cipherkey - The cipher key, with trailing whitespace removed
+ * @param[in]   transform - The cipher, from MakeBlockTransform
+ * @param[in]   input_file - Stream to read the input text from
+ * @param[out]  output_file - Stream to write the result to
+ * @throw   If the text is invalid
+ */
+static void TransposeWholeText(const CipherOptions& options,
+                               const std::string& cipherkey,
+                               const BlockTransform& transform,
+                               std::istream& input_file,
+                               std::ostream& output_file)
+{
+    const bool decrypt_flag = options.decrypt_flag;
+
+    // Input
+    std::string plaintext;
+    ReadFromFile(input_file, plaintext);
+    if (!options.binary)
+    {
+        (void)cipher::rtrim(plaintext);
+    }
+
+    // Do the cipher
+    // When working in place, the output is the input buffer
+    // (a chain handles its own buffers, and case-preserving mode moves
+    // only the letters, so those always go through transform)
+    std::string ciphertext_buffer;
+    std::string& ciphertext = options.in_place ? plaintext : ciphertext_buffer;
+    if (!options.in_place || IsCipherChain(options.method) || options.keep_case)
+    {
+        ciphertext.resize(plaintext.size());
+        ThrowIfError(transform(plaintext.data(), &ciphertext[0], plaintext.size(), 0), "", TextName(options));
+    }
+    else if (options.method == "railfence")
+    {
+        const size_t num_rails = ParseNumericKey(cipherkey, "rail fence");
+        if (options.binary && decrypt_flag)
+        {
+            // Binary data is moved as it is, with no check for letters
+            TransposeRailFenceInPlace<true>(num_rails, &plaintext[0], plaintext.size());
+        }
+        else if (options.binary)
+        {
+            TransposeRailFenceInPlace<false>(num_rails, &plaintext[0], plaintext.size());
+        }
+        else if (decrypt_flag)
+        {
+            DecryptRailFenceAlphaInPlace(num_rails, plaintext);
+        }
+        else
+        {
+            EncryptRailFenceAlphaInPlace(num_rails, plaintext);
+        }
+    }
+    else
+    {
+        const size_t row_width = ParseNumericKey(cipherkey, "scytale");
+        if (decrypt_flag)
+        {
+            DecryptScytaleAlphaInPlace(row_width, plaintext);
+        }
+        else
+        {
+            EncryptScytaleAlphaInPlace(row_width, plaintext);
+        }
+    }
+
+    // Output
+    output_file << ciphertext;
+    if (!options.binary)
+    {
+        output_file << '\n';
+    }
+    output_file.flush();
+}
+
+/**
+ * Run the cipher over an input stream and write the result
+ * Ciphers that work letter by letter are streamed through a pipeline
+ * that reads, ciphers and writes on separate threads. Transposition
+ * ciphers given a block size are streamed block by block; otherwise
+ * they read the whole input first.
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   cipherkey - The cipher key, with trailing whitespace removed
+ * @param[in]   transform - The cipher, from MakeBlockTransform
+ * @param[in]   input_file - Stream to read the input text from
+ * @param[out]  output_file - Stream to write the result to
+ * @throw   If either stream could not be opened, or the text is invalid
+ */
+static void TransformStream(const CipherOptions& options,
+                            const std::string& cipherkey,
+                            const BlockTransform& transform,
+                            std::istream& input_file,
+                            std::ostream& output_file)
+{
+    if (!output_file)
+    {
+        throw std::runtime_error("output file could not be opened");
+    }
+    else if (!input_file)
+    {
+        throw std::runtime_error("input file could not be opened");
+    }
+    else if (IsTransposition(options.method) && (options.block_size == 0))
+    {
+        TransposeWholeText(options, cipherkey, transform, input_file, output_file);
+    }
+    else if (IsTransposition(options.method))
+    {
+        ThrowIfError(StreamTransform(input_file, output_file, options.block_size, transform, options.binary),
+                     "", TextName(options));
+    }
+    else
+    {
+        const size_t block_size = (options.block_size != 0) ? options.block_size : cipher::STREAM_BLOCK_SIZE;
+        ThrowIfError(PipelinedStreamTransform(input_file, output_file, block_size, transform, options.binary),
+                     "", TextName(options));
+    }
+}
+
+/**
+ * Run the cipher over a memory-mapped input file and write the result
+ * The cipher reads straight from the input mapping, and writes straight
+ * into the output mapping when the output is a regular file.
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   transform - The cipher, from MakeBlockTransform
+ * @param[in]   input - The mapped input file
+ * @param[in]   output_path - File to write the result to, or null for stdout
+ * @param[in,out]   scratch - Buffer for output that can't be mapped, reused between calls
+ * @throw   If the output could not be opened, or the text is invalid
+ */
+static void TransformMappedFile(const CipherOptions& options,
+                                const BlockTransform& transform,
+                                const MappedInput& input,
+                                const char* output_path,
+                                std::string& scratch)
+{
+    // Trailing whitespace is dropped and a newline is written after the text,
+    // except for binary data
+    const char* text = input.Data();
+    const size_t length = options.binary ? input.Size() : TrimmedEnd(text, 0, input.Size());
+    const size_t newline_length = options.binary ? 0U : 1U;
+
+    // Transposition ciphers see the whole text unless a block size is given
+    size_t block_size = std::max<size_t>(length, 1U);
+    if (options.block_size != 0)
+    {
+        block_size = options.block_size;
+    }
+    else if (!IsTransposition(options.method))
+    {
+        block_size = cipher::STREAM_BLOCK_SIZE;
+    }
+
+    MappedOutput output;
+    if ((output_path != nullptr) && output.Open(output_path, length + newline_length))
+    {
+        // Write each block straight into the output file
+        char* result = output.Data();
+        for (size_t offset = 0; offset < length; offset += block_size)
+        {
+            CipherResult block_result = transform(text + offset, result + offset,
+                                                  std::min(block_size, length - offset), offset);
+            if (!block_result.Ok())
+            {
+                output.Close(offset);
+                block_result.offset += offset;
+                ThrowIfError(block_result, "", TextName(options));
+            }
+        }
+        if (!options.binary)
+        {
+            result[length] = '\n';
+        }
+    }
+    else
+    {
+        // Not a regular file, write each block through a stream
+        std::ofstream outfile;
+        if (output_path != nullptr)
+        {
+            outfile.open(output_path);
+        }
+        std::ostream& output_file = (output_path != nullptr) ? outfile : std::cout;
+        if (!output_file)
+        {
+            throw std::runtime_error("output file could not be opened");
+        }
+        scratch.resize(std::max(scratch.size(), std::min(block_size, length)));
+        for (size_t offset = 0; offset < length; offset += block_size)
+        {
+            const size_t block_length = std::min(block_size, length - offset);
+            CipherResult block_result = transform(text + offset, &scratch[0], block_length, offset);
+            if (!block_result.Ok())
+            {
+                block_result.offset += offset;
+                ThrowIfError(block_result, "", TextName(options));
+            }
+            output_file.write(scratch.data(), static_cast<std::streamsize>(block_length));
+        }
+        if (!options.binary)
+        {
+            output_file << '\n';
+        }
+        output_file.flush();
+        if (!output_file)
+        {
+            throw std::runtime_error("output file could not be written");
+        }
+    }
+}
+
+/**
+ * Decrypt only a window of a memory-mapped input file and write it
+ * Ciphers that work letter by letter decrypt the window with the key
+ * phase taken from its offset. Rail fence and scytale read each letter of
+ * the window from its place in the ciphertext (or in its block, with -b),
+ * found in closed form, so only the pages holding those letters are read.
+ * @param[in]   options - Method, key, flags and window from the command line
+ * @param[in]   cipherkey - The cipher key, with trailing whitespace removed
+ * @param[in]   transform - The cipher, from MakeBlockTransform
+ * @param[in]   input - The mapped input file
+ * @param[in]   output_path - File to write the window to, or null for stdout
+ * @throw   If the output could not be opened, the method can't decrypt a window, or the text is invalid
+ */
+static void DecryptMappedRange(const CipherOptions& options,
+                               const std::string& cipherkey,
+                               const BlockTransform& transform,
+                               const MappedInput& input,
+                               const char* output_path)
+{
+    const std::string& method = options.method;
+    const bool transposition = IsTransposition(method);
+    if (transposition && IsCipherChain(method))
+    {
+        throw std::runtime_error("--offset and --length do not work with chains that include "
+                                 "'railfence' or 'scytale'");
+    }
+    const size_t size_key = !transposition ? 0U
+        : ParseNumericKey(cipherkey, (method == "railfence") ? "rail fence" : "scytale");
+
+    // The window is clipped to the text, which is trimmed as for the whole file
+    const char* text = input.Data();
+    const size_t length = options.binary ? input.Size() : TrimmedEnd(text, 0, input.Size());
+    const size_t offset = std::min(options.range_offset, length);
+    const size_t count = std::min(options.range_length, length - offset);
+    const size_t block_size = (options.block_size != 0) ? options.block_size : std::max<size_t>(length, 1U);
+
+    std::ofstream outfile;
+    if (output_path != nullptr)
+    {
+        outfile.open(output_path);
+    }
+    std::ostream& output_file = (output_path != nullptr) ? outfile : std::cout;
+    if (!output_file)
+    {
+        throw std::runtime_error("output file could not be opened");
+    }
+
+    std::string scratch(std::min(count, cipher::STREAM_BLOCK_SIZE), '\0');
+    size_t position = offset;
+    while (position < (offset + count))
+    {
+        size_t piece = std::min(scratch.size(), offset + count - position);
+        CipherResult result = cipher::ResultOk();
+        if (!transposition)
+        {
+            result = transform(text + position, &scratch[0], piece, position);
+            result.offset += position;
+        }
+        else
+        {
+            // Each block of a transposition is decrypted on its own
+            const size_t block_start = position - (position % block_size);
+            const std::string_view block(text + block_start, std::min(block_size, length - block_start));
+            piece = std::min(piece, block_start + block.size() - position);
+            if (method == "scytale")
+            {
+                result = TryDecryptScytaleAlphaRange(size_key, block, position - block_start, piece, &scratch[0]);
+            }
+            else if (options.binary)
+            {
+                DecryptRailFenceRange(size_key, block, position - block_start, piece, &scratch[0]);
+            }
+            else
+            {
+                result = TryDecryptRailFenceAlphaRange(size_key, block, position - block_start, piece, &scratch[0]);
+            }
+            result.offset += block_start;
+        }
+        ThrowIfError(result, "", TextName(options));
+        output_file.write(scratch.data(), static_cast<std::streamsize>(piece));
+        position += piece;
+    }
+    if (!options.binary)
+    {
+        output_file << '\n';
+    }
+    output_file.flush();
+}
+
+/**
+ * Compile the cipher for the chunks of a container
+ * Each chunk is a message of its own, ciphered on one thread.
+ * @param[in]   options - Method, key and direction from the command line
+ * @param[in]   cipherkey - The cipher key, with trailing whitespace removed
+ * @param[in]   flags - CONTAINER_FLAG_... values of the container
+ * @return  Transform to call with offset 0 for each whole chunk
+ * @throw   If the method is not supported or the key is invalid
+ */
+static BlockTransform MakeChunkTransform(const CipherOptions& options, const std::string& cipherkey, const uint16_t flags)
+{
+    CipherOptions chunk_options(options);
+    chunk_options.num_threads = 1;
+    chunk_options.block_size = 0;
+    chunk_options.binary = ((flags & cipher::CONTAINER_FLAG_BINARY) != 0);
+    chunk_options.keep_case = ((flags & cipher::CONTAINER_FLAG_KEEP_CASE) != 0);
+    const BlockTransform transform = MakeBlockTransform(chunk_options, cipherkey);
+    if (!transform)
+    {
+        throw std::runtime_error("method \"" + options.method + "\" not supported.");
+    }
+    return transform;
+}
+
+/**
+ * Find how many whole chunks of an interrupted container can be kept
+ * A chunk is kept if the file is long enough to hold it and the input has
+ * a whole chunk of text for it, so a short last chunk, or a partly written
+ * index, is always written again.
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   header - Header of the container being written
+ * @param[in]   input_path - File the container is written from
+ * @param[in]   output_path - The interrupted container
+ * @param[out]  crcs - CRC32C of each kept chunk, if the container has checksums
+ * @return  Number of chunks to keep (0 if there is no output yet), or SIZE_MAX if
+ *          the container is already complete
+ * @throw   If the input can't be mapped, or the output was written with other settings
+ */
+static size_t ResumableChunks(const CipherOptions& options,
+                              const ContainerHeader& header,
+                              const char* input_path,
+                              const char* output_path,
+                              std::vector<uint32_t>& crcs)
+{
+    MappedInput input;
+    MappedInput output;
+    if ((input_path == nullptr) || (output_path == nullptr))
+    {
+        throw std::runtime_error("--resume needs an input file and an output file");
+    }
+    else if (!output.Open(output_path) || (output.Size() == 0))
+    {
+        // Nothing written yet
+        return 0U;
+    }
+    else if (!input.Open(input_path))
+    {
+        throw std::runtime_error("--resume needs an input file that can be mapped");
+    }
+    ContainerHeader written = ContainerHeader();
+    const size_t header_size = cipher::DecodeContainerHeader(output.Data(), output.Size(), written);
+    if ((written.method != header.method) || (written.fingerprint != header.fingerprint) ||
+        (written.chunk_size != header.chunk_size) || (written.flags != header.flags))
+    {
+        throw std::runtime_error("the output was written with another method, key, chunk size or flags");
+    }
+    try
+    {
+        (void)ContainerReader(output.Data(), output.Size());
+        return std::numeric_limits<size_t>::max();
+    }
+    catch (const std::runtime_error&)
+    {
+        // No index yet
+    }
+    const size_t text_length = options.binary ? input.Size() : TrimmedEnd(input.Data(), 0, input.Size());
+    const size_t kept = std::min((output.Size() - header_size) / header.chunk_size, text_length / header.chunk_size);
+    if ((header.flags & cipher::CONTAINER_FLAG_CHECKSUM) != 0)
+    {
+        // The index is written at the end, so the kept chunks are checksummed again
+        for (size_t index = 0; index < kept; ++index)
+        {
+            const size_t chunk_size = static_cast<size_t>(header.chunk_size);
+            crcs.push_back(cipher::Crc32c(output.Data() + header_size + (index * chunk_size), chunk_size));
+        }
+    }
+    return kept;
+}
+
+/**
+ * Encrypt one input into the chunked container format
+ * Chunks are ciphered on -j threads. With --resume, the whole chunks of
+ * an interrupted container are kept and the rest is written after them.
+ * With --checksum, each thread also takes the CRC32C of the chunks it ciphers.
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   cipherkey - The cipher key, with trailing whitespace removed
+ * @param[in]   input_path - File to read the payload from, or null for stdin
+ * @param[in]   output_path - File to write the container to, or null for stdout
+ * @throw   If either file could not be opened, or the text is invalid
+ */
+static void WriteContainerFile(const CipherOptions& options,
+                               const std::string& cipherkey,
+                               const char* input_path,
+                               const char* output_path)
+{
+    ContainerHeader header = ContainerHeader();
+    header.method = cipher::ContainerMethodName(options.method);
+    header.fingerprint = cipher::ContainerFingerprint(options.method, cipherkey);
+    header.chunk_size = (options.block_size != 0) ? options.block_size : cipher::CONTAINER_CHUNK_SIZE;
+    cipher::CheckContainerChunkSize(header.chunk_size);
+    header.flags = static_cast<uint16_t>((options.binary ? cipher::CONTAINER_FLAG_BINARY : 0) |
+                                         (options.keep_case ? cipher::CONTAINER_FLAG_KEEP_CASE : 0) |
+                                         (options.checksum ? cipher::CONTAINER_FLAG_CHECKSUM : 0));
+    const BlockTransform transform = MakeChunkTransform(options, cipherkey, header.flags);
+    std::vector<uint32_t> written_crcs;
+    const size_t chunks_written = options.resume ?
+        ResumableChunks(options, header, input_path, output_path, written_crcs) : 0U;
+    if (chunks_written == std::numeric_limits<size_t>::max())
+    {
+        return;
+    }
+
+    std::ifstream infile;
+    if (input_path != nullptr)
+    {
+        infile.open(input_path, std::ios::binary);
+    }
+    std::istream& input_file = (input_path != nullptr) ? infile : std::cin;
+    if (!input_file)
+    {
+        throw std::runtime_error("input file could not be opened");
+    }
+
+    // A resumed container is cut back to its kept chunks and written on from there
+    std::ofstream outfile;
+    std::unique_ptr<ContainerWriter> writer;
+    if (chunks_written > 0)
+    {
+        const size_t kept_size = cipher::EncodeContainerHeader(header).size() + (chunks_written * header.chunk_size);
+        if (truncate(output_path, static_cast<off_t>(kept_size)) != 0)
+        {
+            throw std::runtime_error("output file could not be resized");
+        }
+        outfile.open(output_path, std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+        input_file.seekg(static_cast<std::streamoff>(chunks_written * header.chunk_size));
+        writer.reset(new ContainerWriter(outfile, header, chunks_written, written_crcs.data()));
+    }
+    else
+    {
+        if (output_path != nullptr)
+        {
+            outfile.open(output_path, std::ios::binary);
+        }
+        writer.reset(new ContainerWriter((output_path != nullptr) ? outfile : std::cout, header));
+    }
+    if ((output_path != nullptr) && !outfile)
+    {
+        throw std::runtime_error("output file could not be opened");
+    }
+
+    std::unique_ptr<ThreadPool> pool;
+    if (options.num_threads != 1)
+    {
+        pool.reset(new ThreadPool(options.num_threads));
+    }
+    ThrowIfError(cipher::WriteContainer(input_file, *writer,
+        [&transform](const char* input, char* output, const size_t length)
+        {
+            return transform(input, output, length, 0);
+        }, pool.get(), options.binary), "", "plaintext");
+}
+
+/**
+ * Decrypt a chunked container, or only a window of it
+ * Only the chunks that hold the window are read, and they are decrypted
+ * on -j threads. The chunk size, binary and case-preserving mode are taken
+ * from the container. With --verify, each thread checks the CRC32C of a
+ * chunk before decrypting it.
+ * @param[in]   options - Method, key and window from the command line
+ * @param[in]   cipherkey - The cipher key, with trailing whitespace removed
+ * @param[in]   input_path - The container
+ * @param[in]   output_path - File to write the payload to, or null for stdout
+ * @throw   If the container can't be mapped or is damaged, the key is wrong, or the text is invalid
+ */
+static void ReadContainerFile(const CipherOptions& options,
+                              const std::string& cipherkey,
+                              const char* input_path,
+                              const char* output_path)
+{
+    MappedInput input;
+    if ((input_path == nullptr) || !input.Open(input_path))
+    {
+        throw std::runtime_error("--container needs an input file that can be mapped to decrypt");
+    }
+    const ContainerReader reader(input.Data(), input.Size());
+    const ContainerHeader& header = reader.Header();
+    if (header.method != cipher::ContainerMethodName(options.method))
+    {
+        throw std::runtime_error("the container was written with method \"" + header.method + "\"");
+    }
+    else if (header.fingerprint != cipher::ContainerFingerprint(options.method, cipherkey))
+    {
+        throw std::runtime_error("the container was written with a different key");
+    }
+    else if (options.verify && !reader.HasChecksums())
+    {
+        throw std::runtime_error("the container has no checksums to verify");
+    }
+    const BlockTransform transform = MakeChunkTransform(options, cipherkey, header.flags);
+    const bool binary = ((header.flags & cipher::CONTAINER_FLAG_BINARY) != 0);
+
+    // The window is clipped to the payload
+    const size_t chunk_size = static_cast<size_t>(header.chunk_size);
+    const size_t length = static_cast<size_t>(reader.PayloadLength());
+    const size_t offset = std::min(options.range_offset, length);
+    const size_t count = std::min(options.range_length, length - offset);
+    const size_t first_chunk = offset / chunk_size;
+    const size_t end_chunk = (count == 0) ? first_chunk : (((offset + count - 1) / chunk_size) + 1);
+
+    std::ofstream outfile;
+    if (output_path != nullptr)
+    {
+        outfile.open(output_path, std::ios::binary);
+    }
+    std::ostream& output_file = (output_path != nullptr) ? outfile : std::cout;
+    if (!output_file)
+    {
+        throw std::runtime_error("output file could not be opened");
+    }
+
+    // Decrypt a batch of chunks for every thread at a time, and write them in order
+    std::unique_ptr<ThreadPool> pool;
+    if (options.num_threads != 1)
+    {
+        pool.reset(new ThreadPool(options.num_threads));
+    }
+    const size_t batch_chunks = cipher::ContainerBatchChunks(chunk_size, (pool != nullptr) ? pool->Size() : 1U);
+    std::vector<std::string> plaintext(batch_chunks);
+    std::vector<CipherResult> results(batch_chunks);
+    std::vector<char> intact(batch_chunks);
+    for (size_t batch = first_chunk; batch < end_chunk; batch += batch_chunks)
+    {
+        const size_t batch_count = std::min(batch_chunks, end_chunk - batch);
+        const auto decrypt_chunk = [&](const size_t index)
+        {
+            intact[index] = !options.verify || reader.ChunkIntact(batch + index);
+            plaintext[index].resize(reader.ChunkLength(batch + index));
+            results[index] = transform(reader.ChunkData(batch + index), &plaintext[index][0],
+                                       reader.ChunkLength(batch + index), 0);
+        };
+        if (pool != nullptr)
+        {
+            pool->ParallelFor(batch_count, decrypt_chunk);
+        }
+        else
+        {
+            for (size_t index = 0; index < batch_count; ++index)
+            {
+                decrypt_chunk(index);
+            }
+        }
+
+        for (size_t index = 0; index < batch_count; ++index)
+        {
+            const size_t chunk_start = (batch + index) * chunk_size;
+            if (!intact[index])
+            {
+                throw std::runtime_error("chunk " + std::to_string(batch + index) +
+                                         " of the container is damaged (CRC32C mismatch)");
+            }
+            results[index].offset += chunk_start;
+            ThrowIfError(results[index], "", TextName(options));
+            const size_t begin = std::max(offset, chunk_start) - chunk_start;
+            const size_t end = std::min(offset + count, chunk_start + plaintext[index].size()) - chunk_start;
+            output_file.write(plaintext[index].data() + begin, static_cast<std::streamsize>(end - begin));
+        }
+    }
+    if (!binary)
+    {
+        output_file << '\n';
+    }
+    output_file.flush();
+}
+
+/**
+ * Run the cipher over one file through io_uring, if asked for and possible
+ * Only ciphers that work letter by letter can take chunks in any order,
+ * and not in case-preserving mode, where the key phase counts letters.
+ * Each thread keeps its own ring and buffers between files.
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   transform - The cipher, from MakeBlockTransform
+ * @param[in]   input_path - File to read the input text from
+ * @param[in]   output_path - File to write the result to
+ * @return  False if the file should go through the other paths instead
+ * @throw   If the output could not be opened, a read or write failed, or the text is invalid
+ */
+static bool TransformFileUring(const CipherOptions& options,
+                               const BlockTransform& transform,
+                               const char* input_path,
+                               const char* output_path)
+{
+    if (!options.io_uring || IsTransposition(options.method) || options.keep_case)
+    {
+        return false;
+    }
+    thread_local std::unique_ptr<UringTransformer> transformer;
+    if (!transformer)
+    {
+        transformer.reset(new UringTransformer(cipher::URING_CHUNK_SIZE, options.direct_io));
+    }
+    if (!transformer->Open(input_path, output_path))
+    {
+        return false;
+    }
+    ThrowIfError(transformer->Run(transform, options.binary), "", TextName(options));
+    return true;
+}
+
+/**
+ * Run the cipher over one file, mapping it when possible
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   cipherkey - The cipher key, with trailing whitespace removed
+ * @param[in]   transform - The cipher, from MakeBlockTransform
+ * @param[in]   input_path - File to read the input text from
+ * @param[in]   output_path - File to write the result to
+ * @param[in,out]   scratch - Buffer for output that can't be mapped, reused between calls
+ * @throw   If either file could not be opened, or the text is invalid
+ */
+static void TransformFile(const CipherOptions& options,
+                          const std::string& cipherkey,
+                          const BlockTransform& transform,
+                          const char* input_path,
+                          const char* output_path,
+                          std::string& scratch)
+{
+    // Neither io_uring nor the mappings can read and write one file at once
+    const bool same_file = cipher::IsSameFile(input_path, output_path);
+    MappedInput mapped_input;
+    if (!same_file && TransformFileUring(options, transform, input_path, output_path))
+    {
+        return;
+    }
+    else if (!same_file && mapped_input.Open(input_path))
+    {
+        TransformMappedFile(options, transform, mapped_input, output_path, scratch);
+    }
+    else
+    {
+        // Don't create the output if there is no input
+        std::ifstream infile(input_path);
+        if (!infile)
+        {
+            throw std::runtime_error("input file could not be opened");
+        }
+        std::ofstream outfile(output_path);
+        TransformStream(options, cipherkey, transform, infile, outfile);
+    }
+}
+
+/**
+ * Compile the cipher and run it over one input
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   input_path - File to read the input text from, or null for stdin
+ * @param[in]   output_path - File to write the result to, or null for stdout
+ * @return  0 on success, 1 on error
+ */
+static int32_t ExecuteCipher(const CipherOptions& options,
+                             const char* input_path,
+                             const char* output_path)
+{
+    // End result return code
+    int32_t retval = 0;
+
+    try
+    {
+        std::string cipherkey(options.cipherkey);
+        (void)cipher::rtrim(cipherkey);
+
+        // A container compiles its own cipher for each chunk
+        const BlockTransform transform = options.container ? BlockTransform() : MakeBlockTransform(options, cipherkey);
+        if (!options.container && !transform)
+        {
+            throw std::runtime_error("method \"" + options.method + "\" not supported.");
+        }
+
+        // Map the input file when possible, otherwise use streams
+        std::string scratch;
+        MappedInput mapped_input;
+        if (options.container && options.decrypt_flag)
+        {
+            ReadContainerFile(options, cipherkey, input_path, output_path);
+        }
+        else if (options.container)
+        {
+            WriteContainerFile(options, cipherkey, input_path, output_path);
+        }
+        else if (options.range)
+        {
+            // Only a mapping lets the window be read without the rest of the file
+            if ((input_path == nullptr) || !mapped_input.Open(input_path))
+            {
+                throw std::runtime_error("--offset and --length need an input file that can be mapped");
+            }
+            DecryptMappedRange(options, cipherkey, transform, mapped_input, output_path);
+        }
+        else if ((input_path != nullptr) && (output_path != nullptr))
+        {
+            TransformFile(options, cipherkey, transform, input_path, output_path, scratch);
+        }
+        else if ((input_path != nullptr) && mapped_input.Open(input_path))
+        {
+            TransformMappedFile(options, transform, mapped_input, output_path, scratch);
+        }
+        // Use both stdin and stdout
+        else if ((input_path == nullptr) && (output_path == nullptr))
+        {
+            TransformStream(options, cipherkey, transform, std::cin, std::cout);
+        }
+        // Use stdin for input and file for output
+        else if (input_path == nullptr)
+        {
+            std::ofstream outfile(output_path);
+            TransformStream(options, cipherkey, transform, std::cin, outfile);
+        }
+        // Use file for input and stdout for output
+        else
+        {
+            std::ifstream infile(input_path);
+            TransformStream(options, cipherkey, transform, infile, std::cout);
+        }
+    }
+    // Catch any exceptions from running the cipher
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        retval = 1;
+    }
+    return retval;
+}
+
+/**
+ * Read a batch list of jobs
+ * Each line holds an input path and an output path, separated by a tab
+ * (or, if there is no tab, by the first run of spaces). Blank lines and
+ * lines starting with '#' are skipped.
+ * @param[in]   list_file - Stream to read the list from
+ * @param[out]  jobs - Input and output path of each job, in list order
+ */
+static void ReadBatchList(std::istream& list_file, std::vector<BatchJob>& jobs)
+{
+    std::string line;
+    while (std::getline(list_file, line))
+    {
+        (void)cipher::trim(line);
+        if (line.empty() || (line[0] == '#'))
+        {
+            continue;
+        }
+        size_t split = line.find('\t');
+        size_t next = split;
+        if (split == std::string::npos)
+        {
+            split = line.find(' ');
+            next = split;
+        }
+        if (split != std::string::npos)
+        {
+            next = line.find_first_not_of(" \t", split);
+        }
+        jobs.push_back(BatchJob{line.substr(0, split),
+                                (next == std::string::npos) ? std::string() : line.substr(next)});
+    }
+}
+
+/**
+ * List a job for every regular file under a directory tree
+ * The output tree mirrors the input tree; its directories are created here.
+ * @param[in]   input_dir - Directory to search
+ * @param[in]   output_dir - Directory to write the results to
+ * @param[out]  jobs - Jobs found, appended in directory order
+ * @throw   If a directory can't be read or created
+ */
+static void ListDirectoryJobs(const std::string& input_dir, const std::string& output_dir, std::vector<BatchJob>& jobs)
+{
+    DIR* directory = opendir(input_dir.c_str());
+    if (directory == nullptr)
+    {
+        throw std::runtime_error("input directory \"" + input_dir + "\" could not be opened");
+    }
+    if ((mkdir(output_dir.c_str(), 0777) != 0) && (errno != EEXIST))
+    {
+        (void)closedir(directory);
+        throw std::runtime_error("output directory \"" + output_dir + "\" could not be created");
+    }
+
+    std::vector<std::string> names;
+    for (const dirent* entry = readdir(directory); entry != nullptr; entry = readdir(directory))
+    {
+        const std::string name(entry->d_name);
+        if ((name != ".") && (name != ".."))
+        {
+            names.push_back(name);
+        }
+    }
+    (void)closedir(directory);
+    std::sort(names.begin(), names.end());
+
+    for (const std::string& name : names)
+    {
+        const std::string input_path = input_dir + "/" + name;
+        const std::string output_path = output_dir + "/" + name;
+        struct stat file_stat;
+        if (stat(input_path.c_str(), &file_stat) != 0)
+        {
+            continue;
+        }
+        else if (S_ISDIR(file_stat.st_mode))
+        {
+            ListDirectoryJobs(input_path, output_path, jobs);
+        }
+        else if (S_ISREG(file_stat.st_mode))
+        {
+            jobs.push_back(BatchJob{input_path, output_path});
+        }
+    }
+}
+
+/**
+ * Run the cipher over a batch of files on a thread pool
+ * The key is checked once up front, and each job compiles its own copy of
+ * the cipher. A failed job is reported without stopping the others, and
+ * its output file is removed so no partial result is left behind.
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   jobs - Input and output path of each job
+ * @return  0 if every job succeeded, 1 otherwise
+ */
+static int32_t ExecuteBatch(const CipherOptions& options, const std::vector<BatchJob>& jobs)
+{
+    // Threads are spent on separate files, so each file is transformed on one thread
+    CipherOptions job_options(options);
+    job_options.num_threads = 1;
+
+    std::string cipherkey(options.cipherkey);
+    (void)cipher::rtrim(cipherkey);
+    BlockTransform transform;
+    try
+    {
+        transform = MakeBlockTransform(job_options, cipherkey);
+        if (!transform)
+        {
+            throw std::runtime_error("method \"" + options.method + "\" not supported.");
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Idle threads claim the next job, so long and short files balance out.
+    // Each file gets its own copy of the cipher, since a case-preserving
+    // Vigenere transform keeps the key phase of the one file it works through.
+    std::vector<std::string> errors(jobs.size());
+    ThreadPool pool(options.num_threads);
+    pool.ParallelFor(jobs.size(), [&](const size_t index)
+    {
+        thread_local std::string scratch;
+        const BatchJob& job = jobs[index];
+        // A job writing over its own input can't remove its output
+        const bool same_file = cipher::IsSameFile(job.input_path.c_str(), job.output_path.c_str());
+        try
+        {
+            if (job.output_path.empty())
+            {
+                throw std::runtime_error("no output file given");
+            }
+            TransformFile(job_options, cipherkey, MakeBlockTransform(job_options, cipherkey),
+                          job.input_path.c_str(), job.output_path.c_str(), scratch);
+        }
+        catch (const std::exception& e)
+        {
+            errors[index] = e.what();
+            if (!job.output_path.empty() && !same_file)
+            {
+                (void)unlink(job.output_path.c_str());
+            }
+        }
+    });
+
+    // Report failures in list order
+    size_t failures = 0U;
+    for (size_t index = 0; index < jobs.size(); ++index)
+    {
+        if (!errors[index].empty())
+        {
+            std::cerr << "Error: " << jobs[index].input_path << ": " << errors[index] << std::endl;
+            ++failures;
+        }
+    }
+    if (failures != 0)
+    {
+        std::cerr << "Error: " << failures << " of " << jobs.size() << " jobs failed" << std::endl;
+    }
+    return (failures == 0) ? 0 : 1;
+}
+
 
 /**
- * Read data from the file into string
- * If the file is empty or can't be opened, empty string is returned
+ * Run one job with a compiled cipher
+ * Trailing whitespace of the payload is ignored.
+ * @param[in]   entry - The compiled cipher, from KeyCache
+ * @param[in]   record - The job; its payload is the text to transform
+ * @param[out]  text - The output text, or the error message
+ * @return  True if text is output text
  */
-static void ReadFromFile(const std::istream& input_file, std::string& output_str)
+static bool RunCipherJob(const KeyCache::Entry& entry, const ManifestRecord& record, std::string& text)
 {
-    std::stringstream buffer;
-    buffer << input_file.rdbuf();
-    output_str = buffer.str();
+    if (!entry.transform)
+    {
+        text = entry.error;
+        return false;
+    }
+    const std::string& payload = record.payload;
+    const size_t length = TrimmedEnd(payload.data(), 0, payload.size());
+    text.resize(length);
+    const CipherResult result = entry.transform(payload.data(), &text[0], length, 0);
+    if (!result.Ok())
+    {
+        try
+        {
+            ThrowIfError(result, "", record.decrypt ? "ciphertext" : "plaintext");
+        }
+        catch (const std::exception& e)
+        {
+            text = e.what();
+        }
+    }
+    return result.Ok();
 }
 
 /**
- *
+ * Run every record of a JSON Lines manifest and write one result line per record
+ * Records are read in windows of MANIFEST_WINDOW, run in parallel on a
+ * thread pool, then written in manifest order. Compiled keys are cached
+ * across records, so records sharing a method and key compile it once.
+ * A bad record gives an error line without stopping the others.
+ * @param[in]   options - Flags from the command line; method and key come from each record
+ * @param[in]   manifest_file - Stream to read the manifest from
+ * @param[out]  output_file - Stream to write the results to
+ * @return  0 if every record succeeded, 1 otherwise
  */
-static int32_t ExecuteCipher(const std::string& method,
-                             std::string& cipherkey,
-                             std::istream& input_file,
-                             std::ostream& output_file,
-                             bool decrypt_flag)
+static int32_t ExecuteManifest(const CipherOptions& options, std::istream& manifest_file, std::ostream& output_file)
 {
-    // End result return code
-    int32_t retval = 0;
+    KeyCache key_cache(options, MANIFEST_KEY_CACHE_SIZE);
 
-    // Input checking
-    if (!output_file)
-    {
-        std::cerr << "Error: output file could not be opened" << std::endl;
-        retval = 1;
-    }
-    else if (!input_file)
+    struct ManifestJob
     {
-        std::cerr << "Error: input file could not be opened" << std::endl;
-        retval = 1;
-    }
-    else
+        ManifestRecord record;                          // The parsed record
+        std::shared_ptr<const KeyCache::Entry> cipher;  // Compiled cipher, or null if the record could not be parsed
+        std::string result;                             // The output text, or the error message
+        bool ok;                                        // True if result is output text
+    };
+    std::vector<ManifestJob> window;
+    window.reserve(MANIFEST_WINDOW);
+
+    ThreadPool pool(options.num_threads);
+    size_t failures = 0U;
+    bool reading = true;
+    while (reading)
     {
-        try
+        // Parse a window of records and look up their ciphers, on this thread
+        window.clear();
+        std::string line;
+        while ((window.size() < MANIFEST_WINDOW) && std::getline(manifest_file, line))
         {
-            // Input
-            std::string plaintext;
-            ReadFromFile(input_file, plaintext);
-            (void)cipher::rtrim(plaintext);
-            (void)cipher::rtrim(cipherkey);
-
-            // Do the cipher
-            std::string ciphertext;
-            if (method == "vigenere")
+            if (cipher::trim(line).empty())
             {
-                if (decrypt_flag)
-                {
-                    DecryptVigenereAlpha(cipherkey, plaintext, ciphertext);
-                }
-                else
-                {
-                    EncryptVigenereAlpha(cipherkey, plaintext, ciphertext);
-                }
+                continue;
             }
-            else if (method == "caesar")
+            window.push_back(ManifestJob{ManifestRecord(), nullptr, std::string(), false});
+            ManifestJob& job = window.back();
+            try
             {
-                if (decrypt_flag)
-                {
-                    DecryptCaesarAlpha(cipherkey[0], plaintext, ciphertext);
-                }
-                else
-                {
-                    EncryptCaesarAlpha(cipherkey[0], plaintext, ciphertext);
-                }
+                job.record = ParseManifestRecord(line);
+                job.cipher = key_cache.Get(job.record.method, job.record.key, job.record.decrypt);
             }
-            else if (method == "railfence")
+            catch (const std::exception& e)
             {
-                // Determine the correct key
-                // In this case, the number of rails
-                size_t num_rails = 0U;
-                char num_rails_char = cipherkey[0];
-                if ((num_rails_char > '0') && (num_rails_char <= '9'))
-                {
-                    num_rails = static_cast<size_t>(num_rails_char - '0');
-                }
-                else
-                {
-                    throw std::runtime_error(std::string("Bad key \"") + cipherkey + "\"; key for rail fence cipher is a number 0-9.");
-                }
+                job.result = e.what();
+            }
+        }
 
-                if (decrypt_flag)
-                {
-                    DecryptRailFenceAlpha(num_rails, plaintext, ciphertext);
-                }
-                else
-                {
-                    EncryptRailFenceAlpha(num_rails, plaintext, ciphertext);
-                }
+        reading = (window.size() == MANIFEST_WINDOW);
+
+        // Run the window
+        pool.ParallelFor(window.size(), [&window](const size_t index)
+        {
+            ManifestJob& job = window[index];
+            if (job.cipher)
+            {
+                job.ok = RunCipherJob(*job.cipher, job.record, job.result);
             }
-            else if (method == "scytale")
+        });
+
+        // Write the results in manifest order
+        for (const ManifestJob& job : window)
+        {
+            output_file << cipher::ManifestResultLine(job.ok, job.result) << '\n';
+            failures += job.ok ? 0U : 1U;
+        }
+    }
+    output_file.flush();
+    return (failures == 0) ? 0 : 1;
+}
+
+/** The running server, for the signal handler */
+static CipherServer* running_server = nullptr;
+
+/** Stop the server on SIGINT or SIGTERM, so the socket file is removed */
+static void StopServer(int)
+{
+    if (running_server != nullptr)
+    {
+        running_server->Stop();
+    }
+}
+
+/**
+ * Serve cipher requests on a Unix domain socket until interrupted
+ * Each request carries its own method, key and direction. Compiled keys
+ * are kept between requests, so repeated keys are only compiled once.
+ * @param[in]   options - Flags from the command line; num_threads sets the worker count
+ * @param[in]   socket_path - Filesystem path to listen on
+ * @return  0 after a clean shutdown, 1 if the server could not start
+ */
+static int32_t ExecuteServer(const CipherOptions& options, const std::string& socket_path)
+{
+    try
+    {
+        KeyCache key_cache(options, SERVER_KEY_CACHE_SIZE);
+        CipherServer server([&key_cache](const ManifestRecord& request, std::string& text)
+        {
+            const std::shared_ptr<const KeyCache::Entry> entry =
+                key_cache.Get(request.method, request.key, request.decrypt);
+            return RunCipherJob(*entry, request, text);
+        }, options.num_threads);
+        server.Listen(socket_path);
+
+        running_server = &server;
+        (void)std::signal(SIGINT, StopServer);
+        (void)std::signal(SIGTERM, StopServer);
+        server.Run();
+        running_server = nullptr;
+    }
+    catch (const std::exception& e)
+    {
+        running_server = nullptr;
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Send the input to a server as one request and write the result
+ * @param[in]   options - Method, key and flags from the command line
+ * @param[in]   input_path - File to read the input text from, or null for stdin
+ * @param[in]   output_path - File to write the result to, or null for stdout
+ * @return  0 if successful, 1 otherwise
+ */
+static int32_t ExecuteClient(const CipherOptions& options, const char* input_path, const char* output_path)
+{
+    try
+    {
+        ManifestRecord request = ManifestRecord();
+        request.method = options.method;
+        request.key = options.cipherkey;
+        request.decrypt = options.decrypt_flag;
+        std::ifstream input_file;
+        if (input_path != nullptr)
+        {
+            input_file.open(input_path);
+            if (!input_file)
             {
-                // Determine the correct key
-                // In this case, the width of the rows
-                size_t row_width = 0U;
-                char row_width_char = cipherkey[0];
-                if ((row_width_char > '0') && (row_width_char <= '9'))
-                {
-                    row_width = static_cast<size_t>(row_width_char - '0');
-                }
-                else
-                {
-                    throw std::runtime_error(std::string("Bad key \"") + cipherkey + "\"; key for scytale cipher is a number 0-9.");
-                }
+                throw std::runtime_error("input file could not be opened");
+            }
+        }
+        ReadFromFile((input_path != nullptr) ? input_file : std::cin, request.payload);
 
-                if (decrypt_flag)
-                {
-                    DecryptScytaleAlpha(row_width, plaintext, ciphertext);
-                }
-                else
+        CipherClient client;
+        client.Connect(options.client);
+        std::string text;
+        if (!client.Call(request, text))
+        {
+            throw std::runtime_error(text);
+        }
+
+        std::ofstream output_file;
+        if (output_path != nullptr)
+        {
+            output_file.open(output_path);
+        }
+        std::ostream& output_stream = (output_path != nullptr) ? output_file : std::cout;
+        if (!output_stream)
+        {
+            throw std::runtime_error("output file could not be opened");
+        }
+        output_stream << text << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Measure request latency against a running server
+ * Each connection sends its share of the requests one at a time and
+ * times every round trip. Throughput and latency percentiles are
+ * written to stdout.
+ * @param[in]   options - Method, key and flags from the command line;
+ *                        num_threads sets the number of connections
+ * @return  0 if every request succeeded, 1 otherwise
+ */
+static int32_t ExecuteBenchmark(const CipherOptions& options)
+{
+    const size_t connections = (options.num_threads == 0)
+        ? std::max(1U, std::thread::hardware_concurrency())
+        : options.num_threads;
+    const size_t requests = std::max(options.bench_requests, connections);
+
+    ManifestRecord request = ManifestRecord();
+    request.method = options.method;
+    request.key = options.cipherkey;
+    request.decrypt = options.decrypt_flag;
+    request.payload.resize(options.bench_payload);
+    for (size_t index = 0; index < request.payload.size(); ++index)
+    {
+        request.payload[index] = static_cast<char>('A' + (index % 26));
+    }
+
+    // Nanoseconds for each round trip, and the first error per connection
+    std::vector<uint64_t> latencies(requests);
+    std::vector<std::string> errors(connections);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t connection = 0; connection < connections; ++connection)
+    {
+        threads.emplace_back([&, connection]()
+        {
+            try
+            {
+                CipherClient client;
+                client.Connect(options.bench);
+                std::string text;
+                for (size_t index = connection; index < requests; index += connections)
                 {
-                    EncryptScytaleAlpha(row_width, plaintext, ciphertext);
+                    const std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+                    if (!client.Call(request, text))
+                    {
+                        throw std::runtime_error(text);
+                    }
+                    latencies[index] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - sent).count());
                 }
-
             }
-            else
+            catch (const std::exception& e)
             {
-                std::cerr << "Error: method \"" << method << "\" not supported." << std::endl;
-                retval = 1;
+                errors[connection] = e.what();
             }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-            // Output
-            output_file << ciphertext << std::endl;
-        }
-        // Catch any exceptions from running the cipher
-        catch (const std::exception& e)
+    for (const std::string& error : errors)
+    {
+        if (!error.empty())
         {
-            std::cerr << "Error: " << e.what() << std::endl;
-            retval = 1;
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
         }
     }
-    return retval;
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](const size_t percent)
+    {
+        return static_cast<double>(latencies[((latencies.size() - 1) * percent) / 100]) / 1000.0;
+    };
+    std::cout << "requests:    " << requests << " over " << connections << " connection(s), "
+              << options.bench_payload << " byte payload" << std::endl;
+    std::cout << "throughput:  " << static_cast<uint64_t>(requests / seconds) << " requests/s" << std::endl;
+    std::cout << "latency us:  p50 " << percentile(50) << "  p90 " << percentile(90)
+              << "  p99 " << percentile(99) << "  max " << percentile(100) << std::endl;
+    return 0;
 }
 
 
@@ -196,10 +1540,43 @@ int main(int32_t argc, char* const* argv)
 
     // Process arguments
     int32_t opt = 0;
-    std::string method;
-    std::string cipherkey;
-    bool decrypt_flag = false;
-    while ((opt = getopt(argc, argv, ":hvdm:k:")) != -1)
+    CipherOptions options;
+    options.decrypt_flag = false;
+    options.in_place = false;
+    options.num_threads = 1;
+    options.block_size = 0;
+    options.batch_directory = false;
+    options.bench_requests = BENCH_DEFAULT_REQUESTS;
+    options.bench_payload = BENCH_DEFAULT_PAYLOAD;
+    options.io_uring = false;
+    options.direct_io = false;
+    options.keep_case = false;
+    options.binary = false;
+    options.range = false;
+    options.range_offset = 0U;
+    options.range_length = std::numeric_limits<size_t>::max();
+    options.container = false;
+    options.resume = false;
+    options.checksum = false;
+    options.verify = false;
+    static const struct option long_options[] = {
+        {"serve",       required_argument, nullptr, OPTION_SERVE},
+        {"client",      required_argument, nullptr, OPTION_CLIENT},
+        {"bench",       required_argument, nullptr, OPTION_BENCH},
+        {"requests",    required_argument, nullptr, OPTION_REQUESTS},
+        {"payload",     required_argument, nullptr, OPTION_PAYLOAD},
+        {"io-uring",    no_argument,       nullptr, OPTION_URING},
+        {"direct",      no_argument,       nullptr, OPTION_DIRECT},
+        {"binary",      no_argument,       nullptr, OPTION_BINARY},
+        {"offset",      required_argument, nullptr, OPTION_OFFSET},
+        {"length",      required_argument, nullptr, OPTION_LENGTH},
+        {"container",   no_argument,       nullptr, OPTION_CONTAINER},
+        {"resume",      no_argument,       nullptr, OPTION_RESUME},
+        {"checksum",    no_argument,       nullptr, OPTION_CHECKSUM},
+        {"verify",      no_argument,       nullptr, OPTION_VERIFY},
+        {nullptr,       0,                 nullptr, 0},
+    };
+    while ((opt = getopt_long(argc, argv, ":hvdcirm:k:j:b:l:J:", long_options, nullptr)) != -1)
     {
         switch(opt)
         {
@@ -225,19 +1602,165 @@ int main(int32_t argc, char* const* argv)
             // m for METHOD
             case 'm':
             {
-                method = optarg;
+                options.method = optarg;
                 break;
             }
             // k for CIPHERKEY
             case 'k':
             {
-                cipherkey = optarg;
+                options.cipherkey = optarg;
                 break;
             }
             // d means decode/decrypt
             case 'd':
             {
-                decrypt_flag = true;
+                options.decrypt_flag = true;
+                break;
+            }
+            // c means keep case and pass non-letters through
+            case 'c':
+            {
+                options.keep_case = true;
+                break;
+            }
+            // i means transform in place
+            case 'i':
+            {
+                options.in_place = true;
+                break;
+            }
+            // j for number of threads
+            case 'j':
+            {
+                char* end = nullptr;
+                options.num_threads = static_cast<size_t>(strtoul(optarg, &end, 10));
+                if ((end == optarg) || (*end != '\0'))
+                {
+                    std::cerr << "Error: Bad thread count \"" << optarg << "\"." << std::endl;
+                    retval = 1;
+                }
+                break;
+            }
+            // b for block size
+            case 'b':
+            {
+                char* end = nullptr;
+                options.block_size = static_cast<size_t>(strtoull(optarg, &end, 10));
+                if ((end == optarg) || (*end != '\0') || (options.block_size == 0))
+                {
+                    std::cerr << "Error: Bad block size \"" << optarg << "\"." << std::endl;
+                    retval = 1;
+                }
+                break;
+            }
+            // l for a batch list of files
+            case 'l':
+            {
+                options.batch_list = optarg;
+                break;
+            }
+            // r for a batch of directory trees
+            case 'r':
+            {
+                options.batch_directory = true;
+                break;
+            }
+            // J for a JSON Lines manifest of jobs
+            case 'J':
+            {
+                options.manifest = optarg;
+                break;
+            }
+            // serve requests on a socket
+            case OPTION_SERVE:
+            {
+                options.serve = optarg;
+                break;
+            }
+            // send the input to a server
+            case OPTION_CLIENT:
+            {
+                options.client = optarg;
+                break;
+            }
+            // measure a server
+            case OPTION_BENCH:
+            {
+                options.bench = optarg;
+                break;
+            }
+            // requests and payload size for the benchmark
+            case OPTION_REQUESTS:
+            case OPTION_PAYLOAD:
+            {
+                char* end = nullptr;
+                const size_t value = static_cast<size_t>(strtoull(optarg, &end, 10));
+                if ((end == optarg) || (*end != '\0') || (value == 0))
+                {
+                    std::cerr << "Error: Bad " << ((opt == OPTION_REQUESTS) ? "request count" : "payload size")
+                              << " \"" << optarg << "\"." << std::endl;
+                    retval = 1;
+                }
+                (opt == OPTION_REQUESTS ? options.bench_requests : options.bench_payload) = value;
+                break;
+            }
+            // file I/O through io_uring, optionally bypassing the page cache
+            case OPTION_URING:
+            {
+                options.io_uring = true;
+                break;
+            }
+            case OPTION_DIRECT:
+            {
+                options.io_uring = true;
+                options.direct_io = true;
+                break;
+            }
+            // raw bytes instead of text
+            case OPTION_BINARY:
+            {
+                options.binary = true;
+                break;
+            }
+            // decrypt only a window of the input
+            case OPTION_OFFSET:
+            case OPTION_LENGTH:
+            {
+                char* end = nullptr;
+                const size_t value = static_cast<size_t>(strtoull(optarg, &end, 10));
+                if ((end == optarg) || (*end != '\0') || (optarg[0] == '-'))
+                {
+                    std::cerr << "Error: Bad " << ((opt == OPTION_OFFSET) ? "offset" : "length")
+                              << " \"" << optarg << "\"." << std::endl;
+                    retval = 1;
+                }
+                (opt == OPTION_OFFSET ? options.range_offset : options.range_length) = value;
+                options.range = true;
+                break;
+            }
+            // chunked container format
+            case OPTION_CONTAINER:
+            {
+                options.container = true;
+                break;
+            }
+            case OPTION_RESUME:
+            {
+                options.container = true;
+                options.resume = true;
+                break;
+            }
+            // chunk checksums
+            case OPTION_CHECKSUM:
+            {
+                options.container = true;
+                options.checksum = true;
+                break;
+            }
+            case OPTION_VERIFY:
+            {
+                options.container = true;
+                options.verify = true;
                 break;
             }
             // Option missing a value
@@ -257,20 +1780,76 @@ int main(int32_t argc, char* const* argv)
         }
     }
 
-    if (retval == 0)
+    const bool remote = !options.serve.empty() || !options.client.empty() || !options.bench.empty();
+    if ((retval == 0) && options.binary && (remote || !options.manifest.empty()))
+    {
+        // Requests and records carry text, not raw bytes
+        std::cerr << "Error: Binary mode is only for files and streams." << std::endl;
+        retval = 1;
+    }
+    else if ((retval == 0) && (options.range || options.container) && (remote || !options.manifest.empty() ||
+             !options.batch_list.empty() || options.batch_directory))
+    {
+        std::cerr << "Error: --offset, --length and --container are only for a single input file." << std::endl;
+        retval = 1;
+    }
+    else if ((retval == 0) && (options.resume || options.checksum) && options.decrypt_flag)
+    {
+        std::cerr << "Error: --resume and --checksum are only for writing a container." << std::endl;
+        retval = 1;
+    }
+    else if ((retval == 0) && options.verify && !options.decrypt_flag)
+    {
+        std::cerr << "Error: --verify is only for decrypting a container." << std::endl;
+        retval = 1;
+    }
+    else if ((retval == 0) && options.range && (!options.decrypt_flag || (options.keep_case && !options.container)))
+    {
+        // With -c the key phase depends on the letters before the window,
+        // so the window can't be found without reading them
+        std::cerr << "Error: --offset and --length need -d, and do not work with -c." << std::endl;
+        retval = 1;
+    }
+    else if ((retval == 0) && !options.serve.empty())
+    {
+        // Each request carries its own method and key
+        retval = ExecuteServer(options, options.serve);
+    }
+    else if ((retval == 0) && !options.manifest.empty())
+    {
+        // Each record carries its own method and key
+        std::ifstream manifest_file;
+        if (options.manifest != "-")
+        {
+            manifest_file.open(options.manifest);
+        }
+        std::istream& manifest_stream = (options.manifest != "-") ? manifest_file : std::cin;
+        if (!manifest_stream)
+        {
+            std::cerr << "Error: manifest could not be opened" << std::endl;
+            retval = 1;
+        }
+        else
+        {
+            retval = ExecuteManifest(options, manifest_stream, std::cout);
+        }
+    }
+    else if (retval == 0)
     {
         // Check for errors in arguments
-        if (method.empty())
+        // A chain carries a key for each of its stages
+        const bool missing_key = options.cipherkey.empty() && !IsCipherChain(options.method);
+        if (options.method.empty())
         {
             std::cerr << "Error: No method given." << std::endl;
             retval = 1;
         }
-        if (cipherkey.empty())
+        if (missing_key)
         {
             std::cerr << "Error: No cipherkey given." << std::endl;
             retval = 1;
         }
-        if (cipherkey.empty() || method.empty())
+        if (missing_key || options.method.empty())
         {
             std::cerr << "Try 'cipher -h' for more information." << std::endl;
         }
@@ -307,29 +1886,63 @@ int main(int32_t argc, char* const* argv)
                 }
             }
 
-            // Use both stdin and stdout
-            if (use_stdin && use_stdout)
+            const char* input_path = use_stdin ? nullptr : argv[optind];
+            const char* output_path = use_stdout ? nullptr : argv[optind + 1];
+            if (!options.client.empty())
+            {
+                retval = ExecuteClient(options, input_path, output_path);
+            }
+            else if (!options.bench.empty())
             {
-                retval = ExecuteCipher(method, cipherkey, std::cin, std::cout, decrypt_flag);
+                retval = ExecuteBenchmark(options);
             }
-            // Use stdin for input and file for output
-            else if (use_stdin)
+            else if (!options.batch_list.empty())
             {
-                std::ofstream outfile(argv[optind + 1]);
-                retval = ExecuteCipher(method, cipherkey, std::cin, outfile, decrypt_flag);
+                // Read the list of jobs from a file or stdin
+                std::vector<BatchJob> jobs;
+                std::ifstream list_file;
+                if (options.batch_list != "-")
+                {
+                    list_file.open(options.batch_list);
+                }
+                std::istream& list_stream = (options.batch_list != "-") ? list_file : std::cin;
+                if (!list_stream)
+                {
+                    std::cerr << "Error: batch list could not be opened" << std::endl;
+                    retval = 1;
+                }
+                else
+                {
+                    ReadBatchList(list_stream, jobs);
+                    retval = ExecuteBatch(options, jobs);
+                }
             }
-            // Use file for input and stdout for output
-            else if (use_stdout)
+            else if (options.batch_directory)
             {
-                std::ifstream infile(argv[optind]);
-                retval = ExecuteCipher(method, cipherkey, infile, std::cout, decrypt_flag);
+                // Every file under the input directory
+                std::vector<BatchJob> jobs;
+                if ((input_path == nullptr) || (output_path == nullptr))
+                {
+                    std::cerr << "Error: -r needs an input and an output directory." << std::endl;
+                    retval = 1;
+                }
+                else
+                {
+                    try
+                    {
+                        ListDirectoryJobs(input_path, output_path, jobs);
+                        retval = ExecuteBatch(options, jobs);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                        retval = 1;
+                    }
+                }
             }
-            // Use files for input and output
             else
             {
-                std::ifstream infile(argv[optind]);
-                std::ofstream outfile(argv[optind + 1]);
-                retval = ExecuteCipher(method, cipherkey, infile, outfile, decrypt_flag);
+                retval = ExecuteCipher(options, input_path, output_path);
             }
         }
     }
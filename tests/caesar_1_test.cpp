@@ -9,10 +9,26 @@ Description:
 
 /* ===== Includes ===== */
 #include <climits>
+#include <string_view>
 #include <gtest/gtest.h>
 #include "caesar_cipher.hpp"
 
 using cipher::EncryptCaesarAlpha;
+using cipher::DecryptCaesarAlpha;
+using cipher::CaesarKey;
+using cipher::EncryptCaesarBytes;
+using cipher::DecryptCaesarBytes;
+using cipher::EncryptCaesarMixed;
+using cipher::DecryptCaesarMixed;
+using cipher::TryEncryptCaesarAlpha;
+using cipher::TryDecryptCaesarAlpha;
+using cipher::CipherResult;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+using cipher::CaesarEncoder;
+using cipher::EncryptCaesarAlphaParallel;
+using cipher::DecryptCaesarAlphaParallel;
+using cipher::TryDecryptCaesarAlphaParallel;
+using cipher::ThreadPool;
 
 
 /* ===== Tests ===== */
@@ -25,3 +41,158 @@ TEST(Caesar, Identity1)
     EXPECT_EQ(plaintext, ciphertext);
 }
 
+// Shift every letter by one, wrapping Z around to A
+TEST(Caesar, ShiftB)
+{
+    const std::string plaintext("HELLOWORLDXYZ");
+    const std::string ciphercheck("IFMMPXPSMEYZA");
+    std::string ciphertext;
+    EncryptCaesarAlpha('B', plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, ciphercheck);
+}
+
+// Decrypting with the same key restores the plaintext
+TEST(Caesar, DecryptShiftB)
+{
+    const std::string plaintext("HELLOWORLDXYZ");
+    std::string ciphertext("IFMMPXPSMEYZA");
+    DecryptCaesarAlpha('B', ciphertext, ciphertext);
+    EXPECT_EQ(ciphertext, plaintext);
+}
+
+// Lower-case letters are rejected
+TEST(Caesar, RejectLowerCase)
+{
+    std::string ciphertext;
+    EXPECT_THROW(EncryptCaesarAlpha('B', "HELLOworld", ciphertext), std::runtime_error);
+}
+
+// The error names the text that was rejected
+TEST(Caesar, RejectNamesText)
+{
+    std::string output;
+    try
+    {
+        EncryptCaesarAlpha('B', "HELLO1", output);
+        FAIL() << "plaintext was not rejected";
+    }
+    catch (const std::runtime_error& e)
+    {
+        EXPECT_EQ(std::string(e.what()), "Non alphabet character 0x31 found in plaintext");
+    }
+    try
+    {
+        DecryptCaesarAlpha('B', "HELLO1", output);
+        FAIL() << "ciphertext was not rejected";
+    }
+    catch (const std::runtime_error& e)
+    {
+        EXPECT_EQ(std::string(e.what()), "Non alphabet character 0x31 found in ciphertext");
+    }
+}
+
+// A compiled key can be reused for encryption and decryption
+TEST(Caesar, CompiledKey)
+{
+    const CaesarKey cipherkey('N');
+    const std::string plaintext("HELLOWORLD");
+    std::string ciphertext;
+    EncryptCaesarAlpha(cipherkey, plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, "URYYBJBEYQ");
+    DecryptCaesarAlpha(cipherkey, ciphertext, ciphertext);
+    EXPECT_EQ(ciphertext, plaintext);
+    EXPECT_THROW(CaesarKey('n'), std::runtime_error);
+}
+
+// Case-preserving mode shifts letters of either case and copies everything else
+TEST(Caesar, MixedKeepsCase)
+{
+    const CaesarKey cipherkey('N');
+    const std::string plaintext("Hello, World! 123");
+    std::string ciphertext;
+    EncryptCaesarMixed(cipherkey, plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, "Uryyb, Jbeyq! 123");
+    DecryptCaesarMixed(cipherkey, ciphertext, ciphertext);
+    EXPECT_EQ(ciphertext, plaintext);
+}
+
+// Binary data is shifted modulo 256 and comes back unchanged
+TEST(Caesar, BytesRoundTrip)
+{
+    const CaesarKey cipherkey('C');
+    const std::string plaintext("\x00\xFE\xFF \n", 5);
+    std::string ciphertext;
+    EncryptCaesarBytes(cipherkey, plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, std::string("\x02\x00\x01\"\x0C", 5));
+    DecryptCaesarBytes(cipherkey, ciphertext, ciphertext);
+    EXPECT_EQ(ciphertext, plaintext);
+}
+
+// Views and raw buffers write into memory owned by the caller
+TEST(Caesar, CallerBuffer)
+{
+    const CaesarKey cipherkey('N');
+    char buffer[16] = {};
+    EXPECT_TRUE(TryEncryptCaesarAlpha(cipherkey, std::string_view("HELLOWORLD"), buffer).Ok());
+    EXPECT_EQ(std::string(buffer, 10), "URYYBJBEYQ");
+    EXPECT_TRUE(TryDecryptCaesarAlpha(cipherkey, buffer, buffer, 10).Ok());
+    EXPECT_EQ(std::string(buffer, 10), "HELLOWORLD");
+
+    const CipherResult result = TryEncryptCaesarAlpha(cipherkey, std::string_view("HELLO WORLD"), buffer);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 5U);
+
+    EncryptCaesarMixed(cipherkey, std::string_view("Hi, you"), buffer);
+    EXPECT_EQ(std::string(buffer, 7), "Uv, lbh");
+    EncryptCaesarBytes(cipherkey, std::string_view("\xFF", 1), buffer);
+    EXPECT_EQ(buffer[0], '\x0C');
+    DecryptCaesarBytes(cipherkey, std::string_view(buffer, 1), buffer);
+    EXPECT_EQ(buffer[0], '\xFF');
+}
+
+// Chunks give the same result as the whole message
+TEST(Caesar, EncoderChunks)
+{
+    const CaesarKey cipherkey('N');
+    CaesarEncoder encoder(cipherkey);
+    char buffer[16] = {};
+    EXPECT_TRUE(encoder.Update(std::string_view("HELLO"), buffer).Ok());
+    EXPECT_TRUE(encoder.Update(std::string_view("WORLD"), buffer + 5).Ok());
+    EXPECT_EQ(std::string(buffer, 10), "URYYBJBEYQ");
+    char scratch[4] = {};
+    const CipherResult result = encoder.Update(std::string_view("AB!"), scratch);
+    EXPECT_EQ(result.offset, 12U);
+    EXPECT_EQ(encoder.Finish(), 10U);
+
+    CaesarEncoder decoder(cipherkey, true);
+    EXPECT_TRUE(decoder.Update(buffer, buffer, 10).Ok());
+    EXPECT_EQ(std::string(buffer, 10), "HELLOWORLD");
+}
+
+// The parallel engine gives the same output as the serial one
+TEST(Caesar, ParallelMatchesSerial)
+{
+    ThreadPool pool(3);
+    std::string plaintext;
+    for (size_t index = 0; index < 500000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 11) % 26)));
+    }
+    const CaesarKey cipherkey('X');
+    std::string ciphercheck;
+    std::string ciphertext;
+    std::string decrypted;
+    EncryptCaesarAlpha(cipherkey, plaintext, ciphercheck);
+    EncryptCaesarAlphaParallel(cipherkey, plaintext, ciphertext, pool);
+    EXPECT_TRUE(ciphertext == ciphercheck);
+    DecryptCaesarAlphaParallel(cipherkey, ciphertext, decrypted, pool);
+    EXPECT_TRUE(decrypted == plaintext);
+
+    // The first invalid character is reported
+    ciphertext[400000] = '?';
+    ciphertext[450000] = '!';
+    const CipherResult result = TryDecryptCaesarAlphaParallel(cipherkey, ciphertext, decrypted, pool);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 400000U);
+    EXPECT_EQ(result.value, '?');
+}
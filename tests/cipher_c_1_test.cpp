@@ -0,0 +1,147 @@
+/************************************************************\
+Filename:   cipher_c_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the C interface of libcipher
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <cstring>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher.h"
+
+
+/* ===== Helpers ===== */
+
+/** Compile a key, failing the test if it is rejected */
+static cipher_key* CreateKey(const char* method, const char* key, const int flags = CIPHER_FLAG_NONE)
+{
+    cipher_key* compiled = nullptr;
+    EXPECT_EQ(cipher_key_create(method, key, flags, &compiled), CIPHER_RESULT_OK) << cipher_last_error();
+    return compiled;
+}
+
+/** Encrypt a text into a new buffer, then decrypt it in place, and return the ciphertext */
+static std::string RoundTrip(const cipher_key* key, const std::string& plaintext)
+{
+    std::string ciphertext(plaintext.size(), '\0');
+    EXPECT_EQ(cipher_encrypt(key, plaintext.data(), &ciphertext[0], plaintext.size()).status, CIPHER_RESULT_OK);
+    std::string decrypted(ciphertext);
+    EXPECT_EQ(cipher_decrypt(key, decrypted.data(), &decrypted[0], decrypted.size()).status, CIPHER_RESULT_OK);
+    EXPECT_EQ(decrypted, plaintext);
+    return ciphertext;
+}
+
+
+/* ===== Tests ===== */
+
+// Every method gives the same text as the cipher program
+TEST(CipherC, Methods)
+{
+    const std::string plaintext("WEAREDISCOVEREDFLEEATONCE");
+    const struct
+    {
+        const char* method;
+        const char* key;
+        const char* expected;
+    } cases[] = {
+        {"caesar", "N", "JRNERQVFPBIRERQSYRRNGBAPR"},
+        {"vigenere", "LEMON", "HIMFROMEQBGIDSQQPQSNESZQR"},
+        {"substitution", "ZEBRAS", "VAZOARFPBLUAOARSIAAZQLKBA"},
+        {"railfence", "3", "WECRLTEERDSOEEFEAOCAIVDEN"},
+        {"scytale", "5", "WDVFTEIELOASRENRCEECEODAE"},
+    };
+    for (const auto& test : cases)
+    {
+        cipher_key* key = CreateKey(test.method, test.key);
+        ASSERT_NE(key, nullptr) << test.method;
+        EXPECT_EQ(RoundTrip(key, plaintext), test.expected) << test.method;
+        cipher_key_free(key);
+    }
+}
+
+// A chain is compiled from its method alone
+TEST(CipherC, Chain)
+{
+    cipher_key* key = CreateKey("vigenere:LEMON,railfence:3", nullptr);
+    ASSERT_NE(key, nullptr);
+    const std::string ciphertext = RoundTrip(key, "WEAREDISCOVEREDFLEEATONCE");
+    EXPECT_EQ(ciphertext, "HRQDPERIFOEBISQQNSQMMGQSZ");
+    cipher_key_free(key);
+}
+
+// Bad text reports its offset, and bad keys, methods and flags are rejected with a message
+TEST(CipherC, Errors)
+{
+    cipher_key* key = CreateKey("caesar", "B");
+    char buffer[16] = {};
+    const cipher_result result = cipher_encrypt(key, "HELLO WORLD", buffer, 11);
+    EXPECT_EQ(result.status, CIPHER_RESULT_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 5U);
+    EXPECT_EQ(result.value, ' ');
+    EXPECT_EQ(cipher_decrypt(nullptr, "A", buffer, 1).status, CIPHER_RESULT_INVALID_ARGUMENT);
+    EXPECT_EQ(cipher_decrypt(key, nullptr, buffer, 1).status, CIPHER_RESULT_INVALID_ARGUMENT);
+    EXPECT_EQ(cipher_decrypt(key, nullptr, nullptr, 0).status, CIPHER_RESULT_OK);
+    cipher_key_free(key);
+    cipher_key_free(nullptr);
+
+    cipher_key* rejected = reinterpret_cast<cipher_key*>(buffer);
+    EXPECT_EQ(cipher_key_create("vigenere", "lemon", CIPHER_FLAG_NONE, &rejected), CIPHER_RESULT_INVALID_KEY);
+    EXPECT_EQ(rejected, nullptr);
+    EXPECT_NE(std::strlen(cipher_last_error()), 0U);
+    EXPECT_EQ(cipher_key_create("railfence", "0", CIPHER_FLAG_NONE, &rejected), CIPHER_RESULT_INVALID_KEY);
+    EXPECT_EQ(cipher_key_create("columnar", "3", CIPHER_FLAG_NONE, &rejected), CIPHER_RESULT_INVALID_KEY);
+    EXPECT_STREQ(cipher_last_error(), "method \"columnar\" not supported.");
+    EXPECT_EQ(cipher_key_create("substitution", "ZEBRAS", CIPHER_FLAG_BINARY, &rejected),
+              CIPHER_RESULT_INVALID_ARGUMENT);
+    EXPECT_EQ(cipher_key_create("caesar", "B", 4, &rejected), CIPHER_RESULT_INVALID_ARGUMENT);
+    EXPECT_EQ(cipher_key_create(nullptr, "B", CIPHER_FLAG_NONE, &rejected), CIPHER_RESULT_INVALID_ARGUMENT);
+
+    // A good key clears the message
+    key = CreateKey("caesar", "B");
+    EXPECT_STREQ(cipher_last_error(), "");
+    cipher_key_free(key);
+}
+
+// Case-preserving keys pass everything but letters through
+TEST(CipherC, KeepCase)
+{
+    cipher_key* key = CreateKey("vigenere", "LEMON", CIPHER_FLAG_KEEP_CASE);
+    EXPECT_EQ(RoundTrip(key, "Attack at dawn, 6am!"), "Lxfopv ef rnhr, 6ma!");
+    cipher_key_free(key);
+
+    key = CreateKey("railfence", "2", CIPHER_FLAG_KEEP_CASE);
+    EXPECT_EQ(RoundTrip(key, "Ab, cD!"), "Ac, bD!");
+    cipher_key_free(key);
+}
+
+// Binary keys cipher every byte, in place or not
+TEST(CipherC, Binary)
+{
+    std::string plaintext;
+    for (int value = 0; value < 256; ++value)
+    {
+        plaintext.push_back(static_cast<char>(value));
+    }
+    for (const char* method : {"caesar", "vigenere", "railfence", "scytale"})
+    {
+        cipher_key* key = CreateKey(method, (method[0] == 'c') || (method[0] == 'v') ? "KEY" : "7",
+                                    CIPHER_FLAG_BINARY);
+        const std::string ciphertext = RoundTrip(key, plaintext);
+        EXPECT_NE(ciphertext, plaintext) << method;
+
+        std::string text(plaintext);
+        EXPECT_EQ(cipher_encrypt(key, text.data(), &text[0], text.size()).status, CIPHER_RESULT_OK);
+        EXPECT_EQ(text, ciphertext) << method;
+        cipher_key_free(key);
+    }
+}
+
+// The version matches the one built into the library
+TEST(CipherC, Version)
+{
+    EXPECT_EQ(std::string(cipher_version()).substr(0, 2), "0.");
+}
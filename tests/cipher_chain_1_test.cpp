@@ -0,0 +1,137 @@
+/************************************************************\
+Filename:   cipher_chain_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for cipher chains
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cipher_chain.hpp"
+
+using cipher::ChainStage;
+using cipher::CipherChain;
+using cipher::CipherResult;
+using cipher::EncryptRailFenceAlpha;
+using cipher::EncryptScytaleAlpha;
+using cipher::EncryptSubstitutionAlpha;
+using cipher::EncryptVigenereAlpha;
+using cipher::ParseChain;
+using cipher::SubstitutionCipher;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+
+
+/* ===== Helpers ===== */
+
+/** Run a chain over a whole string */
+static std::string ApplyChain(const std::string& chain, const bool decrypt, const std::string& input)
+{
+    std::string output(input.size(), '\0');
+    cipher::ThrowIfError(CipherChain(chain, decrypt).Apply(input.data(), &output[0], input.size(), 0), "",
+                         decrypt ? "ciphertext" : "plaintext");
+    return output;
+}
+
+/** A long text of varied letters */
+static std::string LongText(const size_t length)
+{
+    std::string text(length, 'A');
+    for (size_t index = 0; index < length; ++index)
+    {
+        text[index] = static_cast<char>('A' + ((index * 7) + (index / 26)) % 26);
+    }
+    return text;
+}
+
+
+/* ===== Tests ===== */
+
+// Stages are split on commas and at the first colon
+TEST(CipherChain, Parse)
+{
+    const std::vector<ChainStage> stages = ParseChain("vigenere:KEY,railfence:5,scytale:7");
+    ASSERT_EQ(stages.size(), 3U);
+    EXPECT_EQ(stages[0].method, "vigenere");
+    EXPECT_EQ(stages[0].key, "KEY");
+    EXPECT_EQ(stages[2].method, "scytale");
+    EXPECT_EQ(stages[2].key, "7");
+
+    EXPECT_THROW(ParseChain("vigenere"), std::runtime_error);
+    EXPECT_THROW(ParseChain("vigenere:,railfence:5"), std::runtime_error);
+    EXPECT_THROW(ParseChain("vigenere:KEY,"), std::runtime_error);
+    EXPECT_THROW(CipherChain("vigenere:KEY,rot13:1", false), std::runtime_error);
+    EXPECT_THROW(CipherChain("railfence:0", false), std::runtime_error);
+}
+
+// A chain gives the same result as running each cipher in turn
+TEST(CipherChain, MatchesStages)
+{
+    const std::string plaintext = LongText(100000);
+    std::string expected;
+    std::string next;
+    EncryptVigenereAlpha("LEMON", plaintext, expected);
+    EncryptRailFenceAlpha(5, expected, next);
+    EncryptScytaleAlpha(7, next, expected);
+
+    const std::string chain = "vigenere:LEMON,railfence:5,scytale:7";
+    const std::string ciphertext = ApplyChain(chain, false, plaintext);
+    EXPECT_EQ(ciphertext, expected);
+    EXPECT_EQ(ApplyChain(chain, true, ciphertext), plaintext);
+}
+
+// Letter stages that fuse (shifts) and that don't (a substitution between shifts)
+TEST(CipherChain, FusedLetters)
+{
+    const std::string plaintext = LongText(50000);
+    std::string expected;
+    std::string next;
+    EncryptVigenereAlpha("LEMON", plaintext, next);
+    EncryptVigenereAlpha("B", next, expected);
+    EncryptVigenereAlpha("KEY", expected, next);
+    EXPECT_EQ(ApplyChain("vigenere:LEMON,caesar:B,vigenere:KEY", false, plaintext), next);
+
+    EncryptVigenereAlpha("LEMON", plaintext, expected);
+    EncryptSubstitutionAlpha(SubstitutionCipher::FromKeyword("ZEBRA"), expected, next);
+    EncryptVigenereAlpha("KEY", next, expected);
+    const std::string chain = "vigenere:LEMON,substitution:ZEBRA,vigenere:KEY";
+    EXPECT_EQ(ApplyChain(chain, false, plaintext), expected);
+    EXPECT_EQ(ApplyChain(chain, true, expected), plaintext);
+}
+
+// Input and output may be the same buffer, whatever the order of stages
+TEST(CipherChain, InPlace)
+{
+    const std::string plaintext = LongText(1000);
+    for (const char* chain : {"railfence:3", "railfence:3,scytale:4", "scytale:4,caesar:C,railfence:3",
+                              "caesar:C,railfence:3,vigenere:KEY,scytale:9"})
+    {
+        const std::string expected = ApplyChain(chain, false, plaintext);
+        std::string text = plaintext;
+        ASSERT_TRUE(CipherChain(chain, false).Apply(text.data(), &text[0], text.size(), 0).Ok());
+        EXPECT_EQ(text, expected) << chain;
+        ASSERT_TRUE(CipherChain(chain, true).Apply(text.data(), &text[0], text.size(), 0).Ok());
+        EXPECT_EQ(text, plaintext) << chain;
+    }
+}
+
+// The first invalid character is reported, whichever stage comes first
+TEST(CipherChain, Invalid)
+{
+    const std::string text = "HELLOWORLD hello";
+    std::string output(text.size(), '\0');
+    for (const char* chain : {"vigenere:KEY,railfence:3", "scytale:3,vigenere:KEY", "railfence:3,scytale:2"})
+    {
+        const CipherResult result = CipherChain(chain, false).Apply(text.data(), &output[0], text.size(), 0);
+        EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT) << chain;
+        EXPECT_EQ(result.offset, 10U) << chain;
+        EXPECT_EQ(result.value, ' ') << chain;
+    }
+
+    // A chain of scytales accepts any characters, like a single scytale
+    EXPECT_TRUE(CipherChain("scytale:3,scytale:5", false).Apply(text.data(), &output[0], text.size(), 0).Ok());
+}
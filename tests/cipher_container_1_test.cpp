@@ -0,0 +1,307 @@
+/************************************************************\
+Filename:   cipher_container_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the chunked container format
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cipher_container.hpp"
+#include "rail_fence_cipher.hpp"
+#include "vigenere_cipher.hpp"
+
+using cipher::CipherResult;
+using cipher::Crc32c;
+using cipher::ContainerBatchChunks;
+using cipher::ContainerFingerprint;
+using cipher::ContainerHeader;
+using cipher::ContainerMethodName;
+using cipher::ContainerReader;
+using cipher::ContainerWriter;
+using cipher::DecodeContainerHeader;
+using cipher::EncodeContainerHeader;
+using cipher::EncryptRailFenceAlpha;
+using cipher::ThreadPool;
+using cipher::TryRailFenceAlphaBlocked;
+using cipher::TryShiftVigenereAlphaAt;
+using cipher::VigenereKey;
+using cipher::WriteContainer;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+using cipher::CONTAINER_FLAG_CHECKSUM;
+using cipher::CONTAINER_MAX_CHUNK_SIZE;
+
+
+/* ===== Helpers ===== */
+
+/** A header for a rail fence container with the given chunk size */
+static ContainerHeader RailFenceHeader(const size_t chunk_size, const uint16_t flags = 0)
+{
+    ContainerHeader header = ContainerHeader();
+    header.method = "railfence";
+    header.fingerprint = ContainerFingerprint("railfence", "3");
+    header.chunk_size = chunk_size;
+    header.flags = flags;
+    return header;
+}
+
+/** Write text into a container, each chunk encrypted with 3 rails */
+static CipherResult WriteRailFence(const std::string& text,
+                                   const size_t chunk_size,
+                                   ThreadPool* pool,
+                                   std::string& container,
+                                   const uint16_t flags = 0)
+{
+    std::istringstream input(text);
+    std::ostringstream output;
+    ContainerWriter writer(output, RailFenceHeader(chunk_size, flags));
+    const CipherResult result = WriteContainer(input, writer,
+        [](const char* in, char* out, const size_t length)
+        {
+            return TryRailFenceAlphaBlocked<false>(3, in, out, length, nullptr);
+        }, pool, false);
+    container = output.str();
+    return result;
+}
+
+/** Decrypt every chunk of a rail fence container */
+static std::string ReadRailFence(const std::string& container)
+{
+    const ContainerReader reader(container.data(), container.size());
+    std::string text;
+    for (size_t index = 0; index < reader.ChunkCount(); ++index)
+    {
+        std::string chunk(reader.ChunkLength(index), '\0');
+        EXPECT_TRUE(TryRailFenceAlphaBlocked<true>(3, reader.ChunkData(index), &chunk[0],
+                                                   chunk.size(), nullptr).Ok());
+        text += chunk;
+    }
+    EXPECT_EQ(reader.PayloadLength(), text.size());
+    return text;
+}
+
+
+/* ===== Tests ===== */
+
+// A header comes back the same after encoding and decoding
+TEST(CipherContainer, HeaderRoundTrip)
+{
+    ContainerHeader header = ContainerHeader();
+    header.method = ContainerMethodName("vigenere:LEMON,railfence:3");
+    header.fingerprint = ContainerFingerprint("vigenere:LEMON,railfence:3", "");
+    header.chunk_size = 123456789012ULL;
+    header.flags = cipher::CONTAINER_FLAG_KEEP_CASE;
+    const std::string encoded = EncodeContainerHeader(header);
+
+    ContainerHeader decoded = ContainerHeader();
+    EXPECT_EQ(DecodeContainerHeader(encoded.data(), encoded.size(), decoded), encoded.size());
+    EXPECT_EQ(decoded.method, "vigenere,railfence");
+    EXPECT_EQ(decoded.fingerprint, header.fingerprint);
+    EXPECT_EQ(decoded.chunk_size, header.chunk_size);
+    EXPECT_EQ(decoded.flags, header.flags);
+
+    // Cut short, or not a container at all
+    EXPECT_THROW(DecodeContainerHeader(encoded.data(), encoded.size() - 1, decoded), std::runtime_error);
+    EXPECT_THROW(DecodeContainerHeader("HELLO", 5, decoded), std::runtime_error);
+}
+
+// The fingerprint depends on the method and key, but not on the key of a chain
+TEST(CipherContainer, Fingerprint)
+{
+    EXPECT_EQ(ContainerFingerprint("vigenere", "LEMON"), ContainerFingerprint("vigenere", "LEMON"));
+    EXPECT_NE(ContainerFingerprint("vigenere", "LEMON"), ContainerFingerprint("vigenere", "LEMOM"));
+    EXPECT_NE(ContainerFingerprint("vigenere", "LEMON"), ContainerFingerprint("caesar", "LEMON"));
+    EXPECT_NE(ContainerFingerprint("a", "bc"), ContainerFingerprint("ab", "c"));
+    EXPECT_EQ(ContainerFingerprint("caesar:B", "X"), ContainerFingerprint("caesar:B", "Y"));
+    EXPECT_EQ(ContainerMethodName("scytale"), "scytale");
+}
+
+// Every chunk size and thread count gives the same chunks, each transposed on its own
+TEST(CipherContainer, RoundTrip)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 10000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 7) % 26)));
+    }
+    ThreadPool pool(4);
+    for (const size_t chunk_size : {1U, 7U, 1000U, 9999U, 10000U, 20000U})
+    {
+        std::string serial;
+        std::string parallel;
+        EXPECT_TRUE(WriteRailFence(plaintext + " \n", chunk_size, nullptr, serial).Ok());
+        EXPECT_TRUE(WriteRailFence(plaintext, chunk_size, &pool, parallel).Ok());
+        EXPECT_EQ(serial, parallel) << "chunk size " << chunk_size;
+        EXPECT_EQ(ReadRailFence(serial), plaintext) << "chunk size " << chunk_size;
+
+        const ContainerReader reader(serial.data(), serial.size());
+        EXPECT_EQ(reader.ChunkCount(), (plaintext.size() + chunk_size - 1) / chunk_size);
+        std::string first;
+        EncryptRailFenceAlpha(3, plaintext.substr(0, chunk_size), first);
+        EXPECT_EQ(std::string(reader.ChunkData(0), reader.ChunkLength(0)), first);
+    }
+
+    // An empty payload has no chunks
+    std::string container;
+    EXPECT_TRUE(WriteRailFence("\n\n", 10, nullptr, container).Ok());
+    EXPECT_EQ(ContainerReader(container.data(), container.size()).ChunkCount(), 0U);
+}
+
+// An invalid letter is reported at its offset in the whole payload, and no index is written
+TEST(CipherContainer, InvalidText)
+{
+    std::string plaintext(5000, 'A');
+    plaintext[3210] = '!';
+    ThreadPool pool(3);
+    std::string container;
+    const CipherResult result = WriteRailFence(plaintext, 100, &pool, container);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 3210U);
+    EXPECT_EQ(result.value, '!');
+    EXPECT_THROW(ContainerReader(container.data(), container.size()), std::runtime_error);
+}
+
+// A container cut short or with a bad index is rejected
+TEST(CipherContainer, DamagedIndex)
+{
+    std::string container;
+    EXPECT_TRUE(WriteRailFence(std::string(1000, 'Q'), 64, nullptr, container).Ok());
+    EXPECT_NO_THROW(ContainerReader(container.data(), container.size()));
+    EXPECT_THROW(ContainerReader(container.data(), container.size() - 1), std::runtime_error);
+
+    // Change the offset recorded for the second chunk
+    const size_t header_size = EncodeContainerHeader(RailFenceHeader(64)).size();
+    std::string damaged(container);
+    damaged[header_size + 1000 + cipher::CONTAINER_ENTRY_SIZE] ^= 1;
+    EXPECT_THROW(ContainerReader(damaged.data(), damaged.size()), std::runtime_error);
+
+    // Two chunks of 2^63 bytes wrap the file position back to the start of a short last chunk
+    const uint64_t huge = 1ULL << 63;
+    const ContainerHeader wrap_header = RailFenceHeader(huge);
+    std::string wrapped = EncodeContainerHeader(wrap_header);
+    const uint64_t start = wrapped.size();
+    wrapped.append("ABCDEFGHIJ");
+    const uint64_t entries[][2] = {{start, huge}, {start + huge, huge}, {start, 10}};
+    for (const auto& entry : entries)
+    {
+        cipher::AppendLittleEndian(wrapped, entry[0], 8);
+        cipher::AppendLittleEndian(wrapped, entry[1], 8);
+    }
+    cipher::AppendLittleEndian(wrapped, 3, 8);
+    cipher::AppendLittleEndian(wrapped, start + 10, 8);
+    wrapped.append(cipher::CONTAINER_INDEX_MAGIC);
+    EXPECT_THROW(ContainerReader(wrapped.data(), wrapped.size()), std::runtime_error);
+}
+
+// A writer can carry on after the chunks already in a container
+TEST(CipherContainer, Resume)
+{
+    const VigenereKey key("LEMON");
+    std::string plaintext;
+    for (size_t index = 0; index < 999; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 5) % 26)));
+    }
+    const auto encrypt = [&key](const char* in, char* out, const size_t length)
+    {
+        return TryShiftVigenereAlphaAt(key.EncryptPeriod(), key.Period(), 0, in, out, length);
+    };
+    ContainerHeader header = ContainerHeader();
+    header.method = "vigenere";
+    header.fingerprint = ContainerFingerprint("vigenere", "LEMON");
+    header.chunk_size = 100;
+    header.flags = 0;
+
+    std::istringstream whole_input(plaintext);
+    std::ostringstream whole_output;
+    ContainerWriter whole_writer(whole_output, header);
+    EXPECT_TRUE(WriteContainer(whole_input, whole_writer, encrypt, nullptr, false).Ok());
+
+    // Keep the header and four chunks, then write the rest
+    const size_t kept = EncodeContainerHeader(header).size() + 400;
+    std::ostringstream resumed_output;
+    resumed_output << whole_output.str().substr(0, kept);
+    std::istringstream rest_input(plaintext.substr(400));
+    ContainerWriter resumed_writer(resumed_output, header, 4);
+    EXPECT_EQ(resumed_writer.PayloadLength(), 400U);
+    EXPECT_TRUE(WriteContainer(rest_input, resumed_writer, encrypt, nullptr, false).Ok());
+    EXPECT_EQ(resumed_output.str(), whole_output.str());
+}
+
+// Checksums are the same on any number of threads, and find a damaged chunk
+TEST(CipherContainer, Checksum)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 5000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 11) % 26)));
+    }
+    ThreadPool pool(3);
+    std::string serial;
+    std::string parallel;
+    EXPECT_TRUE(WriteRailFence(plaintext, 700, nullptr, serial, CONTAINER_FLAG_CHECKSUM).Ok());
+    EXPECT_TRUE(WriteRailFence(plaintext, 700, &pool, parallel, CONTAINER_FLAG_CHECKSUM).Ok());
+    EXPECT_EQ(serial, parallel);
+    EXPECT_EQ(ReadRailFence(serial), plaintext);
+
+    // Each index entry grows by the 4 byte checksum
+    std::string unchecked;
+    EXPECT_TRUE(WriteRailFence(plaintext, 700, nullptr, unchecked).Ok());
+    EXPECT_EQ(serial.size(), unchecked.size() + (8 * 4));
+    EXPECT_FALSE(ContainerReader(unchecked.data(), unchecked.size()).HasChecksums());
+    EXPECT_TRUE(ContainerReader(unchecked.data(), unchecked.size()).ChunkIntact(0));
+
+    const ContainerReader reader(serial.data(), serial.size());
+    EXPECT_TRUE(reader.HasChecksums());
+    ASSERT_EQ(reader.ChunkCount(), 8U);
+    for (size_t index = 0; index < reader.ChunkCount(); ++index)
+    {
+        EXPECT_TRUE(reader.ChunkIntact(index)) << "chunk " << index;
+    }
+
+    // Flip one bit in the third chunk
+    const size_t header_size = EncodeContainerHeader(RailFenceHeader(700, CONTAINER_FLAG_CHECKSUM)).size();
+    std::string damaged(serial);
+    damaged[header_size + (2 * 700) + 123] ^= 0x04;
+    const ContainerReader damaged_reader(damaged.data(), damaged.size());
+    for (size_t index = 0; index < damaged_reader.ChunkCount(); ++index)
+    {
+        EXPECT_EQ(damaged_reader.ChunkIntact(index), (index != 2)) << "chunk " << index;
+    }
+
+    // A writer carrying on is given the checksums of the chunks already written
+    std::ostringstream resumed_output;
+    resumed_output << serial.substr(0, header_size + (3 * 700));
+    std::istringstream rest_input(plaintext.substr(3 * 700));
+    std::vector<uint32_t> crcs;
+    for (size_t index = 0; index < 3; ++index)
+    {
+        crcs.push_back(Crc32c(reader.ChunkData(index), reader.ChunkLength(index)));
+    }
+    ContainerWriter resumed_writer(resumed_output, RailFenceHeader(700, CONTAINER_FLAG_CHECKSUM), 3, crcs.data());
+    EXPECT_TRUE(WriteContainer(rest_input, resumed_writer,
+        [](const char* in, char* out, const size_t length)
+        {
+            return TryRailFenceAlphaBlocked<false>(3, in, out, length, nullptr);
+        }, nullptr, false).Ok());
+    EXPECT_EQ(resumed_output.str(), serial);
+}
+
+// Batches are capped by bytes, and oversized chunks are refused
+TEST(CipherContainer, ChunkSizeLimit)
+{
+    EXPECT_EQ(ContainerBatchChunks(CONTAINER_MAX_CHUNK_SIZE, 64), 1U);
+    EXPECT_EQ(ContainerBatchChunks(1024 * 1024, 4), 8U);
+    EXPECT_EQ(ContainerBatchChunks(256 * 1024, 1000), 256U);
+
+    std::ostringstream output;
+    EXPECT_THROW(ContainerWriter(output, RailFenceHeader(0)), std::runtime_error);
+    EXPECT_THROW(ContainerWriter(output, RailFenceHeader(CONTAINER_MAX_CHUNK_SIZE + 1)), std::runtime_error);
+    EXPECT_NO_THROW(ContainerWriter(output, RailFenceHeader(CONTAINER_MAX_CHUNK_SIZE)));
+}
@@ -0,0 +1,92 @@
+/************************************************************\
+Filename:   cipher_crc32c_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the CRC32C checksums
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <cstdint>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_crc32c.hpp"
+
+using cipher::Crc32c;
+using cipher::Crc32cFunc;
+using cipher::Crc32cScalar;
+using cipher::GetCrc32cKernel;
+using cipher::simd::GetSimdLevel;
+using cipher::simd::SimdLevel;
+using cipher::simd::SIMD_LEVEL_SCALAR;
+
+
+/* ===== Helpers ===== */
+
+// Build a pseudo-random string of bytes of the given length
+static std::string MakeBytes(const size_t length, uint32_t seed)
+{
+    std::string bytes(length, '\0');
+    for (size_t index = 0; index < length; ++index)
+    {
+        seed = seed * 1103515245U + 12345U;
+        bytes[index] = static_cast<char>(seed >> 16);
+    }
+    return bytes;
+}
+
+
+/* ===== Tests ===== */
+
+// Known values from RFC 3720 and the usual check string
+TEST(CipherCrc32c, KnownValues)
+{
+    EXPECT_EQ(Crc32c("", 0), 0U);
+    EXPECT_EQ(Crc32c("123456789", 9), 0xE3069283U);
+    EXPECT_EQ(Crc32c(std::string(32, '\0').data(), 32), 0x8A9136AAU);
+    EXPECT_EQ(Crc32c(std::string(32, '\xFF').data(), 32), 0x62A8AB43U);
+
+    std::string ascending(32, '\0');
+    for (size_t index = 0; index < ascending.size(); ++index)
+    {
+        ascending[index] = static_cast<char>(index);
+    }
+    EXPECT_EQ(Crc32c(ascending.data(), ascending.size()), 0x46DD794EU);
+}
+
+// Every kernel matches the reference at every length and alignment, across the three-stream blocks
+TEST(CipherCrc32c, KernelsMatchScalar)
+{
+    const std::string bytes = MakeBytes(3 * 3 * cipher::CRC32C_STREAM_BLOCK + 100, 42);
+    for (const size_t length : {0U, 1U, 7U, 8U, 9U, 63U, 12287U, 12288U, 12289U, 24576U, 36963U})
+    {
+        for (size_t start = 0; start < 8; ++start)
+        {
+            const uint32_t expected = Crc32cScalar(0xFFFFFFFFU, bytes.data() + start, length);
+            for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+            {
+                const Crc32cFunc kernel = GetCrc32cKernel(static_cast<SimdLevel>(level));
+                EXPECT_EQ(kernel(0xFFFFFFFFU, bytes.data() + start, length), expected)
+                    << "level " << level << ", length " << length << ", start " << start;
+            }
+        }
+    }
+}
+
+// A checksum can be carried on from the checksum of the bytes before
+TEST(CipherCrc32c, Extend)
+{
+    const std::string bytes = MakeBytes(50000, 7);
+    const uint32_t whole = Crc32c(bytes.data(), bytes.size());
+    for (const size_t split : {0U, 1U, 4096U, 12345U, 50000U})
+    {
+        const uint32_t first = Crc32c(bytes.data(), split);
+        EXPECT_EQ(Crc32c(bytes.data() + split, bytes.size() - split, first), whole) << "split " << split;
+    }
+
+    // A single changed bit changes the checksum
+    std::string damaged(bytes);
+    damaged[31337] ^= 0x10;
+    EXPECT_NE(Crc32c(damaged.data(), damaged.size()), whole);
+}
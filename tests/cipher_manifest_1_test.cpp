@@ -0,0 +1,77 @@
+/************************************************************\
+Filename:   cipher_manifest_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the JSON Lines manifest
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <stdexcept>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_manifest.hpp"
+
+using cipher::ManifestRecord;
+using cipher::ManifestResultLine;
+using cipher::ParseManifestRecord;
+
+
+/* ===== Tests ===== */
+
+// All fields, in any order, with string and number keys
+TEST(CipherManifest, ParseRecord)
+{
+    ManifestRecord record = ParseManifestRecord(
+        "{\"method\": \"vigenere\", \"key\": \"LEMON\", \"decrypt\": true, \"payload\": \"LXFOPVEFRNHR\"}");
+    EXPECT_EQ(record.method, "vigenere");
+    EXPECT_EQ(record.key, "LEMON");
+    EXPECT_TRUE(record.decrypt);
+    EXPECT_EQ(record.payload, "LXFOPVEFRNHR");
+
+    record = ParseManifestRecord(" { \"payload\":\"ABC\" , \"key\" : 12 ,\"method\":\"railfence\" } ");
+    EXPECT_EQ(record.method, "railfence");
+    EXPECT_EQ(record.key, "12");
+    EXPECT_FALSE(record.decrypt);
+    EXPECT_EQ(record.payload, "ABC");
+}
+
+// Escapes are decoded, and unknown fields are skipped whatever they hold
+TEST(CipherManifest, EscapesAndUnknownFields)
+{
+    const ManifestRecord record = ParseManifestRecord(
+        "{\"id\": [1, {\"a\": null}, \"x\"], \"method\": \"caesar\", \"key\": \"B\","
+        " \"payload\": \"A\\\"B\\\\C\\n\\u0041\\u00e9\\ud83d\\ude00\", \"meta\": {}}");
+    EXPECT_EQ(record.payload, "A\"B\\C\nA\xC3\xA9\xF0\x9F\x98\x80");
+}
+
+// Malformed records and missing fields are rejected
+TEST(CipherManifest, BadRecords)
+{
+    EXPECT_THROW(ParseManifestRecord(""), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("[]"), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("{\"method\": \"caesar\" \"payload\": \"A\"}"), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("{\"method\": \"caesar\", \"payload\": \"A}"), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("{\"method\": \"caesar\", \"payload\": \"\\x\"}"), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("{\"method\": \"caesar\", \"payload\": \"\\ud83d\"}"), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("{\"method\": \"caesar\", \"payload\": \"A\"} x"), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("{\"method\": \"caesar\", \"decrypt\": 1, \"payload\": \"A\"}"), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("{\"method\": \"caesar\"}"), std::runtime_error);
+    EXPECT_THROW(ParseManifestRecord("{\"payload\": \"A\"}"), std::runtime_error);
+
+    // Unknown fields may nest, but not without limit
+    const std::string shallow = std::string(100, '[') + std::string(100, ']');
+    EXPECT_EQ(ParseManifestRecord("{\"x\": " + shallow + ", \"method\": \"caesar\", \"payload\": \"A\"}").method,
+              "caesar");
+    const std::string deep = std::string(2000000, '[') + std::string(2000000, ']');
+    EXPECT_THROW(ParseManifestRecord("{\"x\": " + deep + ", \"method\": \"caesar\", \"payload\": \"A\"}"),
+                 std::runtime_error);
+}
+
+// Result lines escape quotes, backslashes and control characters
+TEST(CipherManifest, ResultLine)
+{
+    EXPECT_EQ(ManifestResultLine(true, "HELLO"), "{\"result\":\"HELLO\"}");
+    EXPECT_EQ(ManifestResultLine(false, "bad \"key\"\\\n"), "{\"error\":\"bad \\\"key\\\"\\\\\\u000a\"}");
+}
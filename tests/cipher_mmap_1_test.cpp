@@ -0,0 +1,83 @@
+/************************************************************\
+Filename:   cipher_mmap_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for memory-mapped files
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_mmap.hpp"
+
+using cipher::IsSameFile;
+using cipher::MappedInput;
+using cipher::MappedOutput;
+
+
+/* ===== Helpers ===== */
+
+/** Read a whole file into a string */
+static std::string ReadFile(const std::string& path)
+{
+    std::ifstream file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+
+/* ===== Tests ===== */
+
+// A regular file maps with its contents; an empty file maps with no data
+TEST(CipherMmap, MapInput)
+{
+    const std::string path = testing::TempDir() + "cipher_mmap_input.txt";
+    std::ofstream(path) << "HELLOWORLD\n";
+
+    MappedInput input;
+    ASSERT_TRUE(input.Open(path.c_str()));
+    EXPECT_EQ(std::string(input.Data(), input.Size()), "HELLOWORLD\n");
+
+    std::ofstream(path).close();
+    ASSERT_TRUE(input.Open(path.c_str()));
+    EXPECT_EQ(input.Size(), 0U);
+    EXPECT_EQ(input.Data(), nullptr);
+    std::remove(path.c_str());
+
+    // Missing files and devices can't be mapped
+    EXPECT_FALSE(input.Open(path.c_str()));
+    EXPECT_FALSE(input.Open("/dev/null"));
+}
+
+// The output file is created at its full size, and can be cut short on close
+TEST(CipherMmap, MapOutput)
+{
+    const std::string path = testing::TempDir() + "cipher_mmap_output.txt";
+    std::ofstream(path) << "A much longer file that is overwritten";
+
+    MappedOutput output;
+    ASSERT_TRUE(output.Open(path.c_str(), 6));
+    EXPECT_EQ(output.Size(), 6U);
+    std::string("HELLO\n").copy(output.Data(), 6);
+    output.Close(output.Size());
+    EXPECT_EQ(ReadFile(path), "HELLO\n");
+
+    ASSERT_TRUE(output.Open(path.c_str(), 6));
+    std::string("WORLD\n").copy(output.Data(), 6);
+    output.Close(3);
+    EXPECT_EQ(ReadFile(path), "WOR");
+
+    EXPECT_TRUE(IsSameFile(path.c_str(), path.c_str()));
+    EXPECT_FALSE(IsSameFile(path.c_str(), "/dev/null"));
+    std::remove(path.c_str());
+    EXPECT_FALSE(IsSameFile(path.c_str(), path.c_str()));
+
+    // Devices can't be mapped
+    EXPECT_FALSE(output.Open("/dev/null", 6));
+}
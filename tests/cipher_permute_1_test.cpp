@@ -0,0 +1,71 @@
+/************************************************************\
+Filename:   cipher_permute_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for in-place permutation
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <climits>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_permute.hpp"
+
+using cipher::GatherInPlace;
+using cipher::ScatterInPlace;
+using cipher::VisitedBitmap;
+
+
+/* ===== Tests ===== */
+
+// Scatter then gather with the same map restores the buffer
+TEST(CipherPermute, ScatterGatherRoundTrip)
+{
+    const size_t length = 1000;
+    std::string original(length, '\0');
+    for (size_t index = 0; index < length; ++index)
+    {
+        original[index] = static_cast<char>(index);
+    }
+
+    // Multiplying by a number coprime with the length is a permutation
+    const auto map = [length](const size_t index) { return (index * 7) % length; };
+
+    std::string expected(length, '\0');
+    for (size_t index = 0; index < length; ++index)
+    {
+        expected[map(index)] = original[index];
+    }
+
+    std::string text(original);
+    ScatterInPlace(&text[0], length, map);
+    EXPECT_EQ(text, expected);
+    GatherInPlace(&text[0], length, map);
+    EXPECT_EQ(text, original);
+}
+
+// Reversal is made entirely of 2-cycles (and one fixed point)
+TEST(CipherPermute, Reverse)
+{
+    std::string text("ABCDEFG");
+    ScatterInPlace(&text[0], text.size(), [](const size_t index) { return 6 - index; });
+    EXPECT_EQ(text, "GFEDCBA");
+}
+
+// The bitmap skips runs of visited positions
+TEST(CipherPermute, VisitedBitmapNextUnvisited)
+{
+    VisitedBitmap visited(200);
+    for (size_t index = 0; index < 150; ++index)
+    {
+        visited.Set(index);
+    }
+    EXPECT_TRUE(visited.Test(149));
+    EXPECT_FALSE(visited.Test(150));
+    EXPECT_EQ(visited.NextUnvisited(0, 200), 150U);
+    visited.Set(150);
+    EXPECT_EQ(visited.NextUnvisited(0, 200), 151U);
+    EXPECT_EQ(visited.NextUnvisited(199, 199), 199U);
+}
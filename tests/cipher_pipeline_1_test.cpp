@@ -0,0 +1,198 @@
+/************************************************************\
+Filename:   cipher_pipeline_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the pipelined streaming driver
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <atomic>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+#include "cipher_pipeline.hpp"
+#include "vigenere_cipher.hpp"
+
+using cipher::CipherResult;
+using cipher::PipelinedStreamTransform;
+using cipher::SpscRing;
+using cipher::TryShiftVigenereAlphaAt;
+using cipher::ShiftVigenereBytesAt;
+using cipher::VigenereKey;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+
+
+/* ===== Helpers ===== */
+
+/** Pipe text through a Vigenere encryption with the given chunk size */
+static CipherResult PipelineVigenere(const VigenereKey& key,
+                                     const std::string& text,
+                                     const size_t chunk_size,
+                                     std::string& result)
+{
+    std::istringstream input(text);
+    std::ostringstream output;
+    const CipherResult status = PipelinedStreamTransform(input, output, chunk_size,
+        [&key](const char* in, char* out, const size_t length, const size_t offset)
+        {
+            return TryShiftVigenereAlphaAt(key.EncryptPeriod(), key.Period(), offset, in, out, length);
+        });
+    result = output.str();
+    return status;
+}
+
+
+/* ===== Tests ===== */
+
+// Values come out in order, with the ring full and empty many times over
+TEST(CipherPipeline, RingKeepsOrder)
+{
+    SpscRing<size_t> ring(3);
+    const size_t count = 100000;
+    std::thread producer([&ring]()
+    {
+        for (size_t value = 0; value < count; ++value)
+        {
+            ring.Push(value);
+        }
+    });
+    const std::atomic<bool> never(false);
+    for (size_t expected = 0; expected < count; ++expected)
+    {
+        size_t value = 0;
+        ASSERT_TRUE(ring.Pop(value, never));
+        ASSERT_EQ(value, expected);
+    }
+    producer.join();
+
+    size_t value = 0;
+    EXPECT_FALSE(ring.TryPop(value));
+    const std::atomic<bool> abort(true);
+    EXPECT_FALSE(ring.Pop(value, abort));
+}
+
+// The ring holds its capacity rounded up to a power of two
+TEST(CipherPipeline, RingCapacity)
+{
+    SpscRing<int> ring(3);
+    for (int value = 0; value < 4; ++value)
+    {
+        EXPECT_TRUE(ring.TryPush(value));
+    }
+    EXPECT_FALSE(ring.TryPush(4));
+    int value = 0;
+    EXPECT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(ring.TryPush(4));
+}
+
+// The key phase carries across chunks, so every chunk size gives the same output
+TEST(CipherPipeline, MatchesStreamTransform)
+{
+    const VigenereKey key("LEMON");
+    std::string plaintext;
+    for (size_t index = 0; index < 5000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 11) % 26)));
+    }
+    std::string expected;
+    EncryptVigenereAlpha(key, plaintext, expected);
+    expected.push_back('\n');
+
+    for (const size_t chunk_size : {1U, 3U, 5U, 64U, 999U, 5000U, 8192U})
+    {
+        std::string result;
+        EXPECT_TRUE(PipelineVigenere(key, plaintext + " \n\t\n", chunk_size, result).Ok());
+        EXPECT_EQ(result, expected) << "chunk size " << chunk_size;
+    }
+}
+
+// Whitespace is only dropped at the end of the stream, even across chunks
+TEST(CipherPipeline, TrailingWhitespace)
+{
+    const VigenereKey key("A");
+    std::string result;
+    EXPECT_TRUE(PipelineVigenere(key, "HELLO    ", 2, result).Ok());
+    EXPECT_EQ(result, "HELLO\n");
+    EXPECT_TRUE(PipelineVigenere(key, "", 2, result).Ok());
+    EXPECT_EQ(result, "\n");
+    EXPECT_TRUE(PipelineVigenere(key, " \n \n", 2, result).Ok());
+    EXPECT_EQ(result, "\n");
+
+    // Held-back whitespace followed by more text is passed to the cipher
+    for (const size_t chunk_size : {2U, 4U, 7U, 64U})
+    {
+        const CipherResult status = PipelineVigenere(key, "HELLO    WORLD\n", chunk_size, result);
+        EXPECT_EQ(status.status, CIPHER_STATUS_INVALID_TEXT) << "chunk size " << chunk_size;
+        EXPECT_EQ(status.offset, 5U) << "chunk size " << chunk_size;
+        EXPECT_EQ(status.value, ' ') << "chunk size " << chunk_size;
+    }
+
+    // A cipher that accepts whitespace gets it back in the right place
+    std::istringstream input("AB  \n  CD \n");
+    std::ostringstream output;
+    EXPECT_TRUE(PipelinedStreamTransform(input, output, 3,
+        [](const char* in, char* out, const size_t length, const size_t)
+        {
+            for (size_t index = 0; index < length; ++index)
+            {
+                out[index] = static_cast<char>(std::tolower(static_cast<unsigned char>(in[index])));
+            }
+            return cipher::ResultOk();
+        }).Ok());
+    EXPECT_EQ(output.str(), "ab  \n  cd\n");
+}
+
+// An error late in a long stream reports its offset in the whole stream
+TEST(CipherPipeline, ErrorOffset)
+{
+    const VigenereKey key("KEY");
+    std::string text(100000, 'A');
+    text[77777] = '7';
+    std::string result;
+    const CipherResult status = PipelineVigenere(key, text, 1000, result);
+    EXPECT_EQ(status.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(status.offset, 77777U);
+    EXPECT_EQ(status.value, '7');
+}
+
+// Binary data keeps its trailing whitespace and gets no newline
+TEST(CipherPipeline, BinaryKeepsEveryByte)
+{
+    const VigenereKey key("B");
+    for (const size_t chunk_size : {1U, 3U, 64U})
+    {
+        std::istringstream input(std::string("AB \0\n \n", 7));
+        std::ostringstream output;
+        EXPECT_TRUE(PipelinedStreamTransform(input, output, chunk_size,
+            [&key](const char* in, char* out, const size_t length, const size_t offset)
+            {
+                ShiftVigenereBytesAt(key.EncryptPeriod(), key.Period(), offset, in, out, length);
+                return cipher::ResultOk();
+            }, true).Ok());
+        EXPECT_EQ(output.str(), std::string("BC!\x01\x0B!\x0B", 7)) << "chunk size " << chunk_size;
+    }
+}
+
+// A transform that throws stops every thread and passes the exception on
+TEST(CipherPipeline, TransformThrows)
+{
+    std::istringstream input(std::string(10000, 'A'));
+    std::ostringstream output;
+    size_t calls = 0;
+    EXPECT_THROW(PipelinedStreamTransform(input, output, 100,
+        [&calls](const char*, char*, const size_t, const size_t)
+        {
+            if (++calls == 5)
+            {
+                throw std::runtime_error("transform failed");
+            }
+            return cipher::ResultOk();
+        }), std::runtime_error);
+    EXPECT_LE(output.str().size(), 400U);
+}
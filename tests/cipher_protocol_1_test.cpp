@@ -0,0 +1,84 @@
+/************************************************************\
+Filename:   cipher_protocol_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the cipher server wire format
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <stdexcept>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_protocol.hpp"
+
+using cipher::DecodeRequest;
+using cipher::DecodeResponse;
+using cipher::EncodeRequest;
+using cipher::EncodeResponse;
+using cipher::FRAME_HEADER_SIZE;
+using cipher::ManifestRecord;
+using cipher::ReadFrameLength;
+
+
+/* ===== Tests ===== */
+
+// A request comes back the same after encoding and decoding
+TEST(CipherProtocol, RequestRoundTrip)
+{
+    ManifestRecord request = ManifestRecord();
+    request.method = "vigenere";
+    request.key = "LEMON";
+    request.decrypt = true;
+    request.payload = std::string("LXFOPV\0EFRNHR", 13);
+
+    const std::string frame = EncodeRequest(request);
+    ASSERT_EQ(ReadFrameLength(frame.data()), frame.size() - FRAME_HEADER_SIZE);
+    const ManifestRecord decoded = DecodeRequest(frame.data() + FRAME_HEADER_SIZE, frame.size() - FRAME_HEADER_SIZE);
+    EXPECT_EQ(decoded.method, request.method);
+    EXPECT_EQ(decoded.key, request.key);
+    EXPECT_TRUE(decoded.decrypt);
+    EXPECT_EQ(decoded.payload, request.payload);
+
+    // Empty key and payload
+    request = ManifestRecord();
+    request.method = "caesar";
+    const std::string empty_frame = EncodeRequest(request);
+    const ManifestRecord empty = DecodeRequest(empty_frame.data() + FRAME_HEADER_SIZE,
+                                               empty_frame.size() - FRAME_HEADER_SIZE);
+    EXPECT_EQ(empty.method, "caesar");
+    EXPECT_EQ(empty.key, "");
+    EXPECT_FALSE(empty.decrypt);
+    EXPECT_EQ(empty.payload, "");
+}
+
+// Bodies shorter than their own lengths are rejected
+TEST(CipherProtocol, BadRequests)
+{
+    EXPECT_THROW(DecodeRequest("\x00\x01", 2), std::runtime_error);
+    EXPECT_THROW(DecodeRequest("\x00\x05\x00\x00" "abc", 7), std::runtime_error);
+
+    ManifestRecord request = ManifestRecord();
+    request.method = std::string(256, 'm');
+    EXPECT_THROW(EncodeRequest(request), std::runtime_error);
+    request.method = "vigenere";
+    request.key = std::string(70000, 'K');
+    EXPECT_THROW(EncodeRequest(request), std::runtime_error);
+}
+
+// Results and errors are told apart by the status byte
+TEST(CipherProtocol, Response)
+{
+    std::string text;
+    std::string frame = EncodeResponse(true, "LXFOPVEFRNHR");
+    ASSERT_EQ(ReadFrameLength(frame.data()), 13U);
+    EXPECT_TRUE(DecodeResponse(frame.data() + FRAME_HEADER_SIZE, frame.size() - FRAME_HEADER_SIZE, text));
+    EXPECT_EQ(text, "LXFOPVEFRNHR");
+
+    frame = EncodeResponse(false, "bad key");
+    EXPECT_FALSE(DecodeResponse(frame.data() + FRAME_HEADER_SIZE, frame.size() - FRAME_HEADER_SIZE, text));
+    EXPECT_EQ(text, "bad key");
+
+    EXPECT_THROW(DecodeResponse("", 0, text), std::runtime_error);
+}
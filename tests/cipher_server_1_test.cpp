@@ -0,0 +1,258 @@
+/************************************************************\
+Filename:   cipher_server_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the cipher server and client
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "cipher_server.hpp"
+
+using cipher::CipherClient;
+using cipher::CipherServer;
+using cipher::DecodeResponse;
+using cipher::EncodeRequest;
+using cipher::FRAME_HEADER_SIZE;
+using cipher::FRAME_MAX_SIZE;
+using cipher::ManifestRecord;
+using cipher::ReadFrameLength;
+
+
+/* ===== Helpers ===== */
+
+/** Handler that reverses the payload, or fails for method "fail" */
+static bool ReverseHandler(const ManifestRecord& request, std::string& text)
+{
+    if (request.method == "fail")
+    {
+        throw std::runtime_error("failed: " + request.key);
+    }
+    text.assign(request.payload.rbegin(), request.payload.rend());
+    return true;
+}
+
+/** Build a request for ReverseHandler */
+static ManifestRecord MakeRequest(const std::string& method, const std::string& payload)
+{
+    ManifestRecord request = ManifestRecord();
+    request.method = method;
+    request.key = "KEY";
+    request.payload = payload;
+    return request;
+}
+
+
+/* ===== Tests ===== */
+
+// Several clients at once, with results and errors
+TEST(CipherServer, ClientsAndErrors)
+{
+    const std::string path = testing::TempDir() + "cipher_server_test.sock";
+    CipherServer server(ReverseHandler, 2);
+    server.Listen(path);
+    std::thread loop([&server]() { server.Run(); });
+
+    std::vector<std::thread> clients;
+    std::vector<int> passed(4, 0);
+    for (size_t index = 0; index < passed.size(); ++index)
+    {
+        clients.emplace_back([&path, &passed, index]()
+        {
+            CipherClient client;
+            client.Connect(path);
+            std::string text;
+            bool ok = true;
+            for (size_t call = 0; call < 50; ++call)
+            {
+                const std::string payload(call * 997, static_cast<char>('A' + index));
+                ok = ok && client.Call(MakeRequest("reverse", payload + "XY"), text) &&
+                     (text == "YX" + payload);
+            }
+            ok = ok && !client.Call(MakeRequest("fail", ""), text) && (text == "failed: KEY");
+            passed[index] = ok ? 1 : 0;
+        });
+    }
+    for (std::thread& client : clients)
+    {
+        client.join();
+    }
+    server.Stop();
+    loop.join();
+
+    for (const int ok : passed)
+    {
+        EXPECT_EQ(ok, 1);
+    }
+}
+
+// Requests sent back to back, split at odd points, are answered in order
+TEST(CipherServer, PipelinedRequests)
+{
+    const std::string path = testing::TempDir() + "cipher_server_pipeline.sock";
+    CipherServer server(ReverseHandler, 4);
+    server.Listen(path);
+    std::thread loop([&server]() { server.Run(); });
+
+    std::string frames;
+    for (size_t index = 0; index < 100; ++index)
+    {
+        frames += EncodeRequest(MakeRequest("reverse", std::to_string(index) + "-" + std::string(index * 50, 'Z')));
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    const sockaddr_un address = cipher::UnixSocketAddress(path);
+    ASSERT_EQ(connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    for (size_t sent = 0; sent < frames.size(); sent += 7)
+    {
+        const size_t length = std::min<size_t>(7, frames.size() - sent);
+        ASSERT_EQ(send(fd, frames.data() + sent, length, 0), static_cast<ssize_t>(length));
+    }
+    (void)shutdown(fd, SHUT_WR);
+
+    std::string received;
+    char buffer[4096];
+    ssize_t count = 0;
+    while ((count = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        received.append(buffer, static_cast<size_t>(count));
+    }
+    (void)close(fd);
+    server.Stop();
+    loop.join();
+
+    size_t offset = 0;
+    for (size_t index = 0; index < 100; ++index)
+    {
+        ASSERT_LE(offset + FRAME_HEADER_SIZE, received.size());
+        const size_t length = ReadFrameLength(received.data() + offset);
+        std::string text;
+        ASSERT_TRUE(DecodeResponse(received.data() + offset + FRAME_HEADER_SIZE, length, text));
+        const std::string payload = std::to_string(index) + "-" + std::string(index * 50, 'Z');
+        EXPECT_EQ(text, std::string(payload.rbegin(), payload.rend()));
+        offset += FRAME_HEADER_SIZE + length;
+    }
+    EXPECT_EQ(offset, received.size());
+}
+
+// A client that sends without reading is stopped by the socket, not by the server running out of memory
+TEST(CipherServer, Backpressure)
+{
+    const std::string path = testing::TempDir() + "cipher_server_backpressure.sock";
+    CipherServer server(ReverseHandler, 2);
+    server.Listen(path);
+    std::thread loop([&server]() { server.Run(); });
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    const sockaddr_un address = cipher::UnixSocketAddress(path);
+    ASSERT_EQ(connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+    // Send until the server stops reading, giving up well past anything it should hold
+    const std::string frame = EncodeRequest(MakeRequest("reverse", std::string(64 * 1024, 'Q')));
+    const size_t give_up = 256 * 1024 * 1024;
+    size_t sent = 0;
+    size_t idle_tries = 0;
+    while ((sent < give_up) && (idle_tries < 100))
+    {
+        const size_t offset = sent % frame.size();
+        const ssize_t count = send(fd, frame.data() + offset, frame.size() - offset, MSG_NOSIGNAL);
+        if (count > 0)
+        {
+            sent += static_cast<size_t>(count);
+            idle_tries = 0;
+        }
+        else
+        {
+            ++idle_tries;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    EXPECT_LT(sent, 32U * 1024 * 1024);
+    (void)shutdown(fd, SHUT_WR);
+
+    // Every whole request is still answered once the client reads
+    size_t received = 0;
+    char buffer[65536];
+    while (true)
+    {
+        const ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+        if (count > 0)
+        {
+            received += static_cast<size_t>(count);
+        }
+        else if ((count == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+        {
+            break;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    (void)close(fd);
+    server.Stop();
+    loop.join();
+
+    const size_t response_size = cipher::EncodeResponse(true, std::string(64 * 1024, 'Q')).size();
+    EXPECT_GT(received, 0U);
+    EXPECT_EQ(received, (sent / frame.size()) * response_size);
+}
+
+// Connecting to a path with no server fails cleanly
+TEST(CipherServer, NoServer)
+{
+    CipherClient client;
+    EXPECT_THROW(client.Connect(testing::TempDir() + "cipher_server_missing.sock"), std::runtime_error);
+}
+
+// A response longer than any frame fails the call instead of being allocated
+TEST(CipherServer, ResponseTooLong)
+{
+    const std::string path = testing::TempDir() + "cipher_server_too_long.sock";
+    (void)unlink(path.c_str());
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    const sockaddr_un address = cipher::UnixSocketAddress(path);
+    ASSERT_EQ(bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    ASSERT_EQ(listen(listen_fd, 1), 0);
+
+    // Read the request, then answer with a header claiming one byte too many
+    std::thread fake_server([listen_fd]()
+    {
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        char header[FRAME_HEADER_SIZE];
+        (void)recv(fd, header, sizeof(header), MSG_WAITALL);
+        std::string body(ReadFrameLength(header), '\0');
+        (void)recv(fd, &body[0], body.size(), MSG_WAITALL);
+        std::string response;
+        cipher::AppendFrameLength(response, FRAME_MAX_SIZE + 1);
+        (void)send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+        (void)close(fd);
+    });
+
+    CipherClient client;
+    client.Connect(path);
+    std::string text;
+    try
+    {
+        (void)client.Call(MakeRequest("reverse", "HELLO"), text);
+        FAIL() << "the response was accepted";
+    }
+    catch (const std::runtime_error& e)
+    {
+        EXPECT_EQ(std::string(e.what()), "response is too long");
+    }
+    fake_server.join();
+    (void)close(listen_fd);
+    (void)unlink(path.c_str());
+}
@@ -0,0 +1,322 @@
+/************************************************************\
+Filename:   cipher_simd_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the vectorized cipher kernels
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <climits>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_simd.hpp"
+#include "substitution_cipher.hpp"
+#include "vigenere_cipher.hpp"
+
+using cipher::SubstitutionCipher;
+using cipher::VigenereKey;
+using cipher::simd::FindNonUpperAlphaFunc;
+using cipher::simd::GetFindNonUpperAlphaKernel;
+using cipher::simd::GetShiftAlphaKernel;
+using cipher::simd::GetShiftBytesKernel;
+using cipher::simd::GetShiftMixedKernel;
+using cipher::simd::GetSimdLevel;
+using cipher::simd::GetSubstituteAlphaKernel;
+using cipher::simd::GetSubstituteMixedKernel;
+using cipher::simd::ShiftAlphaFunc;
+using cipher::simd::ShiftAlphaScalar;
+using cipher::simd::ShiftBytesFunc;
+using cipher::simd::ShiftBytesScalar;
+using cipher::simd::ShiftMixedFunc;
+using cipher::simd::ShiftMixedScalar;
+using cipher::simd::SimdLevel;
+using cipher::simd::SubstituteAlphaFunc;
+using cipher::simd::SubstituteAlphaScalar;
+using cipher::simd::SubstituteMixedFunc;
+using cipher::simd::SubstituteMixedScalar;
+using cipher::simd::SIMD_LEVEL_SCALAR;
+using cipher::simd::SIMD_LEVEL_AVX512BW;
+
+
+/* ===== Helpers ===== */
+
+// Build a pseudo-random upper-case string of the given length
+static std::string MakeAlphaText(const size_t length, uint32_t seed)
+{
+    std::string text(length, 'A');
+    for (size_t index = 0; index < length; ++index)
+    {
+        seed = seed * 1103515245U + 12345U;
+        text[index] = static_cast<char>('A' + ((seed >> 16) % 26));
+    }
+    return text;
+}
+
+// Build a pseudo-random string of letters of both cases, digits, punctuation and high bytes
+static std::string MakeMixedText(const size_t length, uint32_t seed)
+{
+    static const char symbols[] = " ,.!?09@[`{\n\t\x80\xC1\xFF";
+    std::string text(length, 'a');
+    for (size_t index = 0; index < length; ++index)
+    {
+        seed = seed * 1103515245U + 12345U;
+        const uint32_t pick = (seed >> 16) % 80;
+        if (pick < 26)
+        {
+            text[index] = static_cast<char>('A' + pick);
+        }
+        else if (pick < 52)
+        {
+            text[index] = static_cast<char>('a' + (pick - 26));
+        }
+        else
+        {
+            text[index] = symbols[pick % (sizeof(symbols) - 1)];
+        }
+    }
+    return text;
+}
+
+/** Count the letters of either case in a string */
+static size_t CountLetters(const std::string& text)
+{
+    size_t count = 0U;
+    for (const char alpha : text)
+    {
+        count += cipher::IsAlpha(alpha) ? 1U : 0U;
+    }
+    return count;
+}
+
+
+/* ===== Tests ===== */
+
+// Every kernel supported by this CPU must match the scalar reference
+TEST(CipherSimd, KernelsMatchScalar)
+{
+    const std::string plaintext = MakeAlphaText(1000, 1);
+    const size_t key_lengths[] = {1, 2, 3, 7, 16, 31, 64, 65, 100};
+    for (const size_t key_length : key_lengths)
+    {
+        const std::string cipherkey = MakeAlphaText(key_length, static_cast<uint32_t>(key_length));
+        const VigenereKey compiled_key(cipherkey);
+        const uint8_t* key_period = compiled_key.EncryptPeriod();
+
+        std::string expected(plaintext.size(), '\0');
+        EXPECT_EQ(ShiftAlphaScalar(key_period, key_length, 0,
+                                   plaintext.data(), &expected[0], plaintext.size()),
+                  plaintext.size());
+
+        for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+        {
+            const ShiftAlphaFunc kernel = GetShiftAlphaKernel(static_cast<SimdLevel>(level));
+            std::string actual(plaintext.size(), '\0');
+            EXPECT_EQ(kernel(key_period, key_length, 0,
+                             plaintext.data(), &actual[0], plaintext.size()),
+                      plaintext.size());
+            EXPECT_EQ(actual, expected) << "level " << level << ", key length " << key_length;
+        }
+    }
+}
+
+// Every kernel must stop at the first invalid byte
+TEST(CipherSimd, KernelsFindInvalidByte)
+{
+    const VigenereKey compiled_key("KEY");
+    const uint8_t* key_period = compiled_key.EncryptPeriod();
+    const size_t bad_positions[] = {0, 15, 16, 63, 64, 130, 199};
+    for (const size_t bad_position : bad_positions)
+    {
+        std::string plaintext = MakeAlphaText(200, 7);
+        plaintext[bad_position] = 'a';
+        plaintext[199] = '\xFF';
+
+        for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+        {
+            const ShiftAlphaFunc kernel = GetShiftAlphaKernel(static_cast<SimdLevel>(level));
+            std::string actual(plaintext.size(), '\0');
+            EXPECT_EQ(kernel(key_period, 3, 0, plaintext.data(), &actual[0], plaintext.size()),
+                      bad_position) << "level " << level;
+        }
+    }
+}
+
+// Starting part way through the key is the same as skipping ahead
+TEST(CipherSimd, KernelsHonourPhase)
+{
+    const std::string plaintext = MakeAlphaText(300, 3);
+    const VigenereKey compiled_key("LEMON");
+    const uint8_t* key_period = compiled_key.EncryptPeriod();
+
+    std::string whole(plaintext.size(), '\0');
+    ShiftAlphaScalar(key_period, 5, 0, plaintext.data(), &whole[0], plaintext.size());
+
+    for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+    {
+        const ShiftAlphaFunc kernel = GetShiftAlphaKernel(static_cast<SimdLevel>(level));
+        std::string tail(plaintext.size() - 102, '\0');
+        kernel(key_period, 5, 102 % 5, plaintext.data() + 102, &tail[0], tail.size());
+        EXPECT_EQ(tail, whole.substr(102)) << "level " << level;
+    }
+}
+
+// Every substitution kernel supported by this CPU must match the scalar reference
+TEST(CipherSimd, SubstituteKernelsMatchScalar)
+{
+    const SubstitutionCipher cipher = SubstitutionCipher::FromKeyword("QWERTYUIOPASDFGHJKLZXCVBNM");
+    const size_t lengths[] = {0, 1, 15, 16, 17, 63, 64, 65, 1000};
+    for (const size_t length : lengths)
+    {
+        std::string plaintext = MakeAlphaText(length, 11);
+        std::string expected(length, '\0');
+        EXPECT_EQ(SubstituteAlphaScalar(cipher.EncryptTable(), plaintext.data(), &expected[0], length), length);
+
+        for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+        {
+            const SubstituteAlphaFunc kernel = GetSubstituteAlphaKernel(static_cast<SimdLevel>(level));
+            std::string actual(length, '\0');
+            EXPECT_EQ(kernel(cipher.EncryptTable(), plaintext.data(), &actual[0], length), length);
+            EXPECT_EQ(actual, expected) << "level " << level << ", length " << length;
+
+            if (length > 0)
+            {
+                const char last = plaintext[length - 1];
+                plaintext[length - 1] = '@';
+                EXPECT_EQ(kernel(cipher.EncryptTable(), plaintext.data(), &actual[0], length), length - 1);
+                plaintext[length - 1] = last;
+            }
+        }
+    }
+}
+
+// Every validation kernel supported by this CPU finds the first invalid byte
+TEST(CipherSimd, FindNonUpperAlphaKernels)
+{
+    const size_t bad_positions[] = {0, 1, 15, 16, 127, 128, 255, 256, 600, 999};
+    for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+    {
+        const FindNonUpperAlphaFunc kernel = GetFindNonUpperAlphaKernel(static_cast<SimdLevel>(level));
+        const std::string valid = MakeAlphaText(1000, 5);
+        EXPECT_EQ(kernel(valid.data(), valid.size()), valid.size());
+        EXPECT_EQ(kernel(valid.data(), 0), 0U);
+
+        for (const size_t bad_position : bad_positions)
+        {
+            std::string text(valid);
+            text[bad_position] = (bad_position % 2) ? '[' : '@';
+            text[999] = '\x80';
+            EXPECT_EQ(kernel(text.data(), text.size()), bad_position) << "level " << level;
+        }
+    }
+}
+
+// The case-preserving scalar kernel shifts letters only and keeps their case
+TEST(CipherSimd, ShiftMixedScalar)
+{
+    const VigenereKey compiled_key("LEMON");
+    const std::string plaintext = "Attack at Dawn! 42 times.";
+    std::string actual(plaintext.size(), '\0');
+    EXPECT_EQ(ShiftMixedScalar(compiled_key.EncryptPeriod(), 5, 0,
+                               plaintext.data(), &actual[0], plaintext.size()),
+              CountLetters(plaintext));
+    EXPECT_EQ(actual, "Lxfopv ef Rnhr! 42 fwzpw.");
+}
+
+// Every case-preserving kernel supported by this CPU must match the scalar reference
+TEST(CipherSimd, ShiftMixedKernelsMatchScalar)
+{
+    const size_t key_lengths[] = {1, 3, 7, 16, 31, 64, 65, 100};
+    const size_t lengths[] = {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 1000};
+    for (const size_t key_length : key_lengths)
+    {
+        const VigenereKey compiled_key(MakeAlphaText(key_length, static_cast<uint32_t>(key_length)));
+        const uint8_t* key_period = compiled_key.EncryptPeriod();
+        for (const size_t length : lengths)
+        {
+            const std::string plaintext = MakeMixedText(length, static_cast<uint32_t>(length + key_length));
+            for (const size_t phase : {static_cast<size_t>(0), key_length / 2, key_length - 1})
+            {
+                std::string expected(length, '\0');
+                const size_t letters = ShiftMixedScalar(key_period, key_length, phase,
+                                                        plaintext.data(), &expected[0], length);
+                EXPECT_EQ(letters, CountLetters(plaintext));
+
+                for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+                {
+                    const ShiftMixedFunc kernel = GetShiftMixedKernel(static_cast<SimdLevel>(level));
+                    std::string actual(plaintext);
+                    EXPECT_EQ(kernel(key_period, key_length, phase, actual.data(), &actual[0], length), letters);
+                    EXPECT_EQ(actual, expected) << "level " << level << ", key length " << key_length
+                                                << ", length " << length << ", phase " << phase;
+                }
+#ifdef CIPHER_SIMD_X86
+                // CPUs with VBMI2 get the expand kernel at the AVX512BW level, so check the other one directly
+                if (GetSimdLevel() >= SIMD_LEVEL_AVX512BW)
+                {
+                    std::string actual(plaintext);
+                    EXPECT_EQ(cipher::simd::ShiftMixedAVX512BW(key_period, key_length, phase,
+                                                               actual.data(), &actual[0], length), letters);
+                    EXPECT_EQ(actual, expected) << "AVX512BW, key length " << key_length
+                                                << ", length " << length << ", phase " << phase;
+                }
+#endif
+            }
+        }
+    }
+}
+
+// Every case-preserving substitution kernel supported by this CPU must match the scalar reference
+TEST(CipherSimd, SubstituteMixedKernelsMatchScalar)
+{
+    const SubstitutionCipher cipher = SubstitutionCipher::FromKeyword("QWERTYUIOPASDFGHJKLZXCVBNM");
+    const std::string sample = "Hello, World!";
+    std::string converted(sample.size(), '\0');
+    SubstituteMixedScalar(cipher.EncryptTable(), sample.data(), &converted[0], sample.size());
+    EXPECT_EQ(converted, "Itssg, Vgksr!");
+
+    const size_t lengths[] = {0, 1, 15, 16, 17, 63, 64, 65, 1000};
+    for (const size_t length : lengths)
+    {
+        const std::string plaintext = MakeMixedText(length, 13);
+        std::string expected(length, '\0');
+        SubstituteMixedScalar(cipher.EncryptTable(), plaintext.data(), &expected[0], length);
+
+        for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+        {
+            const SubstituteMixedFunc kernel = GetSubstituteMixedKernel(static_cast<SimdLevel>(level));
+            std::string actual(plaintext);
+            kernel(cipher.EncryptTable(), actual.data(), &actual[0], length);
+            EXPECT_EQ(actual, expected) << "level " << level << ", length " << length;
+        }
+    }
+}
+
+// Every byte shift kernel supported by this CPU must match the scalar reference, for any byte
+TEST(CipherSimd, ShiftBytesKernelsMatchScalar)
+{
+    std::string data(1000, '\0');
+    for (size_t index = 0; index < data.size(); ++index)
+    {
+        data[index] = static_cast<char>((index * 97) & 0xFF);
+    }
+    const size_t key_lengths[] = {1, 3, 16, 31, 64, 65, 100};
+    for (const size_t key_length : key_lengths)
+    {
+        const VigenereKey compiled_key(MakeAlphaText(key_length, static_cast<uint32_t>(key_length)));
+        for (const uint8_t* key_period : {compiled_key.EncryptPeriod(), compiled_key.ByteDecryptPeriod()})
+        {
+            std::string expected(data.size(), '\0');
+            ShiftBytesScalar(key_period, key_length, key_length / 2, data.data(), &expected[0], data.size());
+
+            for (int level = SIMD_LEVEL_SCALAR; level <= GetSimdLevel(); ++level)
+            {
+                const ShiftBytesFunc kernel = GetShiftBytesKernel(static_cast<SimdLevel>(level));
+                std::string actual(data);
+                kernel(key_period, key_length, key_length / 2, actual.data(), &actual[0], actual.size());
+                EXPECT_EQ(actual, expected) << "level " << level << ", key length " << key_length;
+            }
+        }
+    }
+}
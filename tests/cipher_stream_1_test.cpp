@@ -0,0 +1,119 @@
+/************************************************************\
+Filename:   cipher_stream_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the streaming driver
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_stream.hpp"
+#include "vigenere_cipher.hpp"
+#include "scytale_cipher.hpp"
+
+using cipher::CipherResult;
+using cipher::StreamTransform;
+using cipher::TransposeScytale;
+using cipher::TryShiftVigenereAlphaAt;
+using cipher::ShiftVigenereBytesAt;
+using cipher::VigenereKey;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+
+
+/* ===== Helpers ===== */
+
+/** Stream text through a Vigenere encryption with the given block size */
+static CipherResult StreamVigenere(const VigenereKey& key,
+                                   const std::string& text,
+                                   const size_t block_size,
+                                   std::string& result)
+{
+    std::istringstream input(text);
+    std::ostringstream output;
+    const CipherResult status = StreamTransform(input, output, block_size,
+        [&key](const char* in, char* out, const size_t length, const size_t offset)
+        {
+            return TryShiftVigenereAlphaAt(key.EncryptPeriod(), key.Period(), offset, in, out, length);
+        });
+    result = output.str();
+    return status;
+}
+
+
+/* ===== Tests ===== */
+
+// The key phase carries across blocks, so every block size gives the same output
+TEST(CipherStream, VigenereAnyBlockSize)
+{
+    const VigenereKey key("LEMON");
+    std::string plaintext;
+    for (size_t index = 0; index < 1000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 11) % 26)));
+    }
+    std::string expected;
+    EncryptVigenereAlpha(key, plaintext, expected);
+    expected.push_back('\n');
+
+    for (const size_t block_size : {1U, 3U, 5U, 64U, 999U, 1000U, 4096U})
+    {
+        std::string result;
+        EXPECT_TRUE(StreamVigenere(key, plaintext + " \n\t\n", block_size, result).Ok());
+        EXPECT_EQ(result, expected) << "block size " << block_size;
+    }
+}
+
+// Whitespace is only dropped at the end of the stream
+TEST(CipherStream, TrailingWhitespace)
+{
+    const VigenereKey key("A");
+    std::string result;
+    EXPECT_TRUE(StreamVigenere(key, "HELLO    ", 2, result).Ok());
+    EXPECT_EQ(result, "HELLO\n");
+    EXPECT_TRUE(StreamVigenere(key, "", 2, result).Ok());
+    EXPECT_EQ(result, "\n");
+    EXPECT_TRUE(StreamVigenere(key, " \n \n", 2, result).Ok());
+    EXPECT_EQ(result, "\n");
+
+    // Inner whitespace is passed to the cipher, which rejects it here
+    const CipherResult status = StreamVigenere(key, "HELLO    WORLD\n", 4, result);
+    EXPECT_EQ(status.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(status.offset, 5U);
+    EXPECT_EQ(status.value, ' ');
+}
+
+// Transposition ciphers are applied to each block separately
+TEST(CipherStream, BlockFramedScytale)
+{
+    std::istringstream input("ABCDEFGHIJABCDEFGHIJABC\n");
+    std::ostringstream output;
+    EXPECT_TRUE(StreamTransform(input, output, 10,
+        [](const char* in, char* out, const size_t length, const size_t)
+        {
+            TransposeScytale<false>(4, in, out, length);
+            return cipher::ResultOk();
+        }).Ok());
+    EXPECT_EQ(output.str(), "AEIBFJCGDHAEIBFJCGDHABC\n");
+}
+
+// Binary data keeps its trailing whitespace and gets no newline
+TEST(CipherStream, BinaryKeepsEveryByte)
+{
+    const VigenereKey key("B");
+    for (const size_t block_size : {1U, 3U, 64U})
+    {
+        std::istringstream input(std::string("AB \0\n \n", 7));
+        std::ostringstream output;
+        EXPECT_TRUE(StreamTransform(input, output, block_size,
+            [&key](const char* in, char* out, const size_t length, const size_t offset)
+            {
+                ShiftVigenereBytesAt(key.EncryptPeriod(), key.Period(), offset, in, out, length);
+                return cipher::ResultOk();
+            }, true).Ok());
+        EXPECT_EQ(output.str(), std::string("BC!\x01\x0B!\x0B", 7)) << "block size " << block_size;
+    }
+}
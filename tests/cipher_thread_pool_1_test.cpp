@@ -0,0 +1,67 @@
+/************************************************************\
+Filename:   cipher_thread_pool_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the thread pool
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cipher_thread_pool.hpp"
+
+using cipher::ThreadPool;
+
+
+/* ===== Tests ===== */
+
+// Every index runs exactly once
+TEST(ThreadPool, ParallelForCoversRange)
+{
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.Size(), 4U);
+    for (const size_t count : {0U, 1U, 3U, 1000U})
+    {
+        std::vector<std::atomic<int>> hits(count);
+        for (std::atomic<int>& hit : hits)
+        {
+            hit = 0;
+        }
+        pool.ParallelFor(count, [&hits](const size_t index) { ++hits[index]; });
+        for (size_t index = 0; index < count; ++index)
+        {
+            EXPECT_EQ(hits[index], 1) << "index " << index;
+        }
+    }
+}
+
+// A pool of one runs everything on the calling thread
+TEST(ThreadPool, SingleThread)
+{
+    ThreadPool pool(1);
+    EXPECT_EQ(pool.Size(), 1U);
+    size_t sum = 0;
+    pool.ParallelFor(10, [&sum](const size_t index) { sum += index; });
+    EXPECT_EQ(sum, 45U);
+}
+
+// An exception in a task is rethrown to the caller, and the pool stays usable
+TEST(ThreadPool, ExceptionPropagates)
+{
+    ThreadPool pool(3);
+    EXPECT_THROW(pool.ParallelFor(100, [](const size_t index)
+    {
+        if (index == 42)
+        {
+            throw std::runtime_error("task failed");
+        }
+    }), std::runtime_error);
+
+    std::atomic<size_t> count(0);
+    pool.ParallelFor(100, [&count](const size_t) { ++count; });
+    EXPECT_EQ(count, 100U);
+}
@@ -0,0 +1,53 @@
+/************************************************************\
+Filename:   cipher_transpose_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the blocked byte matrix transpose
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <climits>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_transpose.hpp"
+
+using cipher::TransposeBytes;
+using cipher::TransposeBytesScalar;
+
+
+/* ===== Tests ===== */
+
+// The blocked transpose matches the scalar transpose for many shapes,
+// covering full blocks, full tiles and ragged edges of both
+TEST(CipherTranspose, MatchesScalar)
+{
+    const size_t sizes[] = {1, 2, 15, 16, 17, 33, 64, 65, 130};
+    for (const size_t rows : sizes)
+    {
+        for (const size_t columns : sizes)
+        {
+            std::string source(rows * (columns + 3), '\0');
+            for (size_t index = 0; index < source.size(); ++index)
+            {
+                source[index] = static_cast<char>(index * 7);
+            }
+
+            std::string expected(columns * (rows + 5), '#');
+            std::string actual(expected);
+            TransposeBytesScalar(source.data(), columns + 3, &expected[0], rows + 5, rows, columns);
+            TransposeBytes(source.data(), columns + 3, &actual[0], rows + 5, rows, columns);
+            EXPECT_EQ(actual, expected) << rows << " x " << columns;
+        }
+    }
+}
+
+// A 2x3 example written out by hand
+TEST(CipherTranspose, Small)
+{
+    const std::string source("ABCDEF");
+    std::string destination("......");
+    TransposeBytes(source.data(), 3, &destination[0], 2, 2, 3);
+    EXPECT_EQ(destination, "ADBECF");
+}
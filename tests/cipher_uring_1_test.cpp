@@ -0,0 +1,132 @@
+/************************************************************\
+Filename:   cipher_uring_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for the io_uring file backend
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include "cipher_uring.hpp"
+#include "vigenere_cipher.hpp"
+
+using cipher::CipherResult;
+using cipher::TryShiftVigenereAlphaAt;
+using cipher::UringSupported;
+using cipher::UringTransformer;
+using cipher::VigenereKey;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+
+
+/* ===== Helpers ===== */
+
+/** Read a whole file into a string */
+static std::string ReadFile(const std::string& path)
+{
+    std::ifstream file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+/**
+ * Encrypt one file into another with Vigenere through io_uring
+ * @return  False if io_uring is not available here
+ */
+static bool UringVigenere(UringTransformer& transformer,
+                          const VigenereKey& key,
+                          const std::string& text,
+                          std::string& result,
+                          CipherResult& status)
+{
+    const std::string input_path = testing::TempDir() + "cipher_uring_input.txt";
+    const std::string output_path = testing::TempDir() + "cipher_uring_output.txt";
+    std::ofstream(input_path) << text;
+    const bool opened = transformer.Open(input_path.c_str(), output_path.c_str());
+    if (opened)
+    {
+        status = transformer.Run([&key](const char* in, char* out, const size_t length, const size_t offset)
+        {
+            return TryShiftVigenereAlphaAt(key.EncryptPeriod(), key.Period(), offset, in, out, length);
+        });
+        result = ReadFile(output_path);
+    }
+    std::remove(input_path.c_str());
+    std::remove(output_path.c_str());
+    return opened;
+}
+
+
+/* ===== Tests ===== */
+
+// Without liburing, Open always asks the caller to fall back
+TEST(CipherUring, FallBack)
+{
+    UringTransformer transformer(cipher::URING_CHUNK_SIZE, false);
+    const std::string path = testing::TempDir() + "cipher_uring_fallback.txt";
+    EXPECT_FALSE(transformer.Open("/dev/null", path.c_str()));
+    if (!UringSupported())
+    {
+        std::ofstream(path) << "HELLO\n";
+        EXPECT_FALSE(transformer.Open(path.c_str(), path.c_str()));
+    }
+    std::remove(path.c_str());
+}
+
+// Many chunks through a few buffers, in any order, give the same text as one pass
+TEST(CipherUring, VigenereManyChunks)
+{
+    const VigenereKey key("LEMON");
+    std::string plaintext;
+    for (size_t index = 0; index < 100000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 7) % 26)));
+    }
+    std::string expected;
+    EncryptVigenereAlpha(key, plaintext, expected);
+    expected.push_back('\n');
+
+    for (const bool direct : {false, true})
+    {
+        UringTransformer transformer(1, direct);
+        std::string result;
+        CipherResult status = cipher::ResultOk();
+        if (!UringVigenere(transformer, key, plaintext + "  \n\n", result, status))
+        {
+            GTEST_SKIP() << "io_uring is not available";
+        }
+        EXPECT_TRUE(status.Ok());
+        EXPECT_EQ(result, expected) << "direct " << direct;
+
+        // The same transformer carries on with the next file
+        EXPECT_TRUE(UringVigenere(transformer, key, " \n", result, status));
+        EXPECT_TRUE(status.Ok());
+        EXPECT_EQ(result, "\n");
+    }
+}
+
+// The first error is reported and the output is cut there
+TEST(CipherUring, ErrorOffset)
+{
+    const VigenereKey key("KEY");
+    std::string text(50000, 'A');
+    text[30000] = '7';
+    text[45000] = '8';
+    UringTransformer transformer(1, false);
+    std::string result;
+    CipherResult status = cipher::ResultOk();
+    if (!UringVigenere(transformer, key, text, result, status))
+    {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    EXPECT_EQ(status.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(status.offset, 30000U);
+    EXPECT_EQ(status.value, '7');
+    EXPECT_EQ(result.size(), 30000U);
+}
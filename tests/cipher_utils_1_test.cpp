@@ -14,6 +14,9 @@ Description:
 
 using cipher::IsUpperAlpha;
 using cipher::InvertCipherkey;
+using cipher::GatherLetters;
+using cipher::IsAlpha;
+using cipher::ScatterLetters;
 
 
 /* ===== Tests ===== */
@@ -107,3 +110,25 @@ TEST(CipherUtils, InvertCipherkeyHello)
     EXPECT_EQ(InvertCipherkey("WORLD"), "EMJPX");
 }
 
+// Letters of either case are letters; nothing else is
+TEST(CipherUtils, IsAlphaEitherCase)
+{
+    for (int value = CHAR_MIN; value <= CHAR_MAX; ++value)
+    {
+        const char alpha = static_cast<char>(value);
+        const bool expected = ((alpha >= 'A') && (alpha <= 'Z')) || ((alpha >= 'a') && (alpha <= 'z'));
+        EXPECT_EQ(IsAlpha(alpha), expected) << value;
+    }
+}
+
+// Gathering and scattering letters moves only the letters
+TEST(CipherUtils, GatherScatterLetters)
+{
+    std::string text("Hi, yo! 42");
+    std::string letters(text.size(), '\0');
+    ASSERT_EQ(GatherLetters(text.data(), text.size(), &letters[0]), 4U);
+    EXPECT_EQ(letters.substr(0, 4), "Hiyo");
+
+    ScatterLetters(text.data(), "ABCD", &text[0], text.size());
+    EXPECT_EQ(text, "AB, CD! 42");
+}
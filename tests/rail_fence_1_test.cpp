@@ -8,12 +8,31 @@ Description:
 
 
 /* ===== Includes ===== */
+#include <algorithm>
 #include <climits>
+#include <string_view>
 #include <gtest/gtest.h>
 #include "rail_fence_cipher.hpp"
 
 using cipher::EncryptRailFenceAlpha;
 using cipher::DecryptRailFenceAlpha;
+using cipher::EncryptRailFenceAlphaInPlace;
+using cipher::DecryptRailFenceAlphaInPlace;
+using cipher::EncryptRailFenceAlphaParallel;
+using cipher::DecryptRailFenceAlphaParallel;
+using cipher::TryEncryptRailFenceAlphaParallel;
+using cipher::RailFenceLayout;
+using cipher::TransposeRailFence;
+using cipher::TransposeRailFenceInPlace;
+using cipher::TryEncryptRailFenceAlpha;
+using cipher::TryDecryptRailFenceAlpha;
+using cipher::CipherResult;
+using cipher::ThreadPool;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+using cipher::CIPHER_STATUS_INVALID_KEY;
+using cipher::RailFenceEncoder;
+using cipher::DecryptRailFenceRange;
+using cipher::TryDecryptRailFenceAlphaRange;
 
 
 /* ===== Tests ===== */
@@ -147,3 +166,305 @@ TEST(RailFence, FleeAtOnceDecrypt5)
     EXPECT_EQ(ciphertext, plaintext);
 }
 
+// Non-alpha characters are reported at their offset without throwing
+TEST(RailFence, TryInvalidText)
+{
+    std::string ciphertext;
+    const CipherResult result = TryEncryptRailFenceAlpha(3, "WEAREDISCOVERED FLEEATONCE", ciphertext);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 15U);
+    EXPECT_EQ(result.value, ' ');
+
+    const CipherResult decrypt_result = TryDecryptRailFenceAlpha(1, "WECRLTEERDSOEEFEAOCAIVDEn", ciphertext);
+    EXPECT_EQ(decrypt_result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(decrypt_result.offset, 24U);
+
+    EXPECT_THROW(EncryptRailFenceAlpha(3, "WEAREDISCOVERED FLEEATONCE", ciphertext), std::runtime_error);
+    EXPECT_THROW(DecryptRailFenceAlpha(4, "WECRLTEERDSOEEFEAOCAIVDEn", ciphertext), std::runtime_error);
+}
+
+// Zero rails is an invalid key
+TEST(RailFence, TryInvalidKey)
+{
+    std::string ciphertext;
+    EXPECT_EQ(TryEncryptRailFenceAlpha(0, "HELLO", ciphertext).status, CIPHER_STATUS_INVALID_KEY);
+    EXPECT_TRUE(TryEncryptRailFenceAlpha(2, "HELLO", ciphertext).Ok());
+    EXPECT_EQ(ciphertext, "HLOEL");
+    EXPECT_THROW(DecryptRailFenceAlpha(0, "HELLO", ciphertext), std::runtime_error);
+}
+
+// The closed-form layout agrees with the rail by rail encryption
+TEST(RailFence, LayoutMatchesEncrypt)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 200; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + (index % 26)));
+    }
+    for (size_t num_rails = 2; num_rails < 12; ++num_rails)
+    {
+        for (size_t length = 0; length < 60; ++length)
+        {
+            const std::string text = plaintext.substr(0, length);
+            std::string ciphertext;
+            EncryptRailFenceAlpha(num_rails, text, ciphertext);
+
+            const RailFenceLayout layout(num_rails, length);
+            std::string ciphercheck(length, '\0');
+            for (size_t index = 0; index < length; ++index)
+            {
+                ciphercheck[layout.CipherIndex(index)] = text[index];
+            }
+            EXPECT_EQ(ciphertext, ciphercheck) << num_rails << " rails, length " << length;
+        }
+    }
+}
+
+// In-place encryption and decryption match the Flee At Once examples
+TEST(RailFence, InPlace)
+{
+    std::string text("WEAREDISCOVEREDFLEEATONCE");
+    EncryptRailFenceAlphaInPlace(3, text);
+    EXPECT_EQ(text, "WECRLTEERDSOEEFEAOCAIVDEN");
+    DecryptRailFenceAlphaInPlace(3, text);
+    EXPECT_EQ(text, "WEAREDISCOVEREDFLEEATONCE");
+
+    EncryptRailFenceAlphaInPlace(5, text);
+    EXPECT_EQ(text, "WCLEESOFECAIVDENRDEEAOERT");
+    DecryptRailFenceAlphaInPlace(5, text);
+    EXPECT_EQ(text, "WEAREDISCOVEREDFLEEATONCE");
+
+    // On error the text is left unchanged
+    std::string bad("WEAREDISCOVERED FLEE");
+    EXPECT_THROW(EncryptRailFenceAlphaInPlace(3, bad), std::runtime_error);
+    EXPECT_EQ(bad, "WEAREDISCOVERED FLEE");
+}
+
+// The parallel engine gives the same output as the serial one
+TEST(RailFence, ParallelMatchesSerial)
+{
+    ThreadPool pool(4);
+    std::string plaintext;
+    for (size_t index = 0; index < 700000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 7) % 26)));
+    }
+
+    // Short cycles split by cycle, very long cycles split by rail too
+    const size_t rails[] = {1, 2, 3, 7, 64, 1000, 200000, 800000};
+    const size_t lengths[] = {0, 1, 25, 4096, 700000};
+    for (const size_t num_rails : rails)
+    {
+        for (const size_t length : lengths)
+        {
+            const std::string text = plaintext.substr(0, length);
+            std::string ciphercheck;
+            std::string ciphertext;
+            std::string decrypted;
+            EncryptRailFenceAlpha(num_rails, text, ciphercheck);
+            EncryptRailFenceAlphaParallel(num_rails, text, ciphertext, pool);
+            EXPECT_TRUE(ciphertext == ciphercheck) << num_rails << " rails, length " << length;
+            DecryptRailFenceAlphaParallel(num_rails, ciphertext, decrypted, pool);
+            EXPECT_TRUE(decrypted == text) << num_rails << " rails, length " << length;
+        }
+    }
+}
+
+// The parallel engine reports the first invalid character
+TEST(RailFence, ParallelInvalid)
+{
+    ThreadPool pool(4);
+    std::string text(300000, 'A');
+    text[123456] = 'a';
+    text[200000] = ' ';
+    std::string ciphertext;
+    const CipherResult result = TryEncryptRailFenceAlphaParallel(5, text, ciphertext, pool);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 123456U);
+    EXPECT_EQ(result.value, 'a');
+    EXPECT_EQ(TryEncryptRailFenceAlphaParallel(0, text, ciphertext, pool).status, CIPHER_STATUS_INVALID_KEY);
+    EXPECT_THROW(DecryptRailFenceAlphaParallel(3, "HELLO WORLD", ciphertext, pool), std::runtime_error);
+}
+
+// Any number of rails at least the length of the text leaves it unchanged
+TEST(RailFence, LargeKeyIdentity)
+{
+    const std::string plaintext("WEAREDISCOVEREDFLEEATONCE");
+    std::string ciphertext;
+    std::string decrypted;
+    for (const size_t num_rails : {plaintext.size(), plaintext.size() + 1, size_t(1) << 40, SIZE_MAX})
+    {
+        EncryptRailFenceAlpha(num_rails, plaintext, ciphertext);
+        EXPECT_EQ(ciphertext, plaintext);
+        DecryptRailFenceAlpha(num_rails, ciphertext, decrypted);
+        EXPECT_EQ(decrypted, plaintext);
+
+        std::string text(plaintext);
+        EncryptRailFenceAlphaInPlace(num_rails, text);
+        EXPECT_EQ(text, plaintext);
+    }
+
+    // One rail fewer than the length moves only the last letter
+    EncryptRailFenceAlpha(plaintext.size() - 1, plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, "WEAREDISCOVEREDFLEEATONEC");
+    EXPECT_THROW(EncryptRailFenceAlpha(SIZE_MAX, "HELLO WORLD", ciphertext), std::runtime_error);
+}
+
+// Any bytes are moved the same way as letters
+TEST(RailFence, TransposeBytes)
+{
+    const std::string plaintext("WE ARE\0DISCOVERED\n\xFF", 19);
+    std::string ciphertext(plaintext.size(), '\0');
+    EXPECT_TRUE(TransposeRailFence<false>(3, plaintext.data(), &ciphertext[0], plaintext.size(), nullptr));
+    EXPECT_EQ(ciphertext, std::string("WRIVDEAEDSOEE\n \0CR\xFF", 19));
+
+    std::string decrypted(plaintext.size(), '\0');
+    (void)TransposeRailFence<true>(3, ciphertext.data(), &decrypted[0], ciphertext.size(), nullptr);
+    EXPECT_EQ(decrypted, plaintext);
+    EXPECT_FALSE(TransposeRailFence<false>(3, "HELLO", &decrypted[0], 5, nullptr));
+
+    std::string text(plaintext);
+    TransposeRailFenceInPlace<false>(3, &text[0], text.size());
+    EXPECT_EQ(text, ciphertext);
+    TransposeRailFenceInPlace<true>(3, &text[0], text.size());
+    EXPECT_EQ(text, plaintext);
+}
+
+// Views and raw buffers write into memory owned by the caller, in place or not
+TEST(RailFence, CallerBuffer)
+{
+    const std::string plaintext("WEAREDISCOVEREDFLEEATONCE");
+    char buffer[32] = {};
+    EXPECT_TRUE(TryEncryptRailFenceAlpha(3, std::string_view(plaintext), buffer).Ok());
+    EXPECT_EQ(std::string(buffer, plaintext.size()), "WECRLTEERDSOEEFEAOCAIVDEN");
+    char decrypted[32] = {};
+    EXPECT_TRUE(TryDecryptRailFenceAlpha(3, buffer, decrypted, plaintext.size()).Ok());
+    EXPECT_EQ(std::string(decrypted, plaintext.size()), plaintext);
+
+    // The same buffer for input and output is transposed in place
+    EXPECT_TRUE(TryEncryptRailFenceAlpha(3, decrypted, decrypted, plaintext.size()).Ok());
+    EXPECT_EQ(std::string(decrypted, plaintext.size()), std::string(buffer, plaintext.size()));
+    EXPECT_TRUE(TryDecryptRailFenceAlpha(3, decrypted, decrypted, plaintext.size()).Ok());
+    EXPECT_EQ(std::string(decrypted, plaintext.size()), plaintext);
+
+    CipherResult result = TryEncryptRailFenceAlpha(3, std::string_view("HELLO WORLD"), buffer);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 5U);
+    result = TryDecryptRailFenceAlpha(0, std::string_view("HELLO"), buffer);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_KEY);
+}
+
+// PlainIndex undoes CipherIndex for every letter, with rails of every length
+TEST(RailFence, LayoutPlainIndex)
+{
+    for (const size_t length : {1U, 2U, 5U, 17U, 100U})
+    {
+        for (size_t num_rails = 2; num_rails < length; ++num_rails)
+        {
+            const RailFenceLayout layout(num_rails, length);
+            for (size_t index = 0; index < length; ++index)
+            {
+                ASSERT_EQ(layout.PlainIndex(layout.CipherIndex(index)), index)
+                    << num_rails << " rails, length " << length;
+            }
+        }
+    }
+}
+
+// Chunks are placed as they arrive, and the ready part of the output is already final
+TEST(RailFence, EncoderChunks)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 500; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 7) % 26)));
+    }
+    for (const size_t num_rails : {1U, 2U, 3U, 7U, 499U, 500U})
+    {
+        std::string expected;
+        EncryptRailFenceAlpha(num_rails, plaintext, expected);
+        for (const bool decrypt : {false, true})
+        {
+            const std::string& input = decrypt ? expected : plaintext;
+            const std::string& output = decrypt ? plaintext : expected;
+            std::string result(input.size(), '\0');
+            RailFenceEncoder encoder(num_rails, input.size(), &result[0], decrypt);
+            size_t ready = 0U;
+            for (size_t offset = 0; offset < input.size(); offset += 37)
+            {
+                EXPECT_TRUE(encoder.Update(std::string_view(input).substr(offset, 37)).Ok());
+                ASSERT_GE(encoder.Ready(), ready);
+                ready = encoder.Ready();
+                ASSERT_EQ(result.substr(0, ready), output.substr(0, ready)) << num_rails << " rails";
+            }
+            EXPECT_EQ(encoder.Ready(), input.size());
+            EXPECT_TRUE(encoder.Finish().Ok());
+            EXPECT_EQ(result, output) << num_rails << " rails, decrypt " << decrypt;
+        }
+    }
+
+    // Encrypting WEAREDISCOVERED on 3 rails, each cycle adds a letter to rail 0,
+    // and the last rail holds up the rest until its last letter
+    char buffer[16] = {};
+    RailFenceEncoder encoder(3, 15, buffer);
+    EXPECT_TRUE(encoder.Update("WEAR", 4).Ok());
+    EXPECT_EQ(encoder.Ready(), 1U);
+    EXPECT_TRUE(encoder.Update("EDISCO", 6).Ok());
+    EXPECT_EQ(encoder.Ready(), 3U);
+    EXPECT_TRUE(encoder.Update("VERE", 4).Ok());
+    EXPECT_EQ(encoder.Ready(), 14U);
+    EXPECT_EQ(encoder.Finish().status, CIPHER_STATUS_INVALID_TEXT);
+
+    // Bad letters and text past the declared length are rejected without being placed
+    CipherResult result = encoder.Update("d", 1);
+    EXPECT_EQ(result.offset, 14U);
+    EXPECT_EQ(result.value, 'd');
+    result = encoder.Update("DX", 2);
+    EXPECT_EQ(result.offset, 15U);
+    EXPECT_EQ(result.value, 'X');
+    EXPECT_TRUE(encoder.Update("D", 1).Ok());
+    EXPECT_EQ(encoder.Ready(), 15U);
+    EXPECT_EQ(std::string(buffer, 15), "WECRERDSOEEAIVD");
+    EXPECT_THROW(RailFenceEncoder(0, 15, buffer), std::runtime_error);
+}
+
+// Any window of the plaintext can be decrypted on its own
+TEST(RailFence, DecryptRange)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 300; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 7) % 26)));
+    }
+    for (const size_t num_rails : {1U, 2U, 3U, 7U, 150U, 299U, 300U, 301U})
+    {
+        std::string ciphertext;
+        EncryptRailFenceAlpha(num_rails, plaintext, ciphertext);
+        for (const size_t offset : {0U, 1U, 6U, 150U, 299U, 300U})
+        {
+            for (const size_t count : {0U, 1U, 13U, 300U})
+            {
+                const size_t window = std::min(count, plaintext.size() - offset);
+                std::string result(window, '\0');
+                EXPECT_TRUE(TryDecryptRailFenceAlphaRange(num_rails, ciphertext, offset, window, &result[0]).Ok());
+                EXPECT_EQ(result, plaintext.substr(offset, window)) << "rails " << num_rails << ", offset " << offset;
+            }
+        }
+    }
+
+    // An invalid letter is reported at its place in the ciphertext
+    // WEAREDISCOVERED on 3 rails is WECRERDSOEEAIVD; plaintext offset 5 ('D') is ciphertext offset 6
+    char buffer[16] = {};
+    const CipherResult result = TryDecryptRailFenceAlphaRange(3, "WECRERdSOEEAIVD", 4, 3, buffer);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 6U);
+    EXPECT_EQ(result.value, 'd');
+    EXPECT_EQ(TryDecryptRailFenceAlphaRange(0, "ABCD", 0, 4, buffer).status, CIPHER_STATUS_INVALID_KEY);
+
+    // Any bytes are moved
+    const std::string bytes("a\0 \n\xff\x01z", 7);
+    std::string encrypted(bytes.size(), '\0');
+    (void)TransposeRailFence<false>(3, bytes.data(), &encrypted[0], bytes.size(), nullptr);
+    DecryptRailFenceRange(3, encrypted, 2, 4, buffer);
+    EXPECT_EQ(std::string(buffer, 4), bytes.substr(2, 4));
+}
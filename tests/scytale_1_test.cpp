@@ -8,12 +8,24 @@ Description:
 
 
 /* ===== Includes ===== */
+#include <algorithm>
 #include <climits>
+#include <string_view>
 #include <gtest/gtest.h>
 #include "scytale_cipher.hpp"
 
 using cipher::EncryptScytaleAlpha;
 using cipher::DecryptScytaleAlpha;
+using cipher::EncryptScytaleAlphaInPlace;
+using cipher::DecryptScytaleAlphaInPlace;
+using cipher::TryEncryptScytaleAlpha;
+using cipher::TryDecryptScytaleAlpha;
+using cipher::CIPHER_STATUS_INVALID_KEY;
+using cipher::ScytaleEncoder;
+using cipher::ScytaleLayout;
+using cipher::CipherResult;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+using cipher::TryDecryptScytaleAlphaRange;
 
 
 /* ===== Tests ===== */
@@ -66,3 +78,203 @@ TEST(Scytale, DecryptHurtVeryBadly)
     DecryptScytaleAlpha(5, ciphercheck, ciphertext);
     EXPECT_EQ(ciphertext, plaintext);
 }
+
+// Several columns shorter than the rest
+TEST(Scytale, EncryptRaggedColumns)
+{
+    const std::string plaintext("ABCDEFGHIJ");
+    const std::string ciphercheck("AEIBFJCGDH");
+    std::string ciphertext;
+    EncryptScytaleAlpha(4, plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, ciphercheck);
+    std::string decrypted;
+    DecryptScytaleAlpha(4, ciphercheck, decrypted);
+    EXPECT_EQ(decrypted, plaintext);
+}
+
+// Decryption inverts encryption for every width, including large inputs
+TEST(Scytale, RoundTripManyWidths)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 5000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 7) % 26)));
+    }
+    const size_t widths[] = {1, 2, 3, 15, 16, 17, 64, 100, 4999, 5000, 6000};
+    for (const size_t width : widths)
+    {
+        std::string ciphertext;
+        std::string decrypted;
+        EncryptScytaleAlpha(width, plaintext, ciphertext);
+        DecryptScytaleAlpha(width, ciphertext, decrypted);
+        EXPECT_EQ(decrypted, plaintext) << "width " << width;
+    }
+}
+
+// Zero width is an invalid key, and empty text is fine
+TEST(Scytale, InvalidWidthAndEmpty)
+{
+    std::string ciphertext;
+    EXPECT_THROW(EncryptScytaleAlpha(0, "HELLO", ciphertext), std::runtime_error);
+    EXPECT_THROW(DecryptScytaleAlpha(0, "HELLO", ciphertext), std::runtime_error);
+    DecryptScytaleAlpha(3, "", ciphertext);
+    EXPECT_EQ(ciphertext, "");
+}
+
+// In-place encryption and decryption match the out of place functions
+TEST(Scytale, InPlace)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 1000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 11) % 26)));
+    }
+    const size_t widths[] = {1, 2, 7, 31, 999, 1000, 2000};
+    for (const size_t width : widths)
+    {
+        std::string ciphercheck;
+        EncryptScytaleAlpha(width, plaintext, ciphercheck);
+
+        std::string text(plaintext);
+        EncryptScytaleAlphaInPlace(width, text);
+        EXPECT_EQ(text, ciphercheck) << "width " << width;
+        DecryptScytaleAlphaInPlace(width, text);
+        EXPECT_EQ(text, plaintext) << "width " << width;
+    }
+}
+
+// Any row width at least the length of the text leaves it unchanged
+TEST(Scytale, LargeKeyIdentity)
+{
+    const std::string plaintext("HELLOGOODBYEHELLOGOODBYE");
+    std::string ciphertext;
+    std::string decrypted;
+    for (const size_t row_width : {plaintext.size(), plaintext.size() + 1, size_t(1) << 40, SIZE_MAX})
+    {
+        EncryptScytaleAlpha(row_width, plaintext, ciphertext);
+        EXPECT_EQ(ciphertext, plaintext);
+        DecryptScytaleAlpha(row_width, ciphertext, decrypted);
+        EXPECT_EQ(decrypted, plaintext);
+
+        std::string text(plaintext);
+        EncryptScytaleAlphaInPlace(row_width, text);
+        EXPECT_EQ(text, plaintext);
+    }
+
+    // One column fewer than the length moves only the last letter
+    EncryptScytaleAlpha(plaintext.size() - 1, plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, "HEELLOGOODBYEHELLOGOODBY");
+    DecryptScytaleAlpha(plaintext.size() - 1, ciphertext, decrypted);
+    EXPECT_EQ(decrypted, plaintext);
+}
+
+// Views and raw buffers write into memory owned by the caller, in place or not
+TEST(Scytale, CallerBuffer)
+{
+    const std::string plaintext("IAMHURTVERYBADLYHELP");
+    char buffer[32] = {};
+    EXPECT_TRUE(TryEncryptScytaleAlpha(5, std::string_view(plaintext), buffer).Ok());
+    std::string ciphercheck;
+    EncryptScytaleAlpha(5, plaintext, ciphercheck);
+    EXPECT_EQ(std::string(buffer, plaintext.size()), ciphercheck);
+    char decrypted[32] = {};
+    EXPECT_TRUE(TryDecryptScytaleAlpha(5, buffer, decrypted, plaintext.size()).Ok());
+    EXPECT_EQ(std::string(decrypted, plaintext.size()), plaintext);
+
+    // The same buffer for input and output is transposed in place
+    EXPECT_TRUE(TryEncryptScytaleAlpha(5, decrypted, decrypted, plaintext.size()).Ok());
+    EXPECT_EQ(std::string(decrypted, plaintext.size()), ciphercheck);
+    EXPECT_TRUE(TryDecryptScytaleAlpha(5, decrypted, decrypted, plaintext.size()).Ok());
+    EXPECT_EQ(std::string(decrypted, plaintext.size()), plaintext);
+
+    EXPECT_EQ(TryEncryptScytaleAlpha(0, std::string_view("HELLO"), buffer).status, CIPHER_STATUS_INVALID_KEY);
+    EXPECT_EQ(TryDecryptScytaleAlpha(0, buffer, buffer, 5).status, CIPHER_STATUS_INVALID_KEY);
+}
+
+// PlainIndex undoes CipherIndex for every letter, with any row width
+TEST(Scytale, LayoutPlainIndex)
+{
+    for (const size_t length : {1U, 2U, 5U, 17U, 100U})
+    {
+        for (size_t row_width = 1; row_width <= length + 1; ++row_width)
+        {
+            const ScytaleLayout layout(row_width, length);
+            for (size_t index = 0; index < length; ++index)
+            {
+                ASSERT_EQ(layout.PlainIndex(layout.CipherIndex(index)), index)
+                    << "width " << row_width << ", length " << length;
+            }
+        }
+    }
+}
+
+// Chunks are placed as they arrive, and the ready part of the output is already final
+TEST(Scytale, EncoderChunks)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 500; ++index)
+    {
+        plaintext.push_back(static_cast<char>(index));
+    }
+    for (const size_t row_width : {1U, 2U, 7U, 499U, 500U, 501U})
+    {
+        std::string expected;
+        EncryptScytaleAlpha(row_width, plaintext, expected);
+        for (const bool decrypt : {false, true})
+        {
+            const std::string& input = decrypt ? expected : plaintext;
+            const std::string& output = decrypt ? plaintext : expected;
+            std::string result(input.size(), '\0');
+            ScytaleEncoder encoder(row_width, input.size(), &result[0], decrypt);
+            size_t ready = 0U;
+            for (size_t offset = 0; offset < input.size(); offset += 37)
+            {
+                EXPECT_TRUE(encoder.Update(std::string_view(input).substr(offset, 37)).Ok());
+                ASSERT_GE(encoder.Ready(), ready);
+                ready = encoder.Ready();
+                ASSERT_EQ(result.substr(0, ready), output.substr(0, ready)) << "width " << row_width;
+            }
+            EXPECT_EQ(encoder.Ready(), input.size());
+            EXPECT_TRUE(encoder.Finish().Ok());
+            EXPECT_EQ(result, output) << "width " << row_width << ", decrypt " << decrypt;
+        }
+    }
+
+    // Text past the declared length is rejected, and a short message is reported by Finish
+    char buffer[8] = {};
+    ScytaleEncoder encoder(2, 4, buffer);
+    const CipherResult result = encoder.Update("ABCDE", 5);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 4U);
+    EXPECT_TRUE(encoder.Update("ABC", 3).Ok());
+    EXPECT_EQ(encoder.Ready(), 3U);
+    EXPECT_EQ(encoder.Finish().offset, 3U);
+    EXPECT_THROW(ScytaleEncoder(0, 4, buffer), std::runtime_error);
+}
+
+// Any window of the plaintext can be decrypted on its own
+TEST(Scytale, DecryptRange)
+{
+    std::string plaintext;
+    for (size_t index = 0; index < 300; ++index)
+    {
+        plaintext.push_back(static_cast<char>(index));
+    }
+    for (const size_t row_width : {1U, 2U, 7U, 299U, 300U, 301U})
+    {
+        std::string ciphertext;
+        EncryptScytaleAlpha(row_width, plaintext, ciphertext);
+        for (const size_t offset : {0U, 1U, 6U, 150U, 299U, 300U})
+        {
+            for (const size_t count : {0U, 1U, 13U, 300U})
+            {
+                const size_t window = std::min(count, plaintext.size() - offset);
+                std::string result(window, '\0');
+                EXPECT_TRUE(TryDecryptScytaleAlphaRange(row_width, ciphertext, offset, window, &result[0]).Ok());
+                EXPECT_EQ(result, plaintext.substr(offset, window)) << "width " << row_width << ", offset " << offset;
+            }
+        }
+    }
+    char buffer[4] = {};
+    EXPECT_EQ(TryDecryptScytaleAlphaRange(0, "ABCD", 0, 4, buffer).status, CIPHER_STATUS_INVALID_KEY);
+}
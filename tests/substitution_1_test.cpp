@@ -0,0 +1,128 @@
+/************************************************************\
+Filename:   substitution_1_test.cpp
+Author:     Adrian Padin (padin.adrian@gmail.com)
+Description:
+    Unit tests for substitution cipher
+
+\************************************************************/
+
+
+/* ===== Includes ===== */
+#include <climits>
+#include <string_view>
+#include <gtest/gtest.h>
+#include "caesar_cipher.hpp"
+#include "substitution_cipher.hpp"
+
+using cipher::EncryptCaesarAlpha;
+using cipher::EncryptSubstitutionAlpha;
+using cipher::DecryptSubstitutionAlpha;
+using cipher::SubstitutionCipher;
+using cipher::EncryptSubstitutionMixed;
+using cipher::DecryptSubstitutionMixed;
+using cipher::TryEncryptSubstitutionAlpha;
+using cipher::TryDecryptSubstitutionAlpha;
+using cipher::CipherResult;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+
+
+/* ===== Tests ===== */
+
+// Identity test - plain alphabet as the cipher alphabet
+TEST(Substitution, Identity1)
+{
+    const SubstitutionCipher cipher("ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    const std::string plaintext("HELLOWORLD");
+    std::string ciphertext;
+    EncryptSubstitutionAlpha(cipher, plaintext, ciphertext);
+    EXPECT_EQ(plaintext, ciphertext);
+}
+
+// Keyed alphabet example from header
+TEST(Substitution, KeywordZebras)
+{
+    const SubstitutionCipher cipher = SubstitutionCipher::FromKeyword("ZEBRAS");
+    EXPECT_EQ(cipher.Alphabet(), "ZEBRASCDFGHIJKLMNOPQTUVWXY");
+
+    std::string ciphertext;
+    EncryptSubstitutionAlpha(cipher, "FLEEATONCE", ciphertext);
+    EXPECT_EQ(ciphertext, "SIAAZQLKBA");
+    DecryptSubstitutionAlpha(cipher, ciphertext, ciphertext);
+    EXPECT_EQ(ciphertext, "FLEEATONCE");
+}
+
+// Atbash reverses the alphabet
+TEST(Substitution, Atbash)
+{
+    EXPECT_EQ(SubstitutionCipher::Atbash().Alphabet(), "ZYXWVUTSRQPONMLKJIHGFEDCBA");
+}
+
+// Affine cipher example from Wikipedia: https://en.wikipedia.org/wiki/Affine_cipher
+TEST(Substitution, AffineAffineCipher)
+{
+    const SubstitutionCipher cipher = SubstitutionCipher::Affine(5, 8);
+    std::string ciphertext;
+    EncryptSubstitutionAlpha(cipher, "AFFINECIPHER", ciphertext);
+    EXPECT_EQ(ciphertext, "IHHWVCSWFRCP");
+    EXPECT_THROW(SubstitutionCipher::Affine(13, 1), std::runtime_error);
+    EXPECT_THROW(SubstitutionCipher::Affine(4, 1), std::runtime_error);
+}
+
+// A long message through the Caesar special case matches the Caesar cipher
+TEST(Substitution, CaesarMatchesLongText)
+{
+    std::string plaintext;
+    for (int repeat = 0; repeat < 20; ++repeat)
+    {
+        plaintext += "THEQUICKBROWNFOXJUMPEDOVERTHELAZYDOG";
+    }
+    std::string ciphertext;
+    std::string ciphercheck;
+    EncryptSubstitutionAlpha(SubstitutionCipher::Caesar('K'), plaintext, ciphertext);
+    EncryptCaesarAlpha('K', plaintext, ciphercheck);
+    EXPECT_EQ(ciphertext, ciphercheck);
+}
+
+// Invalid alphabets and text are rejected
+TEST(Substitution, Invalid)
+{
+    EXPECT_THROW(SubstitutionCipher("ABC"), std::runtime_error);
+    EXPECT_THROW(SubstitutionCipher("AACDEFGHIJKLMNOPQRSTUVWXYZ"), std::runtime_error);
+    EXPECT_THROW(SubstitutionCipher::FromKeyword("zebras"), std::runtime_error);
+
+    std::string ciphertext;
+    EXPECT_THROW(EncryptSubstitutionAlpha(SubstitutionCipher::Atbash(), "HELLO WORLD", ciphertext),
+                 std::runtime_error);
+}
+
+// Case-preserving mode substitutes letters of either case and copies everything else
+TEST(Substitution, MixedKeepsCase)
+{
+    const SubstitutionCipher cipher = SubstitutionCipher::Atbash();
+    const std::string plaintext("Hello, World!\n");
+    std::string ciphertext;
+    EncryptSubstitutionMixed(cipher, plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, "Svool, Dliow!\n");
+    DecryptSubstitutionMixed(cipher, ciphertext, ciphertext);
+    EXPECT_EQ(ciphertext, plaintext);
+}
+
+// Views and raw buffers write into memory owned by the caller
+TEST(Substitution, CallerBuffer)
+{
+    const SubstitutionCipher cipher = SubstitutionCipher::Atbash();
+    char buffer[16] = {};
+    EXPECT_TRUE(TryEncryptSubstitutionAlpha(cipher, std::string_view("HELLOWORLD"), buffer).Ok());
+    EXPECT_EQ(std::string(buffer, 10), "SVOOLDLIOW");
+    EXPECT_TRUE(TryDecryptSubstitutionAlpha(cipher, buffer, buffer, 10).Ok());
+    EXPECT_EQ(std::string(buffer, 10), "HELLOWORLD");
+
+    const CipherResult result = TryEncryptSubstitutionAlpha(cipher, std::string_view("HELLO!"), buffer);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 5U);
+
+    EncryptSubstitutionMixed(cipher, std::string_view("Hi, you"), buffer);
+    EXPECT_EQ(std::string(buffer, 7), "Sr, blf");
+    DecryptSubstitutionMixed(cipher, std::string_view(buffer, 7), buffer);
+    EXPECT_EQ(std::string(buffer, 7), "Hi, you");
+}
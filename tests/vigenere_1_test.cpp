@@ -8,12 +8,34 @@ Description:
 
 
 /* ===== Includes ===== */
+#include <algorithm>
 #include <climits>
+#include <string_view>
 #include <gtest/gtest.h>
 #include "vigenere_cipher.hpp"
 
 using cipher::EncryptVigenereAlpha;
 using cipher::DecryptVigenereAlpha;
+using cipher::VigenereKey;
+using cipher::EncryptVigenereBytes;
+using cipher::DecryptVigenereBytes;
+using cipher::EncryptVigenereMixed;
+using cipher::DecryptVigenereMixed;
+using cipher::ShiftVigenereMixedAt;
+using cipher::TryEncryptVigenereAlpha;
+using cipher::TryDecryptVigenereAlpha;
+using cipher::CipherResult;
+using cipher::CIPHER_STATUS_INVALID_TEXT;
+using cipher::VigenereEncoder;
+using cipher::DecryptVigenereBytesRange;
+using cipher::TryDecryptVigenereAlphaRange;
+using cipher::EncryptVigenereAlphaParallel;
+using cipher::DecryptVigenereAlphaParallel;
+using cipher::TryEncryptVigenereAlphaParallel;
+using cipher::ShiftVigenereBytesAt;
+using cipher::ShiftVigenereBytesParallel;
+using cipher::ThreadPool;
+using cipher::VIGENERE_PARALLEL_PIECE;
 
 
 /* ===== Tests ===== */
@@ -88,4 +110,278 @@ TEST(Vigenere, EncryptDecryptRandom)
     EncryptVigenereAlpha(cipherkey, plaintext, plaintext);
     DecryptVigenereAlpha(cipherkey, plaintext, plaintext);
     EXPECT_EQ(plaintext, plaincheck);
-}
\ No newline at end of file
+}
+
+// A compiled key gives the same result as the string key, and can be reused
+TEST(Vigenere, CompiledKeyReuse)
+{
+    const VigenereKey cipherkey("HELLOWORLD");
+    const std::string plaintext("LOISHLDCJLKJDHLIFSUDHFLKSJDHFLISUDHFLISUDFHL");
+    std::string ciphertext;
+    std::string ciphercheck;
+    EncryptVigenereAlpha("HELLOWORLD", plaintext, ciphercheck);
+    for (int repeat = 0; repeat < 3; ++repeat)
+    {
+        EncryptVigenereAlpha(cipherkey, plaintext, ciphertext);
+        EXPECT_EQ(ciphertext, ciphercheck);
+        DecryptVigenereAlpha(cipherkey, ciphertext, ciphertext);
+        EXPECT_EQ(ciphertext, plaintext);
+    }
+}
+
+// Keys longer than the widest vector are repeated correctly
+TEST(Vigenere, CompiledKeyLong)
+{
+    const std::string keyword("THEQUICKBROWNFOXJUMPEDOVERTHELAZYDOGTHEQUICKBROWNFOXJUMPEDOVERTHELAZYDOG");
+    const VigenereKey cipherkey(keyword);
+    EXPECT_EQ(cipherkey.Period(), keyword.size());
+    for (size_t index = 0; index < keyword.size() + 64; ++index)
+    {
+        EXPECT_EQ(cipherkey.EncryptPeriod()[index], keyword[index % keyword.size()] - 'A');
+        EXPECT_EQ((cipherkey.EncryptPeriod()[index] + cipherkey.DecryptPeriod()[index]) % 26, 0);
+    }
+}
+
+// Bad keys are rejected when the key is compiled
+TEST(Vigenere, CompiledKeyInvalid)
+{
+    EXPECT_THROW(VigenereKey(""), std::runtime_error);
+    EXPECT_THROW(VigenereKey("HELLO1"), std::runtime_error);
+    EXPECT_THROW(VigenereKey("hello"), std::runtime_error);
+}
+
+// The non-throwing functions report the first invalid character
+TEST(Vigenere, TryInvalidText)
+{
+    const VigenereKey cipherkey("LEMON");
+    std::string ciphertext;
+    EXPECT_TRUE(TryEncryptVigenereAlpha(cipherkey, "ATTACKATDAWN", ciphertext).Ok());
+    EXPECT_EQ(ciphertext, "LXFOPVEFRNHR");
+
+    const CipherResult result = TryDecryptVigenereAlpha(cipherkey, "LXFOPVEFRNHR\n", ciphertext);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 12U);
+    EXPECT_EQ(result.value, '\n');
+}
+
+// Case-preserving mode only advances the key on letters
+TEST(Vigenere, MixedKeyAdvancesOnLetters)
+{
+    const VigenereKey cipherkey("LEMON");
+    const std::string plaintext("Attack at dawn, 6am!");
+    std::string ciphertext;
+    EncryptVigenereMixed(cipherkey, plaintext, ciphertext);
+    EXPECT_EQ(ciphertext, "Lxfopv ef rnhr, 6ma!");
+    DecryptVigenereMixed(cipherkey, ciphertext, ciphertext);
+    EXPECT_EQ(ciphertext, plaintext);
+
+    // Pieces pick up the key from the number of letters before them
+    std::string pieces(plaintext.size(), '\0');
+    size_t letters = 0;
+    for (size_t offset = 0; offset < plaintext.size(); offset += 3)
+    {
+        const size_t length = std::min<size_t>(3, plaintext.size() - offset);
+        letters += ShiftVigenereMixedAt(cipherkey.EncryptPeriod(), cipherkey.Period(), letters,
+                                        plaintext.data() + offset, &pieces[offset], length);
+    }
+    EXPECT_EQ(letters, 14U);
+    EXPECT_EQ(pieces, "Lxfopv ef rnhr, 6ma!");
+}
+
+// Binary data is shifted modulo 256 and comes back unchanged
+TEST(Vigenere, BytesRoundTrip)
+{
+    const VigenereKey cipherkey("LEMON");
+    std::string plaintext;
+    for (int value = 0; value < 256; ++value)
+    {
+        plaintext.push_back(static_cast<char>(value));
+    }
+    std::string ciphertext;
+    EncryptVigenereBytes(cipherkey, plaintext, ciphertext);
+    ASSERT_EQ(ciphertext.size(), 256U);
+    EXPECT_EQ(ciphertext[0], static_cast<char>(11));
+    EXPECT_EQ(ciphertext[' '], static_cast<char>(' ' + 12));
+    EXPECT_EQ(ciphertext[254], static_cast<char>(254 + 13 - 256));
+
+    std::string decrypted;
+    DecryptVigenereBytes(cipherkey, ciphertext, decrypted);
+    EXPECT_EQ(decrypted, plaintext);
+}
+
+// Views and raw buffers write into memory owned by the caller
+TEST(Vigenere, CallerBuffer)
+{
+    const VigenereKey cipherkey("LEMON");
+    char buffer[16] = {};
+    EXPECT_TRUE(TryEncryptVigenereAlpha(cipherkey, std::string_view("ATTACKATDAWN"), buffer).Ok());
+    EXPECT_EQ(std::string(buffer, 12), "LXFOPVEFRNHR");
+    EXPECT_TRUE(TryDecryptVigenereAlpha(cipherkey, buffer, buffer, 12).Ok());
+    EXPECT_EQ(std::string(buffer, 12), "ATTACKATDAWN");
+
+    const CipherResult result = TryDecryptVigenereAlpha(cipherkey, std::string_view("LXFOPVEFRNHr"), buffer);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 11U);
+
+    EncryptVigenereMixed(cipherkey, std::string_view("At, dawn"), buffer);
+    EXPECT_EQ(std::string(buffer, 8), "Lx, pojy");
+    DecryptVigenereMixed(cipherkey, std::string_view(buffer, 8), buffer);
+    EXPECT_EQ(std::string(buffer, 8), "At, dawn");
+    EncryptVigenereBytes(cipherkey, std::string_view("\xFF\xFF", 2), buffer);
+    EXPECT_EQ(std::string(buffer, 2), "\x0A\x03");
+    DecryptVigenereBytes(cipherkey, std::string_view(buffer, 2), buffer);
+    EXPECT_EQ(std::string(buffer, 2), "\xFF\xFF");
+}
+
+// Chunks of any size carry the key phase over, and each message starts from the first key letter
+TEST(Vigenere, EncoderChunks)
+{
+    const VigenereKey cipherkey("LEMON");
+    std::string plaintext;
+    for (size_t index = 0; index < 1000; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 7) % 26)));
+    }
+    std::string expected;
+    EncryptVigenereAlpha(cipherkey, plaintext, expected);
+
+    VigenereEncoder encoder(cipherkey);
+    VigenereEncoder decoder(cipherkey, true);
+    for (const size_t chunk_size : {1U, 3U, 64U, 333U, 1000U})
+    {
+        std::string ciphertext(plaintext.size(), '\0');
+        std::string decrypted(plaintext.size(), '\0');
+        for (size_t offset = 0; offset < plaintext.size(); offset += chunk_size)
+        {
+            const size_t length = std::min(chunk_size, plaintext.size() - offset);
+            EXPECT_TRUE(encoder.Update(plaintext.data() + offset, &ciphertext[offset], length).Ok());
+            EXPECT_TRUE(decoder.Update(std::string_view(ciphertext).substr(offset, length), &decrypted[offset]).Ok());
+        }
+        EXPECT_EQ(ciphertext, expected) << "chunk size " << chunk_size;
+        EXPECT_EQ(decrypted, plaintext) << "chunk size " << chunk_size;
+        EXPECT_EQ(encoder.Finish(), plaintext.size());
+        EXPECT_EQ(decoder.Finish(), plaintext.size());
+    }
+
+    // An error is reported at its offset in the message, which does not move on
+    char buffer[8] = {};
+    EXPECT_TRUE(encoder.Update("ATTACK", buffer, 6).Ok());
+    const CipherResult result = encoder.Update("AT DAWN", buffer, 7);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 8U);
+    EXPECT_EQ(encoder.Position(), 6U);
+    EXPECT_TRUE(encoder.Update("ATDAWN", buffer, 6).Ok());
+    EXPECT_EQ(std::string(buffer, 6), "EFRNHR");
+}
+
+// An encoder keeps its own copy of the key, so it can be built from a temporary
+TEST(Vigenere, EncoderTemporaryKey)
+{
+    VigenereEncoder encoder(VigenereKey("LEMON"));
+    VigenereEncoder decoder(VigenereKey("LEMON"), true);
+    std::string buffer("ATTACKATDAWN");
+    EXPECT_TRUE(encoder.Update(buffer.data(), &buffer[0], buffer.size()).Ok());
+    EXPECT_EQ(buffer, "LXFOPVEFRNHR");
+
+    // A copy goes on from the same position, even once the original is gone
+    VigenereEncoder copy(decoder);
+    decoder = VigenereEncoder(VigenereKey("ZZZZZ"));
+    EXPECT_TRUE(copy.Update(buffer.data(), &buffer[0], buffer.size()).Ok());
+    EXPECT_EQ(buffer, "ATTACKATDAWN");
+}
+
+// The key phase of a window comes from its offset
+TEST(Vigenere, DecryptRange)
+{
+    const VigenereKey key("LEMON");
+    std::string plaintext;
+    for (size_t index = 0; index < 300; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 11) % 26)));
+    }
+    std::string ciphertext;
+    EncryptVigenereAlpha(key, plaintext, ciphertext);
+    for (const size_t offset : {0U, 1U, 4U, 5U, 151U, 299U, 300U})
+    {
+        for (const size_t count : {0U, 1U, 13U, 300U})
+        {
+            const size_t window = std::min(count, plaintext.size() - offset);
+            std::string result(window, '\0');
+            EXPECT_TRUE(TryDecryptVigenereAlphaRange(key, ciphertext, offset, window, &result[0]).Ok());
+            EXPECT_EQ(result, plaintext.substr(offset, window)) << "offset " << offset;
+        }
+    }
+
+    // An invalid letter is reported at its place in the ciphertext
+    ciphertext[200] = '7';
+    char buffer[16] = {};
+    const CipherResult result = TryDecryptVigenereAlphaRange(key, ciphertext, 195, 10, buffer);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 200U);
+    EXPECT_EQ(result.value, '7');
+
+    // Binary data too
+    std::string bytes;
+    for (size_t index = 0; index < 256; ++index)
+    {
+        bytes.push_back(static_cast<char>(index));
+    }
+    std::string encrypted;
+    EncryptVigenereBytes(key, bytes, encrypted);
+    DecryptVigenereBytesRange(key, encrypted, 103, 16, buffer);
+    EXPECT_EQ(std::string(buffer, 16), bytes.substr(103, 16));
+}
+
+// The parallel engine gives the same output as the serial one for every length and key
+TEST(Vigenere, ParallelMatchesSerial)
+{
+    ThreadPool pool(4);
+    std::string plaintext;
+    for (size_t index = 0; index < (5 * VIGENERE_PARALLEL_PIECE) + 321; ++index)
+    {
+        plaintext.push_back(static_cast<char>('A' + ((index * 7) % 26)));
+    }
+
+    // Key lengths that do and don't divide the piece size
+    const size_t lengths[] = {0, 1, VIGENERE_PARALLEL_PIECE - 1, VIGENERE_PARALLEL_PIECE + 1, plaintext.size()};
+    for (const char* keyword : {"B", "LEMON", "ABCDEFGHIJKLMNOPQRSTUVWXYZQ"})
+    {
+        const VigenereKey key(keyword);
+        for (const size_t length : lengths)
+        {
+            const std::string text = plaintext.substr(0, length);
+            std::string ciphercheck;
+            std::string ciphertext;
+            std::string decrypted;
+            EncryptVigenereAlpha(key, text, ciphercheck);
+            EncryptVigenereAlphaParallel(key, text, ciphertext, pool);
+            EXPECT_TRUE(ciphertext == ciphercheck) << keyword << ", length " << length;
+            DecryptVigenereAlphaParallel(key, ciphertext, decrypted, pool);
+            EXPECT_TRUE(decrypted == text) << keyword << ", length " << length;
+        }
+
+        // A piece of a longer text takes its phase from its offset, and bytes work the same way
+        std::string bytes(plaintext.size(), '\0');
+        std::string bytecheck(plaintext.size(), '\0');
+        ShiftVigenereBytesAt(key.EncryptPeriod(), key.Period(), 12345, plaintext.data(), &bytecheck[0], plaintext.size());
+        ShiftVigenereBytesParallel(key.EncryptPeriod(), key.Period(), 12345,
+                                   plaintext.data(), &bytes[0], plaintext.size(), &pool);
+        EXPECT_TRUE(bytes == bytecheck) << keyword;
+    }
+}
+
+// The parallel engine reports the first invalid character
+TEST(Vigenere, ParallelInvalid)
+{
+    ThreadPool pool(4);
+    std::string text(300000, 'A');
+    text[123456] = 'a';
+    text[200000] = ' ';
+    std::string ciphertext;
+    const CipherResult result = TryEncryptVigenereAlphaParallel(VigenereKey("LEMON"), text, ciphertext, pool);
+    EXPECT_EQ(result.status, CIPHER_STATUS_INVALID_TEXT);
+    EXPECT_EQ(result.offset, 123456U);
+    EXPECT_EQ(result.value, 'a');
+    EXPECT_THROW(DecryptVigenereAlphaParallel(VigenereKey("LEMON"), "HELLO WORLD", ciphertext, pool),
+                 std::runtime_error);
+}